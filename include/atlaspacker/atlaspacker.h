@@ -32,28 +32,75 @@ typedef struct apImage {
     const char*     path;
     const uint8_t*  data;
     apSize          dimensions;  // Original dimensions
+    apRect          trim;        // The part of the original image that is packed. Defaults to the full image
     apRect          placement;   // The placement in the atlas
     int             width;
     int             height;
     int             channels;
     int             rotation;    // Degrees CCW: 0, 90, 180, 270
+    int             flip;        // 1 if the image is mirrored horizontally (before the rotation is applied)
     int             page;
+    int             extrude;     // Number of texels the borders are extended outside of the placement when rendering
+    int             group;       // Images in the same (non zero) group are kept on as few pages as possible
+    float           weight;      // Usage frequency. Images (or groups) with a higher weight are packed first, i.e. on the first page
+    int             has_alpha;   // Set by apPackImages: 1 if the image has 4 channels, and any texel isn't fully opaque (or there's no data)
 
     apPosf*         vertices;
     int             num_vertices;
+
+    // The part of the page mesh that belongs to this image (see apCreateMeshes).
+    // The indices are page vertex indices, i.e. they already include mesh_first_vertex
+    int             mesh_first_vertex;
+    int             mesh_num_vertices;
+    int             mesh_first_index;
+    int             mesh_num_indices;
 } apImage;
 
+// An indexed triangle list
+typedef struct apMesh
+{
+    apPosf*         vertices;
+    uint16_t*       indices;      // If the mesh has at most 65536 vertices
+    uint32_t*       indices32;    // Otherwise (only page meshes can be this large)
+    int             num_vertices;
+    int             num_indices;
+} apMesh;
+
 typedef struct apPage {
     struct apPage*  next;
     struct apImage* first_image;
     struct apImage* last_image;
     apSize          dimensions;
     int             index;
+    int             num_channels; // The number of channels needed to render the page. Opaque RGBA images only need 3
+    apMesh          mesh;         // The meshes of all images in the page, one after the other (see apCreateMeshes)
 } apPage;
 
+// How a page grows when the images don't fit (only used when apOptions::page_size is 0)
+typedef enum
+{
+    AP_GROW_POWER_OF_TWO = 0,   // Doubles the smaller side. The page sizes stay powers of two
+    AP_GROW_FIXED_STEP,         // Adds apOptions::grow_step texels to the smaller side
+    AP_GROW_GOLDEN_RATIO,       // Scales the smaller side by ~1.618
+} apGrowPolicy;
+
+// How images with different channel counts are distributed over the pages
+typedef enum
+{
+    AP_CHANNELS_MIXED = 0,      // Any image can go on any page
+    AP_CHANNELS_SEPARATE,       // Each page only holds images with the same number of channels
+    AP_CHANNELS_SEPARATE_ALPHA, // Images with alpha (see apImage::has_alpha) are kept on different pages than the opaque images
+} apChannelPolicy;
+
 typedef struct
 {
-    int page_size;
+    int             page_size;
+    apGrowPolicy    grow_policy;
+    int             grow_step;      // Used with AP_GROW_FIXED_STEP. Default 128
+    int             shrink_to_fit;  // After packing, crops each page to the used area (rounded up to a power of two for AP_GROW_POWER_OF_TWO)
+    int             max_page_width; // If non zero, the pages won't grow beyond this size, but spill over to new pages instead
+    int             max_page_height;
+    apChannelPolicy channel_policy;
 } apOptions;
 
 typedef struct {
@@ -63,7 +110,7 @@ typedef struct {
     int                 num_images;
     apPage*             pages;
     int                 num_pages;
-    int                 num_channels; // Max of the number of channels of each image
+    int                 num_channels; // Max of the number of channels of each image (see also apPage::num_channels)
     struct _apPacker*   packer;
 } apContext;
 
@@ -75,6 +122,17 @@ typedef struct _apPacker
     void (*packImages)(struct _apPacker* packer, apContext* ctx);
 } apPacker;
 
+typedef struct
+{
+    int     num_images;
+    int     num_pages;
+    int     num_groups;         // Number of distinct non zero groups
+    int     num_split_groups;   // Number of groups that span more than one page
+    int     max_group_pages;    // The largest number of pages that a group spans
+    float   occupancy;          // The area of the placements divided by the area of the pages
+    float   page0_residency;    // The fraction of the total weight that is placed on the first page (each image weighs 1 if no weights are set)
+} apStats;
+
 #pragma options align=reset
 
 /////////////////////////////////////////////////////////
@@ -82,6 +140,10 @@ void        apSetDefaultOptions(apOptions* options);
 apContext*  apCreate(apOptions* options, apPacker* packer);
 void        apDestroy(apContext* ctx);
 apImage*    apAddImage(apContext* ctx, const char* path, int width, int height, int channels, const uint8_t* data);
+// Images that are drawn together (e.g. the frames of an animation) should use the same group, to minimize texture switches.
+// Group 0 means no group
+apImage*    apAddImageToGroup(apContext* ctx, const char* path, int width, int height, int channels, const uint8_t* data, int group);
+// The images are packed in group and weight order, but keep the order they were added in
 void        apPackImages(apContext* ctx);
 
 // Get number of pages
@@ -89,6 +151,11 @@ int         apGetNumPages(apContext* ctx);
 apPage*     apGetPage(apContext* ctx, int page_index);
 apImage*    apPageGetFirstImage(apPage* page);
 
+// Gets statistics of the last packing
+void        apGetStats(apContext* ctx, apStats* stats);
+// Returns the number of pages that the images of a group are placed in
+int         apGetGroupNumPages(apContext* ctx, int group);
+
 
 // Render functions
 
@@ -96,6 +163,17 @@ void        apCopyRGBA(uint8_t* dest, int dest_width, int dest_height, int dest_
                         const uint8_t* source, int source_width, int source_height, int source_channels,
                         int dest_x, int dest_y, int rotation);
 
+// Copies the packed part of the image (see apImage::trim) to its placement in the page,
+// using the rotation and flip of the image.
+// The border texels are repeated apImage::extrude texels outside of the placement.
+// Transparent source texels are skipped
+void        apRenderImage(uint8_t* dest, int dest_width, int dest_height, int dest_channels, const apImage* image);
+
+// Calculates the bounding box of the texels with a non zero alpha.
+// Images without an alpha channel are considered opaque.
+// Returns 0 if the image is fully transparent
+int         apCalcAlphaRect(const uint8_t* image, int width, int height, int num_channels, apRect* rect);
+
 // Creates an image where all the rgba -> 0 or 1.
 // It also dilates the image if necessary.
 // This image is used when creating hulls around the image
@@ -108,16 +186,24 @@ uint8_t*    apCreateHullImage(const uint8_t* image, uint32_t width, uint32_t hei
 // Internal
 
 apPage*     apAllocPage(apContext* ctx);
+// Frees the last allocated page, which must not have any images yet
+void        apFreeLastPage(apContext* ctx);
 // links the image with a certain page
 void        apPageAddImage(apPage* page, apImage* image);
 
 uint64_t    apGetTime(); // for profiling
 
+// Returns the next page size according to the grow policy. The grown side is rounded up to a multiple of 'multiple'.
+// The size is clamped to the max page size, and is returned unchanged if the page cannot grow any more
+apSize      apGrowPageSize(const apOptions* options, apSize size, int multiple);
+
 // Math functions
 uint32_t    apNextPowerOfTwo(uint32_t v);
 
 // Rotates a coord (x,y) in fixed rotations of [0,90,180,270] degrees
 apPos       apRotate(int x, int y, int width, int height, int rotation);
+// Mirrors a coord horizontally (if flip is set), and then rotates it (see apRotate)
+apPos       apTransform(int x, int y, int width, int height, int rotation, int flip);
 
 apPosf      apMathNormalize(apPosf v);
 apPosf      apMathSub(apPosf a, apPosf b);
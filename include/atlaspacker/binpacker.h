@@ -11,13 +11,37 @@
 typedef enum
 {
     AP_BP_MODE_DEFAULT = 0, // Default is whichever enum is also set as 0
-    AP_BP_SKYLINE_BL = 0
+    AP_BP_SKYLINE_BL = 0,
+    AP_BP_MAXRECTS_BSSF,    // MaxRects, Best Short Side Fit
+    AP_BP_MAXRECTS_BAF,     // MaxRects, Best Area Fit
+    AP_BP_MAXRECTS_BL,      // MaxRects, Bottom Left
+    AP_BP_GUILLOTINE,       // Guillotine, Best Area Fit
 } apBinPackMode;
 
+// How the guillotine packer splits the leftover free space after a placement
+typedef enum
+{
+    AP_BP_SPLIT_SHORTER_LEFTOVER_AXIS = 0,
+    AP_BP_SPLIT_LONGER_LEFTOVER_AXIS,
+    AP_BP_SPLIT_MIN_AREA,
+    AP_BP_SPLIT_MAX_AREA,
+    AP_BP_SPLIT_SHORTER_AXIS,
+    AP_BP_SPLIT_LONGER_AXIS,
+} apBinPackGuillotineSplit;
+
 typedef struct
 {
-    apBinPackMode   mode;
-    int             no_rotate;
+    apBinPackMode               mode;
+    int                         no_rotate;
+    apBinPackGuillotineSplit    split;      // Guillotine only. Default AP_BP_SPLIT_SHORTER_LEFTOVER_AXIS
+    int                         no_merge;   // Guillotine only. Don't merge adjacent free rectangles
+    int                         waste_map;  // Skyline only. Keep the gaps below the skyline as free rectangles, and try those first
+    int                         trim;       // Only pack the bounding box of the non transparent texels of each image (see apImage::trim)
+    int                         margin;     // Number of empty texels between the images
+    int                         padding;    // Number of transparent texels around each image (outside of the extruded borders)
+    int                         extrude;    // Number of texels to extrude the image borders (see apImage::extrude)
+    int                         search_page_size;   // Tries many page sizes (also non square), and picks the smallest single page. Only if apOptions::page_size is 0
+    int                         num_threads;        // Number of threads used for the page size search. Default 4
 } apBinPackerOptions;
 
 #pragma options align=reset
@@ -25,3 +49,17 @@ typedef struct
 void      apBinPackerSetDefaultOptions(apBinPackerOptions* options);
 apPacker* apBinPackerCreate(apBinPackerOptions* options);
 void      apBinPackerDestroy(apPacker* packer);
+
+// Online packing of rects into a single page, without a context or any images.
+// E.g. for glyph caches, where the rects arrive one at a time.
+// Once the page is warmed up, inserting rects doesn't allocate any memory.
+typedef struct apBinPackerPage apBinPackerPage;
+
+apBinPackerPage* apBinPackerPageCreate(apBinPackerOptions* options, int width, int height);
+void             apBinPackerPageDestroy(apBinPackerPage* page);
+// Removes all rects from the page (keeps the allocated memory)
+void             apBinPackerPageReset(apBinPackerPage* page);
+// Returns 1 if the rect fit. If the rect was rotated, the rect size is swapped
+int              apBinPackerPageInsert(apBinPackerPage* page, int width, int height, apRect* rect);
+// Returns the used area divided by the page area [0, 1]
+float            apBinPackerPageGetOccupancy(const apBinPackerPage* page);
@@ -0,0 +1,36 @@
+// https://github.com/JCash/atlaspacker
+// License: MIT
+// @2021-@2023 Mathias Westerdahl
+
+#pragma once
+
+#include <stdint.h>
+#include <atlaspacker/atlaspacker.h>
+
+// Traces the outlines of the non zero texels in a bitmap (e.g. from apCreateHullImage).
+// Unlike the convex hulls, the contours follow concave shapes, and also find holes and separate islands.
+
+#pragma pack(1)
+
+typedef struct
+{
+    apPosf* vertices;       // Texel corners, in texel space: [(0,0), (width,height)]
+    int     num_vertices;
+    int     parent;         // For holes, the index of the outer contour the hole is in. -1 for outer contours
+} apContour;
+
+#pragma options align=reset
+
+// Traces the borders between the empty and non empty texels (marching squares on the texel corners).
+// Texels that only touch diagonally belong to separate contours.
+// Outer contours have the same winding as apConvexHullFromImage, and holes have the opposite winding.
+// Every hole has a parent, holes that aren't inside an outer contour are dropped.
+// Returns the number of contours (0 if the image is empty). Free the contours with apContourDestroy
+int     apContourFromImage(const uint8_t* image, int width, int height, apContour** contours);
+
+// Removes vertices (Douglas-Peucker), keeping each contour within max_error texels of the original.
+// Non empty texels are never cut away: outer contours can only grow, and holes can only shrink.
+// The image must be the same as the contours were created from
+void    apContourSimplify(apContour* contours, int num_contours, const uint8_t* image, int width, int height, float max_error);
+
+void    apContourDestroy(apContour* contours, int num_contours);
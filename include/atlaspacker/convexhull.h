@@ -10,10 +10,18 @@
 // May return 0 if it couldn't calculate a hull (i.e. if the image is empty)
 apPosf* apConvexHullFromImage(int num_planes, uint8_t* image, int width, int height, int* num_vertices);
 
+// Calculates the exact convex hull, and then reduces it to an enclosing polygon of at most max_vertices vertices.
+// The vertex count is chosen per image, by minimizing: vertex_cost * num_vertices + area (in texels).
+// I.e. vertex_cost is how much transparent overdraw one vertex is worth.
+// The polygon stays within the image. If it cannot be reduced enough, the bounding box of the texels is returned.
+// The vertices are in the same space and order as apConvexHullFromImage
+// May return 0 if it couldn't calculate a hull (i.e. if the image is empty)
+apPosf* apConvexHullFromImageAdaptive(uint8_t* image, int width, int height, int max_vertices, float vertex_cost, int* num_vertices);
+
 typedef void (*APHullBoxCallback)(void* ctx, int x, int y, int width, int height);
 
-// Takes a bitmap where 0 is empty, and 1 is occupied
-// Temporarily modifies the bitmap (clears bits to 0 to designate the traversal being done)
+// Takes a bitmap where 0 is empty, and non zero is occupied, and splits it into the minimum number
+// of non overlapping boxes. The bitmap isn't modified
 void apHullFindLargestBoxes(int width, int height, uint8_t* data, APHullBoxCallback cbk, void* cbk_ctx);
 
 // May return 0 if it couldn't calculate a hull (i.e. if the image is empty)
@@ -0,0 +1,47 @@
+// https://github.com/JCash/atlaspacker
+// License: MIT
+// @2021-@2023 Mathias Westerdahl
+
+#pragma once
+
+#include <stdint.h>
+#include <atlaspacker/atlaspacker.h>
+
+// A fixed size glyph texture, that evicts the least recently used glyphs when it's full.
+//
+// The texture is divided into a number of horizontal slices, each packed with a skyline packer.
+// When a glyph doesn't fit in any slice, the least recently used slice is cleared
+// (and all its glyphs are evicted), and reused.
+//
+// Apart from the create function, no functions allocate any memory.
+
+#pragma pack(1)
+
+typedef struct
+{
+    uint32_t hits;              // Successful lookups
+    uint32_t misses;            // Failed lookups
+    uint32_t evictions;         // Number of glyphs that were evicted
+    uint32_t page_evictions;    // Number of times a slice was cleared
+    uint32_t num_glyphs;        // Number of glyphs currently in the cache
+} apGlyphCacheStats;
+
+#pragma options align=reset
+
+typedef struct apGlyphCache apGlyphCache;
+
+// num_pages: The number of slices the texture is divided into
+// max_glyphs: The max number of glyphs kept in the cache at any time
+apGlyphCache*   apGlyphCacheCreate(int width, int height, int num_pages, int max_glyphs);
+void            apGlyphCacheDestroy(apGlyphCache* cache);
+
+// Looks up a glyph, and marks it as used. Returns 1 if found.
+// The rect is in texture coordinates
+int             apGlyphCacheFind(apGlyphCache* cache, uint64_t key, apRect* rect);
+
+// Adds a glyph (that isn't already in the cache), evicting glyphs if necessary.
+// Returns 0 if the glyph is larger than a slice.
+// The caller is responsible for uploading the glyph image to the returned rect
+int             apGlyphCacheInsert(apGlyphCache* cache, uint64_t key, int width, int height, apRect* rect);
+
+void            apGlyphCacheGetStats(const apGlyphCache* cache, apGlyphCacheStats* stats);
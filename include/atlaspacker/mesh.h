@@ -0,0 +1,70 @@
+// https://github.com/JCash/atlaspacker
+// License: MIT
+// @2021-@2023 Mathias Westerdahl
+
+#pragma once
+
+#include <stdint.h>
+#include <atlaspacker/atlaspacker.h>
+
+// Creates indexed meshes from triangle lists (e.g. apImage::vertices).
+// Vertices at the same position are welded, and the triangles are split where a vertex
+// lies on the edge of another triangle (a T-junction), so that the edges match up exactly.
+
+// Creates an indexed mesh from a triangle list (3 vertices per triangle).
+// The vertices are in the order they're first used, and the triangles keep their winding.
+// Degenerate triangles are removed.
+// Returns 0 if the mesh has more than 65536 unique vertices.
+// Caller owns the returned memory (see apMeshDestroy)
+int     apMeshFromTriangles(const apPosf* triangles, int num_vertices, apMesh* mesh);
+
+void    apMeshDestroy(apMesh* mesh);
+
+// Creates the mesh of each page (apPage::mesh) from the vertices of the packed images.
+// The mesh of each image is stored contiguously in the page mesh (see apImage::mesh_first_vertex),
+// so each page can be uploaded as one vertex buffer and one index buffer.
+// The indices refer to the page vertices. They are 16 bit (apMesh::indices) if the page has at most 65536 vertices,
+// and 32 bit (apMesh::indices32) otherwise.
+// Call after apPackImages. Returns 0 if any image has more than 65536 vertices
+int     apCreateMeshes(apContext* ctx);
+
+// Compact vertex formats, e.g. for uploading the page meshes to the GPU.
+// The texture coordinates are normalized to the page size: 0 -> 0.0, 65535 -> 1.0
+
+#pragma pack(1)
+
+typedef enum
+{
+    AP_VERTEX_FORMAT_PAGE_U16 = 0,  // apVertexPageU16
+    AP_VERTEX_FORMAT_LOCAL_S16,     // apVertexLocalS16
+} apVertexFormat;
+
+// The position in page texels (rounded to the nearest texel)
+typedef struct
+{
+    uint16_t    x, y;
+    uint16_t    u, v;
+} apVertexPageU16;
+
+// The position in the original image, relative to the pivot, in fixed point (see AP_VERTEX_FIXED_SHIFT)
+typedef struct
+{
+    int16_t     x, y;
+    uint16_t    u, v;
+} apVertexLocalS16;
+
+#pragma options align=reset
+
+// Number of fractional bits of apVertexLocalS16 positions (i.e. 1/16 texel, and a range of +-2048 texels)
+#define AP_VERTEX_FIXED_SHIFT 4
+
+// Writes the vertices of the image mesh (see apImage::mesh_first_vertex) to the caller's buffer,
+// which must have room for apImage::mesh_num_vertices vertices.
+// The pivot is in normalized coordinates of the original image, e.g. (0.5, 0.5) is the center. Only used for local positions.
+// Returns 0 if a position was outside of the range of the format (the position is then clamped)
+int     apMeshWriteImageVertices(const apPage* page, const apImage* image, apVertexFormat format, apPosf pivot, void* vertices);
+
+// Writes the vertices of all images in the page mesh, i.e. apPage::mesh.num_vertices vertices.
+// Returns 0 if a position was outside of the range of the format
+int     apMeshWritePageVertices(const apPage* page, apVertexFormat format, apPosf pivot, void* vertices);
+
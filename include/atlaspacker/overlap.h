@@ -0,0 +1,54 @@
+// https://github.com/JCash/atlaspacker
+// License: MIT
+// @2021-@2023 Mathias Westerdahl
+
+#pragma once
+
+#include <stdint.h>
+#include <atlaspacker/atlaspacker.h>
+
+// Tests one convex polygon against many convex polygons at once (see also apOverlapTest2D).
+// The polygons are stored as structure of arrays, together with their edge normals and bounding boxes,
+// so that each test only needs to project the vertices. The projections use SSE2 or NEON when available.
+
+#pragma pack(1)
+
+typedef struct
+{
+    // The vertices of all polygons, one after the other. Each polygon is padded to a multiple of 4 vertices
+    float*  x;
+    float*  y;
+    // The edge normals (not normalized), one per vertex
+    float*  nx;
+    float*  ny;
+    // The projections of each polygon onto its own edge normals
+    float*  nmin;
+    float*  nmax;
+    int*    offsets;        // The first vertex of each polygon (num_polygons + 1 entries)
+    int*    sizes;          // The number of vertices of each polygon (without the padding)
+
+    // The bounding boxes
+    float*  minx;
+    float*  miny;
+    float*  maxx;
+    float*  maxy;
+
+    int     num_polygons;
+    int     num_vertices;   // Including the padding
+    int     polygon_capacity;
+    int     vertex_capacity;
+} apOverlapBatch;
+
+#pragma options align=reset
+
+apOverlapBatch* apOverlapBatchCreate(void);
+void            apOverlapBatchDestroy(apOverlapBatch* batch);
+void            apOverlapBatchClear(apOverlapBatch* batch);
+
+// Adds a convex polygon (in either winding). Returns the index of the polygon, or -1 if it has no vertices
+int             apOverlapBatchAdd(apOverlapBatch* batch, const apPosf* vertices, int num_vertices);
+
+// Tests the convex polygon against all polygons in the batch.
+// Sets results[i] to 1 if the polygons overlap (or touch), otherwise 0.
+// Returns the number of overlapping polygons (0 if the query polygon has no vertices)
+int             apOverlapBatchTest(const apOverlapBatch* batch, const apPosf* vertices, int num_vertices, uint8_t* results);
@@ -0,0 +1,39 @@
+// https://github.com/JCash/atlaspacker
+// License: MIT
+// @2021-@2023 Mathias Westerdahl
+
+#pragma once
+
+#include <atlaspacker/atlaspacker.h>
+
+// Packs the images by their outlines (concave shapes and holes included), rather than by rectangles or tiles.
+// The placements (see apImage::placement) may overlap, but the non transparent texels of the images never do.
+//
+// Each outline is traced (see apContourFromImage), grown by the padding, and split into convex pieces.
+// The candidate positions for an image are the vertices of the no-fit polygons, i.e. the Minkowski sums of
+// the placed pieces and the mirrored pieces of the image. The candidates are tested bottom left first,
+// against the nearby placed pieces (found with a grid over the page).
+// The intersections of the edges of different no-fit polygons are not candidates, as their number grows quadratically
+// with the number of nearby pieces. So a position where an image would touch two sloped pieces at once is missed,
+// and the image is placed at the next higher vertex instead, leaving a small gap.
+// This is a lot slower than the other packers, and is meant for the final (offline) builds.
+
+#pragma pack(1)
+
+typedef struct
+{
+    int     no_rotate;
+    int     flip;               // Also try the mirrored variants of each image (see apImage::flip). Default 0
+    int     padding;            // Number of texels the outline of each image is grown by. Default 1
+    int     alpha_threshold;    // Values below or equal to this threshold are considered transparent. (range 0-255)
+    float   max_error;          // Max distance (in texels) the simplified outlines may extend outside of the texels. Default 1.5
+    int     search_page_size;   // Repacks the images into smaller single pages, and keeps the smallest. Only if apOptions::page_size is 0
+    int     time_budget;        // Max time (in milliseconds) of the packing and the page size search, not counting the outlines. 0 means no limit (default)
+                                // When it runs out, the remaining images are placed next to each other by their bounding boxes
+} apPolyPackerOptions;
+
+#pragma options align=reset
+
+void      apPolyPackerSetDefaultOptions(apPolyPackerOptions* options);
+apPacker* apPolyPackerCreate(apPolyPackerOptions* options);
+void      apPolyPackerDestroy(apPacker* packer);
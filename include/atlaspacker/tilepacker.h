@@ -14,6 +14,7 @@ typedef struct
     int     tile_size;          // The size in texels. Default 16
     int     padding;            // Internal padding for each image. Default 1
     int     alpha_threshold;    // values below or equal to this threshold are considered transparent. (range 0-255)
+    int     flip;               // Also try the mirrored variants of each image (see apImage::flip). Default 0
 } apTilePackerOptions;
 
 #pragma options align=reset
@@ -27,7 +28,8 @@ int       apTilePackerGetTileSize(apPacker* packer);
 // Each vertex is in range [-0.5, 0.5]
 void      apTilePackerCreateTileImageFromTriangles(apPacker* packer, apImage* image, apPosf* vertices, int num_vertices);
 
-// Takes ownership of the memory!
+// Takes ownership of the memory! The tile image (twidth*theight bytes) must be allocated with malloc(),
+// and is freed together with the image (e.g. in apDestroy). Replaces any previous tile image of the image.
 void      apTilePackerSetTileImage(apPacker* _packer, apImage* _image, int twidth, int theight, uint8_t* timage);
 
 uint8_t*  apTilePackerCreateTileImageFromImage(int tile_size, int width, int height, int channels, uint8_t* src_image, int* twidth, int* theight);
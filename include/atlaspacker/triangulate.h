@@ -0,0 +1,30 @@
+// https://github.com/JCash/atlaspacker
+// License: MIT
+// @2021-@2023 Mathias Westerdahl
+
+#pragma once
+
+#include <stdint.h>
+#include <atlaspacker/atlaspacker.h>
+#include <atlaspacker/contour.h>
+
+// Triangulates simple polygons with holes, using ear clipping.
+// The holes are first bridged to the outer polygon, and for larger polygons,
+// the vertices are indexed with a z-order curve to speed up the ear tests.
+
+// The vertices of the outer polygon come first, followed by the vertices of each hole.
+// The holes must be inside the outer polygon. Either winding is accepted.
+// Returns the number of triangles. The indices (3 per triangle) refer to the vertices,
+// and the triangles have the same winding as the outer polygon.
+// Caller owns the returned memory
+int     apTriangulate(const apPosf* vertices, const int* contour_sizes, int num_contours, int** indices);
+
+// Triangulates each outer contour together with its holes (see apContourFromImage).
+// A contour without a parent, but with the winding of a hole, is skipped.
+// The vertices of all contours are returned in one array.
+// Returns the number of triangles. Caller owns the returned memory
+int     apTriangulateContours(const apContour* contours, int num_contours, apPosf** vertices, int* num_vertices, int** indices);
+
+// Creates a triangle list (3 vertices per triangle), e.g. for apTilePackerCreateTileImageFromTriangles.
+// Caller owns the returned memory
+apPosf* apTriangulateExpand(const apPosf* vertices, const int* indices, int num_triangles);
@@ -72,6 +72,12 @@ CFLAGS="$CFLAGS -g -std=$STDCVERSION -Wall -Iinclude -Isrc -I. -Iexternal -Itest
 CXXFLAGS="$CXXFLAGS -g -std=$STDCXXVERSION -Wall -fno-exceptions -Wno-old-style-cast -Wno-double-promotion -Iinclude -Isrc -I. -Iexternal -Itest $ASAN $PREPROCESS"
 LDFLAGS="$ASAN_LDFLAGS -g -L${BUILD_DIR}"
 
+if [ "$(uname)" != "Windows" ]; then
+    # The bin packer page size search uses pthreads
+    CFLAGS="$CFLAGS -pthread"
+    LDFLAGS="$LDFLAGS -pthread"
+fi
+
 if [ "$CXX" == "clang++" ]; then
     CXXFLAGS="$CXXFLAGS -Wall -Weverything -Wno-poison-system-directories -Wno-global-constructors"
 fi
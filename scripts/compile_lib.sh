@@ -12,6 +12,12 @@ compile_c_file src/atlaspacker.c ${PREFIX}
 compile_c_file src/binpacker.c ${PREFIX}
 compile_c_file src/tilepacker.c ${PREFIX}
 compile_c_file src/convexhull.c ${PREFIX}
+compile_c_file src/glyphcache.c ${PREFIX}
+compile_c_file src/contour.c ${PREFIX}
+compile_c_file src/triangulate.c ${PREFIX}
+compile_c_file src/mesh.c ${PREFIX}
+compile_c_file src/overlap.c ${PREFIX}
+compile_c_file src/polypacker.c ${PREFIX}
 
 # Gathers all object files matching the prefix
 compile_lib atlaspacker ${PREFIX}
@@ -37,3 +37,33 @@ NAME=tilepacker
 compile_cpp_file test/test_${NAME}.cpp test${NAME}
 compile_lib test${NAME} test${NAME}
 link_exe test_${NAME} test${NAME} testutils stb atlaspacker
+
+NAME=glyphcache
+compile_cpp_file test/test_${NAME}.cpp test${NAME}
+compile_lib test${NAME} test${NAME}
+link_exe test_${NAME} test${NAME} testutils stb atlaspacker
+
+NAME=contour
+compile_cpp_file test/test_${NAME}.cpp test${NAME}
+compile_lib test${NAME} test${NAME}
+link_exe test_${NAME} test${NAME} testutils stb atlaspacker
+
+NAME=triangulate
+compile_cpp_file test/test_${NAME}.cpp test${NAME}
+compile_lib test${NAME} test${NAME}
+link_exe test_${NAME} test${NAME} testutils stb atlaspacker
+
+NAME=mesh
+compile_cpp_file test/test_${NAME}.cpp test${NAME}
+compile_lib test${NAME} test${NAME}
+link_exe test_${NAME} test${NAME} testutils stb atlaspacker
+
+NAME=overlap
+compile_cpp_file test/test_${NAME}.cpp test${NAME}
+compile_lib test${NAME} test${NAME}
+link_exe test_${NAME} test${NAME} testutils stb atlaspacker
+
+NAME=polypacker
+compile_cpp_file test/test_${NAME}.cpp test${NAME}
+compile_lib test${NAME} test${NAME}
+link_exe test_${NAME} test${NAME} testutils stb atlaspacker
@@ -7,6 +7,7 @@
 
 #include <assert.h>
 #include <math.h> // sqrtf
+#include <limits.h> // INT_MAX
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h> // printf
@@ -21,6 +22,8 @@ void apSetDefaultOptions(apOptions* options)
 {
     memset(options, 0, sizeof(apOptions));
     options->page_size = 0; // can grow dynamically
+    options->grow_policy = AP_GROW_POWER_OF_TWO;
+    options->grow_step = 128;
 }
 
 apContext* apCreate(apOptions* options, apPacker* packer)
@@ -44,10 +47,26 @@ void apDestroy(apContext* ctx)
         ctx->packer->destroyImage(ctx->packer, ctx->images[i]);
     }
     free((void*)ctx->images);
+
+    apPage* page = ctx->pages;
+    while (page)
+    {
+        apPage* next = page->next;
+        free((void*)page->mesh.vertices);
+        free((void*)page->mesh.indices);
+        free((void*)page->mesh.indices32);
+        free((void*)page);
+        page = next;
+    }
     free((void*)ctx);
 }
 
 apImage* apAddImage(apContext* ctx, const char* path, int width, int height, int channels, const uint8_t* data)
+{
+    return apAddImageToGroup(ctx, path, width, height, channels, data, 0);
+}
+
+apImage* apAddImageToGroup(apContext* ctx, const char* path, int width, int height, int channels, const uint8_t* data, int group)
 {
     if (channels > ctx->num_channels)
         ctx->num_channels = channels;
@@ -59,7 +78,12 @@ apImage* apAddImage(apContext* ctx, const char* path, int width, int height, int
     image->width = width;
     image->height = height;
     image->channels = channels;
+    image->trim.pos.x = 0;
+    image->trim.pos.y = 0;
+    image->trim.size.width = width;
+    image->trim.size.height = height;
     memset(&image->placement, 0, sizeof(image->placement));
+    image->group = group;
 
     ctx->num_images++;
     ctx->images = (apImage**)realloc(ctx->images, sizeof(apImage**)*ctx->num_images);
@@ -68,9 +92,270 @@ apImage* apAddImage(apContext* ctx, const char* path, int width, int height, int
     return image;
 }
 
+apSize apGrowPageSize(const apOptions* options, apSize size, int multiple)
+{
+    int max_width = options->max_page_width > 0 ? options->max_page_width : INT_MAX;
+    int max_height = options->max_page_height > 0 ? options->max_page_height : INT_MAX;
+    max_width = max_width < multiple ? multiple : max_width / multiple * multiple;
+    max_height = max_height < multiple ? multiple : max_height / multiple * multiple;
+
+    // Grow the smaller side, unless it has already reached its limit
+    int grow_width = size.width <= size.height;
+    if (grow_width && size.width >= max_width)
+        grow_width = 0;
+    else if (!grow_width && size.height >= max_height)
+        grow_width = 1;
+
+    int* side = grow_width ? &size.width : &size.height;
+    int limit = grow_width ? max_width : max_height;
+    if (*side >= limit)
+        return size;
+
+    int64_t grown = (int64_t)*side * 2;
+    if (options->grow_policy == AP_GROW_FIXED_STEP)
+        grown = (int64_t)*side + (options->grow_step > 0 ? options->grow_step : 128);
+    else if (options->grow_policy == AP_GROW_GOLDEN_RATIO)
+        grown = (int64_t)ceil(*side * 1.618034);
+
+    grown = ((grown + multiple - 1) / multiple) * multiple;
+    if (grown <= *side)
+        grown = (int64_t)*side + multiple;
+    if (grown > limit)
+        grown = limit;
+    *side = (int)grown;
+    return size;
+}
+
+// Crops the unused columns and rows at the end of each page
+static void apShrinkPages(apContext* ctx)
+{
+    for (apPage* page = ctx->pages; page; page = page->next)
+    {
+        if (!page->first_image)
+            continue;
+
+        float max_x = 0;
+        float max_y = 0;
+        for (apImage* image = page->first_image; image; image = image->next)
+        {
+            max_x = apMathMax(max_x, (float)(image->placement.pos.x + image->placement.size.width + image->extrude));
+            max_y = apMathMax(max_y, (float)(image->placement.pos.y + image->placement.size.height + image->extrude));
+            // The hull vertices may extend outside of the placement
+            for (int v = 0; v < image->num_vertices; ++v)
+            {
+                max_x = apMathMax(max_x, image->vertices[v].x);
+                max_y = apMathMax(max_y, image->vertices[v].y);
+            }
+            if (image == page->last_image)
+                break;
+        }
+
+        int width = (int)ceilf(max_x);
+        int height = (int)ceilf(max_y);
+        if (ctx->options.grow_policy == AP_GROW_POWER_OF_TWO)
+        {
+            width = (int)apNextPowerOfTwo((uint32_t)width);
+            height = (int)apNextPowerOfTwo((uint32_t)height);
+        }
+        if (width < page->dimensions.width)
+            page->dimensions.width = width;
+        if (height < page->dimensions.height)
+            page->dimensions.height = height;
+    }
+}
+
+typedef struct
+{
+    int     group;
+    int     key;
+    int     index;
+    float   weight;
+} apGroupSortItem;
+
+static int apGroupSortOnGroup(const void* _a, const void* _b)
+{
+    const apGroupSortItem* a = (const apGroupSortItem*)_a;
+    const apGroupSortItem* b = (const apGroupSortItem*)_b;
+    if (a->group != b->group)
+        return a->group < b->group ? -1 : 1;
+    return a->index - b->index;
+}
+
+static int apGroupSortOnKey(const void* _a, const void* _b)
+{
+    const apGroupSortItem* a = (const apGroupSortItem*)_a;
+    const apGroupSortItem* b = (const apGroupSortItem*)_b;
+    if (a->weight != b->weight)
+        return a->weight > b->weight ? -1 : 1;
+    if (a->key != b->key)
+        return a->key - b->key;
+    return a->index - b->index;
+}
+
+// Moves the images of each group next to the first image of that group, so the packers see each group as one run.
+// The images (or groups) with a higher weight are moved first, so that they end up on the first page.
+// Otherwise, the order of the images is kept
+static void apOrderImages(apContext* ctx)
+{
+    int num_ordered = 0;
+    for (int i = 0; i < ctx->num_images; ++i)
+        num_ordered += (ctx->images[i]->group != 0 || ctx->images[i]->weight != 0.0f) ? 1 : 0;
+    if (num_ordered == 0)
+        return;
+
+    apGroupSortItem* items = (apGroupSortItem*)malloc(sizeof(apGroupSortItem) * (size_t)ctx->num_images);
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        items[i].group = ctx->images[i]->group;
+        items[i].key = i;
+        items[i].index = i;
+        items[i].weight = ctx->images[i]->weight;
+    }
+
+    // The key of a grouped image is the index of the first image in the group,
+    // and the weight is the sum of the weights in the group
+    qsort(items, (size_t)ctx->num_images, sizeof(apGroupSortItem), apGroupSortOnGroup);
+    for (int start = 0, end = 0; start < ctx->num_images; start = end)
+    {
+        end = start + 1;
+        if (items[start].group != 0)
+        {
+            while (end < ctx->num_images && items[end].group == items[start].group)
+                ++end;
+        }
+
+        float weight = 0.0f;
+        for (int i = start; i < end; ++i)
+            weight += items[i].weight;
+        for (int i = start; i < end; ++i)
+        {
+            items[i].key = items[start].key;
+            items[i].weight = weight;
+        }
+    }
+    qsort(items, (size_t)ctx->num_images, sizeof(apGroupSortItem), apGroupSortOnKey);
+
+    apImage** images = (apImage**)malloc(sizeof(apImage*) * (size_t)ctx->num_images);
+    for (int i = 0; i < ctx->num_images; ++i)
+        images[i] = ctx->images[items[i].index];
+    free((void*)ctx->images);
+    ctx->images = images;
+    free((void*)items);
+}
+
+// Images without alpha can go on RGB pages
+static int apImageHasAlpha(const apImage* image)
+{
+    if (image->channels != 4)
+        return 0;
+    if (!image->data)
+        return 1; // We can't tell, so we have to assume it has
+    size_t num_texels = (size_t)image->width * (size_t)image->height;
+    for (size_t i = 0; i < num_texels; ++i)
+    {
+        if (image->data[i * 4 + 3] != 255)
+            return 1;
+    }
+    return 0;
+}
+
+static int apImageNumPageChannels(const apImage* image)
+{
+    return (image->channels == 4 && !image->has_alpha) ? 3 : image->channels;
+}
+
+static int apImageChannelClass(const apContext* ctx, const apImage* image)
+{
+    if (ctx->options.channel_policy == AP_CHANNELS_SEPARATE_ALPHA)
+        return image->has_alpha;
+    return image->channels;
+}
+
+// Packs each class of images (see apChannelPolicy) separately, so that they end up on different pages.
+// The classes are packed in the order they first appear in, to keep the weight order
+static void apPackImagesByChannels(apContext* ctx)
+{
+    int num_images = ctx->num_images;
+    apImage** images = (apImage**)malloc(sizeof(apImage*) * (size_t)num_images);
+    uint8_t* taken = (uint8_t*)malloc((size_t)num_images);
+    memset(taken, 0, (size_t)num_images);
+
+    int num_sorted = 0;
+    for (int first = 0; first < num_images; ++first)
+    {
+        if (taken[first])
+            continue;
+
+        int start = num_sorted;
+        int image_class = apImageChannelClass(ctx, ctx->images[first]);
+        for (int i = first; i < num_images; ++i)
+        {
+            if (!taken[i] && apImageChannelClass(ctx, ctx->images[i]) == image_class)
+            {
+                taken[i] = 1;
+                images[num_sorted++] = ctx->images[i];
+            }
+        }
+
+        apImage** all_images = ctx->images;
+        ctx->images = images + start;
+        ctx->num_images = num_sorted - start;
+        ctx->packer->packImages(ctx->packer, ctx);
+        ctx->images = all_images;
+        ctx->num_images = num_images;
+    }
+
+    free((void*)ctx->images);
+    ctx->images = images;
+    free((void*)taken);
+}
+
+static void apUpdatePageChannels(apContext* ctx)
+{
+    for (apPage* page = ctx->pages; page; page = page->next)
+    {
+        if (!page->first_image)
+        {
+            page->num_channels = ctx->num_channels;
+            continue;
+        }
+
+        page->num_channels = 0;
+        for (apImage* image = page->first_image; image; image = image->next)
+        {
+            int num_channels = apImageNumPageChannels(image);
+            if (num_channels > page->num_channels)
+                page->num_channels = num_channels;
+            if (image == page->last_image)
+                break;
+        }
+    }
+}
+
 void apPackImages(apContext* ctx)
 {
-    ctx->packer->packImages(ctx->packer, ctx);
+    for (int i = 0; i < ctx->num_images; ++i)
+        ctx->images[i]->has_alpha = apImageHasAlpha(ctx->images[i]);
+
+    // The packers see the images in packing order, but the caller keeps the order they were added in
+    apImage** images = ctx->images;
+    ctx->images = (apImage**)malloc(sizeof(apImage*) * (size_t)(ctx->num_images + 1));
+    memcpy(ctx->images, images, sizeof(apImage*) * (size_t)ctx->num_images);
+
+    apOrderImages(ctx);
+
+    if (ctx->options.channel_policy != AP_CHANNELS_MIXED && ctx->num_images > 0)
+        apPackImagesByChannels(ctx);
+    else
+        ctx->packer->packImages(ctx->packer, ctx);
+
+    free((void*)ctx->images);
+    ctx->images = images;
+
+    apUpdatePageChannels(ctx);
+
+    if (ctx->options.shrink_to_fit)
+        apShrinkPages(ctx);
 }
 
 int apGetNumPages(apContext* ctx)
@@ -108,6 +393,20 @@ apPage* apAllocPage(apContext* ctx)
     return page;
 }
 
+void apFreeLastPage(apContext* ctx)
+{
+    apPage** last = &ctx->pages;
+    while (*last && (*last)->next)
+        last = &(*last)->next;
+    apPage* page = *last;
+    if (!page)
+        return;
+    assert(page->first_image == 0);
+    *last = 0;
+    --ctx->num_pages;
+    free((void*)page);
+}
+
 void apPageAddImage(apPage* page, apImage* image)
 {
     image->page = page->index;
@@ -129,6 +428,98 @@ apImage* apPageGetFirstImage(apPage* page)
     return page->first_image;
 }
 
+static int apGroupSortOnGroupPage(const void* _a, const void* _b)
+{
+    const apGroupSortItem* a = (const apGroupSortItem*)_a;
+    const apGroupSortItem* b = (const apGroupSortItem*)_b;
+    if (a->group != b->group)
+        return a->group < b->group ? -1 : 1;
+    return a->key - b->key;
+}
+
+void apGetStats(apContext* ctx, apStats* stats)
+{
+    memset(stats, 0, sizeof(apStats));
+    stats->num_images = ctx->num_images;
+    stats->num_pages = ctx->num_pages;
+    if (ctx->num_images == 0)
+        return;
+
+    double page_area = 0.0;
+    for (apPage* page = ctx->pages; page; page = page->next)
+        page_area += (double)page->dimensions.width * page->dimensions.height;
+
+    // If no weights are set, each image counts as 1
+    double total_weight = 0.0;
+    for (int i = 0; i < ctx->num_images; ++i)
+        total_weight += ctx->images[i]->weight;
+    int use_weights = total_weight > 0.0;
+
+    double used_area = 0.0;
+    double page0_weight = 0.0;
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        apImage* image = ctx->images[i];
+        if (image->page < 0)
+            continue;
+        used_area += (double)image->placement.size.width * image->placement.size.height;
+        if (image->page == 0)
+            page0_weight += use_weights ? image->weight : 1.0;
+    }
+    stats->occupancy = page_area > 0.0 ? (float)(used_area / page_area) : 0.0f;
+    stats->page0_residency = (float)(page0_weight / (use_weights ? total_weight : ctx->num_images));
+
+    // Sort on group and page, and count the unique pages within each group
+    apGroupSortItem* items = (apGroupSortItem*)malloc(sizeof(apGroupSortItem) * (size_t)ctx->num_images);
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        items[i].group = ctx->images[i]->group;
+        items[i].key = ctx->images[i]->page;
+        items[i].index = i;
+    }
+    qsort(items, (size_t)ctx->num_images, sizeof(apGroupSortItem), apGroupSortOnGroupPage);
+
+    int group_pages = 0;
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        if (items[i].group == 0)
+            continue;
+
+        int new_group = i == 0 || items[i].group != items[i-1].group;
+        if (new_group)
+        {
+            stats->num_groups++;
+            group_pages = 0;
+        }
+        if (new_group || items[i].key != items[i-1].key)
+        {
+            group_pages++;
+            if (group_pages == 2)
+                stats->num_split_groups++;
+            if (group_pages > stats->max_group_pages)
+                stats->max_group_pages = group_pages;
+        }
+    }
+    free((void*)items);
+}
+
+int apGetGroupNumPages(apContext* ctx, int group)
+{
+    uint8_t* used = (uint8_t*)malloc((size_t)ctx->num_pages + 1);
+    memset(used, 0, (size_t)ctx->num_pages + 1);
+    int num_pages = 0;
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        apImage* image = ctx->images[i];
+        if (image->group != group || image->page < 0 || image->page >= ctx->num_pages)
+            continue;
+        num_pages += used[image->page] ? 0 : 1;
+        used[image->page] = 1;
+    }
+    free((void*)used);
+    return num_pages;
+}
+
 apPos apRotate(int x, int y, int width, int height, int rotation)
 {
     apPos pos;
@@ -154,6 +545,13 @@ apPos apRotate(int x, int y, int width, int height, int rotation)
     return pos;
 }
 
+apPos apTransform(int x, int y, int width, int height, int rotation, int flip)
+{
+    if (flip)
+        x = width - 1 - x;
+    return apRotate(x, y, width, height, rotation);
+}
+
 // Copy the source image into the target image
 // Can handle cases where the target texel is outside of the destination
 // Transparent source texels are ignored
@@ -207,6 +605,121 @@ void apCopyRGBA(uint8_t* dest, int dest_width, int dest_height, int dest_channel
     }
 }
 
+void apRenderImage(uint8_t* dest, int dest_width, int dest_height, int dest_channels, const apImage* image)
+{
+    const apRect* trim = &image->trim;
+    int source_channels = image->channels;
+    int source_stride = image->width * source_channels;
+
+    // The flip and rotation is a linear mapping, so we only need the origin and the step for each axis
+    apPos origin = apTransform(0, 0, trim->size.width, trim->size.height, image->rotation, image->flip);
+    apPos stepx = apTransform(1, 0, trim->size.width, trim->size.height, image->rotation, image->flip);
+    apPos stepy = apTransform(0, 1, trim->size.width, trim->size.height, image->rotation, image->flip);
+    stepx.x -= origin.x; stepx.y -= origin.y;
+    stepy.x -= origin.x; stepy.y -= origin.y;
+    origin.x += image->placement.pos.x;
+    origin.y += image->placement.pos.y;
+
+    // The extruded border texels are written in the same pass, by clamping the source coordinates
+    int extrude = image->extrude;
+    int last_x = trim->size.width - 1;
+    int last_y = trim->size.height - 1;
+    for (int y = -extrude; y <= last_y + extrude; ++y)
+    {
+        int sy = y < 0 ? 0 : (y > last_y ? last_y : y);
+        const uint8_t* source_row = image->data + (trim->pos.y + sy) * source_stride + trim->pos.x * source_channels;
+        int target_x = origin.x + y * stepy.x - extrude * stepx.x;
+        int target_y = origin.y + y * stepy.y - extrude * stepx.y;
+        for (int x = -extrude; x <= last_x + extrude; ++x, target_x += stepx.x, target_y += stepx.y)
+        {
+            int sx = x < 0 ? 0 : (x > last_x ? last_x : x);
+            const uint8_t* source = source_row + sx * source_channels;
+            if (source_channels == 4 && source[3] == 0)
+                continue;
+
+            if (target_x < 0 || target_x >= dest_width ||
+                target_y < 0 || target_y >= dest_height)
+                continue;
+
+            uint8_t* target = dest + target_y * dest_width * dest_channels + target_x * dest_channels;
+            for (int c = 0; c < dest_channels; ++c)
+                target[c] = c < source_channels ? source[c] : 255;
+        }
+    }
+}
+
+int apCalcAlphaRect(const uint8_t* image, int width, int height, int num_channels, apRect* rect)
+{
+    rect->pos.x = 0;
+    rect->pos.y = 0;
+    rect->size.width = width;
+    rect->size.height = height;
+    if (num_channels != 4)
+        return 1;
+
+    #define AP_ALPHA(_X, _Y) image[((_Y) * width + (_X)) * 4 + 3]
+
+    // Find the first and last non empty rows
+    int miny = -1;
+    int maxy = -1;
+    for (int y = 0; y < height && miny < 0; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            if (AP_ALPHA(x, y))
+            {
+                miny = y;
+                break;
+            }
+        }
+    }
+    if (miny < 0)
+        return 0;
+
+    for (int y = height-1; y >= miny && maxy < 0; --y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            if (AP_ALPHA(x, y))
+            {
+                maxy = y;
+                break;
+            }
+        }
+    }
+
+    // For each row, we only need to scan the columns outside of the current bounds
+    int minx = width;
+    int maxx = -1;
+    for (int y = miny; y <= maxy; ++y)
+    {
+        for (int x = 0; x < minx; ++x)
+        {
+            if (AP_ALPHA(x, y))
+            {
+                minx = x;
+                break;
+            }
+        }
+        for (int x = width-1; x > maxx; --x)
+        {
+            if (AP_ALPHA(x, y))
+            {
+                maxx = x;
+                break;
+            }
+        }
+    }
+
+    #undef AP_ALPHA
+
+    rect->pos.x = minx;
+    rect->pos.y = miny;
+    rect->size.width = maxx - minx + 1;
+    rect->size.height = maxy - miny + 1;
+    return 1;
+}
+
 // https://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2Float
 uint32_t apNextPowerOfTwo(uint32_t v)
 {
@@ -11,7 +11,13 @@
 #include <string.h>
 #include <limits.h> // INT_MAX
 #include <stdio.h>  // printf
-#include <math.h>   // sqrtf
+#include <math.h>   // sqrt
+
+#if defined(_WIN32)
+    #include <Windows.h> // CreateThread
+#else
+    #include <pthread.h>
+#endif
 
 // The term "skyline" refers to the silhouette of a big city skyline
 // This structure represents one "rooftop" in the skyline
@@ -27,21 +33,96 @@ typedef struct
     int     width;
 } apBinPackSkylineNode;
 
-typedef struct apBinPackerPage
+// A list of indices (or ids)
+typedef struct
+{
+    int*    indices;
+    int     size;
+    int     capacity;
+} apBinPackIndexList;
+
+// An entry in the hash table of the free rectangle corners (see apBinPackFreeList)
+typedef struct
+{
+    int     x;
+    int     y;
+    int     corner;         // One of apBinPackCorner
+    int     index;          // The index of the rectangle, or -1 if the entry is empty
+} apBinPackCornerEntry;
+
+#define AP_BP_NUM_AREA_BUCKETS (64 * 4) // Four buckets per power of two (see apBinPackAreaBucket)
+
+// A set of disjoint free rectangles.
+// The rectangles are grouped on the (log2 of their) area, so that the best area fit only looks at the
+// rectangles of about the right size. Each bucket is sorted on width, so that only the rectangles of about
+// the right shape are visited. A hash table on the corners finds the neighbours to merge with.
+typedef struct
+{
+    apRect*                 rects;          // Unordered
+    int                     size;
+    int                     capacity;
+    apBinPackIndexList      buckets[AP_BP_NUM_AREA_BUCKETS]; // Sorted with apBinPackFreeRectLess()
+    apBinPackCornerEntry*   corners;
+    int                     corners_capacity; // A power of two
+    int                     num_corners;
+} apBinPackFreeList;
+
+struct apBinPackerPage
 {
     struct apBinPackerPage* next;
     apPage*                 page;
+    apBinPackMode           mode;
     apBinPackSkylineNode*   skyline;
     int                     skyline_size;
     int                     skyline_capacity;
-} apBinPackerPage;
+
+    // MaxRects: The list of maximal free rectangles. No rectangle is contained within another.
+    apRect*                 free_rects;
+    int                     free_rects_size;
+    int                     free_rects_capacity;
+    // MaxRects: Scratch list for the rectangles created when splitting
+    apRect*                 new_rects;
+    int                     new_rects_size;
+    int                     new_rects_capacity;
+    // MaxRects: A grid over the page, to find the free rectangles that intersect (or contain) a rectangle.
+    // The cells hold ids, and the ids of removed rectangles are dropped from a cell when it's visited
+    apBinPackIndexList*     cells;
+    int                     cells_capacity;
+    int                     grid_width;
+    int                     grid_height;
+    int                     cell_shift;     // The cells are (1 << cell_shift) texels wide
+    int*                    free_rect_ids;  // The id of each free rectangle
+    int*                    id_slots;       // The index (in free_rects) of each id, or -1 if it was removed
+    int                     num_ids;
+    int                     ids_capacity;
+    int*                    hits;           // Scratch list of free rectangle indices
+    int                     hits_size;
+    int                     hits_capacity;
+
+    // Guillotine: The disjoint free rectangles
+    apBinPackFreeList           free_list;
+    apBinPackGuillotineSplit    split;
+    int                         merge;
+
+    // Skyline: The gaps below the skyline (if enabled)
+    apBinPackFreeList           waste_map;
+    int                         use_waste_map;
+
+    // A summary of the page, used to quickly skip pages that cannot hold a rect.
+    // These are upper bounds, which remain valid as the page fills up
+    apSize                      max_free;   // The largest width/height that may still fit
+    int64_t                     free_area;
+
+    int                         allow_rotate;
+    int                         owns_page;  // If created with apBinPackerPageCreate()
+};
 
 typedef struct
 {
     apPacker            super;
     apBinPackerOptions  options;
-    apBinPackerPage     page;
-    apBinPackerPage*    current_page;
+    apBinPackerPage*    pages;      // All open pages, in page order
+    apBinPackerPage     scratch;    // Used when trying to fit a group of images on a page
 } apBinPacker;
 
 // static void debugSkyline(apBinPackerPage* page)
@@ -238,169 +319,1666 @@ static void apBinPackFixupSkyline(apBinPackerPage* page, int index)
     }
 }
 
-static int apBinPackPackRect(apBinPackerPage* page, int width, int height, int allow_rotate, apRect* rect)
+// ************************************************************************************************************************
+// MaxRects
+//
+// Keeps a list of the maximal free rectangles. When a rect is placed, each free rectangle that intersects it
+// is split into (up to) four new maximal rectangles. Only the newly created rectangles need to be checked
+// for containment, as the surviving rectangles were already pruned against each other.
+// This avoids the O(n^2) pruning pass of the original algorithm.
+//
+// A grid over the page lists the free rectangles overlapping each cell. The rectangles intersecting a placed rect
+// are found from the cells it covers, and a rectangle containing a new rectangle must overlap the cell of its corner.
+// The scoring of the free rectangles (apBinPackMaxRectsFindPosition) is still a scan over the compact array.
+
+static int apBinPackIsMaxRectsMode(apBinPackMode mode)
 {
-	int best_index = apBinPackSkylineBLPackRect(page, width, height, allow_rotate, rect);
-    if (best_index != -1)
+    return mode == AP_BP_MAXRECTS_BSSF || mode == AP_BP_MAXRECTS_BAF || mode == AP_BP_MAXRECTS_BL;
+}
+
+static void apBinPackPushRect(apRect** rects, int* size, int* capacity, const apRect* rect)
+{
+    if (*size == *capacity)
     {
-        apBinPackInsertSkylineNodeFromRect(page, best_index, rect);
-        apBinPackFixupSkyline(page, best_index);
-        return 1;
+        *capacity += 16;
+        *rects = (apRect*)realloc(*rects, *capacity * sizeof(apRect));
     }
-    return 0;
+    (*rects)[(*size)++] = *rect;
 }
 
-static void apBinPackPackGrowPage(apBinPackerPage* page)
+// Returns 1 if b is inside a
+static inline int apBinPackRectContains(const apRect* a, const apRect* b)
 {
-    int prev_width = page->page->dimensions.width;
-    int width = prev_width;
-    int height = page->page->dimensions.height;
-    if (width <= height)
-        width *= 2;
-    else
-        height *= 2;
-    printf("Growing page to %d x %d\n", width, height);
+    return b->pos.x >= a->pos.x && b->pos.y >= a->pos.y &&
+           b->pos.x + b->size.width <= a->pos.x + a->size.width &&
+           b->pos.y + b->size.height <= a->pos.y + a->size.height;
+}
 
-    // if (width > 16384 || height > 16384)
-    //     create new page
+static inline int apBinPackRectIntersects(const apRect* a, const apRect* b)
+{
+    return a->pos.x < b->pos.x + b->size.width && a->pos.x + a->size.width > b->pos.x &&
+           a->pos.y < b->pos.y + b->size.height && a->pos.y + a->size.height > b->pos.y;
+}
 
-    page->page->dimensions.width = width;
-    page->page->dimensions.height = height;
+static void apBinPackPushIndex(int** indices, int* size, int* capacity, int index)
+{
+    if (*size == *capacity)
+    {
+        *capacity = *capacity ? *capacity * 2 : 16;
+        *indices = (int*)realloc(*indices, *capacity * sizeof(int));
+    }
+    (*indices)[(*size)++] = index;
+}
 
-    // If we grew horizontally, we need to insert a new skyline node
-    if (prev_width != width)
+// Gets the range of cells that the rect overlaps
+static void apBinPackGridRange(const apBinPackerPage* page, const apRect* rect, int* x0, int* y0, int* x1, int* y1)
+{
+    int shift = page->cell_shift;
+    *x0 = rect->pos.x >> shift;
+    *y0 = rect->pos.y >> shift;
+    *x1 = (rect->pos.x + rect->size.width - 1) >> shift;
+    *y1 = (rect->pos.y + rect->size.height - 1) >> shift;
+    if (*x1 >= page->grid_width)
+        *x1 = page->grid_width - 1;
+    if (*y1 >= page->grid_height)
+        *y1 = page->grid_height - 1;
+}
+
+static void apBinPackGridAdd(apBinPackerPage* page, const apRect* rect, int id)
+{
+    int x0, y0, x1, y1;
+    apBinPackGridRange(page, rect, &x0, &y0, &x1, &y1);
+    for (int y = y0; y <= y1; ++y)
     {
-        apRect rect;
-        rect.size.width = width - prev_width;
-        rect.size.height = 0;
-        rect.pos.x = prev_width;
-        rect.pos.y = 0;
-        apBinPackInsertSkylineNodeFromRect(page, page->skyline_size, &rect);
+        for (int x = x0; x <= x1; ++x)
+        {
+            apBinPackIndexList* cell = &page->cells[y * page->grid_width + x];
+            apBinPackPushIndex(&cell->indices, &cell->size, &cell->capacity, id);
+        }
     }
 }
 
-static void apBinPackPackImages(apPacker* _packer, apContext* ctx)
+// Gets the index of the i'th free rect in the cell. The ids of removed rects are dropped from the cell.
+// Returns -1 if there are no more rects in the cell
+static int apBinPackGridGet(apBinPackerPage* page, apBinPackIndexList* cell, int i)
 {
-    apBinPacker* packer = (apBinPacker*)_packer;
-    int totalArea = 0;
-    for (int i = 0; i < ctx->num_images; ++i)
+    while (i < cell->size)
     {
-        apImage* image = ctx->images[i];
-        int area = image->dimensions.width * image->dimensions.height;
-        totalArea += area;
+        int index = page->id_slots[cell->indices[i]];
+        if (index >= 0)
+            return index;
+        cell->indices[i] = cell->indices[--cell->size];
     }
+    return -1;
+}
 
-    int page_size = ctx->options.page_size;
-    printf("pagesize: %d\n", page_size);
-    if (page_size == 0)
+static void apBinPackMaxRectsAddFreeRect(apBinPackerPage* page, const apRect* rect)
+{
+    int capacity = page->free_rects_capacity;
+    apBinPackPushRect(&page->free_rects, &page->free_rects_size, &page->free_rects_capacity, rect);
+    if (capacity != page->free_rects_capacity)
+        page->free_rect_ids = (int*)realloc(page->free_rect_ids, page->free_rects_capacity * sizeof(int));
+
+    int index = page->free_rects_size - 1;
+    int id = page->num_ids;
+    apBinPackPushIndex(&page->id_slots, &page->num_ids, &page->ids_capacity, index);
+    page->free_rect_ids[index] = id;
+    apBinPackGridAdd(page, rect, id);
+}
+
+// Removes the free rect, by moving the last free rect into its slot
+static void apBinPackMaxRectsRemoveFreeRect(apBinPackerPage* page, int index)
+{
+    int last = page->free_rects_size - 1;
+    page->id_slots[page->free_rect_ids[index]] = -1;
+    if (index != last)
     {
-        int bin_size = (int)sqrtf(totalArea);
-        if (bin_size == 0)
-        {
-            bin_size = 128;
-        }
-        // Make sure the size is a power of two
-        page_size = apNextPowerOfTwo((uint32_t)bin_size);
-        // However, it's usually a better fit to take a smaller size and then grow a bit
-        page_size /= 2;
+        page->free_rects[index] = page->free_rects[last];
+        page->free_rect_ids[index] = page->free_rect_ids[last];
+        page->id_slots[page->free_rect_ids[index]] = index;
     }
+    page->free_rects_size = last;
+}
 
-    apBinPackerPage* page = &packer->page;
-    memset(page, 0, sizeof(apBinPackerPage));
-    page->page = apAllocPage(ctx);
-    page->page->dimensions.width = page_size;
-    page->page->dimensions.height = page_size;
-    packer->current_page = page;
+// Sizes the grid after the page, and adds all free rects to it (with new ids)
+static void apBinPackMaxRectsRebuildGrid(apBinPackerPage* page)
+{
+    int width = page->page->dimensions.width;
+    int height = page->page->dimensions.height;
+    int size = width > height ? width : height;
+    // At most 64 cells along the longest side
+    page->cell_shift = 4;
+    while (((size - 1) >> page->cell_shift) >= 64)
+        ++page->cell_shift;
+    page->grid_width = ((width - 1) >> page->cell_shift) + 1;
+    page->grid_height = ((height - 1) >> page->cell_shift) + 1;
 
-    apBinPackSkylineNode node;
-    node.x = 0;
-    node.y = 0;
-    node.width = page->page->dimensions.width;
-    apBinPackInsertSkylineNode(packer->current_page, 0, &node);
+    int num_cells = page->grid_width * page->grid_height;
+    if (num_cells > page->cells_capacity)
+    {
+        page->cells = (apBinPackIndexList*)realloc(page->cells, num_cells * sizeof(apBinPackIndexList));
+        memset(page->cells + page->cells_capacity, 0, (num_cells - page->cells_capacity) * sizeof(apBinPackIndexList));
+        page->cells_capacity = num_cells;
+    }
+    for (int i = 0; i < num_cells; ++i)
+        page->cells[i].size = 0;
 
-// printf("packing...\n");
-// printf("  page size: %d x %d\n", page->page->dimensions.width, page->page->dimensions.height);
-// debugSkyline(page);
+    page->free_rect_ids = (int*)realloc(page->free_rect_ids, (page->free_rects_capacity + 1) * sizeof(int));
+    page->num_ids = 0;
+    for (int i = 0; i < page->free_rects_size; ++i)
+    {
+        apBinPackPushIndex(&page->id_slots, &page->num_ids, &page->ids_capacity, i);
+        page->free_rect_ids[i] = i;
+        apBinPackGridAdd(page, &page->free_rects[i], i);
+    }
+}
 
-    int allow_rotate = !packer->options.no_rotate;
-    for (int i = 0; i < ctx->num_images; ++i)
+// Lower scores are better
+static void apBinPackMaxRectsScore(apBinPackMode mode, const apRect* free_rect, int width, int height, int64_t* score1, int* score2)
+{
+    int leftover_x = free_rect->size.width - width;
+    int leftover_y = free_rect->size.height - height;
+    int short_side = leftover_x < leftover_y ? leftover_x : leftover_y;
+    int long_side = leftover_x < leftover_y ? leftover_y : leftover_x;
+
+    switch(mode)
     {
-        apImage* image = ctx->images[i];
+    case AP_BP_MAXRECTS_BAF:
+        *score1 = (int64_t)free_rect->size.width * free_rect->size.height - (int64_t)width * height;
+        *score2 = short_side;
+        break;
+    case AP_BP_MAXRECTS_BL:
+        *score1 = free_rect->pos.y + height;
+        *score2 = free_rect->pos.x;
+        break;
+    default: // AP_BP_MAXRECTS_BSSF
+        *score1 = short_side;
+        *score2 = long_side;
+        break;
+    }
+}
 
-        apBinPackerPage* page = packer->current_page;
-        int fit = apBinPackPackRect(page, image->dimensions.width, image->dimensions.height, allow_rotate, &image->placement);
-        if (fit)
-        {
-            image->rotation = image->placement.size.width == image->dimensions.width ? 0 : 90;
-            apPageAddImage(page->page, image);
+static int apBinPackMaxRectsFindPosition(apBinPackerPage* page, int width, int height, int allow_rotate, apRect* out_rect)
+{
+    int64_t best_score1 = INT64_MAX;
+    int best_score2 = INT_MAX;
+    int found = 0;
 
-            apSize size = {image->width, image->height};
-            if (image->rotation)
+    for (int i = 0; i < page->free_rects_size; ++i)
+    {
+        const apRect* free_rect = &page->free_rects[i];
+        int w = width;
+        int h = height;
+        for (int r = 0; r < 2; ++r)
+        {
+            if (free_rect->size.width >= w && free_rect->size.height >= h)
             {
-                size.width = image->height;
-                size.height = image->width;
+                int64_t score1;
+                int score2;
+                apBinPackMaxRectsScore(page->mode, free_rect, w, h, &score1, &score2);
+                if (score1 < best_score1 || (score1 == best_score1 && score2 < best_score2))
+                {
+                    best_score1 = score1;
+                    best_score2 = score2;
+                    out_rect->pos = free_rect->pos;
+                    out_rect->size.width = w;
+                    out_rect->size.height = h;
+                    found = 1;
+                }
             }
 
-            image->vertices = apCreateBoxVertices(image->placement.pos, size, &image->num_vertices);
+            if (!allow_rotate || width == height)
+                break;
 
-// printf("  rotation: %d   pos: %d, %d  %d, %d\n", image->rotation,
-//         image->placement.pos.x, image->placement.pos.y, image->placement.size.width, image->placement.size.height);
+            w = height;
+            h = width;
         }
+    }
+    return found;
+}
 
-        if (!fit)
+static void apBinPackMaxRectsSplit(apBinPackerPage* page, const apRect* free_rect, const apRect* used)
+{
+    int fx = free_rect->pos.x;
+    int fy = free_rect->pos.y;
+    int fx2 = fx + free_rect->size.width;
+    int fy2 = fy + free_rect->size.height;
+    int ux = used->pos.x;
+    int uy = used->pos.y;
+    int ux2 = ux + used->size.width;
+    int uy2 = uy + used->size.height;
+
+    apRect rect;
+    if (ux > fx)
+    {
+        rect.pos.x = fx; rect.pos.y = fy; rect.size.width = ux - fx; rect.size.height = fy2 - fy;
+        apBinPackPushRect(&page->new_rects, &page->new_rects_size, &page->new_rects_capacity, &rect);
+    }
+    if (ux2 < fx2)
+    {
+        rect.pos.x = ux2; rect.pos.y = fy; rect.size.width = fx2 - ux2; rect.size.height = fy2 - fy;
+        apBinPackPushRect(&page->new_rects, &page->new_rects_size, &page->new_rects_capacity, &rect);
+    }
+    if (uy > fy)
+    {
+        rect.pos.x = fx; rect.pos.y = fy; rect.size.width = fx2 - fx; rect.size.height = uy - fy;
+        apBinPackPushRect(&page->new_rects, &page->new_rects_size, &page->new_rects_capacity, &rect);
+    }
+    if (uy2 < fy2)
+    {
+        rect.pos.x = fx; rect.pos.y = uy2; rect.size.width = fx2 - fx; rect.size.height = fy2 - uy2;
+        apBinPackPushRect(&page->new_rects, &page->new_rects_size, &page->new_rects_capacity, &rect);
+    }
+}
+
+// Removes the new rects that are contained in any other rect, then moves the remaining ones to the free list
+static void apBinPackMaxRectsPruneNewRects(apBinPackerPage* page)
+{
+    apRect* new_rects = page->new_rects;
+    int num_new = page->new_rects_size;
+    for (int i = 0; i < num_new; ++i)
+    {
+        int contained = 0;
+        for (int j = 0; j < num_new && !contained; ++j)
         {
-            if (ctx->options.page_size)
-            {
-                apBinPackerPage* new_page = (apBinPackerPage*)malloc(sizeof(apBinPackerPage));
-                memset(new_page, 0, sizeof(apBinPackerPage));
-                new_page->page = apAllocPage(ctx);
-                new_page->page->dimensions.width = page_size;
-                new_page->page->dimensions.height = page_size;
-
-                apBinPackSkylineNode node;
-                node.x = 0;
-                node.y = 0;
-                node.width = new_page->page->dimensions.width;
-                apBinPackInsertSkylineNode(new_page, 0, &node);
-
-                new_page->next = packer->current_page;
-                packer->current_page = new_page;
-            }
-            else
+            if (i == j || !apBinPackRectContains(&new_rects[j], &new_rects[i]))
+                continue;
+            // For identical rects, we keep the first one
+            int identical = apBinPackRectContains(&new_rects[i], &new_rects[j]);
+            contained = !identical || j < i;
+        }
+        // A rect that contains the new rect also overlaps the cell of its corner
+        apBinPackIndexList* cell = &page->cells[(new_rects[i].pos.y >> page->cell_shift) * page->grid_width + (new_rects[i].pos.x >> page->cell_shift)];
+        int index;
+        for (int j = 0; !contained && (index = apBinPackGridGet(page, cell, j)) >= 0; ++j)
+        {
+            contained = apBinPackRectContains(&page->free_rects[index], &new_rects[i]);
+        }
+
+        if (!contained)
+            apBinPackMaxRectsAddFreeRect(page, &new_rects[i]);
+    }
+    page->new_rects_size = 0;
+}
+
+static int apBinPackCompareIndicesDescending(const void* _a, const void* _b)
+{
+    int a = *(const int*)_a;
+    int b = *(const int*)_b;
+    return b - a;
+}
+
+static void apBinPackMaxRectsPlaceRect(apBinPackerPage* page, const apRect* used)
+{
+    // Start over when most of the ids in the grid belong to removed rects
+    if (page->num_ids > 4 * page->free_rects_size + 1024)
+        apBinPackMaxRectsRebuildGrid(page);
+
+    // Find the intersecting rects. Each one is only reported from the cell where its overlap with the used rect starts
+    int shift = page->cell_shift;
+    int x0, y0, x1, y1;
+    apBinPackGridRange(page, used, &x0, &y0, &x1, &y1);
+    page->hits_size = 0;
+    for (int y = y0; y <= y1; ++y)
+    {
+        for (int x = x0; x <= x1; ++x)
+        {
+            apBinPackIndexList* cell = &page->cells[y * page->grid_width + x];
+            int index;
+            for (int i = 0; (index = apBinPackGridGet(page, cell, i)) >= 0; ++i)
             {
-                // We need to grow the page size (or switch page)
-                apBinPackPackGrowPage(page);
+                const apRect* free_rect = &page->free_rects[index];
+                if (!apBinPackRectIntersects(free_rect, used))
+                    continue;
+                int ox = free_rect->pos.x > used->pos.x ? free_rect->pos.x : used->pos.x;
+                int oy = free_rect->pos.y > used->pos.y ? free_rect->pos.y : used->pos.y;
+                if ((ox >> shift) == x && (oy >> shift) == y)
+                    apBinPackPushIndex(&page->hits, &page->hits_size, &page->hits_capacity, index);
             }
+        }
+    }
 
-            // Try to refit this image again
-            --i;
-            continue;
+    // Split the intersecting rects. The highest indices are removed first, so the moved rects are never among the hits
+    qsort(page->hits, page->hits_size, sizeof(int), apBinPackCompareIndicesDescending);
+    for (int i = 0; i < page->hits_size; ++i)
+    {
+        apRect free_rect = page->free_rects[page->hits[i]];
+        apBinPackMaxRectsSplit(page, &free_rect, used);
+        apBinPackMaxRectsRemoveFreeRect(page, page->hits[i]);
+    }
+
+    apBinPackMaxRectsPruneNewRects(page);
+}
+
+static int apBinPackMaxRectsPackRect(apBinPackerPage* page, int width, int height, int allow_rotate, apRect* rect)
+{
+    if (!apBinPackMaxRectsFindPosition(page, width, height, allow_rotate, rect))
+        return 0;
+    apBinPackMaxRectsPlaceRect(page, rect);
+    return 1;
+}
+
+// All free rects touching the old border can now extend to the new border
+static void apBinPackMaxRectsGrow(apBinPackerPage* page, int prev_width, int prev_height)
+{
+    int width = page->page->dimensions.width;
+    int height = page->page->dimensions.height;
+    for (int i = 0; i < page->free_rects_size; ++i)
+    {
+        apRect* rect = &page->free_rects[i];
+        if (width != prev_width && rect->pos.x + rect->size.width == prev_width)
+            rect->size.width = width - rect->pos.x;
+        if (height != prev_height && rect->pos.y + rect->size.height == prev_height)
+            rect->size.height = height - rect->pos.y;
+    }
+    apBinPackMaxRectsRebuildGrid(page);
+
+    apRect rect;
+    if (width != prev_width)
+    {
+        rect.pos.x = prev_width; rect.pos.y = 0; rect.size.width = width - prev_width; rect.size.height = height;
+    }
+    else
+    {
+        rect.pos.x = 0; rect.pos.y = prev_height; rect.size.width = width; rect.size.height = height - prev_height;
+    }
+    apBinPackPushRect(&page->new_rects, &page->new_rects_size, &page->new_rects_capacity, &rect);
+    apBinPackMaxRectsPruneNewRects(page);
+}
+
+// ************************************************************************************************************************
+// Guillotine
+//
+// The free rectangles are grouped in buckets on their area. The best area fit is found in the first bucket
+// (from the area of the new rect and up) that has a rect that fits, so only the rects of about the right size are visited.
+// Within a bucket, the rects are sorted on width. As the area of the rects is bounded by the bucket, only the rects
+// in a narrow range of widths can hold the new rect, and that range is found with a binary search.
+// A hash table maps the corners of each rect to the rect, so that the neighbours sharing a full edge are found directly.
+
+typedef enum
+{
+    AP_BP_CORNER_TOP_LEFT,
+    AP_BP_CORNER_TOP_RIGHT,
+    AP_BP_CORNER_BOTTOM_LEFT,
+    AP_BP_NUM_CORNERS,
+} apBinPackCorner;
+
+static inline int64_t apBinPackRectArea(const apRect* rect)
+{
+    return (int64_t)rect->size.width * rect->size.height;
+}
+
+// The buckets split each power of two of the area into four, using the two bits below the highest set bit
+static int apBinPackAreaBucket(int64_t area)
+{
+    if (area < 4)
+        return (int)area;
+    int log2 = 0;
+    uint64_t a = (uint64_t)area;
+    while (a >>= 1)
+        ++log2;
+    return log2 * 4 + (int)((area >> (log2 - 2)) & 3);
+}
+
+// Returns the area just above the areas of the bucket
+static int64_t apBinPackAreaBucketEnd(int bucket)
+{
+    if (bucket < 4)
+        return bucket + 1;
+    return (int64_t)(5 + (bucket & 3)) << ((bucket / 4) - 2);
+}
+
+// Orders the rects on width, then position. The free rects are disjoint, so no two are equal
+static inline int apBinPackFreeRectLess(const apRect* a, const apRect* b)
+{
+    if (a->size.width != b->size.width)
+        return a->size.width < b->size.width;
+    if (a->pos.x != b->pos.x)
+        return a->pos.x < b->pos.x;
+    return a->pos.y < b->pos.y;
+}
+
+// Returns the first position in the bucket that doesn't hold a rect that is less than the rect
+static int apBinPackBucketLowerBound(const apBinPackFreeList* list, const apBinPackIndexList* bucket, const apRect* rect)
+{
+    int low = 0;
+    int high = bucket->size;
+    while (low < high)
+    {
+        int mid = (low + high) / 2;
+        if (apBinPackFreeRectLess(&list->rects[bucket->indices[mid]], rect))
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+static void apBinPackGetCorner(const apRect* rect, int corner, int* x, int* y)
+{
+    *x = rect->pos.x + (corner == AP_BP_CORNER_TOP_RIGHT ? rect->size.width : 0);
+    *y = rect->pos.y + (corner == AP_BP_CORNER_BOTTOM_LEFT ? rect->size.height : 0);
+}
+
+static inline uint32_t apBinPackHashCorner(int x, int y, int corner)
+{
+    return ((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u) ^ ((uint32_t)corner * 83492791u);
+}
+
+// Returns the slot of the corner in the hash table, or the empty slot where it would be inserted
+static int apBinPackFindCornerSlot(const apBinPackFreeList* list, int x, int y, int corner)
+{
+    int mask = list->corners_capacity - 1;
+    int slot = (int)(apBinPackHashCorner(x, y, corner) & (uint32_t)mask);
+    while (1)
+    {
+        const apBinPackCornerEntry* entry = &list->corners[slot];
+        if (entry->index < 0 || (entry->x == x && entry->y == y && entry->corner == corner))
+            return slot;
+        slot = (slot + 1) & mask;
+    }
+}
+
+// Returns the index of the rect with the corner, or -1
+static int apBinPackFindCorner(const apBinPackFreeList* list, int x, int y, int corner)
+{
+    if (!list->corners_capacity)
+        return -1;
+    return list->corners[apBinPackFindCornerSlot(list, x, y, corner)].index;
+}
+
+static void apBinPackSetCorner(apBinPackFreeList* list, int x, int y, int corner, int index);
+
+static void apBinPackGrowCorners(apBinPackFreeList* list)
+{
+    apBinPackCornerEntry* old = list->corners;
+    int old_capacity = list->corners_capacity;
+    list->corners_capacity = old_capacity ? old_capacity * 2 : 64;
+    list->corners = (apBinPackCornerEntry*)malloc(list->corners_capacity * sizeof(apBinPackCornerEntry));
+    for (int i = 0; i < list->corners_capacity; ++i)
+        list->corners[i].index = -1;
+    list->num_corners = 0;
+    for (int i = 0; i < old_capacity; ++i)
+    {
+        if (old[i].index >= 0)
+            apBinPackSetCorner(list, old[i].x, old[i].y, old[i].corner, old[i].index);
+    }
+    free((void*)old);
+}
+
+// Inserts or updates the corner
+static void apBinPackSetCorner(apBinPackFreeList* list, int x, int y, int corner, int index)
+{
+    // Keep the load factor at or below 1/2
+    if ((list->num_corners + 1) * 2 > list->corners_capacity)
+        apBinPackGrowCorners(list);
+    apBinPackCornerEntry* entry = &list->corners[apBinPackFindCornerSlot(list, x, y, corner)];
+    if (entry->index < 0)
+        list->num_corners++;
+    entry->x = x;
+    entry->y = y;
+    entry->corner = corner;
+    entry->index = index;
+}
+
+// Removes the corner, if it belongs to the rect
+static void apBinPackRemoveCorner(apBinPackFreeList* list, int x, int y, int corner, int index)
+{
+    int mask = list->corners_capacity - 1;
+    int slot = apBinPackFindCornerSlot(list, x, y, corner);
+    if (list->corners[slot].index != index)
+        return;
+    list->corners[slot].index = -1;
+    list->num_corners--;
+
+    // Move the following entries back, so that no lookup stops early at the new hole
+    int next = (slot + 1) & mask;
+    while (list->corners[next].index >= 0)
+    {
+        apBinPackCornerEntry entry = list->corners[next];
+        int home = (int)(apBinPackHashCorner(entry.x, entry.y, entry.corner) & (uint32_t)mask);
+        // Only move the entry if its home slot isn't in the range (slot, next]
+        if (((next - home) & mask) >= ((next - slot) & mask))
+        {
+            list->corners[slot] = entry;
+            list->corners[next].index = -1;
+            slot = next;
         }
+        next = (next + 1) & mask;
+    }
+}
 
-        //debugSkyline(page);
+static void apBinPackFreeListInsert(apBinPackFreeList* list, const apRect* rect)
+{
+    if (list->size == list->capacity)
+    {
+        list->capacity = list->capacity ? list->capacity * 2 : 16;
+        list->rects = (apRect*)realloc(list->rects, list->capacity * sizeof(apRect));
     }
+    int index = list->size++;
+    list->rects[index] = *rect;
+
+    apBinPackIndexList* bucket = &list->buckets[apBinPackAreaBucket(apBinPackRectArea(rect))];
+    int slot = apBinPackBucketLowerBound(list, bucket, rect);
+    apBinPackPushIndex(&bucket->indices, &bucket->size, &bucket->capacity, index);
+    memmove(bucket->indices + slot + 1, bucket->indices + slot, (bucket->size - 1 - slot) * sizeof(int));
+    bucket->indices[slot] = index;
 
+    for (int c = 0; c < AP_BP_NUM_CORNERS; ++c)
+    {
+        int x, y;
+        apBinPackGetCorner(rect, c, &x, &y);
+        apBinPackSetCorner(list, x, y, c, index);
+    }
 }
 
-void apBinPackerSetDefaultOptions(apBinPackerOptions* options)
+// Removes the rect, by moving the last rect into its slot
+static void apBinPackFreeListErase(apBinPackFreeList* list, int index)
 {
-    memset(options, 0, sizeof(apBinPackerOptions));
-    options->mode = AP_BP_MODE_DEFAULT;
+    const apRect* rect = &list->rects[index];
+    for (int c = 0; c < AP_BP_NUM_CORNERS; ++c)
+    {
+        int x, y;
+        apBinPackGetCorner(rect, c, &x, &y);
+        apBinPackRemoveCorner(list, x, y, c, index);
+    }
+
+    apBinPackIndexList* bucket = &list->buckets[apBinPackAreaBucket(apBinPackRectArea(rect))];
+    int slot = apBinPackBucketLowerBound(list, bucket, rect);
+    memmove(bucket->indices + slot, bucket->indices + slot + 1, (bucket->size - 1 - slot) * sizeof(int));
+    --bucket->size;
+
+    int last = --list->size;
+    if (index == last)
+        return;
+    list->rects[index] = list->rects[last];
+    rect = &list->rects[index];
+    bucket = &list->buckets[apBinPackAreaBucket(apBinPackRectArea(rect))];
+    bucket->indices[apBinPackBucketLowerBound(list, bucket, rect)] = index;
+    for (int c = 0; c < AP_BP_NUM_CORNERS; ++c)
+    {
+        int x, y;
+        apBinPackGetCorner(rect, c, &x, &y);
+        if (apBinPackFindCorner(list, x, y, c) == last)
+            apBinPackSetCorner(list, x, y, c, index);
+    }
 }
 
-apPacker* apBinPackerCreate(apBinPackerOptions* options)
+static void apBinPackFreeListClear(apBinPackFreeList* list)
 {
-    apBinPacker* packer = (apBinPacker*)malloc(sizeof(apBinPacker));
-    memset(packer, 0, sizeof(apBinPacker));
-    packer->super.packer_type = "apBinPacker";
-    packer->super.createImage = apBinPackCreateImage;
-    packer->super.destroyImage = apBinPackDestroyImage;
-    packer->super.packImages = apBinPackPackImages;
-    packer->options = *options;
-    return (apPacker*)packer;
+    list->size = 0;
+    for (int i = 0; i < AP_BP_NUM_AREA_BUCKETS; ++i)
+        list->buckets[i].size = 0;
+    for (int i = 0; i < list->corners_capacity; ++i)
+        list->corners[i].index = -1;
+    list->num_corners = 0;
 }
 
-void apBinPackerDestroy(apPacker* packer)
+static void apBinPackFreeListFree(apBinPackFreeList* list)
 {
-    free((void*)packer);
+    free((void*)list->rects);
+    for (int i = 0; i < AP_BP_NUM_AREA_BUCKETS; ++i)
+        free((void*)list->buckets[i].indices);
+    free((void*)list->corners);
+}
+
+static void apBinPackFreeListCopy(apBinPackFreeList* dst, const apBinPackFreeList* src)
+{
+    apBinPackFreeListClear(dst);
+    for (int i = 0; i < src->size; ++i)
+        apBinPackFreeListInsert(dst, &src->rects[i]);
+}
+
+// Returns the index of the smallest rect in the bucket that holds the size (unrotated), if it is smaller than 'best_area'.
+// Otherwise returns 'best'
+static int apBinPackBucketFindBestArea(const apBinPackFreeList* list, int b, int width, int height, int best, int64_t* best_area)
+{
+    const apBinPackIndexList* bucket = &list->buckets[b];
+    if (!bucket->size)
+        return best;
+
+    // The area of the rects is bounded by the bucket, so the wider ones aren't high enough
+    int64_t max_width = (apBinPackAreaBucketEnd(b) - 1) / height;
+    apRect key;
+    key.pos.x = INT_MIN;
+    key.pos.y = INT_MIN;
+    key.size.width = width;
+    key.size.height = height;
+    for (int i = apBinPackBucketLowerBound(list, bucket, &key); i < bucket->size; ++i)
+    {
+        const apRect* rect = &list->rects[bucket->indices[i]];
+        if (rect->size.width > max_width)
+            break;
+        int64_t area = apBinPackRectArea(rect);
+        if (rect->size.height < height || area >= *best_area)
+            continue;
+        best = bucket->indices[i];
+        *best_area = area;
+    }
+    return best;
+}
+
+// Returns the index of the best area fit, or -1 if no rect could hold it
+static int apBinPackFreeListFindBestArea(const apBinPackFreeList* list, int width, int height, int allow_rotate, int* rotated)
+{
+    // The buckets are ordered on area, so the first bucket with a fitting rect holds the best fit
+    for (int b = apBinPackAreaBucket((int64_t)width * height); b < AP_BP_NUM_AREA_BUCKETS; ++b)
+    {
+        int64_t best_area = INT64_MAX;
+        int best = apBinPackBucketFindBestArea(list, b, width, height, -1, &best_area);
+        if (allow_rotate)
+            best = apBinPackBucketFindBestArea(list, b, height, width, best, &best_area);
+        if (best >= 0)
+        {
+            const apRect* rect = &list->rects[best];
+            *rotated = !(rect->size.width >= width && rect->size.height >= height);
+            return best;
+        }
+    }
+    return -1;
+}
+
+// Merges two rects if they share a full edge
+static int apBinPackMergeRects(apRect* a, const apRect* b)
+{
+    if (a->pos.y == b->pos.y && a->size.height == b->size.height)
+    {
+        if (a->pos.x + a->size.width == b->pos.x)
+        {
+            a->size.width += b->size.width;
+            return 1;
+        }
+        if (b->pos.x + b->size.width == a->pos.x)
+        {
+            a->pos.x = b->pos.x;
+            a->size.width += b->size.width;
+            return 1;
+        }
+    }
+    if (a->pos.x == b->pos.x && a->size.width == b->size.width)
+    {
+        if (a->pos.y + a->size.height == b->pos.y)
+        {
+            a->size.height += b->size.height;
+            return 1;
+        }
+        if (b->pos.y + b->size.height == a->pos.y)
+        {
+            a->pos.y = b->pos.y;
+            a->size.height += b->size.height;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Returns the index of a rect that shares a full edge with the rect, or -1
+static int apBinPackFreeListFindNeighbour(const apBinPackFreeList* list, const apRect* rect)
+{
+    int x = rect->pos.x;
+    int y = rect->pos.y;
+    int candidates[4];
+    candidates[0] = apBinPackFindCorner(list, x, y, AP_BP_CORNER_TOP_RIGHT);                       // Left
+    candidates[1] = apBinPackFindCorner(list, x + rect->size.width, y, AP_BP_CORNER_TOP_LEFT);     // Right
+    candidates[2] = apBinPackFindCorner(list, x, y, AP_BP_CORNER_BOTTOM_LEFT);                     // Above
+    candidates[3] = apBinPackFindCorner(list, x, y + rect->size.height, AP_BP_CORNER_TOP_LEFT);    // Below
+    for (int i = 0; i < 4; ++i)
+    {
+        if (candidates[i] < 0)
+            continue;
+        const apRect* other = &list->rects[candidates[i]];
+        if (i < 2 ? other->size.height == rect->size.height : other->size.width == rect->size.width)
+            return candidates[i];
+    }
+    return -1;
+}
+
+// Adds a free rect, and merges it with its neighbours (repeatedly) if possible
+static void apBinPackFreeListAdd(apBinPackFreeList* list, apRect rect, int merge)
+{
+    if (rect.size.width <= 0 || rect.size.height <= 0)
+        return;
+
+    while (merge)
+    {
+        int index = apBinPackFreeListFindNeighbour(list, &rect);
+        if (index < 0)
+            break;
+        apBinPackMergeRects(&rect, &list->rects[index]);
+        apBinPackFreeListErase(list, index);
+    }
+    apBinPackFreeListInsert(list, &rect);
+}
+
+// Splits the free rect into two disjoint rects, after placing a rect in its top left corner
+static void apBinPackGuillotineSplitRect(apBinPackFreeList* list, const apRect* free_rect, const apRect* used,
+                                            apBinPackGuillotineSplit split, int merge)
+{
+    int leftover_x = free_rect->size.width - used->size.width;
+    int leftover_y = free_rect->size.height - used->size.height;
+
+    int split_horizontal;
+    switch(split)
+    {
+    case AP_BP_SPLIT_LONGER_LEFTOVER_AXIS:  split_horizontal = leftover_x > leftover_y; break;
+    case AP_BP_SPLIT_MIN_AREA:              split_horizontal = (int64_t)used->size.width * leftover_y > (int64_t)leftover_x * used->size.height; break;
+    case AP_BP_SPLIT_MAX_AREA:              split_horizontal = (int64_t)used->size.width * leftover_y <= (int64_t)leftover_x * used->size.height; break;
+    case AP_BP_SPLIT_SHORTER_AXIS:          split_horizontal = free_rect->size.width <= free_rect->size.height; break;
+    case AP_BP_SPLIT_LONGER_AXIS:           split_horizontal = free_rect->size.width > free_rect->size.height; break;
+    default:                                split_horizontal = leftover_x <= leftover_y; break; // AP_BP_SPLIT_SHORTER_LEFTOVER_AXIS
+    }
+
+    apRect right;
+    right.pos.x = free_rect->pos.x + used->size.width;
+    right.pos.y = free_rect->pos.y;
+    right.size.width = leftover_x;
+    right.size.height = split_horizontal ? used->size.height : free_rect->size.height;
+
+    apRect bottom;
+    bottom.pos.x = free_rect->pos.x;
+    bottom.pos.y = free_rect->pos.y + used->size.height;
+    bottom.size.width = split_horizontal ? free_rect->size.width : used->size.width;
+    bottom.size.height = leftover_y;
+
+    apBinPackFreeListAdd(list, right, merge);
+    apBinPackFreeListAdd(list, bottom, merge);
+}
+
+// Places the rect in the best fitting free rect. Returns 0 if it didn't fit
+static int apBinPackFreeListPackRect(apBinPackFreeList* list, int width, int height, int allow_rotate,
+                                        apBinPackGuillotineSplit split, int merge, apRect* rect)
+{
+    int rotated = 0;
+    int index = apBinPackFreeListFindBestArea(list, width, height, allow_rotate && width != height, &rotated);
+    if (index == -1)
+        return 0;
+
+    apRect free_rect = list->rects[index];
+    apBinPackFreeListErase(list, index);
+
+    rect->pos = free_rect.pos;
+    rect->size.width = rotated ? height : width;
+    rect->size.height = rotated ? width : height;
+    apBinPackGuillotineSplitRect(list, &free_rect, rect, split, merge);
+    return 1;
+}
+
+static void apBinPackGuillotineGrow(apBinPackerPage* page, int prev_width, int prev_height)
+{
+    int width = page->page->dimensions.width;
+    int height = page->page->dimensions.height;
+    apRect rect;
+    if (width != prev_width)
+    {
+        rect.pos.x = prev_width; rect.pos.y = 0; rect.size.width = width - prev_width; rect.size.height = height;
+    }
+    else
+    {
+        rect.pos.x = 0; rect.pos.y = prev_height; rect.size.width = width; rect.size.height = height - prev_height;
+    }
+    apBinPackFreeListAdd(&page->free_list, rect, page->merge);
+}
+
+// ************************************************************************************************************************
+
+static void apBinPackInitPage(apBinPackerPage* page, const apBinPackerOptions* options)
+{
+    apBinPackMode mode = options->mode;
+    page->mode = mode;
+    page->split = options->split;
+    page->merge = !options->no_merge;
+    page->use_waste_map = options->waste_map;
+    page->allow_rotate = !options->no_rotate;
+    page->max_free = page->page->dimensions;
+    page->free_area = (int64_t)page->page->dimensions.width * page->page->dimensions.height;
+    if (apBinPackIsMaxRectsMode(mode))
+    {
+        apRect rect;
+        rect.pos.x = 0;
+        rect.pos.y = 0;
+        rect.size = page->page->dimensions;
+        apBinPackMaxRectsRebuildGrid(page);
+        apBinPackMaxRectsAddFreeRect(page, &rect);
+    }
+    else if (mode == AP_BP_GUILLOTINE)
+    {
+        apRect rect;
+        rect.pos.x = 0;
+        rect.pos.y = 0;
+        rect.size = page->page->dimensions;
+        apBinPackFreeListAdd(&page->free_list, rect, 0);
+    }
+    else
+    {
+        apBinPackSkylineNode node;
+        node.x = 0;
+        node.y = 0;
+        node.width = page->page->dimensions.width;
+        apBinPackInsertSkylineNode(page, 0, &node);
+    }
+}
+
+// Adds the gaps between the skyline nodes and the bottom of the rect to the waste map
+static void apBinPackAddWasteMapArea(apBinPackerPage* page, int index, const apRect* rect)
+{
+    apBinPackSkylineNode* skyline = page->skyline;
+    int rect_right = rect->pos.x + rect->size.width;
+    for (int i = index; i < page->skyline_size && skyline[i].x < rect_right; ++i)
+    {
+        int left = skyline[i].x;
+        int right = skyline[i].x + skyline[i].width;
+        if (right > rect_right)
+            right = rect_right;
+
+        apRect waste;
+        waste.pos.x = left;
+        waste.pos.y = skyline[i].y;
+        waste.size.width = right - left;
+        waste.size.height = rect->pos.y - skyline[i].y;
+        apBinPackFreeListAdd(&page->waste_map, waste, page->merge);
+    }
+}
+
+static int apBinPackPackRect(apBinPackerPage* page, int width, int height, int allow_rotate, apRect* rect)
+{
+    if (apBinPackIsMaxRectsMode(page->mode))
+        return apBinPackMaxRectsPackRect(page, width, height, allow_rotate, rect);
+    if (page->mode == AP_BP_GUILLOTINE)
+        return apBinPackFreeListPackRect(&page->free_list, width, height, allow_rotate, page->split, page->merge, rect);
+
+    if (page->use_waste_map)
+    {
+        if (apBinPackFreeListPackRect(&page->waste_map, width, height, allow_rotate, page->split, page->merge, rect))
+            return 1;
+    }
+
+    int best_index = apBinPackSkylineBLPackRect(page, width, height, allow_rotate, rect);
+    if (best_index != -1)
+    {
+        if (page->use_waste_map)
+            apBinPackAddWasteMapArea(page, best_index, rect);
+        apBinPackInsertSkylineNodeFromRect(page, best_index, rect);
+        apBinPackFixupSkyline(page, best_index);
+        return 1;
+    }
+    return 0;
+}
+
+// Returns 0 if the page cannot grow any more
+static int apBinPackPackGrowPage(apBinPackerPage* page, const apOptions* options)
+{
+    int prev_width = page->page->dimensions.width;
+    apSize size = apGrowPageSize(options, page->page->dimensions, 1);
+    if (size.width == prev_width && size.height == page->page->dimensions.height)
+        return 0;
+    int width = size.width;
+    int height = size.height;
+    printf("Growing page to %d x %d\n", width, height);
+
+    int64_t prev_area = (int64_t)prev_width * page->page->dimensions.height;
+    page->free_area += (int64_t)width * height - prev_area;
+
+    int prev_height = page->page->dimensions.height;
+    page->page->dimensions.width = width;
+    page->page->dimensions.height = height;
+
+    if (apBinPackIsMaxRectsMode(page->mode))
+    {
+        apBinPackMaxRectsGrow(page, prev_width, prev_height);
+        return 1;
+    }
+    if (page->mode == AP_BP_GUILLOTINE)
+    {
+        apBinPackGuillotineGrow(page, prev_width, prev_height);
+        return 1;
+    }
+
+    // If we grew horizontally, we need to insert a new skyline node
+    if (prev_width != width)
+    {
+        apRect rect;
+        rect.size.width = width - prev_width;
+        rect.size.height = 0;
+        rect.pos.x = prev_width;
+        rect.pos.y = 0;
+        apBinPackInsertSkylineNodeFromRect(page, page->skyline_size, &rect);
+    }
+    return 1;
+}
+
+static apBinPackerPage* apBinPackCreatePage(apBinPacker* packer, apContext* ctx, int width, int height)
+{
+    apBinPackerPage* page = (apBinPackerPage*)malloc(sizeof(apBinPackerPage));
+    memset(page, 0, sizeof(apBinPackerPage));
+    page->page = apAllocPage(ctx);
+    page->page->dimensions.width = width;
+    page->page->dimensions.height = height;
+
+    apBinPackInitPage(page, &packer->options);
+
+    // Add it last
+    apBinPackerPage** last = &packer->pages;
+    while (*last)
+        last = &(*last)->next;
+    *last = page;
+    return page;
+}
+
+static void apBinPackFreePageData(apBinPackerPage* page)
+{
+    if (page->owns_page)
+        free((void*)page->page);
+    free((void*)page->skyline);
+    free((void*)page->free_rects);
+    free((void*)page->new_rects);
+    for (int i = 0; i < page->cells_capacity; ++i)
+        free((void*)page->cells[i].indices);
+    free((void*)page->cells);
+    free((void*)page->free_rect_ids);
+    free((void*)page->id_slots);
+    free((void*)page->hits);
+    apBinPackFreeListFree(&page->free_list);
+    apBinPackFreeListFree(&page->waste_map);
+}
+
+static void apBinPackDestroyPage(apBinPackerPage* page)
+{
+    apBinPackFreePageData(page);
+    free((void*)page);
+}
+
+// Removes the last page, which has no images
+static void apBinPackDestroyLastPage(apBinPacker* packer, apContext* ctx)
+{
+    apBinPackerPage** last = &packer->pages;
+    while ((*last)->next)
+        last = &(*last)->next;
+    apBinPackDestroyPage(*last);
+    *last = 0;
+    apFreeLastPage(ctx);
+}
+
+static void apBinPackDestroyPages(apBinPacker* packer)
+{
+    apBinPackerPage* page = packer->pages;
+    while (page)
+    {
+        apBinPackerPage* next = page->next;
+        apBinPackDestroyPage(page);
+        page = next;
+    }
+    packer->pages = 0;
+
+    apBinPackFreePageData(&packer->scratch);
+    memset(&packer->scratch, 0, sizeof(apBinPackerPage));
+}
+
+static void apBinPackCopyArray(void** dst, int* dst_capacity, const void* src, int size, size_t element_size)
+{
+    if (*dst_capacity < size)
+    {
+        *dst_capacity = size;
+        *dst = realloc(*dst, (size_t)size * element_size);
+    }
+    if (size)
+        memcpy(*dst, src, (size_t)size * element_size);
+}
+
+// Copies the packing state, reusing the memory of the destination
+static void apBinPackCopyPageState(apBinPackerPage* dst, const apBinPackerPage* src)
+{
+    apBinPackCopyArray((void**)&dst->skyline, &dst->skyline_capacity, src->skyline, src->skyline_size, sizeof(apBinPackSkylineNode));
+    dst->skyline_size = src->skyline_size;
+    apBinPackCopyArray((void**)&dst->free_rects, &dst->free_rects_capacity, src->free_rects, src->free_rects_size, sizeof(apRect));
+    dst->free_rects_size = src->free_rects_size;
+    dst->new_rects_size = 0;
+    apBinPackFreeListCopy(&dst->free_list, &src->free_list);
+    apBinPackFreeListCopy(&dst->waste_map, &src->waste_map);
+
+    dst->page = src->page; // Only for reading the dimensions
+    dst->mode = src->mode;
+    dst->split = src->split;
+    dst->merge = src->merge;
+    dst->use_waste_map = src->use_waste_map;
+    dst->max_free = src->max_free;
+    dst->free_area = src->free_area;
+    dst->allow_rotate = src->allow_rotate;
+
+    if (apBinPackIsMaxRectsMode(dst->mode))
+        apBinPackMaxRectsRebuildGrid(dst);
+}
+
+// Swaps the packing state of the page with the scratch page
+static void apBinPackSwapPageState(apBinPackerPage* page, apBinPackerPage* scratch)
+{
+    apBinPackerPage tmp = *page;
+    *page = *scratch;
+    *scratch = tmp;
+    page->next = scratch->next;
+    page->owns_page = scratch->owns_page;
+    scratch->next = 0;
+    scratch->owns_page = 0;
+}
+
+static int apBinPackPageMayFit(const apBinPackerPage* page, int width, int height, int allow_rotate)
+{
+    if ((int64_t)width * height > page->free_area)
+        return 0;
+    if (width <= page->max_free.width && height <= page->max_free.height)
+        return 1;
+    return allow_rotate && height <= page->max_free.width && width <= page->max_free.height;
+}
+
+static void apBinPackGetMaxSize(const apRect* rects, int num_rects, apSize* max_size)
+{
+    for (int i = 0; i < num_rects; ++i)
+    {
+        if (rects[i].size.width > max_size->width)
+            max_size->width = rects[i].size.width;
+        if (rects[i].size.height > max_size->height)
+            max_size->height = rects[i].size.height;
+    }
+}
+
+// Recalculates the upper bounds of the page. Only done when a rect fails to fit,
+// as the previous bounds are still valid (albeit less tight) after a rect was placed
+static void apBinPackUpdatePageSummary(apBinPackerPage* page)
+{
+    apSize max_free = {0, 0};
+    if (apBinPackIsMaxRectsMode(page->mode))
+    {
+        apBinPackGetMaxSize(page->free_rects, page->free_rects_size, &max_free);
+    }
+    else if (page->mode == AP_BP_GUILLOTINE)
+    {
+        apBinPackGetMaxSize(page->free_list.rects, page->free_list.size, &max_free);
+    }
+    else
+    {
+        int min_y = INT_MAX;
+        for (int i = 0; i < page->skyline_size; ++i)
+        {
+            if (page->skyline[i].y < min_y)
+                min_y = page->skyline[i].y;
+        }
+        max_free.width = page->page->dimensions.width;
+        max_free.height = page->page->dimensions.height - min_y;
+        // The gaps below the skyline may be taller than the space above it
+        apBinPackGetMaxSize(page->waste_map.rects, page->waste_map.size, &max_free);
+    }
+    page->max_free = max_free;
+}
+
+// ************************************************************************************************************************
+// Page size search
+//
+// Each candidate page width is packed as a strip (i.e. with an unbounded height), which gives the smallest
+// height for that width. The trials run on worker threads, and a trial is aborted as soon as its area
+// exceeds the best area found so far.
+
+#define AP_MIN(_A, _B) ((_A) < (_B) ? (_A) : (_B))
+#define AP_MAX(_A, _B) ((_A) > (_B) ? (_A) : (_B))
+
+#if defined(_WIN32)
+typedef HANDLE              apBinPackThread;
+typedef CRITICAL_SECTION    apBinPackMutex;
+#define AP_MUTEX_INIT(_M)       InitializeCriticalSection(_M)
+#define AP_MUTEX_DESTROY(_M)    DeleteCriticalSection(_M)
+#define AP_MUTEX_LOCK(_M)       EnterCriticalSection(_M)
+#define AP_MUTEX_UNLOCK(_M)     LeaveCriticalSection(_M)
+#else
+typedef pthread_t           apBinPackThread;
+typedef pthread_mutex_t     apBinPackMutex;
+#define AP_MUTEX_INIT(_M)       pthread_mutex_init(_M, 0)
+#define AP_MUTEX_DESTROY(_M)    pthread_mutex_destroy(_M)
+#define AP_MUTEX_LOCK(_M)       pthread_mutex_lock(_M)
+#define AP_MUTEX_UNLOCK(_M)     pthread_mutex_unlock(_M)
+#endif
+
+typedef struct
+{
+    const apBinPackerOptions*   options;
+    const apSize*               sizes;      // The reserved size of each image
+    int                         num_sizes;
+    const int*                  widths;     // The candidate page widths
+    int                         num_widths;
+    int                         max_height;
+    int                         power_of_two;
+
+    apBinPackMutex              mutex;
+    // Protected by the mutex
+    int                         next_width; // Index of the next candidate to try
+    int64_t                     best_area;
+    int                         best_index;
+    apSize                      best_size;
+    apRect*                     best_rects;
+} apBinPackSearch;
+
+static int64_t apBinPackSearchArea(const apBinPackSearch* search, int width, int height)
+{
+    if (search->power_of_two)
+        return (int64_t)apNextPowerOfTwo((uint32_t)width) * apNextPowerOfTwo((uint32_t)height);
+    return (int64_t)width * height;
+}
+
+static int64_t apBinPackSearchGetBestArea(apBinPackSearch* search)
+{
+    AP_MUTEX_LOCK(&search->mutex);
+    int64_t best_area = search->best_area;
+    AP_MUTEX_UNLOCK(&search->mutex);
+    return best_area;
+}
+
+static void apBinPackSearchWorker(apBinPackSearch* search)
+{
+    // Each worker has its own copy, the caller's options are never written to
+    apBinPackerOptions options = *search->options;
+    apRect* rects = (apRect*)malloc(sizeof(apRect) * (size_t)search->num_sizes);
+    while (1)
+    {
+        AP_MUTEX_LOCK(&search->mutex);
+        int index = search->next_width++;
+        int64_t best_area = search->best_area;
+        AP_MUTEX_UNLOCK(&search->mutex);
+        if (index >= search->num_widths)
+            break;
+
+        // The area of the trial page is kept within an int
+        int width = search->widths[index];
+        int max_height = AP_MIN(search->max_height, INT_MAX / width);
+        apBinPackerPage* page = apBinPackerPageCreate(&options, width, max_height);
+
+        int height = 0;
+        int fit = 1;
+        for (int i = 0; i < search->num_sizes && fit; ++i)
+        {
+            // Other trials may have finished in the meantime
+            if ((i & 63) == 63)
+                best_area = apBinPackSearchGetBestArea(search);
+
+            fit = apBinPackerPageInsert(page, search->sizes[i].width, search->sizes[i].height, &rects[i]);
+            if (!fit)
+                break;
+            height = AP_MAX(height, rects[i].pos.y + rects[i].size.height);
+
+            // Equal areas are allowed to finish, so that the narrowest candidate wins regardless of the thread timing
+            if (apBinPackSearchArea(search, width, height) > best_area)
+                fit = 0;
+        }
+        apBinPackerPageDestroy(page);
+
+        if (!fit)
+            continue;
+
+        int64_t area = apBinPackSearchArea(search, width, height);
+        AP_MUTEX_LOCK(&search->mutex);
+        if (area < search->best_area || (area == search->best_area && index < search->best_index))
+        {
+            search->best_area = area;
+            search->best_index = index;
+            search->best_size.width = width;
+            search->best_size.height = height;
+            memcpy(search->best_rects, rects, sizeof(apRect) * (size_t)search->num_sizes);
+        }
+        AP_MUTEX_UNLOCK(&search->mutex);
+    }
+    free((void*)rects);
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI apBinPackSearchThreadMain(LPVOID ctx)
+{
+    apBinPackSearchWorker((apBinPackSearch*)ctx);
+    return 0;
+}
+#else
+static void* apBinPackSearchThreadMain(void* ctx)
+{
+    apBinPackSearchWorker((apBinPackSearch*)ctx);
+    return 0;
+}
+#endif
+
+// Returns the number of candidate widths written
+static int apBinPackSearchCreateWidths(int min_width, int max_width, int power_of_two, int* widths, int max_widths)
+{
+    int num_widths = 0;
+    if (power_of_two)
+    {
+        for (int64_t width = apNextPowerOfTwo((uint32_t)min_width); width <= max_width && num_widths < max_widths; width *= 2)
+            widths[num_widths++] = (int)width;
+        if (num_widths == 0)
+            widths[num_widths++] = max_width;
+        return num_widths;
+    }
+
+    int64_t range = (int64_t)max_width - min_width;
+    for (int i = 0; i < max_widths; ++i)
+    {
+        int width = min_width + (int)(range * i / (max_widths - 1));
+        if (num_widths == 0 || widths[num_widths-1] != width)
+            widths[num_widths++] = width;
+    }
+    return num_widths;
+}
+
+// Searches for the smallest single page that holds all the rects.
+// Returns 0 if no candidate page held all the rects
+static int apBinPackSearchPageSize(const apBinPackerOptions* options, const apOptions* ctx_options,
+                                    const apSize* sizes, int num_sizes, int64_t total_area,
+                                    apSize* page_size, apRect* rects)
+{
+    // The page needs to be as wide as the narrowest side of every rect, and as wide as the square root of the area
+    int min_width = 1;
+    int max_side = 1;
+    int64_t max_height = 0;
+    for (int i = 0; i < num_sizes; ++i)
+    {
+        int width = sizes[i].width;
+        int height = sizes[i].height;
+        int narrow = options->no_rotate ? width : AP_MIN(width, height);
+        min_width = AP_MAX(min_width, narrow);
+        max_side = AP_MAX(max_side, AP_MAX(width, height));
+        // Stacking the rects on top of each other gives an upper bound of the height
+        max_height += options->no_rotate ? height : AP_MAX(width, height);
+    }
+    int sqrt_area = (int)ceil(sqrt((double)total_area));
+    int max_width = AP_MAX(AP_MAX(min_width, max_side), 2 * sqrt_area);
+    min_width = AP_MAX(min_width, sqrt_area / 2);
+
+    if (ctx_options->max_page_width > 0)
+        max_width = AP_MIN(max_width, ctx_options->max_page_width);
+    if (ctx_options->max_page_height > 0 && max_height > ctx_options->max_page_height)
+        max_height = ctx_options->max_page_height;
+    if (max_height > INT_MAX)
+        max_height = INT_MAX;
+    if (min_width > max_width)
+        return 0;
+
+    int widths[64];
+    apBinPackSearch search;
+    memset(&search, 0, sizeof(search));
+    search.options = options;
+    search.sizes = sizes;
+    search.num_sizes = num_sizes;
+    search.widths = widths;
+    search.power_of_two = ctx_options->grow_policy == AP_GROW_POWER_OF_TWO;
+    search.num_widths = apBinPackSearchCreateWidths(min_width, max_width, search.power_of_two, widths, 64);
+    search.max_height = (int)max_height;
+    search.best_area = INT64_MAX;
+    search.best_index = search.num_widths;
+    search.best_rects = rects;
+    AP_MUTEX_INIT(&search.mutex);
+
+    int num_threads = options->num_threads > 0 ? options->num_threads : 4;
+    num_threads = AP_MIN(num_threads, search.num_widths);
+
+    // The calling thread is also a worker
+    apBinPackThread threads[64];
+    int num_workers = 0;
+    for (int i = 1; i < num_threads && num_workers < 64; ++i)
+    {
+#if defined(_WIN32)
+        threads[num_workers] = CreateThread(0, 0, apBinPackSearchThreadMain, &search, 0, 0);
+        if (threads[num_workers])
+            ++num_workers;
+#else
+        if (pthread_create(&threads[num_workers], 0, apBinPackSearchThreadMain, &search) == 0)
+            ++num_workers;
+#endif
+    }
+
+    apBinPackSearchWorker(&search);
+
+    for (int i = 0; i < num_workers; ++i)
+    {
+#if defined(_WIN32)
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i], 0);
+#endif
+    }
+    AP_MUTEX_DESTROY(&search.mutex);
+
+    if (search.best_index == search.num_widths)
+        return 0;
+
+    *page_size = search.best_size;
+    if (search.power_of_two)
+    {
+        page_size->width = (int)apNextPowerOfTwo((uint32_t)page_size->width);
+        page_size->height = (int)apNextPowerOfTwo((uint32_t)page_size->height);
+        if (ctx_options->max_page_width > 0)
+            page_size->width = AP_MIN(page_size->width, ctx_options->max_page_width);
+        if (ctx_options->max_page_height > 0)
+            page_size->height = AP_MIN(page_size->height, ctx_options->max_page_height);
+    }
+    printf("Found page size %d x %d (%d candidates)\n", page_size->width, page_size->height, search.num_widths);
+    return 1;
+}
+
+// ************************************************************************************************************************
+
+// Sets the final placement of the image from its reserved rect, and adds it to the page
+static void apBinPackPlaceImage(apBinPackerPage* page, apImage* image, int width, int inset, int border)
+{
+    page->free_area -= (int64_t)image->placement.size.width * image->placement.size.height;
+
+    image->rotation = image->placement.size.width == width ? 0 : 90;
+
+    // The placement is the part of the reserved rect that holds the image texels
+    image->placement.pos.x += inset;
+    image->placement.pos.y += inset;
+    image->placement.size.width -= border;
+    image->placement.size.height -= border;
+    apPageAddImage(page->page, image);
+
+    image->vertices = apCreateBoxVertices(image->placement.pos, image->placement.size, &image->num_vertices);
+}
+
+// Packs the images [first, last) into a copy of the page. Returns 1 if they all fit
+static int apBinPackTryPackGroup(apBinPackerPage* page, apBinPackerPage* scratch, apContext* ctx, int first, int last, int border)
+{
+    apBinPackCopyPageState(scratch, page);
+    for (int i = first; i < last; ++i)
+    {
+        apImage* image = ctx->images[i];
+        int width = image->trim.size.width + border;
+        int height = image->trim.size.height + border;
+        if (!apBinPackPackRect(scratch, width, height, scratch->allow_rotate, &image->placement))
+            return 0;
+    }
+    return 1;
+}
+
+// Packs the images [first, last) onto one page, growing or adding pages as needed.
+// Returns 0 if the group doesn't fit on a single page
+static int apBinPackPackGroup(apBinPacker* packer, apContext* ctx, int first, int last, int inset, int border, apSize page_dims)
+{
+    while (1)
+    {
+        apBinPackerPage* page = packer->pages;
+        apBinPackerPage* last_page = page;
+        for (; page; page = page->next)
+        {
+            last_page = page;
+            if (apBinPackTryPackGroup(page, &packer->scratch, ctx, first, last, border))
+            {
+                apBinPackSwapPageState(page, &packer->scratch);
+                for (int i = first; i < last; ++i)
+                    apBinPackPlaceImage(page, ctx->images[i], ctx->images[i]->trim.size.width + border, inset, border);
+                return 1;
+            }
+        }
+
+        if (!ctx->options.page_size && apBinPackPackGrowPage(last_page, &ctx->options))
+        {
+            apBinPackUpdatePageSummary(last_page);
+            continue;
+        }
+
+        // If it didn't fit in an empty page, it never will.
+        // Don't leave an empty page behind, if it was opened for this group
+        if (!last_page->page->first_image)
+        {
+            if (last_page != packer->pages)
+                apBinPackDestroyLastPage(packer, ctx);
+            return 0;
+        }
+        apBinPackCreatePage(packer, ctx, page_dims.width, page_dims.height);
+    }
+}
+
+static void apBinPackPackImages(apPacker* _packer, apContext* ctx)
+{
+    apBinPacker* packer = (apBinPacker*)_packer;
+
+    // Each placement reserves room for the extruded borders and padding on both sides,
+    // and the margin to the next image on one side
+    int inset = packer->options.extrude + packer->options.padding;
+    int border = 2 * inset + packer->options.margin;
+
+    // 64 bit, as large texture sets easily exceed 2^31 texels
+    int64_t totalArea = 0;
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        apImage* image = ctx->images[i];
+        if (packer->options.trim && image->data)
+        {
+            if (!apCalcAlphaRect(image->data, image->width, image->height, image->channels, &image->trim))
+            {
+                // Fully transparent, but we still want a valid placement
+                image->trim.size.width = 1;
+                image->trim.size.height = 1;
+            }
+        }
+        image->extrude = packer->options.extrude;
+        int64_t area = (int64_t)(image->trim.size.width + border) * (image->trim.size.height + border);
+        totalArea += area;
+    }
+
+    int page_size = ctx->options.page_size;
+    printf("pagesize: %d\n", page_size);
+    if (page_size == 0)
+    {
+        int bin_size = (int)sqrt((double)totalArea);
+        if (bin_size == 0)
+        {
+            bin_size = 128;
+        }
+        // Make sure the size is a power of two
+        page_size = apNextPowerOfTwo((uint32_t)bin_size);
+        // However, it's usually a better fit to take a smaller size and then grow a bit
+        page_size /= 2;
+    }
+
+    // The size of new pages, and the largest size a page may become
+    apSize page_dims = { page_size, page_size };
+    apSize max_dims = { INT_MAX, INT_MAX };
+    if (ctx->options.page_size)
+        max_dims = page_dims;
+    if (ctx->options.max_page_width > 0)
+        max_dims.width = AP_MIN(max_dims.width, ctx->options.max_page_width);
+    if (ctx->options.max_page_height > 0)
+        max_dims.height = AP_MIN(max_dims.height, ctx->options.max_page_height);
+    page_dims.width = AP_MIN(page_dims.width, max_dims.width);
+    page_dims.height = AP_MIN(page_dims.height, max_dims.height);
+
+    // Clear any pages from a previous packing
+    apBinPackDestroyPages(packer);
+
+    int allow_rotate = !packer->options.no_rotate;
+
+    if (packer->options.search_page_size && ctx->options.page_size == 0 && ctx->num_images > 0)
+    {
+        apSize* sizes = (apSize*)malloc(sizeof(apSize) * (size_t)ctx->num_images);
+        apRect* rects = (apRect*)malloc(sizeof(apRect) * (size_t)ctx->num_images);
+        for (int i = 0; i < ctx->num_images; ++i)
+        {
+            sizes[i].width = ctx->images[i]->trim.size.width + border;
+            sizes[i].height = ctx->images[i]->trim.size.height + border;
+        }
+
+        apSize size;
+        int found = apBinPackSearchPageSize(&packer->options, &ctx->options, sizes, ctx->num_images, totalArea, &size, rects);
+        if (found)
+        {
+            apBinPackerPage* page = apBinPackCreatePage(packer, ctx, size.width, size.height);
+            for (int i = 0; i < ctx->num_images; ++i)
+            {
+                ctx->images[i]->placement = rects[i];
+                apBinPackPlaceImage(page, ctx->images[i], sizes[i].width, inset, border);
+            }
+        }
+        free((void*)sizes);
+        free((void*)rects);
+        if (found)
+            return;
+    }
+
+    apBinPackCreatePage(packer, ctx, page_dims.width, page_dims.height);
+
+// printf("packing...\n");
+// printf("  page size: %d x %d\n", page->page->dimensions.width, page->page->dimensions.height);
+// debugSkyline(page);
+
+    int group_end = 0; // The end of the last group that was handled
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        apImage* image = ctx->images[i];
+        int width = image->trim.size.width + border;
+        int height = image->trim.size.height + border;
+
+        // The images of a group are next to each other (see apPackImages), and are packed onto one page if possible
+        if (image->group && i >= group_end)
+        {
+            group_end = i + 1;
+            while (group_end < ctx->num_images && ctx->images[group_end]->group == image->group)
+                ++group_end;
+
+            if (group_end - i > 1 && apBinPackPackGroup(packer, ctx, i, group_end, inset, border, page_dims))
+            {
+                i = group_end - 1;
+                continue;
+            }
+            // Otherwise, the images are packed one by one
+        }
+
+        if (!(width <= max_dims.width && height <= max_dims.height) &&
+            !(allow_rotate && height <= max_dims.width && width <= max_dims.height))
+        {
+            printf("Image %s (%d x %d) is larger than the max page size %d x %d\n", image->path, width, height, max_dims.width, max_dims.height);
+            image->page = -1;
+            continue;
+        }
+
+        // Try all open pages, so that smaller images can backfill the earlier pages
+        int fit = 0;
+        apBinPackerPage* page = packer->pages;
+        for (; page; page = page->next)
+        {
+            if (!apBinPackPageMayFit(page, width, height, allow_rotate))
+                continue;
+
+            fit = apBinPackPackRect(page, width, height, allow_rotate, &image->placement);
+            if (fit)
+                break;
+
+            apBinPackUpdatePageSummary(page);
+        }
+
+        if (fit)
+        {
+            apBinPackPlaceImage(page, image, width, inset, border);
+
+// printf("  rotation: %d   pos: %d, %d  %d, %d\n", image->rotation,
+//         image->placement.pos.x, image->placement.pos.y, image->placement.size.width, image->placement.size.height);
+        }
+
+        if (!fit)
+        {
+            // Grow the last page, or create a new page if it has reached its max size
+            page = packer->pages;
+            while (page->next)
+                page = page->next;
+
+            if (ctx->options.page_size || !apBinPackPackGrowPage(page, &ctx->options))
+                apBinPackCreatePage(packer, ctx, page_dims.width, page_dims.height);
+            else
+                apBinPackUpdatePageSummary(page);
+
+            // Try to refit this image again
+            --i;
+            continue;
+        }
+
+        //debugSkyline(page);
+    }
+
+}
+
+#undef AP_MIN
+#undef AP_MAX
+
+void apBinPackerSetDefaultOptions(apBinPackerOptions* options)
+{
+    memset(options, 0, sizeof(apBinPackerOptions));
+    options->mode = AP_BP_MODE_DEFAULT;
+    options->num_threads = 4;
+}
+
+apPacker* apBinPackerCreate(apBinPackerOptions* options)
+{
+    apBinPacker* packer = (apBinPacker*)malloc(sizeof(apBinPacker));
+    memset(packer, 0, sizeof(apBinPacker));
+    packer->super.packer_type = "apBinPacker";
+    packer->super.createImage = apBinPackCreateImage;
+    packer->super.destroyImage = apBinPackDestroyImage;
+    packer->super.packImages = apBinPackPackImages;
+    packer->options = *options;
+    return (apPacker*)packer;
+}
+
+void apBinPackerDestroy(apPacker* packer)
+{
+    apBinPackDestroyPages((apBinPacker*)packer);
+    free((void*)packer);
+}
+
+apBinPackerPage* apBinPackerPageCreate(apBinPackerOptions* options, int width, int height)
+{
+    apBinPackerPage* page = (apBinPackerPage*)malloc(sizeof(apBinPackerPage));
+    memset(page, 0, sizeof(apBinPackerPage));
+    page->page = (apPage*)malloc(sizeof(apPage));
+    memset(page->page, 0, sizeof(apPage));
+    page->page->dimensions.width = width;
+    page->page->dimensions.height = height;
+    page->owns_page = 1;
+
+    apBinPackInitPage(page, options);
+    return page;
+}
+
+void apBinPackerPageDestroy(apBinPackerPage* page)
+{
+    apBinPackDestroyPage(page);
+}
+
+void apBinPackerPageReset(apBinPackerPage* page)
+{
+    page->skyline_size = 0;
+    page->free_rects_size = 0;
+    page->new_rects_size = 0;
+    apBinPackFreeListClear(&page->free_list);
+    apBinPackFreeListClear(&page->waste_map);
+
+    apBinPackerOptions options;
+    memset(&options, 0, sizeof(options));
+    options.mode = page->mode;
+    options.no_rotate = !page->allow_rotate;
+    options.split = page->split;
+    options.no_merge = !page->merge;
+    options.waste_map = page->use_waste_map;
+    apBinPackInitPage(page, &options);
+}
+
+int apBinPackerPageInsert(apBinPackerPage* page, int width, int height, apRect* rect)
+{
+    if (!apBinPackPageMayFit(page, width, height, page->allow_rotate))
+        return 0;
+
+    if (!apBinPackPackRect(page, width, height, page->allow_rotate, rect))
+    {
+        apBinPackUpdatePageSummary(page);
+        return 0;
+    }
+    page->free_area -= (int64_t)width * height;
+    return 1;
+}
+
+float apBinPackerPageGetOccupancy(const apBinPackerPage* page)
+{
+    float area = (float)page->page->dimensions.width * (float)page->page->dimensions.height;
+    return area > 0 ? 1.0f - (float)page->free_area / area : 0.0f;
 }
@@ -0,0 +1,446 @@
+// https://github.com/JCash/atlaspacker
+// License: MIT
+// @2021-@2023 Mathias Westerdahl
+
+#include <atlaspacker/contour.h>
+#include <atlaspacker/atlaspacker.h>
+
+#include <math.h> // fabsf, sqrtf
+#include <stdlib.h> // malloc
+#include <string.h> // memset
+
+// The borders are directed edges between the texel corners, with the non empty texel on the right hand side
+// (i.e. cross(edge, p - start) < 0), for both outer contours and holes.
+//
+// Horizontal edges: (width * (height+1)), the edge (x,y) -> (x+1,y) is at index y*width + x
+// Vertical edges: ((width+1) * height), the edge (x,y) -> (x,y+1) is at index y*(width+1) + x
+// The value is the direction along the axis (+1 or -1), or 0 if there is no edge (or it's already traced)
+
+typedef struct
+{
+    int         width;
+    int         height;
+    int8_t*     hedges;
+    int8_t*     vedges;
+} apContourEdges;
+
+typedef struct
+{
+    int capacity;
+    int size;
+    apPos* points;  // The start point of each edge
+    int* dirs;      // The direction of each edge (0: +x, 1: +y, 2: -x, 3: -y)
+} apContourTrace;
+
+static const int g_DirX[4] = { 1, 0, -1, 0 };
+static const int g_DirY[4] = { 0, 1, 0, -1 };
+
+static int apContourIsSet(const uint8_t* image, int width, int height, int x, int y)
+{
+    if (x < 0 || y < 0 || x >= width || y >= height)
+        return 0;
+    return image[y * width + x] != 0;
+}
+
+static void apContourCreateEdges(apContourEdges* edges, const uint8_t* image, int width, int height)
+{
+    edges->width = width;
+    edges->height = height;
+    edges->hedges = (int8_t*)malloc((size_t)width * (size_t)(height + 1));
+    edges->vedges = (int8_t*)malloc((size_t)(width + 1) * (size_t)height);
+
+    for (int y = 0; y <= height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            int above = apContourIsSet(image, width, height, x, y - 1);
+            int below = apContourIsSet(image, width, height, x, y);
+            edges->hedges[y * width + x] = (int8_t)(above == below ? 0 : (above ? 1 : -1));
+        }
+    }
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x <= width; ++x)
+        {
+            int left = apContourIsSet(image, width, height, x - 1, y);
+            int right = apContourIsSet(image, width, height, x, y);
+            edges->vedges[y * (width + 1) + x] = (int8_t)(left == right ? 0 : (right ? 1 : -1));
+        }
+    }
+}
+
+// Returns the edge flag for an edge starting at (x,y) in the direction dir, or 0 if there is none
+static int8_t* apContourGetEdge(apContourEdges* edges, int x, int y, int dir)
+{
+    int width = edges->width;
+    int height = edges->height;
+    int8_t* edge = 0;
+    int8_t value = 0;
+    switch(dir)
+    {
+    case 0: if (x < width && y <= height) { edge = &edges->hedges[y * width + x]; value = 1; } break;
+    case 1: if (y < height && x <= width) { edge = &edges->vedges[y * (width + 1) + x]; value = 1; } break;
+    case 2: if (x > 0 && y <= height) { edge = &edges->hedges[y * width + x - 1]; value = -1; } break;
+    case 3: if (y > 0 && x <= width) { edge = &edges->vedges[(y - 1) * (width + 1) + x]; value = -1; } break;
+    }
+    if (!edge || *edge != value)
+        return 0;
+    return edge;
+}
+
+static void apContourTraceAdd(apContourTrace* trace, int x, int y, int dir)
+{
+    if (trace->size == trace->capacity)
+    {
+        trace->capacity = trace->capacity ? trace->capacity * 2 : 256;
+        trace->points = (apPos*)realloc(trace->points, sizeof(apPos) * (size_t)trace->capacity);
+        trace->dirs = (int*)realloc(trace->dirs, sizeof(int) * (size_t)trace->capacity);
+    }
+    trace->points[trace->size].x = x;
+    trace->points[trace->size].y = y;
+    trace->dirs[trace->size] = dir;
+    trace->size++;
+}
+
+// Returns 1 if there's an edge from (x,y) in the direction dir, i.e. the texel to the right is set, and the texel to the left isn't
+static int apContourHasEdge(const uint8_t* image, int width, int height, int x, int y, int dir)
+{
+    static const int right_x[4] = { 0,  0, -1, -1 };
+    static const int right_y[4] = { -1, 0,  0, -1 };
+    static const int left_x[4] =  { 0, -1, -1,  0 };
+    static const int left_y[4] =  { 0,  0, -1, -1 };
+    return apContourIsSet(image, width, height, x + right_x[dir], y + right_y[dir]) &&
+          !apContourIsSet(image, width, height, x + left_x[dir], y + left_y[dir]);
+}
+
+// Follows the edges from the start edge until it's back at the start.
+// At a corner where two texels only touch diagonally, it turns towards the non empty side,
+// which keeps the two texels in separate contours.
+static void apContourFollow(apContourEdges* edges, const uint8_t* image, int x, int y, int dir, apContourTrace* trace)
+{
+    int width = edges->width;
+    int height = edges->height;
+    int start_x = x;
+    int start_y = y;
+    int start_dir = dir;
+
+    trace->size = 0;
+    do
+    {
+        int8_t* edge = apContourGetEdge(edges, x, y, dir);
+        if (edge)
+            *edge = 0; // Mark as traced
+        apContourTraceAdd(trace, x, y, dir);
+        x += g_DirX[dir];
+        y += g_DirY[dir];
+
+        // The non empty side is to the right, i.e. (dir + 3) % 4
+        int candidates[3] = { (dir + 3) & 3, dir, (dir + 1) & 3 };
+        for (int c = 0; c < 3; ++c)
+        {
+            if (apContourHasEdge(image, width, height, x, y, candidates[c]))
+            {
+                dir = candidates[c];
+                break;
+            }
+        }
+    } while (x != start_x || y != start_y || dir != start_dir);
+}
+
+static float apContourSignedArea(const apPosf* vertices, int num_vertices)
+{
+    double area = 0;
+    for (int i = 0; i < num_vertices; ++i)
+    {
+        const apPosf* a = &vertices[i];
+        const apPosf* b = &vertices[(i+1) % num_vertices];
+        area += (double)a->x * b->y - (double)b->x * a->y;
+    }
+    return (float)(area * 0.5);
+}
+
+static int apContourInside(const apContour* contour, apPosf p)
+{
+    int inside = 0;
+    for (int i = 0, j = contour->num_vertices - 1; i < contour->num_vertices; j = i++)
+    {
+        apPosf a = contour->vertices[i];
+        apPosf b = contour->vertices[j];
+        if (((a.y > p.y) != (b.y > p.y)) && (p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x))
+            inside = !inside;
+    }
+    return inside;
+}
+
+int apContourFromImage(const uint8_t* image, int width, int height, apContour** out_contours)
+{
+    apContourEdges edges;
+    apContourCreateEdges(&edges, image, width, height);
+
+    apContourTrace trace;
+    memset(&trace, 0, sizeof(trace));
+
+    int capacity = 0;
+    int num_contours = 0;
+    apContour* contours = 0;
+    apPosf* probes = 0;
+
+    // Each contour has at least one horizontal edge
+    for (int y = 0; y <= height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            int8_t value = edges.hedges[y * width + x];
+            if (!value)
+                continue;
+
+            if (value > 0)
+                apContourFollow(&edges, image, x, y, 0, &trace);
+            else
+                apContourFollow(&edges, image, x + 1, y, 2, &trace);
+
+            // Only keep the corners
+            int num_vertices = 0;
+            for (int i = 0; i < trace.size; ++i)
+                num_vertices += trace.dirs[i] != trace.dirs[(i + trace.size - 1) % trace.size] ? 1 : 0;
+
+            if (num_contours == capacity)
+            {
+                capacity = capacity ? capacity * 2 : 8;
+                contours = (apContour*)realloc(contours, sizeof(apContour) * (size_t)capacity);
+                probes = (apPosf*)realloc(probes, sizeof(apPosf) * (size_t)capacity);
+            }
+            apContour* contour = &contours[num_contours];
+            contour->vertices = (apPosf*)malloc(sizeof(apPosf) * (size_t)num_vertices);
+            contour->num_vertices = 0;
+            for (int i = 0; i < trace.size; ++i)
+            {
+                if (trace.dirs[i] == trace.dirs[(i + trace.size - 1) % trace.size])
+                    continue;
+                apPosf p = { (float)trace.points[i].x, (float)trace.points[i].y };
+                contour->vertices[contour->num_vertices++] = p;
+            }
+
+            // Outer contours have a negative area
+            if (apContourSignedArea(contour->vertices, contour->num_vertices) > 0)
+            {
+                // For holes, we keep the center of a non empty texel next to it, to find the outer contour
+                int dir = trace.dirs[0];
+                int right = (dir + 3) & 3;
+                probes[num_contours].x = trace.points[0].x + 0.5f * g_DirX[dir] + 0.5f * g_DirX[right];
+                probes[num_contours].y = trace.points[0].y + 0.5f * g_DirY[dir] + 0.5f * g_DirY[right];
+                contour->parent = 0;
+            }
+            else
+            {
+                contour->parent = -1;
+            }
+            num_contours++;
+        }
+    }
+
+    free((void*)trace.points);
+    free((void*)trace.dirs);
+    free((void*)edges.hedges);
+    free((void*)edges.vedges);
+
+    // The parent is the smallest outer contour that contains the hole
+    for (int i = 0; i < num_contours; ++i)
+    {
+        if (contours[i].parent < 0)
+            continue;
+
+        int parent = -1;
+        float parent_area = 0;
+        for (int j = 0; j < num_contours; ++j)
+        {
+            if (contours[j].parent >= 0 || !apContourInside(&contours[j], probes[i]))
+                continue;
+            float area = -apContourSignedArea(contours[j].vertices, contours[j].num_vertices);
+            if (parent < 0 || area < parent_area)
+            {
+                parent = j;
+                parent_area = area;
+            }
+        }
+        contours[i].parent = parent;
+
+        // A hole without an outer contour would be filled as an outer contour, so it's dropped
+        if (parent < 0)
+        {
+            free((void*)contours[i].vertices);
+            contours[i].vertices = 0;
+            contours[i].num_vertices = 0;
+        }
+    }
+    free((void*)probes);
+
+    int* remap = (int*)malloc(sizeof(int) * (size_t)(num_contours + 1));
+    int num_kept = 0;
+    for (int i = 0; i < num_contours; ++i)
+    {
+        remap[i] = num_kept;
+        if (contours[i].num_vertices)
+            contours[num_kept++] = contours[i];
+    }
+    for (int i = 0; i < num_kept; ++i)
+    {
+        if (contours[i].parent >= 0)
+            contours[i].parent = remap[contours[i].parent];
+    }
+    num_contours = num_kept;
+    free((void*)remap);
+
+    *out_contours = contours;
+    return num_contours;
+}
+
+void apContourDestroy(apContour* contours, int num_contours)
+{
+    for (int i = 0; i < num_contours; ++i)
+        free((void*)contours[i].vertices);
+    free((void*)contours);
+}
+
+// ************************************************************************************************************************
+// Simplification
+
+// Returns 1 if the segment passes through the inside of any non empty texel.
+// The end points are texel corners, so the segment always spans whole columns
+static int apContourSegmentHitsTexels(const uint8_t* image, int width, int height, apPosf a, apPosf b)
+{
+    if (a.x == b.x || a.y == b.y)
+        return 0; // Along the texel borders
+    if (a.x > b.x)
+    {
+        apPosf t = a; a = b; b = t;
+    }
+    float slope = (b.y - a.y) / (b.x - a.x);
+    for (int x = (int)a.x; x < (int)b.x; ++x)
+    {
+        float y0 = a.y + slope * (x - a.x);
+        float y1 = a.y + slope * (x + 1 - a.x);
+        float ymin = y0 < y1 ? y0 : y1;
+        float ymax = y0 < y1 ? y1 : y0;
+        // The rows whose open interval (y, y+1) overlaps (ymin, ymax)
+        for (int y = (int)floorf(ymin); y < (int)ceilf(ymax); ++y)
+        {
+            if (apContourIsSet(image, width, height, x, y))
+                return 1;
+        }
+    }
+    return 0;
+}
+
+// Checks if the vertices between start and end (exclusive) can be replaced by a straight line.
+// Returns the index of the vertex to split at if not, or -1 if they can
+static int apContourCanSimplify(const apPosf* vertices, int num_vertices, int start, int end, float max_error,
+                                const uint8_t* image, int width, int height)
+{
+    apPosf a = vertices[start];
+    apPosf b = vertices[end % num_vertices];
+    apPosf d = { b.x - a.x, b.y - a.y };
+    float length = sqrtf(d.x * d.x + d.y * d.y);
+
+    int valid = 1;
+    int max_index = (start + end) / 2;
+    float max_distance = -1.0f;
+    for (int i = start + 1; i < end; ++i)
+    {
+        apPosf p = vertices[i % num_vertices];
+        float cross = d.x * (p.y - a.y) - d.y * (p.x - a.x);
+        float distance = length > 0.0f ? fabsf(cross) / length : sqrtf((p.x - a.x) * (p.x - a.x) + (p.y - a.y) * (p.y - a.y));
+
+        // The removed vertices must be on the non empty side (the right), or the line would cut into the texels
+        if (cross > 0.0f || distance > max_error)
+            valid = 0;
+        if (distance > max_distance)
+        {
+            max_distance = distance;
+            max_index = i;
+        }
+    }
+
+    if (valid && length > 0.0f && !apContourSegmentHitsTexels(image, width, height, a, b))
+        return -1;
+    return max_index;
+}
+
+static int apContourSimplifyOne(apContour* contour, const uint8_t* image, int width, int height, float max_error)
+{
+    int num_vertices = contour->num_vertices;
+    if (num_vertices <= 4)
+        return num_vertices;
+
+    uint8_t* keep = (uint8_t*)malloc((size_t)num_vertices);
+    memset(keep, 0, (size_t)num_vertices);
+    int* stack = (int*)malloc(sizeof(int) * 2 * (size_t)(num_vertices + 1));
+    int stack_size = 0;
+
+    // The closed contour is split into two parts, at the vertex furthest away from the first vertex
+    int far_index = 0;
+    float far_distance = 0;
+    for (int i = 1; i < num_vertices; ++i)
+    {
+        float dx = contour->vertices[i].x - contour->vertices[0].x;
+        float dy = contour->vertices[i].y - contour->vertices[0].y;
+        if (dx * dx + dy * dy > far_distance)
+        {
+            far_distance = dx * dx + dy * dy;
+            far_index = i;
+        }
+    }
+    keep[0] = 1;
+    keep[far_index] = 1;
+    stack[stack_size++] = 0;
+    stack[stack_size++] = far_index;
+    stack[stack_size++] = far_index;
+    stack[stack_size++] = num_vertices; // i.e. vertex 0
+
+    while (stack_size)
+    {
+        int end = stack[--stack_size];
+        int start = stack[--stack_size];
+        if (end - start < 2)
+            continue;
+
+        int split = apContourCanSimplify(contour->vertices, num_vertices, start, end, max_error, image, width, height);
+        if (split < 0)
+            continue;
+
+        keep[split] = 1;
+        stack[stack_size++] = start;
+        stack[stack_size++] = split;
+        stack[stack_size++] = split;
+        stack[stack_size++] = end;
+    }
+
+    int num_kept = 0;
+    for (int i = 0; i < num_vertices; ++i)
+        num_kept += keep[i];
+
+    // A contour always keeps some area, but let's make sure
+    if (num_kept >= 3)
+    {
+        num_kept = 0;
+        for (int i = 0; i < num_vertices; ++i)
+        {
+            if (keep[i])
+                contour->vertices[num_kept++] = contour->vertices[i];
+        }
+    }
+    else
+    {
+        num_kept = num_vertices;
+    }
+
+    free((void*)stack);
+    free((void*)keep);
+    return num_kept;
+}
+
+void apContourSimplify(apContour* contours, int num_contours, const uint8_t* image, int width, int height, float max_error)
+{
+    for (int i = 0; i < num_contours; ++i)
+        contours[i].num_vertices = apContourSimplifyOne(&contours[i], image, width, height, max_error);
+}
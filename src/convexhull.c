@@ -6,15 +6,13 @@
 #include <atlaspacker/atlaspacker.h>
 
 #include <stdlib.h> // malloc
+#include <string.h> // memcpy
 #include <stdio.h> // printf
 #include <math.h> // cosf/sinf
 #ifndef  M_PI
 #define  M_PI  3.1415926535897932384626433
 #endif
 
-static const uint8_t TILE_VALUE_DEFAULT = 1;
-static const uint8_t TILE_VALUE_VISITED = 2;
-
 typedef struct
 {
     int num_planes;
@@ -23,40 +21,120 @@ typedef struct
 } apConvexHull;
 
 
-static int apConvexHullCalculatePlanes(apConvexHull* hull, uint8_t* image, int width, int height)
+// Unit normals at every 2*pi/64 radians. Any plane count that divides 64 can use every n'th entry
+#define AP_HULL_NORMAL_TABLE_SIZE 64
+static const apPosf g_HullNormals[AP_HULL_NORMAL_TABLE_SIZE] = {
+    { 1.000000000f, 0.000000000f }, { 0.995184727f, 0.098017140f },
+    { 0.980785280f, 0.195090322f }, { 0.956940336f, 0.290284677f },
+    { 0.923879533f, 0.382683432f }, { 0.881921264f, 0.471396737f },
+    { 0.831469612f, 0.555570233f }, { 0.773010453f, 0.634393284f },
+    { 0.707106781f, 0.707106781f }, { 0.634393284f, 0.773010453f },
+    { 0.555570233f, 0.831469612f }, { 0.471396737f, 0.881921264f },
+    { 0.382683432f, 0.923879533f }, { 0.290284677f, 0.956940336f },
+    { 0.195090322f, 0.980785280f }, { 0.098017140f, 0.995184727f },
+    { 0.000000000f, 1.000000000f }, { -0.098017140f, 0.995184727f },
+    { -0.195090322f, 0.980785280f }, { -0.290284677f, 0.956940336f },
+    { -0.382683432f, 0.923879533f }, { -0.471396737f, 0.881921264f },
+    { -0.555570233f, 0.831469612f }, { -0.634393284f, 0.773010453f },
+    { -0.707106781f, 0.707106781f }, { -0.773010453f, 0.634393284f },
+    { -0.831469612f, 0.555570233f }, { -0.881921264f, 0.471396737f },
+    { -0.923879533f, 0.382683432f }, { -0.956940336f, 0.290284677f },
+    { -0.980785280f, 0.195090322f }, { -0.995184727f, 0.098017140f },
+    { -1.000000000f, 0.000000000f }, { -0.995184727f, -0.098017140f },
+    { -0.980785280f, -0.195090322f }, { -0.956940336f, -0.290284677f },
+    { -0.923879533f, -0.382683432f }, { -0.881921264f, -0.471396737f },
+    { -0.831469612f, -0.555570233f }, { -0.773010453f, -0.634393284f },
+    { -0.707106781f, -0.707106781f }, { -0.634393284f, -0.773010453f },
+    { -0.555570233f, -0.831469612f }, { -0.471396737f, -0.881921264f },
+    { -0.382683432f, -0.923879533f }, { -0.290284677f, -0.956940336f },
+    { -0.195090322f, -0.980785280f }, { -0.098017140f, -0.995184727f },
+    { 0.000000000f, -1.000000000f }, { 0.098017140f, -0.995184727f },
+    { 0.195090322f, -0.980785280f }, { 0.290284677f, -0.956940336f },
+    { 0.382683432f, -0.923879533f }, { 0.471396737f, -0.881921264f },
+    { 0.555570233f, -0.831469612f }, { 0.634393284f, -0.773010453f },
+    { 0.707106781f, -0.707106781f }, { 0.773010453f, -0.634393284f },
+    { 0.831469612f, -0.555570233f }, { 0.881921264f, -0.471396737f },
+    { 0.923879533f, -0.382683432f }, { 0.956940336f, -0.290284677f },
+    { 0.980785280f, -0.195090322f }, { 0.995184727f, -0.098017140f },
+};
+
+static void apConvexHullCalculateNormals(apConvexHull* hull)
 {
-    int empty = 1;
-
     int num_planes = hull->num_planes;
-    for (int i = 0; i < num_planes; ++i)
+    if (num_planes <= AP_HULL_NORMAL_TABLE_SIZE && (AP_HULL_NORMAL_TABLE_SIZE % num_planes) == 0)
     {
-        hull->distances[i] = -1000000.0f;
+        int step = AP_HULL_NORMAL_TABLE_SIZE / num_planes;
+        for (int i = 0; i < num_planes; ++i)
+            hull->normals[i] = g_HullNormals[i * step];
+        return;
+    }
 
+    for (int i = 0; i < num_planes; ++i)
+    {
         float angle = i * 2.0f * M_PI / (float)num_planes;
         hull->normals[i].x = cosf(angle);
         hull->normals[i].y = sinf(angle);
         hull->normals[i] = apMathNormalize(hull->normals[i]);
     }
+}
+
+// Returns the first non zero texel in [x, end), or end if there is none
+static int apConvexHullScanRow(const uint8_t* row, int x, int end)
+{
+    // Skip empty texels 8 at a time
+    for (; x + 8 <= end; x += 8)
+    {
+        uint64_t texels;
+        memcpy(&texels, row + x, sizeof(texels));
+        if (texels)
+            break;
+    }
+    for (; x < end; ++x)
+    {
+        if (row[x])
+            return x;
+    }
+    return end;
+}
+
+// Only the leftmost and rightmost texel of each row can lie on the hull,
+// so we only project those onto the planes, instead of every texel in the image
+static int apConvexHullCalculatePlanes(apConvexHull* hull, uint8_t* image, int width, int height)
+{
+    int empty = 1;
+
+    int num_planes = hull->num_planes;
+    apConvexHullCalculateNormals(hull);
+    for (int i = 0; i < num_planes; ++i)
+        hull->distances[i] = -1000000.0f;
 
-    apPos center = { width / 2.0f, height / 2.0f };
+    apPosf center = { width / 2.0f, height / 2.0f };
     for (int y = 0; y < height; ++y)
     {
-        for (int x = 0; x < width; ++x)
-        {
-            if (!image[y * width + x])
-                continue;
+        const uint8_t* row = image + y * width;
+        int left = apConvexHullScanRow(row, 0, width);
+        if (left == width)
+            continue;
 
-            empty = 0;
+        int right = width - 1;
+        while (!row[right])
+            --right;
 
-            apPosf pos = { x + 0.5f - center.x, y + 0.5f - center.y };
-            for (int p = 0; p < num_planes; ++p)
-            {
-                apPosf dir = hull->normals[p];
+        empty = 0;
 
-                float distance = apMathDot(dir, pos);
-                if (distance > hull->distances[p])
-                    hull->distances[p] = distance;
-            }
+        float py = y + 0.5f - center.y;
+        float pleft = left + 0.5f - center.x;
+        float pright = right + 0.5f - center.x;
+        for (int p = 0; p < num_planes; ++p)
+        {
+            apPosf dir = hull->normals[p];
+
+            // The plane distance is linear in x, so the max is at one of the ends
+            float px = dir.x < 0.0f ? pleft : pright;
+            apPosf pos = { px, py };
+            float distance = apMathDot(dir, pos);
+            if (distance > hull->distances[p])
+                hull->distances[p] = distance;
         }
     }
 
@@ -152,184 +230,704 @@ apPosf* apConvexHullFromImage(int num_planes, uint8_t* image, int width, int hei
     hull.distances = (float*)malloc(sizeof(float)*num_planes);
 
     int valid = apConvexHullCalculatePlanes(&hull, image, width, height);
-    if (!valid)
-        return 0;
-
-    apPosf* vertices = apConvexHullCalculateVertices(&hull, width, height);
+    apPosf* vertices = valid ? apConvexHullCalculateVertices(&hull, width, height) : 0;
 
     free((void*)hull.normals);
     free((void*)hull.distances);
 
+    if (!valid)
+        return 0;
+
     *num_vertices = num_planes; // until we simplify the hull
     return vertices;
 }
 
 // ************************************************************************************************************************
+// Exact hull
 
-// Checks if the box can grow by one to the right and/or bottom
-static int CanGrowBoxByOne(int width, int height, uint8_t* data, int bx, int by, int bwidth, int bheight, int* growx, int* growy)
+typedef struct
 {
-    *growx = 0;
-    *growy = 0;
-    int x = bx + bwidth;
-    if (x < width)
+    int x, y;
+} apHullPoint;
+
+static int apHullSortPoints(const void* _a, const void* _b)
+{
+    const apHullPoint* a = (const apHullPoint*)_a;
+    const apHullPoint* b = (const apHullPoint*)_b;
+    if (a->x != b->x)
+        return a->x < b->x ? -1 : 1;
+    if (a->y != b->y)
+        return a->y < b->y ? -1 : 1;
+    return 0;
+}
+
+static int64_t apHullCross(apHullPoint o, apHullPoint a, apHullPoint b)
+{
+    return (int64_t)(a.x - o.x) * (b.y - o.y) - (int64_t)(a.y - o.y) * (b.x - o.x);
+}
+
+// Calculates the exact convex hull of the non empty texels (using the texel corners), in texel space.
+// Only the corners of the leftmost and rightmost texel of each row are used (see apConvexHullCalculatePlanes)
+// Returns the number of vertices (in positive/CCW order, with no collinear vertices), or 0 if the image is empty
+static int apConvexHullCalculateExact(const uint8_t* image, int width, int height, apPosf** out_vertices)
+{
+    apHullPoint* points = (apHullPoint*)malloc(sizeof(apHullPoint) * 4 * (size_t)height);
+    int num_points = 0;
+    for (int y = 0; y < height; ++y)
     {
-        *growx = 1;
-        for (int y = by; y < (by + bheight) && y < height; ++y)
-        {
-            if (data[y*width+x] == 1)
-                continue;
+        const uint8_t* row = image + y * width;
+        int left = apConvexHullScanRow(row, 0, width);
+        if (left == width)
+            continue;
+
+        int right = width - 1;
+        while (!row[right])
+            --right;
+
+        apHullPoint corners[4] = { {left, y}, {left, y + 1}, {right + 1, y}, {right + 1, y + 1} };
+        for (int c = 0; c < 4; ++c)
+            points[num_points++] = corners[c];
+    }
 
-             // if we find a zero, we can't expand the box in this direction
-            *growx = 0;
-            break;
-        }
+    if (num_points == 0)
+    {
+        free((void*)points);
+        return 0;
     }
 
-    int y = by + bheight;
-    if (y < height)
+    // Andrew's monotone chain
+    qsort(points, (size_t)num_points, sizeof(apHullPoint), apHullSortPoints);
+
+    apHullPoint* hull = (apHullPoint*)malloc(sizeof(apHullPoint) * 2 * (size_t)num_points);
+    int size = 0;
+    for (int i = 0; i < num_points; ++i)
     {
-        *growy = 1;
-        for (int x = bx; x < (bx + bwidth) && x < width; ++x)
-        {
-            if (data[y*width+x] == 1)
-                continue;
+        while (size >= 2 && apHullCross(hull[size-2], hull[size-1], points[i]) <= 0)
+            --size;
+        hull[size++] = points[i];
+    }
+    int lower_size = size + 1;
+    for (int i = num_points - 2; i >= 0; --i)
+    {
+        while (size >= lower_size && apHullCross(hull[size-2], hull[size-1], points[i]) <= 0)
+            --size;
+        hull[size++] = points[i];
+    }
+    --size; // The last point is the same as the first
+
+    apPosf* vertices = (apPosf*)malloc(sizeof(apPosf) * (size_t)size);
+    for (int i = 0; i < size; ++i)
+    {
+        vertices[i].x = (float)hull[i].x;
+        vertices[i].y = (float)hull[i].y;
+    }
+    free((void*)hull);
+    free((void*)points);
+
+    *out_vertices = vertices;
+    return size;
+}
+
+static float apConvexHullArea(const apPosf* vertices, int num_vertices)
+{
+    double area = 0;
+    for (int i = 0; i < num_vertices; ++i)
+    {
+        const apPosf* a = &vertices[i];
+        const apPosf* b = &vertices[(i+1) % num_vertices];
+        area += (double)a->x * b->y - (double)b->x * a->y;
+    }
+    return (float)(area * 0.5);
+}
+
+// The cost of removing the edge (i, i+1) by extending its neighbouring edges until they meet.
+// Returns the added area, or a negative value if the edges don't meet inside the image bounds
+static float apConvexHullEdgeRemovalCost(const apPosf* vertices, int num_vertices, int i, int width, int height, apPosf* out)
+{
+    apPosf prev = vertices[(i + num_vertices - 1) % num_vertices];
+    apPosf a = vertices[i];
+    apPosf b = vertices[(i + 1) % num_vertices];
+    apPosf next = vertices[(i + 2) % num_vertices];
+
+    apPosf d1 = apMathSub(a, prev);
+    apPosf d2 = apMathSub(next, b);
+    apPosf ab = apMathSub(b, a);
+    float denom = d1.x * d2.y - d1.y * d2.x;
+    if (denom <= 1e-6f)
+        return -1.0f; // The edges are parallel, or diverge
+
+    float t = (ab.x * d2.y - ab.y * d2.x) / denom;
+    float u = (ab.x * d1.y - ab.y * d1.x) / denom;
+    if (t < 0.0f || u > 0.0f)
+        return -1.0f;
+
+    apPosf p = { a.x + d1.x * t, a.y + d1.y * t };
+    const float epsilon = 0.001f;
+    if (p.x < -epsilon || p.y < -epsilon || p.x > width + epsilon || p.y > height + epsilon)
+        return -1.0f;
+
+    *out = p;
+    apPosf ap = apMathSub(p, a);
+    return 0.5f * (ap.x * ab.y - ap.y * ab.x);
+}
 
-             // if we find a zero, we can't expand the box in this direction
-            *growy = 0;
+// Greedily removes the edge that adds the least area, until max_vertices is reached (or no edge can be removed).
+// Keeps the polygon that minimizes: vertex_cost * num_vertices + area
+static int apConvexHullReduce(apPosf* vertices, int num_vertices, int width, int height, int max_vertices, float vertex_cost, apPosf* best, float* best_cost)
+{
+    float area = apConvexHullArea(vertices, num_vertices);
+    int num_best = 0;
+    *best_cost = 0;
+    if (num_vertices <= max_vertices)
+    {
+        memcpy(best, vertices, sizeof(apPosf) * (size_t)num_vertices);
+        num_best = num_vertices;
+        *best_cost = vertex_cost * num_vertices + area;
+    }
+
+    while (num_vertices > 3)
+    {
+        int min_index = -1;
+        float min_area = 0;
+        apPosf min_point = { 0, 0 };
+        for (int i = 0; i < num_vertices; ++i)
+        {
+            apPosf p;
+            float added = apConvexHullEdgeRemovalCost(vertices, num_vertices, i, width, height, &p);
+            if (added >= 0.0f && (min_index < 0 || added < min_area))
+            {
+                min_index = i;
+                min_area = added;
+                min_point = p;
+            }
+        }
+        if (min_index < 0)
             break;
+
+        // Replace the two vertices of the edge with the intersection
+        int j = (min_index + 1) % num_vertices;
+        vertices[min_index] = min_point;
+        memmove(vertices + j, vertices + j + 1, sizeof(apPosf) * (size_t)(num_vertices - j - 1));
+        --num_vertices;
+        area += min_area;
+
+        float cost = vertex_cost * num_vertices + area;
+        if (num_vertices <= max_vertices && (num_best == 0 || cost < *best_cost))
+        {
+            memcpy(best, vertices, sizeof(apPosf) * (size_t)num_vertices);
+            num_best = num_vertices;
+            *best_cost = cost;
         }
     }
+    return num_best;
+}
 
-    int corner_x = bx+bwidth;
-    int corner_y = by+bheight;
-    int corner = (corner_x < width && corner_y < height) ? data[corner_y*width + corner_x] != 0 : 0;
+apPosf* apConvexHullFromImageAdaptive(uint8_t* image, int width, int height, int max_vertices, float vertex_cost, int* num_vertices)
+{
+    apPosf* hull = 0;
+    int num_hull = apConvexHullCalculateExact(image, width, height, &hull);
+    if (!num_hull)
+        return 0;
 
-    // It's possible the diagonal is not set, but we can expand in both x or y
-    if (!corner && (*growx & *growy))
+    // The bounding box is always a candidate
+    apPosf box_min = hull[0];
+    apPosf box_max = hull[0];
+    for (int i = 1; i < num_hull; ++i)
     {
-        *growy = 0;
+        box_min.x = apMathMin(box_min.x, hull[i].x);
+        box_min.y = apMathMin(box_min.y, hull[i].y);
+        box_max.x = apMathMax(box_max.x, hull[i].x);
+        box_max.y = apMathMax(box_max.y, hull[i].y);
     }
+    apPosf box[4] = { box_min, { box_max.x, box_min.y }, box_max, { box_min.x, box_max.y } };
+    float box_cost = vertex_cost * 4 + (box_max.x - box_min.x) * (box_max.y - box_min.y);
 
-    //printf("CanGrowBoxByOne: %d %d  %d %d -> %d %d\n", x, y, bwidth, bheight, *growx, *growy);
+    apPosf* best = (apPosf*)malloc(sizeof(apPosf) * (size_t)(num_hull > 4 ? num_hull : 4));
+    float best_cost;
+    int num_best = apConvexHullReduce(hull, num_hull, width, height, max_vertices, vertex_cost, best, &best_cost);
+    if (num_best == 0 || box_cost < best_cost)
+    {
+        memcpy(best, box, sizeof(box));
+        num_best = 4;
+    }
+    free((void*)hull);
 
-    return *growx | *growy;
+    // To [(-0.5,-0.5), (0.5,0.5)], and in the same order as apConvexHullFromImage
+    apPosf* vertices = (apPosf*)malloc(sizeof(apPosf) * (size_t)num_best);
+    for (int i = 0; i < num_best; ++i)
+    {
+        apPosf v = best[num_best - i - 1];
+        vertices[i].x = apConvexHullRoundEdge(v.x / width - 0.5f);
+        vertices[i].y = apConvexHullRoundEdge(v.y / height - 0.5f);
+    }
+    free((void*)best);
+
+    *num_vertices = num_best;
+    return vertices;
 }
 
-static void ExpandBox(int width, int height, uint8_t* data, int bx, int by, int* out_bwidth, int* out_bheight)
+// ************************************************************************************************************************
+
+// Box decomposition
+//
+// A minimal partition of the non empty texels into rectangles (see "Minimum partition of rectilinear polygons").
+// Each concave corner needs a cut. A chord between two concave corners resolves both of them with one cut,
+// so we pick the largest set of chords that don't cross (the maximum independent set of the bipartite
+// horizontal/vertical chord graph). Each remaining concave corner then gets a vertical cut.
+//
+// Lattice points are the texel corners (x,y) in [0,width]x[0,height].
+// A horizontal segment (x,y)-(x+1,y) is at index y*width+x, and a vertical segment (x,y)-(x,y+1) at y*(width+1)+x
+
+typedef struct
 {
-    int bwidth = 1;
-    int bheight = 1;
-    while (1)
+    int width;
+    int height;
+    const uint8_t* data;
+
+    uint8_t* hwalls;    // The cuts along the horizontal segments
+    uint8_t* vwalls;    // The cuts along the vertical segments
+    uint8_t* resolved;  // Concave corners that are already cut, per lattice point
+
+    apRect* chords;     // Horizontal chords first (height is 0), then the vertical chords (width is 0)
+    int num_hchords;
+    int num_vchords;
+
+    int* adjacency;     // For each horizontal chord, the vertical chords it crosses
+    int* adjacency_offsets;
+    int* match_h;       // The vertical chord matched to each horizontal chord, or -1
+    int* match_v;       // The horizontal chord matched to each vertical chord, or -1
+    int* visited;
+    int visit_stamp;
+    int* path_h;        // The augmenting path: the horizontal chords,
+    int* path_v;        // the vertical chord taken from each of them,
+    int* path_next;     // and the next adjacency to try for each of them
+} apHullBoxContext;
+
+static inline int apHullIsSet(const apHullBoxContext* ctx, int x, int y)
+{
+    if (x < 0 || y < 0 || x >= ctx->width || y >= ctx->height)
+        return 0;
+    return ctx->data[y*ctx->width+x] != 0;
+}
+
+// Returns non zero if the lattice point is a concave corner (i.e. exactly one of the four texels is empty)
+// The directions point away from the empty texel, along the two possible cuts
+static int apHullIsConcave(const apHullBoxContext* ctx, int x, int y, int* dirx, int* diry)
+{
+    int nw = apHullIsSet(ctx, x-1, y-1);
+    int ne = apHullIsSet(ctx, x, y-1);
+    int sw = apHullIsSet(ctx, x-1, y);
+    int se = apHullIsSet(ctx, x, y);
+    if (nw + ne + sw + se != 3)
+        return 0;
+    *dirx = (nw & sw) ? -1 : 1;
+    *diry = (nw & ne) ? -1 : 1;
+    return 1;
+}
+
+// Is the segment inside the shape (i.e. the texels on both sides are set)
+static inline int apHullIsInsideH(const apHullBoxContext* ctx, int x, int y)
+{
+    return apHullIsSet(ctx, x, y-1) && apHullIsSet(ctx, x, y);
+}
+
+static inline int apHullIsInsideV(const apHullBoxContext* ctx, int x, int y)
+{
+    return apHullIsSet(ctx, x-1, y) && apHullIsSet(ctx, x, y);
+}
+
+// Finds the chords, going right and down from each concave corner.
+// Returns the number of chords. If chords is null, they're only counted
+static int apHullFindChords(apHullBoxContext* ctx, int horizontal, apRect* chords)
+{
+    int num_chords = 0;
+    for (int y = 1; y < ctx->height; ++y)
     {
-        int growx;
-        int growy;
-        if (!CanGrowBoxByOne(width, height, data, bx, by, bwidth, bheight, &growx, &growy))
-            break;
+        for (int x = 1; x < ctx->width; ++x)
+        {
+            int dirx, diry;
+            if (!apHullIsConcave(ctx, x, y, &dirx, &diry))
+                continue;
+            if ((horizontal ? dirx : diry) < 0)
+                continue;
 
-        bwidth += growx;
-        bheight += growy;
+            int end = horizontal ? x : y;
+            while (1)
+            {
+                int inside = horizontal ? apHullIsInsideH(ctx, end, y) : apHullIsInsideV(ctx, x, end);
+                if (!inside)
+                    break;
+                ++end;
+
+                int enddirx, enddiry;
+                if (apHullIsConcave(ctx, horizontal ? end : x, horizontal ? y : end, &enddirx, &enddiry))
+                {
+                    if (chords)
+                    {
+                        apRect chord = { { x, y }, { horizontal ? end - x : 0, horizontal ? 0 : end - y } };
+                        chords[num_chords] = chord;
+                    }
+                    ++num_chords;
+                    break;
+                }
+            }
+        }
     }
-    *out_bwidth = bwidth;
-    *out_bheight = bheight;
+    return num_chords;
 }
 
-static void ClearBox(int width, int height, uint8_t* data, int bx, int by, int bwidth, int bheight)
+// Kuhn's augmenting path. Iterative, as the path may be as long as the number of chords
+static int apHullAugment(apHullBoxContext* ctx, int root)
 {
-    int maxx = apMathMin(width, bx+bwidth);
-    int maxy = apMathMin(height, by+bheight);
-    for (int y = by; y < maxy; ++y)
+    int depth = 0;
+    ctx->path_h[0] = root;
+    ctx->path_next[0] = ctx->adjacency_offsets[root];
+    while (depth >= 0)
     {
-        for (int x = bx; x < maxx; ++x)
+        int h = ctx->path_h[depth];
+        if (ctx->path_next[depth] == ctx->adjacency_offsets[h+1])
+        {
+            --depth; // No path from this chord
+            continue;
+        }
+
+        int v = ctx->adjacency[ctx->path_next[depth]++];
+        if (ctx->visited[v] == ctx->visit_stamp)
+            continue;
+        ctx->visited[v] = ctx->visit_stamp;
+        ctx->path_v[depth] = v;
+
+        if (ctx->match_v[v] < 0)
         {
-            data[y*width+x] = TILE_VALUE_VISITED;
+            // Flip the matching along the path
+            for (int d = depth; d >= 0; --d)
+            {
+                ctx->match_h[ctx->path_h[d]] = ctx->path_v[d];
+                ctx->match_v[ctx->path_v[d]] = ctx->path_h[d];
+            }
+            return 1;
         }
+
+        // Each matched chord is reached at most once, via its vertical chord
+        ++depth;
+        ctx->path_h[depth] = ctx->match_v[v];
+        ctx->path_next[depth] = ctx->adjacency_offsets[ctx->match_v[v]];
     }
+    return 0;
 }
 
-static void ResetImage(int width, int height, uint8_t* data)
+// Marks the chord as a cut, and its end points as resolved
+static void apHullCutChord(apHullBoxContext* ctx, const apRect* chord)
 {
-    for (int i = 0; i < width*height; ++i)
+    int width = ctx->width;
+    if (chord->size.width)
     {
-        if (data[i])
-            data[i] = TILE_VALUE_DEFAULT;
+        for (int x = chord->pos.x; x < chord->pos.x + chord->size.width; ++x)
+            ctx->hwalls[chord->pos.y*width+x] = 1;
+        ctx->resolved[chord->pos.y*(width+1) + chord->pos.x + chord->size.width] = 1;
     }
+    else
+    {
+        for (int y = chord->pos.y; y < chord->pos.y + chord->size.height; ++y)
+            ctx->vwalls[y*(width+1)+chord->pos.x] = 1;
+        ctx->resolved[(chord->pos.y + chord->size.height)*(width+1) + chord->pos.x] = 1;
+    }
+    ctx->resolved[chord->pos.y*(width+1) + chord->pos.x] = 1;
 }
 
+// Cuts along the maximum set of non crossing chords
+static void apHullCutChords(apHullBoxContext* ctx)
+{
+    int width = ctx->width;
+    int height = ctx->height;
+    int num_hchords = ctx->num_hchords;
+    int num_vchords = ctx->num_vchords;
+    apRect* hchords = ctx->chords;
+    apRect* vchords = ctx->chords + num_hchords;
+
+    // The horizontal chord that covers each horizontal segment
+    int* hsegments = (int*)malloc(sizeof(int) * (size_t)(width * (height + 1)));
+    for (int i = 0; i < width * (height + 1); ++i)
+        hsegments[i] = -1;
+    for (int h = 0; h < num_hchords; ++h)
+    {
+        for (int x = hchords[h].pos.x; x < hchords[h].pos.x + hchords[h].size.width; ++x)
+            hsegments[hchords[h].pos.y*width+x] = h;
+    }
 
-// Takes a bitmap where 0 is empty, and 1 is occupied
-// Modifies the bitmap (clears bits to 0 to designate the traversal being done)
-void apHullFindLargestBoxes(int width, int height, uint8_t* data, APHullBoxCallback cbk, void* cbk_ctx)
+    // Two chords cross (or touch) if a lattice point on the vertical chord has a horizontal chord on either side
+    // First count the crossings per horizontal chord, then store them
+    ctx->adjacency_offsets = (int*)malloc(sizeof(int) * (size_t)(num_hchords + 1));
+    memset(ctx->adjacency_offsets, 0, sizeof(int) * (size_t)(num_hchords + 1));
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (int v = 0; v < num_vchords; ++v)
+        {
+            int x = vchords[v].pos.x;
+            for (int y = vchords[v].pos.y; y <= vchords[v].pos.y + vchords[v].size.height; ++y)
+            {
+                int left = hsegments[y*width+x-1];
+                int right = x < width ? hsegments[y*width+x] : -1;
+                int crossings[2] = { left, right != left ? right : -1 };
+                for (int c = 0; c < 2; ++c)
+                {
+                    int h = crossings[c];
+                    if (h < 0)
+                        continue;
+                    if (pass == 0)
+                        ctx->adjacency_offsets[h+1]++;
+                    else
+                        ctx->adjacency[ctx->visited[h]++] = v;
+                }
+            }
+        }
+
+        if (pass == 0)
+        {
+            for (int h = 0; h < num_hchords; ++h)
+                ctx->adjacency_offsets[h+1] += ctx->adjacency_offsets[h];
+            ctx->adjacency = (int*)malloc(sizeof(int) * (size_t)(ctx->adjacency_offsets[num_hchords] + 1));
+            // Use the visited array as the write cursors
+            ctx->visited = (int*)malloc(sizeof(int) * (size_t)(apMathMax(num_hchords, num_vchords) + 1));
+            memcpy(ctx->visited, ctx->adjacency_offsets, sizeof(int) * (size_t)num_hchords);
+        }
+    }
+    free((void*)hsegments);
+
+    // Maximum matching
+    ctx->match_h = (int*)malloc(sizeof(int) * (size_t)(num_hchords + 1));
+    ctx->match_v = (int*)malloc(sizeof(int) * (size_t)(num_vchords + 1));
+    for (int h = 0; h < num_hchords; ++h)
+        ctx->match_h[h] = -1;
+    for (int v = 0; v < num_vchords; ++v)
+    {
+        ctx->match_v[v] = -1;
+        ctx->visited[v] = 0;
+    }
+    ctx->path_h = (int*)malloc(sizeof(int) * (size_t)(num_hchords + 1));
+    ctx->path_v = (int*)malloc(sizeof(int) * (size_t)(num_hchords + 1));
+    ctx->path_next = (int*)malloc(sizeof(int) * (size_t)(num_hchords + 1));
+    ctx->visit_stamp = 0;
+    for (int h = 0; h < num_hchords; ++h)
+    {
+        ++ctx->visit_stamp;
+        apHullAugment(ctx, h);
+    }
+    free((void*)ctx->path_next);
+    free((void*)ctx->path_v);
+    free((void*)ctx->path_h);
+
+    // König's theorem: Starting from the unmatched horizontal chords, and alternating between
+    // unmatched and matched edges, the reached horizontal chords and the unreached vertical chords
+    // form the maximum independent set
+    uint8_t* reached_h = (uint8_t*)malloc((size_t)(num_hchords + 1));
+    uint8_t* reached_v = (uint8_t*)malloc((size_t)(num_vchords + 1));
+    memset(reached_h, 0, (size_t)(num_hchords + 1));
+    memset(reached_v, 0, (size_t)(num_vchords + 1));
+    int* queue = (int*)malloc(sizeof(int) * (size_t)(num_hchords + 1));
+    int queue_size = 0;
+    for (int h = 0; h < num_hchords; ++h)
+    {
+        if (ctx->match_h[h] < 0)
+        {
+            reached_h[h] = 1;
+            queue[queue_size++] = h;
+        }
+    }
+    for (int q = 0; q < queue_size; ++q)
+    {
+        int h = queue[q];
+        for (int i = ctx->adjacency_offsets[h]; i < ctx->adjacency_offsets[h+1]; ++i)
+        {
+            int v = ctx->adjacency[i];
+            if (reached_v[v])
+                continue;
+            reached_v[v] = 1;
+            int next = ctx->match_v[v];
+            if (next >= 0 && !reached_h[next])
+            {
+                reached_h[next] = 1;
+                queue[queue_size++] = next;
+            }
+        }
+    }
+
+    for (int h = 0; h < num_hchords; ++h)
+    {
+        if (reached_h[h])
+            apHullCutChord(ctx, &hchords[h]);
+    }
+    for (int v = 0; v < num_vchords; ++v)
+    {
+        if (!reached_v[v])
+            apHullCutChord(ctx, &vchords[v]);
+    }
+
+    free((void*)queue);
+    free((void*)reached_v);
+    free((void*)reached_h);
+    free((void*)ctx->match_v);
+    free((void*)ctx->match_h);
+    free((void*)ctx->visited);
+    free((void*)ctx->adjacency);
+    free((void*)ctx->adjacency_offsets);
+}
+
+// Cuts vertically from each concave corner that isn't resolved yet, until the cut reaches the edge or another cut
+static void apHullCutCorners(apHullBoxContext* ctx)
 {
-    for (int y = 0; y < height; ++y)
+    int width = ctx->width;
+    for (int y = 1; y < ctx->height; ++y)
     {
-        for (int x = 0; x < width; ++x)
+        for (int x = 1; x < width; ++x)
         {
-            if (data[y*width+x] == TILE_VALUE_DEFAULT)
+            int dirx, diry;
+            if (ctx->resolved[y*(width+1)+x] || !apHullIsConcave(ctx, x, y, &dirx, &diry))
+                continue;
+
+            int cy = y;
+            while (1)
             {
-                int bwidth;
-                int bheight;
-                ExpandBox(width, height, data, x, y, &bwidth, &bheight);
-                ClearBox(width, height, data, x, y, bwidth, bheight);
-                cbk(cbk_ctx, x, y, bwidth, bheight);
+                int sy = diry > 0 ? cy : cy - 1; // the segment
+                if (!apHullIsInsideV(ctx, x, sy) || ctx->vwalls[sy*(width+1)+x])
+                    break;
+                ctx->vwalls[sy*(width+1)+x] = 1;
+                cy += diry;
+                if (ctx->hwalls[cy*width+x-1] || (x < width && ctx->hwalls[cy*width+x]))
+                    break;
             }
         }
     }
-    ResetImage(width, height, data);
 }
 
-typedef struct
+// After the cuts, each region is a rectangle
+// Returns the number of boxes
+static int apHullCollectBoxes(apHullBoxContext* ctx, apRect* boxes)
 {
-    int capacity;
-    int size;
-    void* mem;
+    int width = ctx->width;
+    int height = ctx->height;
+    uint8_t* visited = (uint8_t*)malloc((size_t)(width * height));
+    memset(visited, 0, (size_t)(width * height));
+
+    int num_boxes = 0;
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            if (visited[y*width+x] || !ctx->data[y*width+x])
+                continue;
 
-    float width;
-    float height;
-} ContourCreateContext;
+            int bwidth = 1;
+            while (x + bwidth < width && ctx->data[y*width+x+bwidth] && !ctx->vwalls[y*(width+1)+x+bwidth])
+                ++bwidth;
+            int bheight = 1;
+            while (y + bheight < height && ctx->data[(y+bheight)*width+x] && !ctx->hwalls[(y+bheight)*width+x])
+                ++bheight;
 
-static void BoxToVertices(void* _ctx, int x, int y, int width, int height)
+            for (int by = y; by < y + bheight; ++by)
+                memset(visited + by*width + x, 1, (size_t)bwidth);
+
+            apRect box = { { x, y }, { bwidth, bheight } };
+            boxes[num_boxes++] = box;
+        }
+    }
+    free((void*)visited);
+    return num_boxes;
+}
+
+// Returns the number of boxes. Caller owns the returned memory
+static int apHullDecompose(int width, int height, const uint8_t* data, apRect** out_boxes)
 {
-    ContourCreateContext* ctx = (ContourCreateContext*)_ctx;
-    //printf("  BOX: %d, %d %d, %d\n", x, y, width, height);
+    *out_boxes = 0;
+
+    apHullBoxContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.width = width;
+    ctx.height = height;
+    ctx.data = data;
 
-    if (ctx->size + 2 >= ctx->capacity)
+    // Each box starts on a row run, so that's the upper bound
+    int max_boxes = 0;
+    for (int y = 0; y < height; ++y)
     {
-        ctx->capacity += 6 * 4; // each box: 2 triangles = 6 vertices. Preallocate some boxes
-        ctx->mem = realloc(ctx->mem, ctx->capacity * sizeof(apPosf));
+        int prev = 0;
+        for (int x = 0; x < width; ++x)
+        {
+            int set = data[y*width+x] != 0;
+            max_boxes += set & !prev;
+            prev = set;
+        }
     }
+    if (!max_boxes)
+        return 0;
 
-    float fwidth = (float)ctx->width;
-    float fheight = (float)ctx->height;
+    ctx.hwalls = (uint8_t*)malloc((size_t)(width * (height + 1)));
+    ctx.vwalls = (uint8_t*)malloc((size_t)((width + 1) * height));
+    ctx.resolved = (uint8_t*)malloc((size_t)((width + 1) * (height + 1)));
+    memset(ctx.hwalls, 0, (size_t)(width * (height + 1)));
+    memset(ctx.vwalls, 0, (size_t)((width + 1) * height));
+    memset(ctx.resolved, 0, (size_t)((width + 1) * (height + 1)));
 
-    apPosf* vertices = (apPosf*)ctx->mem;
+    ctx.num_hchords = apHullFindChords(&ctx, 1, 0);
+    ctx.num_vchords = apHullFindChords(&ctx, 0, 0);
+    if (ctx.num_hchords + ctx.num_vchords)
+    {
+        ctx.chords = (apRect*)malloc(sizeof(apRect) * (size_t)(ctx.num_hchords + ctx.num_vchords));
+        apHullFindChords(&ctx, 1, ctx.chords);
+        apHullFindChords(&ctx, 0, ctx.chords + ctx.num_hchords);
+        apHullCutChords(&ctx);
+        free((void*)ctx.chords);
+    }
+    apHullCutCorners(&ctx);
 
-    apPosf box[4] = {
-        { x,         y },
-        { x + width, y },
-        { x + width, y + height },
-        { x,         y + height }
-    };
+    apRect* boxes = (apRect*)malloc(sizeof(apRect) * (size_t)max_boxes);
+    int num_boxes = apHullCollectBoxes(&ctx, boxes);
+
+    free((void*)ctx.resolved);
+    free((void*)ctx.vwalls);
+    free((void*)ctx.hwalls);
 
-    vertices[ctx->size++] = box[0];
-    vertices[ctx->size++] = box[1];
-    vertices[ctx->size++] = box[2];
-    vertices[ctx->size++] = box[0];
-    vertices[ctx->size++] = box[2];
-    vertices[ctx->size++] = box[3];
+    *out_boxes = boxes;
+    return num_boxes;
+}
+
+// Takes a bitmap where 0 is empty, and non zero is occupied
+void apHullFindLargestBoxes(int width, int height, uint8_t* data, APHullBoxCallback cbk, void* cbk_ctx)
+{
+    apRect* boxes;
+    int num_boxes = apHullDecompose(width, height, data, &boxes);
+    for (int i = 0; i < num_boxes; ++i)
+        cbk(cbk_ctx, boxes[i].pos.x, boxes[i].pos.y, boxes[i].size.width, boxes[i].size.height);
+    free((void*)boxes);
 }
 
 apPosf* apHullFromImage(uint8_t* image, int width, int height, int* num_vertices)
 {
-    ContourCreateContext ctx;
-    ctx.size = 0;
-    ctx.capacity = 0;
-    ctx.mem = 0;
-    ctx.width = (float)width;
-    ctx.height = (float)height;
-    apHullFindLargestBoxes(width, height, image, BoxToVertices, &ctx);
-    *num_vertices = ctx.size;
-    return ctx.mem;
+    apRect* boxes;
+    int num_boxes = apHullDecompose(width, height, image, &boxes);
+    *num_vertices = num_boxes * 6;
+    if (!num_boxes)
+        return 0;
+
+    // Each box: 2 triangles = 6 vertices
+    apPosf* vertices = (apPosf*)malloc(sizeof(apPosf) * 6 * (size_t)num_boxes);
+    apPosf* v = vertices;
+    for (int i = 0; i < num_boxes; ++i)
+    {
+        float x0 = (float)boxes[i].pos.x;
+        float y0 = (float)boxes[i].pos.y;
+        float x1 = x0 + boxes[i].size.width;
+        float y1 = y0 + boxes[i].size.height;
+        apPosf box[4] = { { x0, y0 }, { x1, y0 }, { x1, y1 }, { x0, y1 } };
+        *v++ = box[0];
+        *v++ = box[1];
+        *v++ = box[2];
+        *v++ = box[0];
+        *v++ = box[2];
+        *v++ = box[3];
+    }
+    free((void*)boxes);
+    return vertices;
 }
 
 apPosf* apCreateBoxVertices(apPos pos, apSize size, int* num_vertices)
@@ -0,0 +1,223 @@
+// https://github.com/JCash/atlaspacker
+// License: MIT
+// @2021-@2023 Mathias Westerdahl
+
+#include <atlaspacker/glyphcache.h>
+#include <atlaspacker/binpacker.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    uint64_t    key;
+    apRect      rect;
+    int         page;       // -1 if the slot is empty
+} apGlyphCacheEntry;
+
+typedef struct
+{
+    apBinPackerPage*    packer;
+    int                 y;          // The offset of the slice in the texture
+    int                 num_glyphs;
+    uint64_t            last_used;
+} apGlyphCachePage;
+
+struct apGlyphCache
+{
+    apGlyphCachePage*   pages;
+    int                 num_pages;
+    int                 width;
+    int                 min_page_height;
+
+    // Open addressing hash table, with linear probing.
+    // It's at least twice the size of max_glyphs, so there's always an empty slot
+    apGlyphCacheEntry*  entries;
+    apGlyphCacheEntry*  scratch;    // Used when rebuilding the table after an eviction
+    uint32_t            capacity;   // A power of two
+    int                 max_glyphs;
+
+    uint64_t            tick;
+    apGlyphCacheStats   stats;
+};
+
+static inline uint32_t apGlyphCacheHash(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return (uint32_t)key;
+}
+
+// Returns the entry with the key, or the empty slot where it should be inserted
+static apGlyphCacheEntry* apGlyphCacheLookup(apGlyphCacheEntry* entries, uint32_t capacity, uint64_t key)
+{
+    uint32_t mask = capacity - 1;
+    uint32_t index = apGlyphCacheHash(key) & mask;
+    while (entries[index].page != -1 && entries[index].key != key)
+        index = (index + 1) & mask;
+    return &entries[index];
+}
+
+static void apGlyphCacheClearEntries(apGlyphCacheEntry* entries, uint32_t capacity)
+{
+    for (uint32_t i = 0; i < capacity; ++i)
+        entries[i].page = -1;
+}
+
+// Clears the slice and removes all its glyphs from the table
+static void apGlyphCacheEvictPage(apGlyphCache* cache, int page_index)
+{
+    apGlyphCachePage* page = &cache->pages[page_index];
+    cache->stats.evictions += (uint32_t)page->num_glyphs;
+    cache->stats.page_evictions++;
+    cache->stats.num_glyphs -= (uint32_t)page->num_glyphs;
+    page->num_glyphs = 0;
+    apBinPackerPageReset(page->packer);
+
+    // Rebuild the table without the evicted glyphs (there are no tombstones to clean up later)
+    apGlyphCacheClearEntries(cache->scratch, cache->capacity);
+    for (uint32_t i = 0; i < cache->capacity; ++i)
+    {
+        apGlyphCacheEntry* entry = &cache->entries[i];
+        if (entry->page == -1 || entry->page == page_index)
+            continue;
+        *apGlyphCacheLookup(cache->scratch, cache->capacity, entry->key) = *entry;
+    }
+
+    apGlyphCacheEntry* tmp = cache->entries;
+    cache->entries = cache->scratch;
+    cache->scratch = tmp;
+}
+
+// Empty slices are skipped, as evicting them wouldn't free anything
+static int apGlyphCacheGetLeastRecentlyUsedPage(apGlyphCache* cache)
+{
+    int lru = 0;
+    for (int i = 1; i < cache->num_pages; ++i)
+    {
+        const apGlyphCachePage* page = &cache->pages[i];
+        if (page->num_glyphs == 0)
+            continue;
+        if (cache->pages[lru].num_glyphs == 0 || page->last_used < cache->pages[lru].last_used)
+            lru = i;
+    }
+    return lru;
+}
+
+apGlyphCache* apGlyphCacheCreate(int width, int height, int num_pages, int max_glyphs)
+{
+    assert(num_pages > 0);
+    assert(max_glyphs > 0);
+
+    apGlyphCache* cache = (apGlyphCache*)malloc(sizeof(apGlyphCache));
+    memset(cache, 0, sizeof(apGlyphCache));
+    cache->width = width;
+    cache->num_pages = num_pages;
+    cache->min_page_height = height / num_pages;
+    cache->max_glyphs = max_glyphs;
+
+    apBinPackerOptions options;
+    apBinPackerSetDefaultOptions(&options);
+    options.mode = AP_BP_SKYLINE_BL;
+    options.no_rotate = 1;
+    options.waste_map = 1;
+
+    cache->pages = (apGlyphCachePage*)malloc(sizeof(apGlyphCachePage) * (size_t)num_pages);
+    memset(cache->pages, 0, sizeof(apGlyphCachePage) * (size_t)num_pages);
+    for (int i = 0; i < num_pages; ++i)
+    {
+        apGlyphCachePage* page = &cache->pages[i];
+        page->y = i * cache->min_page_height;
+        // The last slice gets the remainder
+        int page_height = i == (num_pages - 1) ? height - page->y : cache->min_page_height;
+        page->packer = apBinPackerPageCreate(&options, width, page_height);
+    }
+
+    cache->capacity = apNextPowerOfTwo((uint32_t)max_glyphs * 2);
+    cache->entries = (apGlyphCacheEntry*)malloc(sizeof(apGlyphCacheEntry) * cache->capacity);
+    cache->scratch = (apGlyphCacheEntry*)malloc(sizeof(apGlyphCacheEntry) * cache->capacity);
+    apGlyphCacheClearEntries(cache->entries, cache->capacity);
+    return cache;
+}
+
+void apGlyphCacheDestroy(apGlyphCache* cache)
+{
+    for (int i = 0; i < cache->num_pages; ++i)
+        apBinPackerPageDestroy(cache->pages[i].packer);
+    free((void*)cache->pages);
+    free((void*)cache->entries);
+    free((void*)cache->scratch);
+    free((void*)cache);
+}
+
+int apGlyphCacheFind(apGlyphCache* cache, uint64_t key, apRect* rect)
+{
+    cache->tick++;
+    apGlyphCacheEntry* entry = apGlyphCacheLookup(cache->entries, cache->capacity, key);
+    if (entry->page == -1)
+    {
+        cache->stats.misses++;
+        return 0;
+    }
+    cache->stats.hits++;
+    cache->pages[entry->page].last_used = cache->tick;
+    *rect = entry->rect;
+    return 1;
+}
+
+int apGlyphCacheInsert(apGlyphCache* cache, uint64_t key, int width, int height, apRect* rect)
+{
+    if (width > cache->width || height > cache->min_page_height)
+        return 0;
+
+    cache->tick++;
+    apGlyphCacheEntry* entry = apGlyphCacheLookup(cache->entries, cache->capacity, key);
+    if (entry->page != -1)
+    {
+        cache->pages[entry->page].last_used = cache->tick;
+        *rect = entry->rect;
+        return 1;
+    }
+
+    if (cache->stats.num_glyphs >= (uint32_t)cache->max_glyphs)
+        apGlyphCacheEvictPage(cache, apGlyphCacheGetLeastRecentlyUsedPage(cache));
+
+    int page_index = -1;
+    for (int i = 0; i < cache->num_pages; ++i)
+    {
+        if (apBinPackerPageInsert(cache->pages[i].packer, width, height, rect))
+        {
+            page_index = i;
+            break;
+        }
+    }
+
+    if (page_index == -1)
+    {
+        page_index = apGlyphCacheGetLeastRecentlyUsedPage(cache);
+        apGlyphCacheEvictPage(cache, page_index);
+        if (!apBinPackerPageInsert(cache->pages[page_index].packer, width, height, rect))
+            return 0;
+    }
+
+    apGlyphCachePage* page = &cache->pages[page_index];
+    page->last_used = cache->tick;
+    page->num_glyphs++;
+    rect->pos.y += page->y;
+
+    // The table may have been rebuilt
+    entry = apGlyphCacheLookup(cache->entries, cache->capacity, key);
+    entry->key = key;
+    entry->rect = *rect;
+    entry->page = page_index;
+    cache->stats.num_glyphs++;
+    return 1;
+}
+
+void apGlyphCacheGetStats(const apGlyphCache* cache, apGlyphCacheStats* stats)
+{
+    *stats = cache->stats;
+}
@@ -0,0 +1,419 @@
+// https://github.com/JCash/atlaspacker
+// License: MIT
+// @2021-@2023 Mathias Westerdahl
+
+#include <atlaspacker/mesh.h>
+
+#include <stdlib.h> // malloc
+#include <string.h> // memset
+#include <math.h> // floorf
+
+#define AP_MESH_MAX_VERTICES 65536
+
+// How far (in texels) a vertex may be from an edge, to still be considered on the edge
+#define AP_MESH_EDGE_EPSILON 0.0001f
+
+typedef struct
+{
+    apPosf  pos;
+    int     index;  // The index in the triangle list
+} apMeshSortItem;
+
+typedef struct
+{
+    apPosf*     positions;  // The unique positions, sorted on x, then y
+    int*        ids;        // The vertex index of each unique position
+    int         num_positions;
+
+    uint16_t*   indices;
+    int         num_indices;
+    int         capacity;
+
+    int*        edge_points[3]; // Scratch memory for the vertices on each edge of a triangle
+    float*      edge_distances;
+} apMeshContext;
+
+static int apMeshSortOnPosition(const void* _a, const void* _b)
+{
+    const apMeshSortItem* a = (const apMeshSortItem*)_a;
+    const apMeshSortItem* b = (const apMeshSortItem*)_b;
+    if (a->pos.x != b->pos.x)
+        return a->pos.x < b->pos.x ? -1 : 1;
+    if (a->pos.y != b->pos.y)
+        return a->pos.y < b->pos.y ? -1 : 1;
+    return a->index - b->index;
+}
+
+static float apMeshCross(apPosf o, apPosf a, apPosf b)
+{
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+static void apMeshAddTriangle(apMeshContext* ctx, int a, int b, int c)
+{
+    if (ctx->num_indices + 3 > ctx->capacity)
+    {
+        ctx->capacity = ctx->capacity ? ctx->capacity * 2 : 3 * 16;
+        ctx->indices = (uint16_t*)realloc(ctx->indices, sizeof(uint16_t) * (size_t)ctx->capacity);
+    }
+    ctx->indices[ctx->num_indices++] = (uint16_t)a;
+    ctx->indices[ctx->num_indices++] = (uint16_t)b;
+    ctx->indices[ctx->num_indices++] = (uint16_t)c;
+}
+
+// Finds the vertices that lie on the edge (but not at the end points)
+// Returns the number of points, sorted on the distance from a
+static int apMeshFindEdgePoints(apMeshContext* ctx, apPosf a, apPosf b, int ia, int ib, int* points)
+{
+    float minx = apMathMin(a.x, b.x) - AP_MESH_EDGE_EPSILON;
+    float maxx = apMathMax(a.x, b.x) + AP_MESH_EDGE_EPSILON;
+    float miny = apMathMin(a.y, b.y) - AP_MESH_EDGE_EPSILON;
+    float maxy = apMathMax(a.y, b.y) + AP_MESH_EDGE_EPSILON;
+    apPosf ab = { b.x - a.x, b.y - a.y };
+    float length_sq = ab.x * ab.x + ab.y * ab.y;
+
+    // The first position with x >= minx
+    int lo = 0;
+    int hi = ctx->num_positions;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (ctx->positions[mid].x < minx)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    int num_points = 0;
+    for (int i = lo; i < ctx->num_positions && ctx->positions[i].x <= maxx; ++i)
+    {
+        apPosf p = ctx->positions[i];
+        int id = ctx->ids[i];
+        if (p.y < miny || p.y > maxy || id == ia || id == ib)
+            continue;
+
+        float cross = apMeshCross(a, b, p);
+        if (cross * cross > AP_MESH_EDGE_EPSILON * AP_MESH_EDGE_EPSILON * length_sq)
+            continue;
+        float t = (p.x - a.x) * ab.x + (p.y - a.y) * ab.y;
+        if (t <= 0.0f || t >= length_sq)
+            continue;
+
+        // Insertion sort, there are usually only a few points
+        int j = num_points++;
+        while (j > 0 && ctx->edge_distances[j-1] > t)
+        {
+            points[j] = points[j-1];
+            ctx->edge_distances[j] = ctx->edge_distances[j-1];
+            --j;
+        }
+        points[j] = id;
+        ctx->edge_distances[j] = t;
+    }
+    return num_points;
+}
+
+// Triangulates a triangle with extra vertices on its edges.
+// The edge from corner i to corner i+1 has the points[i] (in order from corner i)
+static void apMeshSplitTriangle(apMeshContext* ctx, const int corners[3], const int* points[3], const int num_points[3])
+{
+    int k = num_points[0] ? 0 : (num_points[1] ? 1 : 2);
+    if (!num_points[k])
+    {
+        apMeshAddTriangle(ctx, corners[0], corners[1], corners[2]);
+        return;
+    }
+
+    int k1 = (k + 1) % 3;
+    int k2 = (k + 2) % 3;
+    int opposite = corners[k2];
+    if (!num_points[k1] && !num_points[k2])
+    {
+        // Only one edge has points, so we make a fan from the opposite corner
+        int prev = corners[k];
+        for (int i = 0; i < num_points[k]; ++i)
+        {
+            apMeshAddTriangle(ctx, opposite, prev, points[k][i]);
+            prev = points[k][i];
+        }
+        apMeshAddTriangle(ctx, opposite, prev, corners[k1]);
+        return;
+    }
+
+    // Split the triangle from the first point on the edge, to the opposite corner
+    int split = points[k][0];
+
+    // The first part only has the points on the edge from the opposite corner
+    int first_corners[3] = { corners[k], split, opposite };
+    const int* first_points[3] = { 0, 0, points[k2] };
+    int first_num_points[3] = { 0, 0, num_points[k2] };
+    apMeshSplitTriangle(ctx, first_corners, first_points, first_num_points);
+
+    // The second part has the rest of the points on the edge, and the points on the next edge
+    int second_corners[3] = { split, corners[k1], opposite };
+    const int* second_points[3] = { points[k] + 1, points[k1], 0 };
+    int second_num_points[3] = { num_points[k] - 1, num_points[k1], 0 };
+    apMeshSplitTriangle(ctx, second_corners, second_points, second_num_points);
+}
+
+int apMeshFromTriangles(const apPosf* triangles, int num_vertices, apMesh* mesh)
+{
+    memset(mesh, 0, sizeof(apMesh));
+    num_vertices -= num_vertices % 3;
+    if (num_vertices <= 0)
+        return 1;
+
+    // Weld the vertices with the same position
+    apMeshSortItem* items = (apMeshSortItem*)malloc(sizeof(apMeshSortItem) * (size_t)num_vertices);
+    for (int i = 0; i < num_vertices; ++i)
+    {
+        items[i].pos = triangles[i];
+        items[i].index = i;
+    }
+    qsort(items, (size_t)num_vertices, sizeof(apMeshSortItem), apMeshSortOnPosition);
+
+    apMeshContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.positions = (apPosf*)malloc(sizeof(apPosf) * (size_t)num_vertices);
+    ctx.ids = (int*)malloc(sizeof(int) * (size_t)num_vertices);
+
+    int* position_of = (int*)malloc(sizeof(int) * (size_t)num_vertices); // triangle list index -> unique position
+    for (int i = 0; i < num_vertices; ++i)
+    {
+        if (i == 0 || items[i].pos.x != items[i-1].pos.x || items[i].pos.y != items[i-1].pos.y)
+        {
+            ctx.positions[ctx.num_positions] = items[i].pos;
+            ctx.ids[ctx.num_positions] = -1;
+            ctx.num_positions++;
+        }
+        position_of[items[i].index] = ctx.num_positions - 1;
+    }
+    free((void*)items);
+
+    if (ctx.num_positions > AP_MESH_MAX_VERTICES)
+    {
+        free((void*)position_of);
+        free((void*)ctx.ids);
+        free((void*)ctx.positions);
+        return 0;
+    }
+
+    // The vertices are numbered in the order they're first used
+    mesh->vertices = (apPosf*)malloc(sizeof(apPosf) * (size_t)ctx.num_positions);
+    int* vertex_of = (int*)malloc(sizeof(int) * (size_t)num_vertices); // triangle list index -> vertex
+    for (int i = 0; i < num_vertices; ++i)
+    {
+        int position = position_of[i];
+        if (ctx.ids[position] < 0)
+        {
+            ctx.ids[position] = mesh->num_vertices;
+            mesh->vertices[mesh->num_vertices++] = ctx.positions[position];
+        }
+        vertex_of[i] = ctx.ids[position];
+    }
+    free((void*)position_of);
+
+    for (int e = 0; e < 3; ++e)
+        ctx.edge_points[e] = (int*)malloc(sizeof(int) * (size_t)ctx.num_positions);
+    ctx.edge_distances = (float*)malloc(sizeof(float) * (size_t)ctx.num_positions);
+
+    for (int t = 0; t < num_vertices; t += 3)
+    {
+        int corners[3] = { vertex_of[t], vertex_of[t+1], vertex_of[t+2] };
+        if (corners[0] == corners[1] || corners[1] == corners[2] || corners[2] == corners[0])
+            continue;
+        if (apMeshCross(triangles[t], triangles[t+1], triangles[t+2]) == 0.0f)
+            continue;
+
+        // Split the triangle where other vertices lie on its edges, to avoid T-junctions
+        const int* points[3];
+        int num_points[3];
+        for (int e = 0; e < 3; ++e)
+        {
+            int a = corners[e];
+            int b = corners[(e + 1) % 3];
+            num_points[e] = apMeshFindEdgePoints(&ctx, mesh->vertices[a], mesh->vertices[b], a, b, ctx.edge_points[e]);
+            points[e] = ctx.edge_points[e];
+        }
+        apMeshSplitTriangle(&ctx, corners, points, num_points);
+    }
+
+    for (int e = 0; e < 3; ++e)
+        free((void*)ctx.edge_points[e]);
+    free((void*)ctx.edge_distances);
+    free((void*)vertex_of);
+    free((void*)ctx.ids);
+    free((void*)ctx.positions);
+
+    mesh->indices = ctx.indices;
+    mesh->num_indices = ctx.num_indices;
+    return 1;
+}
+
+void apMeshDestroy(apMesh* mesh)
+{
+    free((void*)mesh->vertices);
+    free((void*)mesh->indices);
+    free((void*)mesh->indices32);
+    memset(mesh, 0, sizeof(apMesh));
+}
+
+int apCreateMeshes(apContext* ctx)
+{
+    int result = 1;
+    for (apPage* page = ctx->pages; page; page = page->next)
+    {
+        apMeshDestroy(&page->mesh);
+        if (!page->first_image)
+            continue;
+
+        int num_images = 0;
+        for (apImage* image = page->first_image; image; image = image->next)
+        {
+            ++num_images;
+            if (image == page->last_image)
+                break;
+        }
+
+        // Create the meshes first, so that the page mesh can be allocated once
+        apMesh* meshes = (apMesh*)malloc(sizeof(apMesh) * (size_t)num_images);
+        int num_vertices = 0;
+        int num_indices = 0;
+        apImage* image = page->first_image;
+        for (int i = 0; i < num_images; ++i, image = image->next)
+        {
+            if (!apMeshFromTriangles(image->vertices, image->num_vertices, &meshes[i]))
+                result = 0;
+            num_vertices += meshes[i].num_vertices;
+            num_indices += meshes[i].num_indices;
+        }
+
+        // The indices are rebased to the page vertices, which may need 32 bits
+        page->mesh.vertices = (apPosf*)malloc(sizeof(apPosf) * (size_t)(num_vertices + 1));
+        if (num_vertices <= 65536)
+            page->mesh.indices = (uint16_t*)malloc(sizeof(uint16_t) * (size_t)(num_indices + 1));
+        else
+            page->mesh.indices32 = (uint32_t*)malloc(sizeof(uint32_t) * (size_t)(num_indices + 1));
+
+        image = page->first_image;
+        for (int i = 0; i < num_images; ++i, image = image->next)
+        {
+            apMesh* mesh = &meshes[i];
+            image->mesh_first_vertex = page->mesh.num_vertices;
+            image->mesh_num_vertices = mesh->num_vertices;
+            image->mesh_first_index = page->mesh.num_indices;
+            image->mesh_num_indices = mesh->num_indices;
+
+            if (mesh->num_vertices)
+                memcpy(page->mesh.vertices + page->mesh.num_vertices, mesh->vertices, sizeof(apPosf) * (size_t)mesh->num_vertices);
+            int base = page->mesh.num_vertices;
+            for (int j = 0; j < mesh->num_indices; ++j)
+            {
+                if (page->mesh.indices)
+                    page->mesh.indices[page->mesh.num_indices + j] = (uint16_t)(base + mesh->indices[j]);
+                else
+                    page->mesh.indices32[page->mesh.num_indices + j] = (uint32_t)(base + mesh->indices[j]);
+            }
+            page->mesh.num_vertices += mesh->num_vertices;
+            page->mesh.num_indices += mesh->num_indices;
+
+            apMeshDestroy(mesh);
+        }
+        free((void*)meshes);
+    }
+    return result;
+}
+
+// ************************************************************************************************************************
+// Vertex formats
+
+static uint16_t apMeshQuantizeUnit(float v)
+{
+    float q = v * 65535.0f + 0.5f;
+    return (uint16_t)(q < 0.0f ? 0.0f : (q > 65535.0f ? 65535.0f : q));
+}
+
+// Rounds to the nearest integer, and clamps it to the range. Sets *clamped if it's outside of the range
+static int apMeshQuantize(float v, int min, int max, int* clamped)
+{
+    float r = floorf(v + 0.5f);
+    if (r < (float)min || r > (float)max)
+    {
+        *clamped = 1;
+        return r < (float)min ? min : max;
+    }
+    return (int)r;
+}
+
+// Maps a position in the page back to the original image, i.e. the inverse of the mapping in apRenderImage
+static apPosf apMeshPageToImage(const apImage* image, apPosf p)
+{
+    const apRect* trim = &image->trim;
+    apPos origin = apTransform(0, 0, trim->size.width, trim->size.height, image->rotation, image->flip);
+    apPos stepx = apTransform(1, 0, trim->size.width, trim->size.height, image->rotation, image->flip);
+    apPos stepy = apTransform(0, 1, trim->size.width, trim->size.height, image->rotation, image->flip);
+    stepx.x -= origin.x; stepx.y -= origin.y;
+    stepy.x -= origin.x; stepy.y -= origin.y;
+
+    // The steps are orthogonal unit vectors, relative to the center of the first texel
+    float dx = p.x - (image->placement.pos.x + origin.x + 0.5f);
+    float dy = p.y - (image->placement.pos.y + origin.y + 0.5f);
+    apPosf local;
+    local.x = trim->pos.x + 0.5f + dx * stepx.x + dy * stepx.y;
+    local.y = trim->pos.y + 0.5f + dx * stepy.x + dy * stepy.y;
+    return local;
+}
+
+int apMeshWriteImageVertices(const apPage* page, const apImage* image, apVertexFormat format, apPosf pivot, void* vertices)
+{
+    const apPosf* positions = page->mesh.vertices + image->mesh_first_vertex;
+    int num_vertices = image->mesh_num_vertices;
+    float inv_width = 1.0f / (float)page->dimensions.width;
+    float inv_height = 1.0f / (float)page->dimensions.height;
+
+    int clamped = 0;
+    if (format == AP_VERTEX_FORMAT_PAGE_U16)
+    {
+        apVertexPageU16* out = (apVertexPageU16*)vertices;
+        for (int i = 0; i < num_vertices; ++i)
+        {
+            apPosf p = positions[i];
+            out[i].x = (uint16_t)apMeshQuantize(p.x, 0, 65535, &clamped);
+            out[i].y = (uint16_t)apMeshQuantize(p.y, 0, 65535, &clamped);
+            out[i].u = apMeshQuantizeUnit(p.x * inv_width);
+            out[i].v = apMeshQuantizeUnit(p.y * inv_height);
+        }
+    }
+    else
+    {
+        apVertexLocalS16* out = (apVertexLocalS16*)vertices;
+        float pivotx = pivot.x * image->dimensions.width;
+        float pivoty = pivot.y * image->dimensions.height;
+        const float scale = (float)(1 << AP_VERTEX_FIXED_SHIFT);
+        for (int i = 0; i < num_vertices; ++i)
+        {
+            apPosf p = positions[i];
+            apPosf local = apMeshPageToImage(image, p);
+            out[i].x = (int16_t)apMeshQuantize((local.x - pivotx) * scale, -32768, 32767, &clamped);
+            out[i].y = (int16_t)apMeshQuantize((local.y - pivoty) * scale, -32768, 32767, &clamped);
+            out[i].u = apMeshQuantizeUnit(p.x * inv_width);
+            out[i].v = apMeshQuantizeUnit(p.y * inv_height);
+        }
+    }
+    return !clamped;
+}
+
+int apMeshWritePageVertices(const apPage* page, apVertexFormat format, apPosf pivot, void* vertices)
+{
+    size_t vertex_size = format == AP_VERTEX_FORMAT_PAGE_U16 ? sizeof(apVertexPageU16) : sizeof(apVertexLocalS16);
+    int result = 1;
+    for (apImage* image = page->first_image; image; image = image->next)
+    {
+        uint8_t* out = (uint8_t*)vertices + vertex_size * (size_t)image->mesh_first_vertex;
+        if (!apMeshWriteImageVertices(page, image, format, pivot, out))
+            result = 0;
+        if (image == page->last_image)
+            break;
+    }
+    return result;
+}
@@ -0,0 +1,312 @@
+// https://github.com/JCash/atlaspacker
+// License: MIT
+// @2021-@2023 Mathias Westerdahl
+
+#include <atlaspacker/overlap.h>
+
+#include <stdlib.h> // malloc
+#include <string.h> // memset
+#include <float.h>  // FLT_MAX
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define AP_OVERLAP_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    #include <arm_neon.h>
+    #define AP_OVERLAP_NEON
+#endif
+
+// The polygons are padded to a multiple of this many vertices
+#define AP_OVERLAP_LANES 4
+
+// Query polygons up to this size don't need to allocate memory
+#define AP_OVERLAP_MAX_STACK_VERTICES 64
+
+static inline int apOverlapRoundUp(int v)
+{
+    return (v + AP_OVERLAP_LANES - 1) & ~(AP_OVERLAP_LANES - 1);
+}
+
+// Projects the vertices onto the axis. The count must be a multiple of AP_OVERLAP_LANES
+static void apOverlapProject(const float* x, const float* y, int count, float ax, float ay, float* out_min, float* out_max)
+{
+#if defined(AP_OVERLAP_SSE2)
+    __m128 vax = _mm_set1_ps(ax);
+    __m128 vay = _mm_set1_ps(ay);
+    __m128 vmin = _mm_set1_ps(FLT_MAX);
+    __m128 vmax = _mm_set1_ps(-FLT_MAX);
+    for (int i = 0; i < count; i += 4)
+    {
+        __m128 d = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(x + i), vax), _mm_mul_ps(_mm_loadu_ps(y + i), vay));
+        vmin = _mm_min_ps(vmin, d);
+        vmax = _mm_max_ps(vmax, d);
+    }
+    vmin = _mm_min_ps(vmin, _mm_shuffle_ps(vmin, vmin, _MM_SHUFFLE(1, 0, 3, 2)));
+    vmin = _mm_min_ps(vmin, _mm_shuffle_ps(vmin, vmin, _MM_SHUFFLE(2, 3, 0, 1)));
+    vmax = _mm_max_ps(vmax, _mm_shuffle_ps(vmax, vmax, _MM_SHUFFLE(1, 0, 3, 2)));
+    vmax = _mm_max_ps(vmax, _mm_shuffle_ps(vmax, vmax, _MM_SHUFFLE(2, 3, 0, 1)));
+    *out_min = _mm_cvtss_f32(vmin);
+    *out_max = _mm_cvtss_f32(vmax);
+#elif defined(AP_OVERLAP_NEON)
+    float32x4_t vax = vdupq_n_f32(ax);
+    float32x4_t vay = vdupq_n_f32(ay);
+    float32x4_t vmin = vdupq_n_f32(FLT_MAX);
+    float32x4_t vmax = vdupq_n_f32(-FLT_MAX);
+    for (int i = 0; i < count; i += 4)
+    {
+        float32x4_t d = vaddq_f32(vmulq_f32(vld1q_f32(x + i), vax), vmulq_f32(vld1q_f32(y + i), vay));
+        vmin = vminq_f32(vmin, d);
+        vmax = vmaxq_f32(vmax, d);
+    }
+    *out_min = vminvq_f32(vmin);
+    *out_max = vmaxvq_f32(vmax);
+#else
+    float min = FLT_MAX;
+    float max = -FLT_MAX;
+    for (int i = 0; i < count; ++i)
+    {
+        float d = x[i] * ax + y[i] * ay;
+        min = d < min ? d : min;
+        max = d > max ? d : max;
+    }
+    *out_min = min;
+    *out_max = max;
+#endif
+}
+
+// Calculates the edge normals of a (padded) polygon. The padding gets zero normals
+static void apOverlapCalcNormals(const float* x, const float* y, int num_vertices, int count, float* nx, float* ny)
+{
+    for (int i = 0; i < num_vertices; ++i)
+    {
+        int j = (i + 1) % num_vertices;
+        nx[i] = -(y[j] - y[i]);
+        ny[i] = x[j] - x[i];
+    }
+    for (int i = num_vertices; i < count; ++i)
+    {
+        nx[i] = 0.0f;
+        ny[i] = 0.0f;
+    }
+}
+
+apOverlapBatch* apOverlapBatchCreate(void)
+{
+    apOverlapBatch* batch = (apOverlapBatch*)malloc(sizeof(apOverlapBatch));
+    memset(batch, 0, sizeof(apOverlapBatch));
+    batch->offsets = (int*)malloc(sizeof(int));
+    batch->offsets[0] = 0;
+    return batch;
+}
+
+void apOverlapBatchDestroy(apOverlapBatch* batch)
+{
+    free((void*)batch->x);
+    free((void*)batch->y);
+    free((void*)batch->nx);
+    free((void*)batch->ny);
+    free((void*)batch->nmin);
+    free((void*)batch->nmax);
+    free((void*)batch->offsets);
+    free((void*)batch->sizes);
+    free((void*)batch->minx);
+    free((void*)batch->miny);
+    free((void*)batch->maxx);
+    free((void*)batch->maxy);
+    free((void*)batch);
+}
+
+void apOverlapBatchClear(apOverlapBatch* batch)
+{
+    batch->num_polygons = 0;
+    batch->num_vertices = 0;
+}
+
+int apOverlapBatchAdd(apOverlapBatch* batch, const apPosf* vertices, int num_vertices)
+{
+    if (num_vertices <= 0)
+        return -1;
+
+    int count = apOverlapRoundUp(num_vertices);
+    if (batch->num_vertices + count > batch->vertex_capacity)
+    {
+        int capacity = batch->vertex_capacity ? batch->vertex_capacity * 2 : 256;
+        while (capacity < batch->num_vertices + count)
+            capacity *= 2;
+        batch->x = (float*)realloc(batch->x, sizeof(float) * (size_t)capacity);
+        batch->y = (float*)realloc(batch->y, sizeof(float) * (size_t)capacity);
+        batch->nx = (float*)realloc(batch->nx, sizeof(float) * (size_t)capacity);
+        batch->ny = (float*)realloc(batch->ny, sizeof(float) * (size_t)capacity);
+        batch->nmin = (float*)realloc(batch->nmin, sizeof(float) * (size_t)capacity);
+        batch->nmax = (float*)realloc(batch->nmax, sizeof(float) * (size_t)capacity);
+        batch->vertex_capacity = capacity;
+    }
+    if (batch->num_polygons + 1 > batch->polygon_capacity)
+    {
+        int capacity = batch->polygon_capacity ? batch->polygon_capacity * 2 : 64;
+        batch->offsets = (int*)realloc(batch->offsets, sizeof(int) * (size_t)(capacity + 1));
+        batch->sizes = (int*)realloc(batch->sizes, sizeof(int) * (size_t)capacity);
+        batch->minx = (float*)realloc(batch->minx, sizeof(float) * (size_t)capacity);
+        batch->miny = (float*)realloc(batch->miny, sizeof(float) * (size_t)capacity);
+        batch->maxx = (float*)realloc(batch->maxx, sizeof(float) * (size_t)capacity);
+        batch->maxy = (float*)realloc(batch->maxy, sizeof(float) * (size_t)capacity);
+        batch->polygon_capacity = capacity;
+    }
+
+    int index = batch->num_polygons++;
+    int offset = batch->num_vertices;
+    batch->num_vertices += count;
+    batch->offsets[index] = offset;
+    batch->offsets[index + 1] = batch->num_vertices;
+    batch->sizes[index] = num_vertices;
+
+    // The padding repeats the last vertex, which doesn't change the projections
+    float* x = batch->x + offset;
+    float* y = batch->y + offset;
+    for (int i = 0; i < count; ++i)
+    {
+        apPosf p = vertices[i < num_vertices ? i : num_vertices - 1];
+        x[i] = p.x;
+        y[i] = p.y;
+    }
+
+    float minx = FLT_MAX, miny = FLT_MAX, maxx = -FLT_MAX, maxy = -FLT_MAX;
+    for (int i = 0; i < num_vertices; ++i)
+    {
+        minx = x[i] < minx ? x[i] : minx;
+        miny = y[i] < miny ? y[i] : miny;
+        maxx = x[i] > maxx ? x[i] : maxx;
+        maxy = y[i] > maxy ? y[i] : maxy;
+    }
+    batch->minx[index] = minx;
+    batch->miny[index] = miny;
+    batch->maxx[index] = maxx;
+    batch->maxy[index] = maxy;
+
+    float* nx = batch->nx + offset;
+    float* ny = batch->ny + offset;
+    apOverlapCalcNormals(x, y, num_vertices, count, nx, ny);
+    for (int i = 0; i < num_vertices; ++i)
+        apOverlapProject(x, y, count, nx[i], ny[i], &batch->nmin[offset + i], &batch->nmax[offset + i]);
+
+    return index;
+}
+
+// Tests the bounding boxes of 4 polygons at a time. Returns a bit mask of the polygons that may overlap
+static int apOverlapTestBoxes(const apOverlapBatch* batch, int first, float minx, float miny, float maxx, float maxy)
+{
+#if defined(AP_OVERLAP_SSE2)
+    __m128 separated = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(_mm_loadu_ps(batch->maxx + first), _mm_set1_ps(minx)),
+                                            _mm_cmplt_ps(_mm_set1_ps(maxx), _mm_loadu_ps(batch->minx + first))),
+                                 _mm_or_ps(_mm_cmplt_ps(_mm_loadu_ps(batch->maxy + first), _mm_set1_ps(miny)),
+                                            _mm_cmplt_ps(_mm_set1_ps(maxy), _mm_loadu_ps(batch->miny + first))));
+    return ~_mm_movemask_ps(separated) & 0xF;
+#elif defined(AP_OVERLAP_NEON)
+    uint32x4_t separated = vorrq_u32(vorrq_u32(vcltq_f32(vld1q_f32(batch->maxx + first), vdupq_n_f32(minx)),
+                                               vcltq_f32(vdupq_n_f32(maxx), vld1q_f32(batch->minx + first))),
+                                     vorrq_u32(vcltq_f32(vld1q_f32(batch->maxy + first), vdupq_n_f32(miny)),
+                                               vcltq_f32(vdupq_n_f32(maxy), vld1q_f32(batch->miny + first))));
+    uint32_t lanes[4];
+    vst1q_u32(lanes, separated);
+    return (lanes[0] ? 0 : 1) | (lanes[1] ? 0 : 2) | (lanes[2] ? 0 : 4) | (lanes[3] ? 0 : 8);
+#else
+    int mask = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        int p = first + i;
+        int separated = batch->maxx[p] < minx || maxx < batch->minx[p] || batch->maxy[p] < miny || maxy < batch->miny[p];
+        mask |= separated ? 0 : (1 << i);
+    }
+    return mask;
+#endif
+}
+
+int apOverlapBatchTest(const apOverlapBatch* batch, const apPosf* vertices, int num_vertices, uint8_t* results)
+{
+    if (num_vertices <= 0)
+    {
+        if (batch->num_polygons)
+            memset(results, 0, (size_t)batch->num_polygons);
+        return 0;
+    }
+
+    // The query polygon, in the same layout as the batch: x, y, nx, ny, qmin, qmax
+    int count = apOverlapRoundUp(num_vertices);
+    float stack_memory[AP_OVERLAP_MAX_STACK_VERTICES * 6];
+    float* memory = count <= AP_OVERLAP_MAX_STACK_VERTICES ? stack_memory : (float*)malloc(sizeof(float) * 6 * (size_t)count);
+    float* x = memory;
+    float* y = x + count;
+    float* nx = y + count;
+    float* ny = nx + count;
+    float* qmin = ny + count;
+    float* qmax = qmin + count;
+
+    float minx = FLT_MAX, miny = FLT_MAX, maxx = -FLT_MAX, maxy = -FLT_MAX;
+    for (int i = 0; i < count; ++i)
+    {
+        apPosf p = vertices[i < num_vertices ? i : num_vertices - 1];
+        x[i] = p.x;
+        y[i] = p.y;
+        minx = p.x < minx ? p.x : minx;
+        miny = p.y < miny ? p.y : miny;
+        maxx = p.x > maxx ? p.x : maxx;
+        maxy = p.y > maxy ? p.y : maxy;
+    }
+    apOverlapCalcNormals(x, y, num_vertices, count, nx, ny);
+    for (int i = 0; i < num_vertices; ++i)
+        apOverlapProject(x, y, count, nx[i], ny[i], &qmin[i], &qmax[i]);
+
+    int num_polygons = batch->num_polygons;
+    int num_overlaps = 0;
+    for (int first = 0; first < num_polygons; first += 4)
+    {
+        int mask;
+        if (first + 4 <= num_polygons)
+            mask = apOverlapTestBoxes(batch, first, minx, miny, maxx, maxy);
+        else
+        {
+            mask = 0;
+            for (int p = first; p < num_polygons; ++p)
+            {
+                int separated = batch->maxx[p] < minx || maxx < batch->minx[p] || batch->maxy[p] < miny || maxy < batch->miny[p];
+                mask |= separated ? 0 : (1 << (p - first));
+            }
+        }
+
+        int last = first + 4 < num_polygons ? first + 4 : num_polygons;
+        for (int p = first; p < last; ++p)
+        {
+            int overlap = (mask >> (p - first)) & 1;
+
+            int offset = batch->offsets[p];
+            int polygon_count = batch->offsets[p + 1] - offset;
+            const float* px = batch->x + offset;
+            const float* py = batch->y + offset;
+
+            // The axes of the query polygon
+            for (int i = 0; i < num_vertices && overlap; ++i)
+            {
+                float pmin, pmax;
+                apOverlapProject(px, py, polygon_count, nx[i], ny[i], &pmin, &pmax);
+                overlap = !(pmax < qmin[i] || qmax[i] < pmin);
+            }
+
+            // The axes of the polygon in the batch
+            const float* pnx = batch->nx + offset;
+            const float* pny = batch->ny + offset;
+            for (int i = 0; i < batch->sizes[p] && overlap; ++i)
+            {
+                float min, max;
+                apOverlapProject(x, y, count, pnx[i], pny[i], &min, &max);
+                overlap = !(batch->nmax[offset + i] < min || max < batch->nmin[offset + i]);
+            }
+
+            results[p] = (uint8_t)overlap;
+            num_overlaps += overlap;
+        }
+    }
+
+    if (memory != stack_memory)
+        free((void*)memory);
+    return num_overlaps;
+}
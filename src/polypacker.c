@@ -0,0 +1,1743 @@
+// https://github.com/JCash/atlaspacker
+// License: MIT
+// @2021-@2023 Mathias Westerdahl
+
+#include <atlaspacker/polypacker.h>
+#include <atlaspacker/contour.h>
+#include <atlaspacker/triangulate.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h> // INT_MAX
+#include <stdio.h>  // printf
+#include <math.h>   // sqrt
+
+#pragma pack(1)
+
+// The outline of an image in one orientation, split into convex pieces.
+// The vertices are texel corners, relative to the placement of the image, and each piece is CCW (positive area)
+typedef struct
+{
+    apPos*  vertices;       // The vertices of all pieces, one after the other
+    int*    offsets;        // The first vertex of each piece (num_pieces + 1 entries)
+    int     num_pieces;
+    apPos*  piece_min;      // The bounding box of each piece
+    apPos*  piece_max;
+    apPos   min;            // The bounding box of all pieces
+    apPos   max;
+    apSize  size;           // The size of the placement
+    int     rotation;
+    int     flip;
+    apPos   probes[5];      // Texels that are covered by the shape. Used to quickly discard positions
+    int     num_probes;
+} apPolyPackShape;
+
+typedef struct
+{
+    apImage         super;
+    apPolyPackShape shapes[8];  // One per orientation (rotations, and flips)
+    int             num_shapes;
+    int64_t         area;       // The area of the outline
+
+    // The result of the current packing
+    int             fit_page;
+    int             fit_shape;
+    apPos           pos;
+
+    // The result of the best packing so far (see apPolyPackerOptions::search_page_size)
+    int             best_page;
+    int             best_shape;
+    apPos           best_pos;
+} apPolyPackerImage;
+
+// A placed convex piece
+typedef struct
+{
+    int     first;          // The first vertex in apPolyPackerPage::vertices
+    int     count;
+    apPos   min;
+    apPos   max;
+    int     stamp;          // So that each piece is only tested once per query
+} apPolyPackPiece;
+
+// Links a piece to a grid cell that it overlaps
+typedef struct
+{
+    int     piece;
+    int     cell;
+    int     next;           // The next entry in the same cell, or -1
+} apPolyPackCellEntry;
+
+// A placed piece and a piece of the shape that is being placed
+typedef struct
+{
+    int     piece;          // The index in apPolyPackerPage::pieces
+    int     shape_piece;
+    int     next;           // The next pair in the same row, or -1
+} apPolyPackPair;
+
+typedef struct
+{
+    apSize                  dimensions;
+
+    apPos*                  vertices;       // The vertices of the placed pieces, in page space
+    int                     num_vertices;
+    int                     vertices_capacity;
+    apPolyPackPiece*        pieces;
+    int                     num_pieces;
+    int                     pieces_capacity;
+    int                     stamp;
+
+    // A grid over the page. Each cell holds the first entry of the list of pieces that overlap the cell
+    int*                    cells;
+    int                     cells_capacity;
+    int                     grid_width;
+    int                     grid_height;
+    apPolyPackCellEntry*    entries;
+    int                     num_entries;
+    int                     entries_capacity;
+
+    // One byte per texel. Non zero if the texel is fully covered by a placed piece
+    uint8_t*                texels;
+    int                     texels_capacity;
+} apPolyPackerPage;
+
+typedef struct
+{
+    apPacker                super;
+    apPolyPackerOptions     options;
+    apPolyPackerPage*       pages;          // The pages of the current packing
+    int                     num_pages;
+    int                     pages_capacity;
+    apSize*                 best_dims;      // The page sizes of the best packing
+    int                     num_best_pages;
+    int                     cell_size;
+
+    apPos*                  candidates;     // Scratch heap of candidate positions
+    int                     num_candidates;
+    int                     candidates_capacity;
+    apPolyPackPair*         pairs;          // Scratch list of the piece pairs to create no-fit polygons for
+    int                     num_pairs;
+    int                     pairs_capacity;
+    int*                    rows;           // The first pair of each row, by the lowest valid position where the pieces can touch
+    int                     rows_capacity;
+
+    uint64_t                deadline;       // When the current pass runs out of time (0 means no limit)
+    int                     out_of_time;    // Set when a search for a position was stopped by the deadline
+
+    // When the time budget has run out, the remaining images are placed next to each other, on shelves above the placed pieces
+    int                     shelf_page;     // The page of the current shelf, or -1
+    apPos                   shelf_pos;      // Where the next image on the shelf is placed
+    int                     shelf_height;
+} apPolyPacker;
+
+#pragma options align=reset
+
+#define AP_MIN(_A, _B) ((_A) < (_B) ? (_A) : (_B))
+#define AP_MAX(_A, _B) ((_A) > (_B) ? (_A) : (_B))
+
+// Makes room for at least 'size' elements
+static void apPolyPackReserve(void** data, int* capacity, int size, size_t element_size)
+{
+    if (size <= *capacity)
+        return;
+    int new_capacity = AP_MAX(16, *capacity * 2);
+    if (new_capacity < size)
+        new_capacity = size;
+    *data = realloc(*data, (size_t)new_capacity * element_size);
+    *capacity = new_capacity;
+}
+
+static inline int64_t apPolyPackCross(apPos a, apPos b, apPos c)
+{
+    return (int64_t)(b.x - a.x) * (c.y - a.y) - (int64_t)(b.y - a.y) * (c.x - a.x);
+}
+
+static int64_t apPolyPackArea(const apPos* vertices, int num_vertices)
+{
+    int64_t area = 0;
+    for (int i = 0; i < num_vertices; ++i)
+    {
+        apPos a = vertices[i];
+        apPos b = vertices[(i+1) % num_vertices];
+        area += (int64_t)a.x * b.y - (int64_t)b.x * a.y;
+    }
+    return area; // times 2
+}
+
+// Returns 1 if the point is inside (or on the border of) the convex CCW polygon
+static int apPolyPackInside(const apPos* vertices, int num_vertices, int x, int y)
+{
+    apPos p = { x, y };
+    for (int i = 0; i < num_vertices; ++i)
+    {
+        if (apPolyPackCross(vertices[i], vertices[(i + 1) % num_vertices], p) < 0)
+            return 0;
+    }
+    return 1;
+}
+
+// Calls the callback for each texel that is fully covered by the convex CCW polygon
+static void apPolyPackRasterize(const apPos* vertices, int num_vertices, void (*callback)(void* ctx, int x, int y), void* ctx)
+{
+    apPos min = vertices[0];
+    apPos max = vertices[0];
+    for (int i = 1; i < num_vertices; ++i)
+    {
+        min.x = AP_MIN(min.x, vertices[i].x);
+        min.y = AP_MIN(min.y, vertices[i].y);
+        max.x = AP_MAX(max.x, vertices[i].x);
+        max.y = AP_MAX(max.y, vertices[i].y);
+    }
+
+    // The polygon is convex, so a texel is covered if all its corners are
+    int width = max.x - min.x + 1;
+    uint8_t* corners = (uint8_t*)malloc((size_t)width * 2);
+    uint8_t* prev = corners;
+    uint8_t* row = corners + width;
+    for (int x = 0; x < width; ++x)
+        prev[x] = (uint8_t)apPolyPackInside(vertices, num_vertices, min.x + x, min.y);
+    for (int y = min.y + 1; y <= max.y; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+            row[x] = (uint8_t)apPolyPackInside(vertices, num_vertices, min.x + x, y);
+        for (int x = 0; x < width - 1; ++x)
+        {
+            if (prev[x] && prev[x + 1] && row[x] && row[x + 1])
+                callback(ctx, min.x + x, y - 1);
+        }
+        uint8_t* tmp = prev;
+        prev = row;
+        row = tmp;
+    }
+    free((void*)corners);
+}
+
+// ************************************************************************************************************************
+// Outlines
+
+// Creates a mask of the non transparent texels of the trimmed image, grown by the padding.
+// The mask has a border of 'padding' texels on each side
+static uint8_t* apPolyPackCreateMask(const apImage* image, int alpha_threshold, int padding, int* out_width, int* out_height)
+{
+    const apRect* trim = &image->trim;
+    int width = trim->size.width + 2 * padding;
+    int height = trim->size.height + 2 * padding;
+    uint8_t* mask = (uint8_t*)malloc((size_t)width * (size_t)height);
+    memset(mask, 0, (size_t)width * (size_t)height);
+
+    int num_set = 0;
+    for (int y = 0; y < trim->size.height; ++y)
+    {
+        for (int x = 0; x < trim->size.width; ++x)
+        {
+            int set = 1;
+            if (image->data && image->channels == 4)
+                set = image->data[((trim->pos.y + y) * image->width + trim->pos.x + x) * 4 + 3] > alpha_threshold;
+            mask[(y + padding) * width + x + padding] = (uint8_t)set;
+            num_set += set;
+        }
+    }
+
+    // Fully transparent images still need a valid placement
+    if (!num_set)
+    {
+        for (int y = 0; y < trim->size.height; ++y)
+            memset(mask + (y + padding) * width + padding, 1, (size_t)trim->size.width);
+    }
+
+    if (padding)
+    {
+        // Grows the texels by the padding (a square kernel), one axis at a time
+        uint8_t* tmp = (uint8_t*)malloc((size_t)width * (size_t)height);
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                uint8_t value = 0;
+                for (int i = AP_MAX(0, x - padding); i <= AP_MIN(width - 1, x + padding) && !value; ++i)
+                    value = mask[y * width + i];
+                tmp[y * width + x] = value;
+            }
+        }
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                uint8_t value = 0;
+                for (int i = AP_MAX(0, y - padding); i <= AP_MIN(height - 1, y + padding) && !value; ++i)
+                    value = tmp[i * width + x];
+                mask[y * width + x] = value;
+            }
+        }
+        free((void*)tmp);
+    }
+
+    *out_width = width;
+    *out_height = height;
+    return mask;
+}
+
+typedef struct
+{
+    apPos*  vertices;
+    int     num_vertices;
+} apPolyPackPolygon;
+
+// An edge (a -> b) of a polygon
+typedef struct
+{
+    apPos   a;
+    apPos   b;
+    int     polygon;
+    int     index;
+} apPolyPackEdge;
+
+static int apPolyPackCompareEdges(const void* _a, const void* _b)
+{
+    const apPolyPackEdge* a = (const apPolyPackEdge*)_a;
+    const apPolyPackEdge* b = (const apPolyPackEdge*)_b;
+    if (a->a.x != b->a.x) return a->a.x < b->a.x ? -1 : 1;
+    if (a->a.y != b->a.y) return a->a.y < b->a.y ? -1 : 1;
+    if (a->b.x != b->b.x) return a->b.x < b->b.x ? -1 : 1;
+    if (a->b.y != b->b.y) return a->b.y < b->b.y ? -1 : 1;
+    return 0;
+}
+
+// Removes the collinear vertices. Returns 0 if the polygon isn't convex
+static int apPolyPackMakeConvex(apPos* vertices, int* num_vertices)
+{
+    int n = *num_vertices;
+    int num_kept = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        apPos prev = vertices[(i + n - 1) % n];
+        apPos p = vertices[i];
+        apPos next = vertices[(i + 1) % n];
+        int64_t cross = apPolyPackCross(prev, p, next);
+        if (cross < 0)
+            return 0;
+        if (cross == 0)
+        {
+            // A spike isn't convex
+            if ((int64_t)(p.x - prev.x) * (next.x - p.x) + (int64_t)(p.y - prev.y) * (next.y - p.y) < 0)
+                return 0;
+            continue;
+        }
+        vertices[num_kept++] = p;
+    }
+    *num_vertices = num_kept;
+    return num_kept >= 3;
+}
+
+// Merges the triangles into convex polygons, by removing the shared edges where the result stays convex (Hertel-Mehlhorn).
+// Returns the number of polygons left at the start of the array
+static int apPolyPackMergeTriangles(apPolyPackPolygon* polygons, int num_polygons)
+{
+    int num_edges = 0;
+    for (int i = 0; i < num_polygons; ++i)
+        num_edges += polygons[i].num_vertices;
+    apPolyPackEdge* edges = (apPolyPackEdge*)malloc(sizeof(apPolyPackEdge) * (size_t)num_edges);
+    uint8_t* dirty = (uint8_t*)malloc((size_t)num_polygons);
+    apPos* merged = (apPos*)malloc(sizeof(apPos) * (size_t)num_edges);
+
+    int num_merged = 1;
+    while (num_merged)
+    {
+        // Polygons that were merged in this pass are left as they are until the next pass, since their edges have changed
+        num_merged = 0;
+        num_edges = 0;
+        for (int i = 0; i < num_polygons; ++i)
+        {
+            for (int v = 0; v < polygons[i].num_vertices; ++v)
+            {
+                apPolyPackEdge* edge = &edges[num_edges++];
+                edge->a = polygons[i].vertices[v];
+                edge->b = polygons[i].vertices[(v + 1) % polygons[i].num_vertices];
+                edge->polygon = i;
+                edge->index = v;
+            }
+        }
+        qsort(edges, (size_t)num_edges, sizeof(apPolyPackEdge), apPolyPackCompareEdges);
+        memset(dirty, 0, (size_t)num_polygons);
+
+        for (int i = 0; i < num_polygons; ++i)
+        {
+            apPolyPackPolygon* polygon = &polygons[i];
+            for (int v = 0; v < polygon->num_vertices && !dirty[i]; ++v)
+            {
+                apPolyPackEdge key;
+                key.a = polygon->vertices[(v + 1) % polygon->num_vertices];
+                key.b = polygon->vertices[v];
+                apPolyPackEdge* twin = (apPolyPackEdge*)bsearch(&key, edges, (size_t)num_edges, sizeof(apPolyPackEdge), apPolyPackCompareEdges);
+                if (!twin || twin->polygon == i || dirty[twin->polygon] || !polygons[twin->polygon].num_vertices)
+                    continue;
+
+                // This polygon: ... a, b ...  The other polygon: ... b, a ...
+                // The merged polygon goes from b to a in this polygon, and then back to b in the other one
+                const apPolyPackPolygon* other = &polygons[twin->polygon];
+                int num_vertices = 0;
+                for (int k = 0; k < polygon->num_vertices; ++k)
+                    merged[num_vertices++] = polygon->vertices[(v + 1 + k) % polygon->num_vertices];
+                for (int k = 2; k < other->num_vertices; ++k)
+                    merged[num_vertices++] = other->vertices[(twin->index + k) % other->num_vertices];
+
+                if (!apPolyPackMakeConvex(merged, &num_vertices))
+                    continue;
+
+                polygon->vertices = (apPos*)realloc(polygon->vertices, sizeof(apPos) * (size_t)num_vertices);
+                memcpy(polygon->vertices, merged, sizeof(apPos) * (size_t)num_vertices);
+                polygon->num_vertices = num_vertices;
+                free((void*)other->vertices);
+                polygons[twin->polygon].vertices = 0;
+                polygons[twin->polygon].num_vertices = 0;
+                dirty[i] = 1;
+                dirty[twin->polygon] = 1;
+                ++num_merged;
+            }
+        }
+
+        // Remove the merged polygons
+        int num_kept = 0;
+        for (int i = 0; i < num_polygons; ++i)
+        {
+            if (polygons[i].num_vertices)
+                polygons[num_kept++] = polygons[i];
+        }
+        num_polygons = num_kept;
+    }
+
+    free((void*)edges);
+    free((void*)dirty);
+    free((void*)merged);
+    return num_polygons;
+}
+
+// Traces the outline of the image (grown by the padding), and splits it into convex pieces.
+// The vertices are relative to the trimmed image. Returns the pieces in the same format as apPolyPackShape
+static int apPolyPackCreateOutline(const apImage* image, const apPolyPackerOptions* options, apPos** out_vertices, int** out_offsets)
+{
+    int padding = options->padding;
+    int width, height;
+    uint8_t* mask = apPolyPackCreateMask(image, options->alpha_threshold, padding, &width, &height);
+
+    apContour* contours = 0;
+    int num_contours = apContourFromImage(mask, width, height, &contours);
+    if (options->max_error > 0.0f)
+        apContourSimplify(contours, num_contours, mask, width, height, options->max_error);
+
+    apPosf* vertices = 0;
+    int num_vertices = 0;
+    int* indices = 0;
+    int num_triangles = apTriangulateContours(contours, num_contours, &vertices, &num_vertices, &indices);
+    apContourDestroy(contours, num_contours);
+    free((void*)mask);
+
+    // The contour vertices are texel corners, so they're exact as integers
+    apPolyPackPolygon* polygons = (apPolyPackPolygon*)malloc(sizeof(apPolyPackPolygon) * (size_t)AP_MAX(1, num_triangles));
+    int num_polygons = 0;
+    for (int t = 0; t < num_triangles; ++t)
+    {
+        apPos triangle[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            apPosf p = vertices[indices[t * 3 + i]];
+            triangle[i].x = (int)floorf(p.x + 0.5f) - padding;
+            triangle[i].y = (int)floorf(p.y + 0.5f) - padding;
+        }
+        int64_t area = apPolyPackCross(triangle[0], triangle[1], triangle[2]);
+        if (area == 0)
+            continue;
+        if (area < 0)
+        {
+            apPos tmp = triangle[1];
+            triangle[1] = triangle[2];
+            triangle[2] = tmp;
+        }
+        apPolyPackPolygon* polygon = &polygons[num_polygons++];
+        polygon->vertices = (apPos*)malloc(sizeof(apPos) * 3);
+        memcpy(polygon->vertices, triangle, sizeof(triangle));
+        polygon->num_vertices = 3;
+    }
+    free((void*)vertices);
+    free((void*)indices);
+
+    num_polygons = apPolyPackMergeTriangles(polygons, num_polygons);
+    if (!num_polygons)
+    {
+        // Use the (padded) rectangle of the image
+        apPos box[4] = { { -padding, -padding }, { image->trim.size.width + padding, -padding },
+                         { image->trim.size.width + padding, image->trim.size.height + padding }, { -padding, image->trim.size.height + padding } };
+        polygons[0].vertices = (apPos*)malloc(sizeof(box));
+        memcpy(polygons[0].vertices, box, sizeof(box));
+        polygons[0].num_vertices = 4;
+        num_polygons = 1;
+    }
+
+    int total_vertices = 0;
+    for (int i = 0; i < num_polygons; ++i)
+        total_vertices += polygons[i].num_vertices;
+
+    *out_vertices = (apPos*)malloc(sizeof(apPos) * (size_t)AP_MAX(1, total_vertices));
+    *out_offsets = (int*)malloc(sizeof(int) * (size_t)(num_polygons + 1));
+    int offset = 0;
+    for (int i = 0; i < num_polygons; ++i)
+    {
+        (*out_offsets)[i] = offset;
+        memcpy(*out_vertices + offset, polygons[i].vertices, sizeof(apPos) * (size_t)polygons[i].num_vertices);
+        offset += polygons[i].num_vertices;
+        free((void*)polygons[i].vertices);
+    }
+    (*out_offsets)[num_polygons] = offset;
+    free((void*)polygons);
+    return num_polygons;
+}
+
+// Transforms the outline the same way as the image is transformed when rendered (see apRenderImage)
+static void apPolyPackCreateShape(apPolyPackShape* shape, const apImage* image, const apPos* vertices, const int* offsets, int num_pieces,
+                                    int rotation, int flip)
+{
+    int width = image->trim.size.width;
+    int height = image->trim.size.height;
+
+    // The texel mapping is linear, and texel (x,y) covers the corners (x,y) to (x+1,y+1)
+    apPos origin = apTransform(0, 0, width, height, rotation, flip);
+    apPos stepx = apTransform(1, 0, width, height, rotation, flip);
+    apPos stepy = apTransform(0, 1, width, height, rotation, flip);
+    stepx.x -= origin.x; stepx.y -= origin.y;
+    stepy.x -= origin.x; stepy.y -= origin.y;
+    origin.x = (2 * origin.x + 1 - stepx.x - stepy.x) / 2;
+    origin.y = (2 * origin.y + 1 - stepx.y - stepy.y) / 2;
+
+    int num_vertices = offsets[num_pieces];
+    shape->vertices = (apPos*)malloc(sizeof(apPos) * (size_t)AP_MAX(1, num_vertices));
+    shape->offsets = (int*)malloc(sizeof(int) * (size_t)(num_pieces + 1));
+    memcpy(shape->offsets, offsets, sizeof(int) * (size_t)(num_pieces + 1));
+    shape->num_pieces = num_pieces;
+    shape->piece_min = (apPos*)malloc(sizeof(apPos) * (size_t)AP_MAX(1, num_pieces));
+    shape->piece_max = (apPos*)malloc(sizeof(apPos) * (size_t)AP_MAX(1, num_pieces));
+    shape->rotation = rotation;
+    shape->flip = flip;
+    shape->size.width = (rotation == 90 || rotation == 270) ? height : width;
+    shape->size.height = (rotation == 90 || rotation == 270) ? width : height;
+    shape->min.x = shape->min.y = INT_MAX;
+    shape->max.x = shape->max.y = INT_MIN;
+
+    for (int i = 0; i < num_pieces; ++i)
+    {
+        int first = offsets[i];
+        int count = offsets[i + 1] - first;
+        shape->piece_min[i].x = shape->piece_min[i].y = INT_MAX;
+        shape->piece_max[i].x = shape->piece_max[i].y = INT_MIN;
+        for (int v = 0; v < count; ++v)
+        {
+            // A mirrored piece has the opposite winding, so the vertex order is reversed
+            apPos p = vertices[first + (flip ? count - 1 - v : v)];
+            apPos t;
+            t.x = origin.x + p.x * stepx.x + p.y * stepy.x;
+            t.y = origin.y + p.x * stepx.y + p.y * stepy.y;
+            shape->vertices[first + v] = t;
+            shape->piece_min[i].x = AP_MIN(shape->piece_min[i].x, t.x);
+            shape->piece_min[i].y = AP_MIN(shape->piece_min[i].y, t.y);
+            shape->piece_max[i].x = AP_MAX(shape->piece_max[i].x, t.x);
+            shape->piece_max[i].y = AP_MAX(shape->piece_max[i].y, t.y);
+            shape->min.x = AP_MIN(shape->min.x, t.x);
+            shape->min.y = AP_MIN(shape->min.y, t.y);
+            shape->max.x = AP_MAX(shape->max.x, t.x);
+            shape->max.y = AP_MAX(shape->max.y, t.y);
+        }
+    }
+}
+
+typedef struct
+{
+    uint8_t*    texels;
+    int         width;
+    apPos       min;
+} apPolyPackMask;
+
+static void apPolyPackSetMaskTexel(void* ctx, int x, int y)
+{
+    apPolyPackMask* mask = (apPolyPackMask*)ctx;
+    mask->texels[(y - mask->min.y) * mask->width + x - mask->min.x] = 1;
+}
+
+// Picks a few covered texels, near the corners and the center of the shape
+static void apPolyPackCreateProbes(apPolyPackShape* shape)
+{
+    apPolyPackMask mask;
+    mask.min = shape->min;
+    mask.width = shape->max.x - shape->min.x;
+    int height = shape->max.y - shape->min.y;
+    mask.texels = (uint8_t*)malloc((size_t)mask.width * (size_t)height);
+    memset(mask.texels, 0, (size_t)mask.width * (size_t)height);
+    for (int i = 0; i < shape->num_pieces; ++i)
+        apPolyPackRasterize(shape->vertices + shape->offsets[i], shape->offsets[i + 1] - shape->offsets[i], apPolyPackSetMaskTexel, &mask);
+
+    apPos targets[5] = { { 0, 0 }, { mask.width - 1, 0 }, { 0, height - 1 }, { mask.width - 1, height - 1 }, { mask.width / 2, height / 2 } };
+    shape->num_probes = 0;
+    for (int t = 0; t < 5; ++t)
+    {
+        int64_t best = INT64_MAX;
+        apPos probe = { 0, 0 };
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < mask.width; ++x)
+            {
+                if (!mask.texels[y * mask.width + x])
+                    continue;
+                int64_t dx = x - targets[t].x;
+                int64_t dy = y - targets[t].y;
+                if (dx * dx + dy * dy < best)
+                {
+                    best = dx * dx + dy * dy;
+                    probe.x = x + mask.min.x;
+                    probe.y = y + mask.min.y;
+                }
+            }
+        }
+        if (best != INT64_MAX)
+            shape->probes[shape->num_probes++] = probe;
+    }
+    free((void*)mask.texels);
+}
+
+static void apPolyPackCreateShapes(apPolyPacker* packer, apPolyPackerImage* image)
+{
+    apImage* apimage = &image->super;
+    if (apimage->data && apimage->channels == 4)
+    {
+        if (!apCalcAlphaRect(apimage->data, apimage->width, apimage->height, apimage->channels, &apimage->trim))
+        {
+            // Fully transparent, but we still want a valid placement
+            apimage->trim.size.width = 1;
+            apimage->trim.size.height = 1;
+        }
+    }
+
+    apPos* vertices = 0;
+    int* offsets = 0;
+    int num_pieces = apPolyPackCreateOutline(apimage, &packer->options, &vertices, &offsets);
+
+    image->area = 0;
+    for (int i = 0; i < num_pieces; ++i)
+        image->area += apPolyPackArea(vertices + offsets[i], offsets[i + 1] - offsets[i]) / 2;
+
+    int num_rotations = packer->options.no_rotate ? 1 : 4;
+    int num_flips = packer->options.flip ? 2 : 1;
+    image->num_shapes = 0;
+    for (int f = 0; f < num_flips; ++f)
+    {
+        for (int r = 0; r < num_rotations; ++r)
+        {
+            apPolyPackShape* shape = &image->shapes[image->num_shapes++];
+            apPolyPackCreateShape(shape, apimage, vertices, offsets, num_pieces, r * 90, f);
+            apPolyPackCreateProbes(shape);
+        }
+    }
+
+    free((void*)vertices);
+    free((void*)offsets);
+}
+
+static void apPolyPackDestroyShapes(apPolyPackerImage* image)
+{
+    for (int i = 0; i < image->num_shapes; ++i)
+    {
+        free((void*)image->shapes[i].vertices);
+        free((void*)image->shapes[i].offsets);
+        free((void*)image->shapes[i].piece_min);
+        free((void*)image->shapes[i].piece_max);
+    }
+    image->num_shapes = 0;
+}
+
+static apImage* apPolyPackCreateImage(apPacker* packer, const char* path, int width, int height, int channels, const uint8_t* data)
+{
+    apPolyPackerImage* image = (apPolyPackerImage*)malloc(sizeof(apPolyPackerImage));
+    memset(image, 0, sizeof(apPolyPackerImage));
+    image->super.page = -1;
+    return (apImage*)image;
+}
+
+static void apPolyPackDestroyImage(apPacker* packer, apImage* image)
+{
+    apPolyPackDestroyShapes((apPolyPackerImage*)image);
+    free((void*)image);
+}
+
+// ************************************************************************************************************************
+// Pages
+
+static void apPolyPackAddPieceToGrid(apPolyPackerPage* page, int index, int cell_size)
+{
+    const apPolyPackPiece* piece = &page->pieces[index];
+    int x0 = AP_MAX(0, piece->min.x / cell_size);
+    int y0 = AP_MAX(0, piece->min.y / cell_size);
+    int x1 = AP_MIN(page->grid_width - 1, piece->max.x / cell_size);
+    int y1 = AP_MIN(page->grid_height - 1, piece->max.y / cell_size);
+    for (int y = y0; y <= y1; ++y)
+    {
+        for (int x = x0; x <= x1; ++x)
+        {
+            apPolyPackReserve((void**)&page->entries, &page->entries_capacity, page->num_entries + 1, sizeof(apPolyPackCellEntry));
+            apPolyPackCellEntry* entry = &page->entries[page->num_entries];
+            entry->piece = index;
+            entry->cell = y * page->grid_width + x;
+            entry->next = page->cells[entry->cell];
+            page->cells[entry->cell] = page->num_entries++;
+        }
+    }
+}
+
+static void apPolyPackSetPageTexel(void* ctx, int x, int y)
+{
+    apPolyPackerPage* page = (apPolyPackerPage*)ctx;
+    page->texels[y * page->dimensions.width + x] = 1;
+}
+
+static void apPolyPackAddPieceToTexels(apPolyPackerPage* page, int index)
+{
+    const apPolyPackPiece* piece = &page->pieces[index];
+    apPolyPackRasterize(page->vertices + piece->first, piece->count, apPolyPackSetPageTexel, page);
+}
+
+// Creates the grid and the texel coverage for the current page size, and adds the placed pieces to them
+static void apPolyPackRebuildPage(apPolyPackerPage* page, int cell_size)
+{
+    int num_texels = page->dimensions.width * page->dimensions.height;
+    apPolyPackReserve((void**)&page->texels, &page->texels_capacity, num_texels, 1);
+    memset(page->texels, 0, (size_t)num_texels);
+    for (int i = 0; i < page->num_pieces; ++i)
+        apPolyPackAddPieceToTexels(page, i);
+
+    page->grid_width = (page->dimensions.width + cell_size - 1) / cell_size;
+    page->grid_height = (page->dimensions.height + cell_size - 1) / cell_size;
+    int num_cells = AP_MAX(1, page->grid_width * page->grid_height);
+    apPolyPackReserve((void**)&page->cells, &page->cells_capacity, num_cells, sizeof(int));
+    for (int i = 0; i < num_cells; ++i)
+        page->cells[i] = -1;
+
+    page->num_entries = 0;
+    for (int i = 0; i < page->num_pieces; ++i)
+        apPolyPackAddPieceToGrid(page, i, cell_size);
+}
+
+// Adds an empty page to the current packing (reusing the memory of a previous packing)
+static apPolyPackerPage* apPolyPackAddPage(apPolyPacker* packer, apSize dimensions)
+{
+    if (packer->num_pages == packer->pages_capacity)
+    {
+        int capacity = packer->pages_capacity;
+        apPolyPackReserve((void**)&packer->pages, &packer->pages_capacity, packer->num_pages + 1, sizeof(apPolyPackerPage));
+        memset(packer->pages + capacity, 0, sizeof(apPolyPackerPage) * (size_t)(packer->pages_capacity - capacity));
+    }
+    apPolyPackerPage* page = &packer->pages[packer->num_pages++];
+    page->dimensions = dimensions;
+    page->num_vertices = 0;
+    page->num_pieces = 0;
+    page->stamp = 0;
+    apPolyPackRebuildPage(page, packer->cell_size);
+    return page;
+}
+
+static void apPolyPackDestroyPages(apPolyPacker* packer)
+{
+    for (int i = 0; i < packer->pages_capacity; ++i)
+    {
+        apPolyPackerPage* page = &packer->pages[i];
+        free((void*)page->vertices);
+        free((void*)page->pieces);
+        free((void*)page->cells);
+        free((void*)page->entries);
+        free((void*)page->texels);
+    }
+    free((void*)packer->pages);
+    packer->pages = 0;
+    packer->num_pages = 0;
+    packer->pages_capacity = 0;
+}
+
+// Grows the page. The grid and the texels are only rebuilt if 'cell_size' is non zero
+static int apPolyPackGrowPage(apPolyPackerPage* page, const apOptions* options, int cell_size)
+{
+    apSize grown = apGrowPageSize(options, page->dimensions, 1);
+    if (grown.width == page->dimensions.width && grown.height == page->dimensions.height)
+        return 0;
+    page->dimensions = grown;
+    if (cell_size)
+        apPolyPackRebuildPage(page, cell_size);
+    return 1;
+}
+
+// Adds the pieces of the shape to the page. The grid and the texels are only updated if 'cell_size' is non zero
+static void apPolyPackPlaceShape(apPolyPackerPage* page, const apPolyPackShape* shape, apPos pos, int cell_size)
+{
+    for (int i = 0; i < shape->num_pieces; ++i)
+    {
+        int first = shape->offsets[i];
+        int count = shape->offsets[i + 1] - first;
+        apPolyPackReserve((void**)&page->vertices, &page->vertices_capacity, page->num_vertices + count, sizeof(apPos));
+        apPolyPackReserve((void**)&page->pieces, &page->pieces_capacity, page->num_pieces + 1, sizeof(apPolyPackPiece));
+
+        apPolyPackPiece* piece = &page->pieces[page->num_pieces];
+        piece->first = page->num_vertices;
+        piece->count = count;
+        piece->min.x = piece->min.y = INT_MAX;
+        piece->max.x = piece->max.y = INT_MIN;
+        piece->stamp = page->stamp;
+        for (int v = 0; v < count; ++v)
+        {
+            apPos p = shape->vertices[first + v];
+            p.x += pos.x;
+            p.y += pos.y;
+            page->vertices[page->num_vertices++] = p;
+            piece->min.x = AP_MIN(piece->min.x, p.x);
+            piece->min.y = AP_MIN(piece->min.y, p.y);
+            piece->max.x = AP_MAX(piece->max.x, p.x);
+            piece->max.y = AP_MAX(piece->max.y, p.y);
+        }
+        if (cell_size)
+        {
+            apPolyPackAddPieceToGrid(page, page->num_pieces, cell_size);
+            apPolyPackAddPieceToTexels(page, page->num_pieces);
+        }
+        ++page->num_pieces;
+    }
+}
+
+// Removes the pieces that were placed after the page had the given number of pieces
+static void apPolyPackRollback(apPolyPackerPage* page, int num_pieces)
+{
+    if (num_pieces == page->num_pieces)
+        return;
+    int first_entry = page->num_entries;
+    while (first_entry > 0 && page->entries[first_entry - 1].piece >= num_pieces)
+        --first_entry;
+    // The newest entries are first in each cell list
+    for (int i = page->num_entries - 1; i >= first_entry; --i)
+        page->cells[page->entries[i].cell] = page->entries[i].next;
+    page->num_entries = first_entry;
+    page->num_vertices = page->pieces[num_pieces].first;
+    page->num_pieces = num_pieces;
+
+    memset(page->texels, 0, (size_t)page->dimensions.width * (size_t)page->dimensions.height);
+    for (int i = 0; i < page->num_pieces; ++i)
+        apPolyPackAddPieceToTexels(page, i);
+}
+
+// ************************************************************************************************************************
+// Fitting
+
+// Returns 1 if any edge of 'a' separates the convex polygons. Touching polygons are separated.
+// The polygons are CCW, and 'b' is moved by 'offset'
+static int apPolyPackHasSeparatingEdge(const apPos* a, int na, const apPos* b, int nb, apPos offset)
+{
+    for (int i = 0; i < na; ++i)
+    {
+        apPos p0 = a[i];
+        apPos p1 = a[(i + 1) % na];
+        // The outward normal. All of 'a' is on the inside of the edge
+        int64_t nx = p1.y - p0.y;
+        int64_t ny = p0.x - p1.x;
+        int64_t amax = nx * p0.x + ny * p0.y;
+        int separated = 1;
+        for (int j = 0; j < nb && separated; ++j)
+            separated = nx * (b[j].x + offset.x) + ny * (b[j].y + offset.y) >= amax;
+        if (separated)
+            return 1;
+    }
+    return 0;
+}
+
+static int apPolyPackHasSeparatingEdgeB(const apPos* a, int na, const apPos* b, int nb, apPos offset)
+{
+    for (int i = 0; i < nb; ++i)
+    {
+        apPos p0 = { b[i].x + offset.x, b[i].y + offset.y };
+        apPos p1 = { b[(i + 1) % nb].x + offset.x, b[(i + 1) % nb].y + offset.y };
+        int64_t nx = p1.y - p0.y;
+        int64_t ny = p0.x - p1.x;
+        int64_t bmax = nx * p0.x + ny * p0.y;
+        int separated = 1;
+        for (int j = 0; j < na && separated; ++j)
+            separated = nx * a[j].x + ny * a[j].y >= bmax;
+        if (separated)
+            return 1;
+    }
+    return 0;
+}
+
+// Returns 1 if the shape can be placed at the position, without overlapping any placed piece
+static int apPolyPackShapeFits(apPolyPackerPage* page, const apPolyPackShape* shape, apPos pos, int cell_size)
+{
+    for (int i = 0; i < shape->num_pieces; ++i)
+    {
+        const apPos* b = shape->vertices + shape->offsets[i];
+        int nb = shape->offsets[i + 1] - shape->offsets[i];
+        apPos bmin = { INT_MAX, INT_MAX };
+        apPos bmax = { INT_MIN, INT_MIN };
+        for (int v = 0; v < nb; ++v)
+        {
+            bmin.x = AP_MIN(bmin.x, b[v].x + pos.x);
+            bmin.y = AP_MIN(bmin.y, b[v].y + pos.y);
+            bmax.x = AP_MAX(bmax.x, b[v].x + pos.x);
+            bmax.y = AP_MAX(bmax.y, b[v].y + pos.y);
+        }
+
+        if (page->stamp == INT_MAX)
+        {
+            for (int p = 0; p < page->num_pieces; ++p)
+                page->pieces[p].stamp = 0;
+            page->stamp = 0;
+        }
+        int stamp = ++page->stamp;
+
+        int x0 = AP_MAX(0, bmin.x / cell_size);
+        int y0 = AP_MAX(0, bmin.y / cell_size);
+        int x1 = AP_MIN(page->grid_width - 1, bmax.x / cell_size);
+        int y1 = AP_MIN(page->grid_height - 1, bmax.y / cell_size);
+        for (int y = y0; y <= y1; ++y)
+        {
+            for (int x = x0; x <= x1; ++x)
+            {
+                for (int e = page->cells[y * page->grid_width + x]; e != -1; e = page->entries[e].next)
+                {
+                    apPolyPackPiece* piece = &page->pieces[page->entries[e].piece];
+                    if (piece->stamp == stamp)
+                        continue;
+                    piece->stamp = stamp;
+
+                    if (piece->max.x <= bmin.x || bmax.x <= piece->min.x ||
+                        piece->max.y <= bmin.y || bmax.y <= piece->min.y)
+                        continue;
+
+                    const apPos* a = page->vertices + piece->first;
+                    if (!apPolyPackHasSeparatingEdge(a, piece->count, b, nb, pos) &&
+                        !apPolyPackHasSeparatingEdgeB(a, piece->count, b, nb, pos))
+                        return 0;
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+typedef struct
+{
+    const apPolyPackerPage* page;
+    const apPolyPackShape*  shape;
+    apRect  bounds;     // The valid positions (the inner fit rectangle): pos.x <= x <= pos.x + size.width
+    int     top_offset; // shape->max.y
+    int     left_offset;// shape->min.x
+    int     best_top;   // The best position so far (of any shape)
+    int     best_left;
+} apPolyPackSearch;
+
+// The positions are ordered bottom left first, by the top of the shape, and then its left side
+static inline int apPolyPackIsBetter(const apPolyPackSearch* search, int x, int y)
+{
+    int top = y + search->top_offset;
+    int left = x + search->left_offset;
+    return top < search->best_top || (top == search->best_top && left < search->best_left);
+}
+
+static inline int apPolyPackLess(apPos a, apPos b)
+{
+    return a.y < b.y || (a.y == b.y && a.x < b.x);
+}
+
+// The candidates are kept in a binary heap, lowest position first
+static void apPolyPackPushCandidate(apPolyPacker* packer, apPos pos)
+{
+    apPolyPackReserve((void**)&packer->candidates, &packer->candidates_capacity, packer->num_candidates + 1, sizeof(apPos));
+    apPos* heap = packer->candidates;
+    int i = packer->num_candidates++;
+    while (i > 0)
+    {
+        int parent = (i - 1) / 2;
+        if (!apPolyPackLess(pos, heap[parent]))
+            break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = pos;
+}
+
+static apPos apPolyPackPopCandidate(apPolyPacker* packer)
+{
+    apPos* heap = packer->candidates;
+    apPos top = heap[0];
+    apPos last = heap[--packer->num_candidates];
+    int n = packer->num_candidates;
+    int i = 0;
+    while (1)
+    {
+        int child = 2 * i + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n && apPolyPackLess(heap[child + 1], heap[child]))
+            ++child;
+        if (!apPolyPackLess(heap[child], last))
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (n > 0)
+        heap[i] = last;
+    return top;
+}
+
+static void apPolyPackAddCandidate(apPolyPacker* packer, const apPolyPackSearch* search, int x, int y)
+{
+    const apRect* bounds = &search->bounds;
+    if (x < bounds->pos.x || x > bounds->pos.x + bounds->size.width ||
+        y < bounds->pos.y || y > bounds->pos.y + bounds->size.height)
+        return;
+    if (!apPolyPackIsBetter(search, x, y))
+        return;
+    // Discard the positions where the shape would overlap a covered texel
+    const apPolyPackShape* shape = search->shape;
+    const apPolyPackerPage* page = search->page;
+    for (int i = 0; i < shape->num_probes; ++i)
+    {
+        if (page->texels[(y + shape->probes[i].y) * page->dimensions.width + x + shape->probes[i].x])
+            return;
+    }
+    apPos pos = { x, y };
+    apPolyPackPushCandidate(packer, pos);
+}
+
+static inline int64_t apPolyPackFloorDiv(int64_t a, int64_t b)
+{
+    int64_t q = a / b;
+    if (a % b != 0 && ((a < 0) != (b < 0)))
+        --q;
+    return q;
+}
+
+// Adds the positions where the edge of a no-fit polygon crosses the bottom or the left side of the valid positions,
+// so that the shapes can slide into the corners. The positions are rounded outwards, away from the (CCW) polygon
+static void apPolyPackAddCrossings(apPolyPacker* packer, const apPolyPackSearch* search, apPos p0, apPos p1)
+{
+    int64_t dx = p1.x - p0.x;
+    int64_t dy = p1.y - p0.y;
+    int bottom = search->bounds.pos.y;
+    if ((p0.y < bottom && p1.y > bottom) || (p0.y > bottom && p1.y < bottom))
+    {
+        // An edge going down is on the left side of the polygon
+        int64_t n = (int64_t)(bottom - p0.y) * dx;
+        int64_t x = dy < 0 ? apPolyPackFloorDiv(n, dy) : -apPolyPackFloorDiv(-n, dy);
+        apPolyPackAddCandidate(packer, search, p0.x + (int)x, bottom);
+    }
+    int left = search->bounds.pos.x;
+    if ((p0.x < left && p1.x > left) || (p0.x > left && p1.x < left))
+    {
+        // An edge going right is on the bottom side of the polygon
+        int64_t n = (int64_t)(left - p0.x) * dy;
+        int64_t y = dx > 0 ? apPolyPackFloorDiv(n, dx) : -apPolyPackFloorDiv(-n, dx);
+        apPolyPackAddCandidate(packer, search, left, p0.y + (int)y);
+    }
+}
+
+// Compares the angles of the vectors, in the range [0, 2pi)
+static int apPolyPackCompareAngles(apPos a, apPos b)
+{
+    int half_a = a.y < 0 || (a.y == 0 && a.x < 0);
+    int half_b = b.y < 0 || (b.y == 0 && b.x < 0);
+    if (half_a != half_b)
+        return half_a - half_b;
+    int64_t cross = (int64_t)a.x * b.y - (int64_t)a.y * b.x;
+    return cross > 0 ? -1 : (cross < 0 ? 1 : 0);
+}
+
+// Adds the vertices of the no-fit polygon of the pieces, i.e. the positions where 'b' touches 'a'.
+// For convex pieces, it's the Minkowski sum of 'a' and the mirrored 'b'.
+static void apPolyPackAddNoFitPolygon(apPolyPacker* packer, const apPolyPackSearch* search, const apPos* a, int na, const apPos* b, int nb)
+{
+    // Start at the bottom most vertex of 'a', and the top most vertex of 'b' (i.e. the bottom most vertex of -b)
+    int ia = 0;
+    for (int i = 1; i < na; ++i)
+    {
+        if (a[i].y < a[ia].y || (a[i].y == a[ia].y && a[i].x < a[ia].x))
+            ia = i;
+    }
+    int ib = 0;
+    for (int i = 1; i < nb; ++i)
+    {
+        if (b[i].y > b[ib].y || (b[i].y == b[ib].y && b[i].x > b[ib].x))
+            ib = i;
+    }
+
+    // Merge the edges of both polygons, by their angle
+    apPos first = { a[ia].x - b[ib].x, a[ia].y - b[ib].y };
+    apPos prev = first;
+    int i = 0;
+    int j = 0;
+    while (i < na || j < nb)
+    {
+        apPos pa = a[(ia + i) % na];
+        apPos pb = b[(ib + j) % nb];
+        apPos nfp = { pa.x - pb.x, pa.y - pb.y };
+        apPolyPackAddCandidate(packer, search, nfp.x, nfp.y);
+        apPolyPackAddCrossings(packer, search, prev, nfp);
+        prev = nfp;
+
+        if (i == na)
+        {
+            ++j;
+            continue;
+        }
+        if (j == nb)
+        {
+            ++i;
+            continue;
+        }
+
+        apPos pa1 = a[(ia + i + 1) % na];
+        apPos pb1 = b[(ib + j + 1) % nb];
+        apPos ea = { pa1.x - pa.x, pa1.y - pa.y };
+        apPos eb = { pb.x - pb1.x, pb.y - pb1.y }; // The edge of -b
+        int order = apPolyPackCompareAngles(ea, eb);
+        if (order <= 0)
+            ++i;
+        if (order >= 0)
+            ++j;
+    }
+    apPolyPackAddCrossings(packer, search, prev, first);
+}
+
+// Collects the pairs of pieces whose no-fit polygons have any valid positions, into one list per row
+static void apPolyPackCollectPairs(apPolyPacker* packer, const apPolyPackSearch* search)
+{
+    const apPolyPackerPage* page = search->page;
+    const apPolyPackShape* shape = search->shape;
+    const apRect* bounds = &search->bounds;
+    int num_rows = bounds->size.height + 1;
+    apPolyPackReserve((void**)&packer->rows, &packer->rows_capacity, num_rows, sizeof(int));
+    for (int i = 0; i < num_rows; ++i)
+        packer->rows[i] = -1;
+    packer->num_pairs = 0;
+    for (int p = 0; p < page->num_pieces; ++p)
+    {
+        const apPolyPackPiece* piece = &page->pieces[p];
+        for (int i = 0; i < shape->num_pieces; ++i)
+        {
+            // The bounding box of the no-fit polygon
+            apPos min = { piece->min.x - shape->piece_max[i].x, piece->min.y - shape->piece_max[i].y };
+            apPos max = { piece->max.x - shape->piece_min[i].x, piece->max.y - shape->piece_min[i].y };
+            if (max.x < bounds->pos.x || min.x > bounds->pos.x + bounds->size.width ||
+                max.y < bounds->pos.y || min.y > bounds->pos.y + bounds->size.height)
+                continue;
+
+            apPolyPackReserve((void**)&packer->pairs, &packer->pairs_capacity, packer->num_pairs + 1, sizeof(apPolyPackPair));
+            apPolyPackPair* pair = &packer->pairs[packer->num_pairs];
+            int row = AP_MAX(0, min.y - bounds->pos.y);
+            pair->piece = p;
+            pair->shape_piece = i;
+            pair->next = packer->rows[row];
+            packer->rows[row] = packer->num_pairs++;
+        }
+    }
+}
+
+// Finds the bottom left most position on the page, for any of the shapes of the image.
+// The no-fit polygons are created lazily, lowest first, and the candidates are tested once
+// no remaining pair can create a lower position.
+// Returns 1 if the image fits on the page. Returns 0 (and sets apPolyPacker::out_of_time) if the deadline has passed
+static int apPolyPackFindPosition(apPolyPacker* packer, apPolyPackerPage* page, apPolyPackerImage* image, int* out_shape, apPos* out_pos)
+{
+    int cell_size = packer->cell_size;
+    apPolyPackSearch search;
+    search.page = page;
+    search.best_top = INT_MAX;
+    search.best_left = INT_MAX;
+    int found = 0;
+    int num_tested = 0;
+
+    for (int s = 0; s < image->num_shapes; ++s)
+    {
+        const apPolyPackShape* shape = &image->shapes[s];
+        search.bounds.pos.x = -shape->min.x;
+        search.bounds.pos.y = -shape->min.y;
+        search.bounds.size.width = page->dimensions.width - shape->max.x - search.bounds.pos.x;
+        search.bounds.size.height = page->dimensions.height - shape->max.y - search.bounds.pos.y;
+        if (search.bounds.size.width < 0 || search.bounds.size.height < 0)
+            continue;
+        search.shape = shape;
+        search.top_offset = shape->max.y;
+        search.left_offset = shape->min.x;
+
+        packer->num_candidates = 0;
+        apPolyPackAddCandidate(packer, &search, search.bounds.pos.x, search.bounds.pos.y);
+        apPolyPackCollectPairs(packer, &search);
+
+        int num_rows = search.bounds.size.height + 1;
+        int row = 0;
+        int done = 0;
+        apPos last = { INT_MIN, INT_MIN };
+        while (!done)
+        {
+            // Reading the time is slow compared to a single row, so it's only checked every so often
+            if (packer->deadline && (++num_tested & 63) == 0 && apGetTime() > packer->deadline)
+            {
+                packer->out_of_time = 1;
+                return 0;
+            }
+
+            // The candidates below this row can't be beaten by the remaining pairs
+            while (row < num_rows && packer->rows[row] == -1)
+                ++row;
+            int next_y = row < num_rows ? search.bounds.pos.y + row : INT_MAX;
+            while (packer->num_candidates && packer->candidates[0].y < next_y)
+            {
+                apPos pos = apPolyPackPopCandidate(packer);
+                if (pos.x == last.x && pos.y == last.y)
+                    continue;
+                last = pos;
+                // The candidates are popped in order, so none of the remaining ones are better
+                if (!apPolyPackIsBetter(&search, pos.x, pos.y))
+                {
+                    done = 1;
+                    break;
+                }
+                if (!apPolyPackShapeFits(page, shape, pos, cell_size))
+                    continue;
+
+                search.best_top = pos.y + search.top_offset;
+                search.best_left = pos.x + search.left_offset;
+                *out_shape = s;
+                *out_pos = pos;
+                found = 1;
+                done = 1;
+                break;
+            }
+            if (done || row == num_rows || !apPolyPackIsBetter(&search, INT_MIN / 2, next_y))
+                break;
+
+            for (int p = packer->rows[row++]; p != -1; p = packer->pairs[p].next)
+            {
+                const apPolyPackPair* pair = &packer->pairs[p];
+                const apPolyPackPiece* piece = &page->pieces[pair->piece];
+                const apPos* b = shape->vertices + shape->offsets[pair->shape_piece];
+                int nb = shape->offsets[pair->shape_piece + 1] - shape->offsets[pair->shape_piece];
+                apPolyPackAddNoFitPolygon(packer, &search, page->vertices + piece->first, piece->count, b, nb);
+            }
+        }
+    }
+    return found;
+}
+
+static int apPolyPackPlaceImage(apPolyPacker* packer, int page_index, apPolyPackerImage* image)
+{
+    apPolyPackerPage* page = &packer->pages[page_index];
+    int shape;
+    apPos pos;
+    if (!apPolyPackFindPosition(packer, page, image, &shape, &pos))
+        return 0;
+    apPolyPackPlaceShape(page, &image->shapes[shape], pos, packer->cell_size);
+    image->fit_page = page_index;
+    image->fit_shape = shape;
+    image->pos = pos;
+    return 1;
+}
+
+// Places the image by its bounding box, next to the previous one on the current shelf of the last page.
+// Much faster than apPolyPackPlaceImage(), but leaves more empty space. The grid and the texels of the page
+// aren't kept up to date, so no other images may be placed on the page with apPolyPackPlaceImage() afterwards
+// Returns 0 if the image doesn't fit on an empty page
+static int apPolyPackPlaceImageOnShelf(apPolyPacker* packer, apContext* ctx, apPolyPackerImage* image, apSize page_dims)
+{
+    while (1)
+    {
+        int page_index = packer->num_pages - 1;
+        apPolyPackerPage* page = &packer->pages[page_index];
+        if (packer->shelf_page != page_index)
+        {
+            // The first shelf is above all pieces that are already on the page
+            packer->shelf_page = page_index;
+            packer->shelf_pos.x = 0;
+            packer->shelf_pos.y = 0;
+            packer->shelf_height = 0;
+            for (int i = 0; i < page->num_pieces; ++i)
+                packer->shelf_pos.y = AP_MAX(packer->shelf_pos.y, page->pieces[i].max.y);
+        }
+
+        // The lowest shape that fits on the shelf
+        int best = -1;
+        int best_height = INT_MAX;
+        for (int s = 0; s < image->num_shapes; ++s)
+        {
+            const apPolyPackShape* shape = &image->shapes[s];
+            int width = AP_MAX(shape->max.x, shape->size.width) - AP_MIN(shape->min.x, 0);
+            int height = AP_MAX(shape->max.y, shape->size.height) - AP_MIN(shape->min.y, 0);
+            if (packer->shelf_pos.x + width <= page->dimensions.width && packer->shelf_pos.y + height <= page->dimensions.height && height < best_height)
+            {
+                best = s;
+                best_height = height;
+            }
+        }
+
+        if (best >= 0)
+        {
+            const apPolyPackShape* shape = &image->shapes[best];
+            apPos pos = { packer->shelf_pos.x - AP_MIN(shape->min.x, 0), packer->shelf_pos.y - AP_MIN(shape->min.y, 0) };
+            apPolyPackPlaceShape(page, shape, pos, 0);
+            image->fit_page = page_index;
+            image->fit_shape = best;
+            image->pos = pos;
+            packer->shelf_pos.x += AP_MAX(shape->max.x, shape->size.width) - AP_MIN(shape->min.x, 0);
+            packer->shelf_height = AP_MAX(packer->shelf_height, best_height);
+            return 1;
+        }
+
+        // Start a new shelf, grow the page, or add a new page
+        if (packer->shelf_pos.x > 0)
+        {
+            packer->shelf_pos.x = 0;
+            packer->shelf_pos.y += packer->shelf_height;
+            packer->shelf_height = 0;
+        }
+        else if (ctx->options.page_size || !apPolyPackGrowPage(page, &ctx->options, 0))
+        {
+            if (!page->num_pieces)
+                return 0;
+            apPolyPackAddPage(packer, page_dims);
+        }
+    }
+}
+
+// Returns 1 if any shape of the image fits within the size
+static int apPolyPackFitsSize(const apPolyPackerImage* image, apSize size)
+{
+    for (int s = 0; s < image->num_shapes; ++s)
+    {
+        const apPolyPackShape* shape = &image->shapes[s];
+        if (shape->max.x - shape->min.x <= size.width && shape->max.y - shape->min.y <= size.height)
+            return 1;
+    }
+    return 0;
+}
+
+// Packs the images [first, last) onto one page, growing or adding pages as needed.
+// Returns 0 if the group doesn't fit on a single page, or if the deadline has passed
+static int apPolyPackPackGroup(apPolyPacker* packer, apContext* ctx, int first, int last, apSize page_dims)
+{
+    while (1)
+    {
+        for (int p = 0; p < packer->num_pages && !packer->out_of_time; ++p)
+        {
+            int num_pieces = packer->pages[p].num_pieces;
+            int fit = 1;
+            for (int i = first; i < last && fit; ++i)
+                fit = apPolyPackPlaceImage(packer, p, (apPolyPackerImage*)ctx->images[i]);
+            if (fit)
+                return 1;
+            apPolyPackRollback(&packer->pages[p], num_pieces);
+        }
+
+        apPolyPackerPage* last_page = &packer->pages[packer->num_pages - 1];
+        if (!packer->out_of_time && !ctx->options.page_size && apPolyPackGrowPage(last_page, &ctx->options, packer->cell_size))
+            continue;
+
+        // If it didn't fit in an empty page, it never will.
+        // Don't leave an empty page behind, if it was opened for this group
+        if (packer->out_of_time || !last_page->num_pieces)
+        {
+            if (!last_page->num_pieces && packer->num_pages > 1)
+                --packer->num_pages;
+            return 0;
+        }
+        apPolyPackAddPage(packer, page_dims);
+    }
+}
+
+// Packs all images. If 'can_grow' is set, the last page grows (or new pages are added) when an image doesn't fit,
+// and once the deadline (if non zero) has passed, the remaining images are placed on shelves.
+// Otherwise, all images are packed onto one page of the given size.
+// Returns 0 if an image didn't fit, or if the deadline has passed and 'can_grow' isn't set
+static int apPolyPackPass(apPolyPacker* packer, apContext* ctx, apSize page_dims, apSize max_dims, int can_grow, uint64_t deadline)
+{
+    packer->num_pages = 0;
+    packer->shelf_page = -1;
+    packer->deadline = deadline;
+    packer->out_of_time = 0;
+    apPolyPackAddPage(packer, page_dims);
+
+    int use_shelves = 0;
+    int group_end = 0; // The end of the last group that was handled
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        apPolyPackerImage* image = (apPolyPackerImage*)ctx->images[i];
+        if (!use_shelves && (packer->out_of_time || (deadline && apGetTime() > deadline)))
+        {
+            if (!can_grow)
+                return 0;
+            printf("  Out of time, placing the remaining %d images on shelves\n", ctx->num_images - i);
+            use_shelves = 1;
+        }
+
+        // The images of a group are next to each other (see apPackImages), and are packed onto one page if possible
+        if (can_grow && !use_shelves && image->super.group && i >= group_end)
+        {
+            group_end = i + 1;
+            while (group_end < ctx->num_images && ctx->images[group_end]->group == image->super.group)
+                ++group_end;
+
+            if (group_end - i > 1 && apPolyPackPackGroup(packer, ctx, i, group_end, page_dims))
+            {
+                i = group_end - 1;
+                continue;
+            }
+            // Otherwise, the images are packed one by one
+        }
+
+        image->fit_page = -1;
+        if (!apPolyPackFitsSize(image, max_dims))
+        {
+            if (!can_grow)
+                return 0;
+            printf("Image %s (%d x %d) is larger than the max page size %d x %d\n", image->super.path,
+                    image->super.trim.size.width, image->super.trim.size.height, max_dims.width, max_dims.height);
+            continue;
+        }
+
+        if (use_shelves)
+        {
+            if (!apPolyPackPlaceImageOnShelf(packer, ctx, image, page_dims))
+                printf("Image %s (%d x %d) doesn't fit in a page\n", image->super.path, image->super.trim.size.width, image->super.trim.size.height);
+            continue;
+        }
+
+        // Try all open pages, so that smaller images can backfill the earlier pages
+        int fit = 0;
+        for (int p = 0; p < packer->num_pages && !fit && !packer->out_of_time; ++p)
+            fit = apPolyPackPlaceImage(packer, p, image);
+        if (fit)
+            continue;
+        if (!can_grow)
+            return 0;
+        if (packer->out_of_time)
+        {
+            // Place this image on a shelf as well
+            --i;
+            continue;
+        }
+
+        // Grow the last page, or create a new page if it has reached its max size
+        apPolyPackerPage* last_page = &packer->pages[packer->num_pages - 1];
+        if (ctx->options.page_size || !apPolyPackGrowPage(last_page, &ctx->options, packer->cell_size))
+        {
+            if (!last_page->num_pieces)
+            {
+                printf("Image %s (%d x %d) doesn't fit in a page\n", image->super.path, image->super.trim.size.width, image->super.trim.size.height);
+                continue;
+            }
+            apPolyPackAddPage(packer, page_dims);
+        }
+
+        // Try to refit this image again
+        --i;
+    }
+    return 1;
+}
+
+// Stores the current packing as the best one
+static void apPolyPackKeepPacking(apPolyPacker* packer, apContext* ctx)
+{
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        apPolyPackerImage* image = (apPolyPackerImage*)ctx->images[i];
+        image->best_page = image->fit_page;
+        image->best_shape = image->fit_shape;
+        image->best_pos = image->pos;
+    }
+    packer->best_dims = (apSize*)realloc(packer->best_dims, sizeof(apSize) * (size_t)packer->num_pages);
+    for (int p = 0; p < packer->num_pages; ++p)
+        packer->best_dims[p] = packer->pages[p].dimensions;
+    packer->num_best_pages = packer->num_pages;
+}
+
+static int apPolyPackRoundSize(const apOptions* options, int size)
+{
+    return options->grow_policy == AP_GROW_POWER_OF_TWO ? (int)apNextPowerOfTwo((uint32_t)size) : size;
+}
+
+// Calculates the size of the used area of the first page (rounded up according to the grow policy)
+static apSize apPolyPackGetUsedSize(apPolyPacker* packer, apContext* ctx)
+{
+    apSize size = { 1, 1 };
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        apPolyPackerImage* image = (apPolyPackerImage*)ctx->images[i];
+        if (image->fit_page != 0)
+            continue;
+        const apPolyPackShape* shape = &image->shapes[image->fit_shape];
+        size.width = AP_MAX(size.width, image->pos.x + AP_MAX(shape->max.x, shape->size.width));
+        size.height = AP_MAX(size.height, image->pos.y + AP_MAX(shape->max.y, shape->size.height));
+    }
+    size.width = apPolyPackRoundSize(&ctx->options, size.width);
+    size.height = apPolyPackRoundSize(&ctx->options, size.height);
+    return size;
+}
+
+static inline int apPolyPackDistance(int a, int b)
+{
+    return a > b ? a - b : b - a;
+}
+
+// Repacks the images onto single pages of different widths, and keeps the packing with the smallest area.
+// Each page is only as high as it can be while still being smaller than the best packing so far
+static void apPolyPackSearchPageSize(apPolyPacker* packer, apContext* ctx, int64_t total_area, uint64_t deadline)
+{
+    const apOptions* options = &ctx->options;
+    int power_of_two = options->grow_policy == AP_GROW_POWER_OF_TWO;
+
+    apSize best = apPolyPackGetUsedSize(packer, ctx);
+    int64_t best_area = (int64_t)best.width * best.height;
+
+    // The narrowest page that any image fits in
+    int min_width = 1;
+    int min_height = 1;
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        apPolyPackerImage* image = (apPolyPackerImage*)ctx->images[i];
+        int width = INT_MAX;
+        int height = INT_MAX;
+        for (int s = 0; s < image->num_shapes; ++s)
+        {
+            width = AP_MIN(width, image->shapes[s].max.x - image->shapes[s].min.x);
+            height = AP_MIN(height, image->shapes[s].max.y - image->shapes[s].min.y);
+        }
+        min_width = AP_MAX(min_width, width);
+        min_height = AP_MAX(min_height, height);
+    }
+    int max_width = (int)AP_MIN(best_area / min_height, (int64_t)INT_MAX);
+    if (options->max_page_width > 0)
+        max_width = AP_MIN(max_width, options->max_page_width);
+
+    const int max_widths = 32;
+    int widths[32];
+    int num_widths = 0;
+    if (power_of_two)
+    {
+        for (int width = (int)apNextPowerOfTwo((uint32_t)min_width); width <= max_width && num_widths < max_widths; width *= 2)
+            widths[num_widths++] = width;
+    }
+    else
+    {
+        for (int i = 0; i < max_widths && min_width <= max_width; ++i)
+        {
+            int width = min_width + (int)((int64_t)(max_width - min_width) * i / (max_widths - 1));
+            if (!num_widths || width != widths[num_widths - 1])
+                widths[num_widths++] = width;
+        }
+    }
+
+    // Try the square-ish pages first
+    int target = (int)sqrt((double)total_area);
+    for (int i = 1; i < num_widths; ++i)
+    {
+        for (int j = i; j > 0 && apPolyPackDistance(widths[j], target) < apPolyPackDistance(widths[j-1], target); --j)
+        {
+            int tmp = widths[j];
+            widths[j] = widths[j-1];
+            widths[j-1] = tmp;
+        }
+    }
+
+    int num_tries = 0;
+    for (int i = 0; i < num_widths; ++i)
+    {
+        if (deadline && apGetTime() > deadline)
+            break;
+
+        // The page has to be smaller than the best one
+        int width = widths[i];
+        int64_t height = (best_area - 1) / width;
+        if (power_of_two)
+            height = height > 0 ? apNextPowerOfTwo((uint32_t)height + 1) / 2 : 0;
+        if (options->max_page_height > 0)
+            height = AP_MIN(height, options->max_page_height);
+        if (height < min_height)
+            continue;
+
+        apSize page_dims = { width, (int)height };
+        ++num_tries;
+        if (!apPolyPackPass(packer, ctx, page_dims, page_dims, 0, deadline))
+            continue;
+
+        apSize size = apPolyPackGetUsedSize(packer, ctx);
+        if ((int64_t)size.width * size.height < best_area)
+        {
+            best = size;
+            best_area = (int64_t)size.width * size.height;
+            packer->pages[0].dimensions = size;
+            apPolyPackKeepPacking(packer, ctx);
+        }
+    }
+    printf("  Page size search: %d tries, best page %d x %d\n", num_tries, best.width, best.height);
+}
+
+// Adds the pages and images of the best packing to the context
+static void apPolyPackCommit(apPolyPacker* packer, apContext* ctx)
+{
+    apPage** pages = (apPage**)malloc(sizeof(apPage*) * (size_t)AP_MAX(1, packer->num_best_pages));
+    for (int p = 0; p < packer->num_best_pages; ++p)
+    {
+        pages[p] = apAllocPage(ctx);
+        pages[p]->dimensions = packer->best_dims[p];
+    }
+
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        apPolyPackerImage* image = (apPolyPackerImage*)ctx->images[i];
+        apImage* apimage = &image->super;
+        free((void*)apimage->vertices);
+        apimage->vertices = 0;
+        apimage->num_vertices = 0;
+        apimage->next = 0;
+
+        if (image->best_page < 0)
+        {
+            apimage->page = -1;
+            continue;
+        }
+
+        const apPolyPackShape* shape = &image->shapes[image->best_shape];
+        apimage->rotation = shape->rotation;
+        apimage->flip = shape->flip;
+        apimage->extrude = 0;
+        apimage->placement.pos = image->best_pos;
+        apimage->placement.size = shape->size;
+        apPageAddImage(pages[image->best_page], apimage);
+
+        // The pieces as a triangle list, in page space
+        int num_vertices = 0;
+        for (int p = 0; p < shape->num_pieces; ++p)
+            num_vertices += (shape->offsets[p + 1] - shape->offsets[p] - 2) * 3;
+        apimage->vertices = (apPosf*)malloc(sizeof(apPosf) * (size_t)AP_MAX(1, num_vertices));
+        apimage->num_vertices = num_vertices;
+
+        apPosf* out = apimage->vertices;
+        for (int p = 0; p < shape->num_pieces; ++p)
+        {
+            const apPos* piece = shape->vertices + shape->offsets[p];
+            int count = shape->offsets[p + 1] - shape->offsets[p];
+            for (int v = 1; v < count - 1; ++v)
+            {
+                const apPos* triangle[3] = { &piece[0], &piece[v], &piece[v + 1] };
+                for (int k = 0; k < 3; ++k)
+                {
+                    out->x = (float)(triangle[k]->x + image->best_pos.x);
+                    out->y = (float)(triangle[k]->y + image->best_pos.y);
+                    ++out;
+                }
+            }
+        }
+    }
+    free((void*)pages);
+}
+
+static void apPolyPackPackImages(apPacker* _packer, apContext* ctx)
+{
+    apPolyPacker* packer = (apPolyPacker*)_packer;
+    uint64_t t_total_start = apGetTime();
+
+    // Create the outlines
+    int64_t total_area = 0;
+    int64_t total_side = 0;
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        apPolyPackerImage* image = (apPolyPackerImage*)ctx->images[i];
+        if (!image->num_shapes)
+            apPolyPackCreateShapes(packer, image);
+        total_area += image->area;
+        total_side += image->shapes[0].max.x - image->shapes[0].min.x + image->shapes[0].max.y - image->shapes[0].min.y;
+    }
+
+    uint64_t t_outlines = apGetTime();
+    printf("  Create outlines took %.2f ms\n", (t_outlines-t_total_start)/1000.0f);
+
+    // The grid cells are about the size of the pieces
+    int average_side = ctx->num_images ? (int)(total_side / (2 * ctx->num_images)) : 16;
+    packer->cell_size = AP_MIN(128, AP_MAX(8, (int)apNextPowerOfTwo((uint32_t)AP_MAX(1, average_side / 2))));
+
+    int page_size = ctx->options.page_size;
+    if (page_size == 0)
+    {
+        int bin_size = (int)sqrt((double)total_area);
+        if (bin_size == 0)
+        {
+            bin_size = 128;
+        }
+        // Make sure the size is a power of two
+        page_size = apNextPowerOfTwo((uint32_t)bin_size);
+        // However, it's usually a better fit to take a smaller size and then grow a bit
+        page_size /= 2;
+    }
+
+    // The size of new pages, and the largest size a page may become
+    apSize page_dims = { page_size, page_size };
+    apSize max_dims = { INT_MAX, INT_MAX };
+    if (ctx->options.page_size)
+        max_dims = page_dims;
+    if (ctx->options.max_page_width > 0)
+        max_dims.width = AP_MIN(max_dims.width, ctx->options.max_page_width);
+    if (ctx->options.max_page_height > 0)
+        max_dims.height = AP_MIN(max_dims.height, ctx->options.max_page_height);
+    page_dims.width = AP_MIN(page_dims.width, max_dims.width);
+    page_dims.height = AP_MIN(page_dims.height, max_dims.height);
+
+    // The time budget covers both the packing and the page size search
+    uint64_t deadline = packer->options.time_budget > 0 ? t_outlines + (uint64_t)packer->options.time_budget * 1000 : 0;
+    apPolyPackPass(packer, ctx, page_dims, max_dims, 1, deadline);
+    apPolyPackKeepPacking(packer, ctx);
+
+    uint64_t t_pack = apGetTime();
+    printf("  Packing outlines took %.2f ms\n", (t_pack-t_outlines)/1000.0f);
+
+    int all_placed = 1;
+    for (int i = 0; i < ctx->num_images; ++i)
+        all_placed &= ((apPolyPackerImage*)ctx->images[i])->fit_page == 0;
+
+    if (packer->options.search_page_size && ctx->options.page_size == 0 && packer->num_pages == 1 && all_placed && ctx->num_images > 0)
+        apPolyPackSearchPageSize(packer, ctx, total_area, deadline);
+
+    apPolyPackCommit(packer, ctx);
+
+    uint64_t t_total_end = apGetTime();
+    printf("   Packing atlas took %.2f ms\n", (t_total_end-t_total_start)/1000.0f);
+}
+
+#undef AP_MIN
+#undef AP_MAX
+
+void apPolyPackerSetDefaultOptions(apPolyPackerOptions* options)
+{
+    memset(options, 0, sizeof(apPolyPackerOptions));
+    options->padding = 1;
+    options->max_error = 1.5f;
+}
+
+apPacker* apPolyPackerCreate(apPolyPackerOptions* options)
+{
+    apPolyPacker* packer = (apPolyPacker*)malloc(sizeof(apPolyPacker));
+    memset(packer, 0, sizeof(apPolyPacker));
+    packer->super.packer_type = "apPolyPacker";
+    packer->super.createImage = apPolyPackCreateImage;
+    packer->super.destroyImage = apPolyPackDestroyImage;
+    packer->super.packImages = apPolyPackPackImages;
+    packer->options = *options;
+    return (apPacker*)packer;
+}
+
+void apPolyPackerDestroy(apPacker* _packer)
+{
+    apPolyPacker* packer = (apPolyPacker*)_packer;
+    apPolyPackDestroyPages(packer);
+    free((void*)packer->best_dims);
+    free((void*)packer->candidates);
+    free((void*)packer->pairs);
+    free((void*)packer->rows);
+    free((void*)packer);
+}
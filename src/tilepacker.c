@@ -7,8 +7,9 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
-#include <math.h>   // sqrtf
+#include <math.h>   // sqrt
 #include <stdio.h>   // printf
+#include <limits.h>  // INT_MAX
 
 // To create a concave hull of a set of points
 // http://repositorium.sdum.uminho.pt/bitstream/1822/6429/1/ConcaveHull_ACM_MYS.pdf
@@ -26,9 +27,10 @@ typedef struct apTileImage
     int twidth;         // width in #tiles
     int theight;        // height in #tiles
     int rotation;       // 0, 90, 180, 270
+    int flip;           // 1 if mirrored horizontally (before the rotation)
     apRect rect;        // The bounding box of the cells that are valid in this image
 
-    uint32_t bytecount;
+    size_t   bytecount;
     uint8_t* bytes;     // Each byte represents a tile. 0 means it's not occupied
 } apTileImage;
 
@@ -93,18 +95,6 @@ static int apTilePackCheckSubImage(int tile_size, int x, int y,
     return 0;
 }
 
-// Returns 1 if all bits are set (i.e. a solid rectangle)
-static int apTilePackerImageIsSolidRect(const apTileImage* image)
-{
-    int size = image->bytecount;
-    for (int i = 0; i < size; ++i)
-    {
-        if (image->bytes[i] == 0)
-            return 0;
-    }
-    return 1;
-}
-
 static apTileImage* apTilePackerCreateTileImage(int width, int height, int tile_size)
 {
     apTileImage* image = (apTileImage*)malloc(sizeof(apTileImage));
@@ -114,9 +104,9 @@ static apTileImage* apTilePackerCreateTileImage(int width, int height, int tile_
     int theight = apMathRoundUp(height, tile_size) / tile_size;
     image->twidth = twidth;
     image->theight = theight;
-    image->bytecount = twidth*theight;
-    image->bytes = (uint8_t*)malloc(twidth*theight);
-    memset(image->bytes, 0, twidth*theight);
+    image->bytecount = (size_t)twidth*theight;
+    image->bytes = (uint8_t*)malloc(image->bytecount);
+    memset(image->bytes, 0, image->bytecount);
 
     image->rect.pos.x = 0;
     image->rect.pos.y = 0;
@@ -137,9 +127,9 @@ static void apTilePackerGrowTileImage(apTileImage* image, int width, int height,
 
     uint8_t* oldbytes = image->bytes;
 
-    image->bytecount = twidth*theight;
-    image->bytes = (uint8_t*)malloc(twidth*theight);
-    memset(image->bytes, 0, twidth*theight);
+    image->bytecount = (size_t)twidth*theight;
+    image->bytes = (uint8_t*)malloc(image->bytecount);
+    memset(image->bytes, 0, image->bytecount);
 
     for (int y = 0; y < oldtheight; ++y)
     {
@@ -220,7 +210,7 @@ uint8_t* apTilePackerCreateTileImageFromImage(int tile_size, int width, int heig
 }
 
 
-static apTileImage* apTilePackerCreateRotatedCopy(const apTileImage* image, int rotation)
+static apTileImage* apTilePackerCreateTransformedCopy(const apTileImage* image, int rotation, int flip)
 {
     apTileImage* outimage = (apTileImage*)malloc(sizeof(apTileImage));
     memset(outimage, 0, sizeof(apTileImage));
@@ -229,6 +219,7 @@ static apTileImage* apTilePackerCreateRotatedCopy(const apTileImage* image, int
     outimage->twidth = rotated ? image->theight : image->twidth;
     outimage->theight = rotated ? image->twidth : image->theight;
     outimage->rotation = rotation;
+    outimage->flip = flip;
     outimage->bytecount = image->bytecount;
     outimage->bytes = (uint8_t*)malloc(outimage->bytecount);
 
@@ -240,7 +231,7 @@ static apTileImage* apTilePackerCreateRotatedCopy(const apTileImage* image, int
         uint8_t* srcrow = &image->bytes[y * twidth];
         for (int x = 0; x < twidth; ++x)
         {
-            apPos outpos = apRotate(x, y, twidth, theight, rotation);
+            apPos outpos = apTransform(x, y, twidth, theight, rotation, flip);
 
             uint8_t* dstrow = &outimage->bytes[outpos.y * outtwidth];
             dstrow[outpos.x] = srcrow[x];
@@ -249,8 +240,8 @@ static apTileImage* apTilePackerCreateRotatedCopy(const apTileImage* image, int
 
     apPos p1 = image->rect.pos;
     apPos p2 = { image->rect.pos.x + image->rect.size.width - 1, image->rect.pos.y + image->rect.size.height - 1 };
-    apPos rp1 = apRotate(p1.x, p1.y, twidth, theight, rotation);
-    apPos rp2 = apRotate(p2.x, p2.y, twidth, theight, rotation);
+    apPos rp1 = apTransform(p1.x, p1.y, twidth, theight, rotation, flip);
+    apPos rp2 = apTransform(p2.x, p2.y, twidth, theight, rotation, flip);
     apPos new_p1 = { apMathMin(rp1.x, rp2.x), apMathMin(rp1.y, rp2.y) };
     apPos new_p2 = { apMathMax(rp1.x, rp2.x), apMathMax(rp1.y, rp2.y) };
 
@@ -261,19 +252,45 @@ static apTileImage* apTilePackerCreateRotatedCopy(const apTileImage* image, int
     return outimage;
 }
 
+static void apTilePackerDestroyTileImage(apTileImage* image)
+{
+    free((void*)image->bytes);
+    free((void*)image);
+}
+
+// Returns 1 if the image has the same tiles as one of the previous variants
+static int apTilePackerIsDuplicateTileImage(const apTilePackerImage* image, const apTileImage* tile_image)
+{
+    for (int i = 0; i < image->num_images; ++i)
+    {
+        const apTileImage* other = image->images[i];
+        if (other->twidth == tile_image->twidth && other->theight == tile_image->theight &&
+            memcmp(other->bytes, tile_image->bytes, tile_image->bytecount) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+// Creates the rotated (and optionally mirrored) variants of the first tile image.
+// Variants with the same tiles as a previous variant (e.g. due to symmetry) are skipped
 static void apTilePackerCreateRotatedTileImages(apTilePacker* packer, apTilePackerImage* image)
 {
     apTileImage* tile_image = image->images[0];
     assert(tile_image);
-    if (!apTilePackerImageIsSolidRect(tile_image)) // TODO: Should probably optimize
+
+    int num_flips = packer->options.flip ? 2 : 1;
+    for (int flip = 0; flip < num_flips; ++flip)
     {
-        image->images[image->num_images++] = apTilePackerCreateRotatedCopy(tile_image, 90);
-        image->images[image->num_images++] = apTilePackerCreateRotatedCopy(tile_image, 180);
-        image->images[image->num_images++] = apTilePackerCreateRotatedCopy(tile_image, 270);
-    } else {
-        if (tile_image->twidth != tile_image->theight)
+        for (int rotation = 0; rotation < 360; rotation += 90)
         {
-            image->images[image->num_images++] = apTilePackerCreateRotatedCopy(tile_image, 90);
+            if (rotation == 0 && flip == 0)
+                continue;
+
+            apTileImage* variant = apTilePackerCreateTransformedCopy(tile_image, rotation, flip);
+            if (apTilePackerIsDuplicateTileImage(image, variant))
+                apTilePackerDestroyTileImage(variant);
+            else
+                image->images[image->num_images++] = variant;
         }
     }
 }
@@ -300,8 +317,8 @@ static void apTilePackerCreateTileImageFromImageData(apTilePacker* packer, apTil
     int theight = apMathRoundUp(height, tile_size) / tile_size;
     tile_image->twidth = twidth;
     tile_image->theight = theight;
-    tile_image->bytecount = twidth*theight;
-    tile_image->bytes = (uint8_t*)malloc(twidth*theight);
+    tile_image->bytecount = (size_t)twidth*theight;
+    tile_image->bytes = (uint8_t*)malloc(tile_image->bytecount);
 
     apTilePackerMakeTileImageFromImageData(tile_image, tile_size, alpha_threshold, width, height, image->super.channels, data);
 
@@ -457,13 +474,93 @@ static apImage* apTilePackerCreateImage(apPacker* _packer, const char* path, int
     return (apImage*)image;
 }
 
+// Frees the tile image and its rotated/mirrored variants
+static void apTilePackerDestroyTileImages(apTilePackerImage* image)
+{
+    for (int i = 0; i < image->num_images; ++i)
+    {
+        apTilePackerDestroyTileImage(image->images[i]);
+        image->images[i] = 0;
+    }
+    image->num_images = 0;
+}
+
 static void apTilePackerDestroyImage(apPacker* packer, apImage* _image)
 {
     apTilePackerImage* image = (apTilePackerImage*)_image;
+    apTilePackerDestroyTileImages(image);
+    free((void*)image->images);
     free((void*)image->data);
     free((void*)image);
 }
 
+// Sets all tiles that overlap (or touch) the triangle, i.e. a conservative rasterization.
+// For each tile in the bounding box of the triangle, the corner of the tile that is furthest inside each edge is tested
+static void apTilePackerRasterizeTriangle(uint8_t* bytes, int twidth, int theight, const apPosf triangle[3])
+{
+    float minx = apMathMin(triangle[0].x, apMathMin(triangle[1].x, triangle[2].x));
+    float maxx = apMathMax(triangle[0].x, apMathMax(triangle[1].x, triangle[2].x));
+    float miny = apMathMin(triangle[0].y, apMathMin(triangle[1].y, triangle[2].y));
+    float maxy = apMathMax(triangle[0].y, apMathMax(triangle[1].y, triangle[2].y));
+
+    // The tiles [x, x+1] that touch the range [minx, maxx]
+    int x0 = (int)ceilf(minx) - 1;
+    int x1 = (int)floorf(maxx);
+    int y0 = (int)ceilf(miny) - 1;
+    int y1 = (int)floorf(maxy);
+    x0 = x0 < 0 ? 0 : x0;
+    y0 = y0 < 0 ? 0 : y0;
+    x1 = x1 >= twidth ? twidth - 1 : x1;
+    y1 = y1 >= theight ? theight - 1 : y1;
+    if (x0 > x1 || y0 > y1)
+        return;
+
+    float area = (triangle[1].x - triangle[0].x) * (triangle[2].y - triangle[0].y) - (triangle[1].y - triangle[0].y) * (triangle[2].x - triangle[0].x);
+    float sign = area < 0.0f ? -1.0f : 1.0f;
+
+    // The edge functions e(x,y) = a*x + b*y + c, which are positive on the inside of the edge
+    // A degenerate triangle is a line, so the tile must be on both sides of it
+    float a[3], b[3], c[3], epsilon[3];
+    int num_edges = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        apPosf p0 = triangle[i];
+        apPosf p1 = triangle[(i+1)%3];
+        float ea = -(p1.y - p0.y) * sign;
+        float eb = (p1.x - p0.x) * sign;
+        if (ea == 0.0f && eb == 0.0f)
+            continue;
+        a[num_edges] = ea;
+        b[num_edges] = eb;
+        c[num_edges] = -(ea * p0.x + eb * p0.y);
+        // Make the test slightly more conservative, to counter rounding errors
+        epsilon[num_edges] = 0.0001f * (fabsf(ea) + fabsf(eb));
+        ++num_edges;
+    }
+
+    for (int y = y0; y <= y1; ++y)
+    {
+        uint8_t* row = bytes + y * twidth;
+        for (int x = x0; x <= x1; ++x)
+        {
+            int inside = 1;
+            for (int e = 0; e < num_edges && inside; ++e)
+            {
+                float corner_x = a[e] > 0.0f ? (float)(x + 1) : (float)x;
+                float corner_y = b[e] > 0.0f ? (float)(y + 1) : (float)y;
+                float max_value = a[e] * corner_x + b[e] * corner_y + c[e];
+                inside = max_value >= -epsilon[e];
+                if (inside && area == 0.0f)
+                {
+                    float min_value = a[e] * ((float)(2 * x + 1) - corner_x) + b[e] * ((float)(2 * y + 1) - corner_y) + c[e];
+                    inside = min_value <= epsilon[e];
+                }
+            }
+            row[x] |= (uint8_t)inside;
+        }
+    }
+}
+
 void apTilePackerCreateTileImageFromTriangles(apPacker* _packer, apImage* _image, apPosf* triangles, int num_vertices)
 {
     apTilePacker* packer = (apTilePacker*)_packer;
@@ -490,8 +587,8 @@ void apTilePackerCreateTileImageFromTriangles(apPacker* _packer, apImage* _image
     int theight = apMathRoundUp(image->super.height, tile_size) / tile_size;
     tile_image->twidth = twidth;
     tile_image->theight = theight;
-    tile_image->bytecount = twidth*theight;
-    tile_image->bytes = (uint8_t*)malloc(twidth*theight);
+    tile_image->bytecount = (size_t)twidth*theight;
+    tile_image->bytes = (uint8_t*)malloc(tile_image->bytecount);
 
     apPosf half = {0.5f, 0.5f};
     apPosf tsize = {twidth, theight};
@@ -510,43 +607,15 @@ void apTilePackerCreateTileImageFromTriangles(apPacker* _packer, apImage* _image
         // }
     }
 
-    // Currently, I see two ways to create the image:
-    // 1) Texel overlap tests
-    // 2) Triangle rasterization
-
-    for (int y = 0; y < theight; ++y)
+    memset(tile_image->bytes, 0, tile_image->bytecount);
+    for (int t = 0, ti = 0; t < num_vertices/3; ++t, ti += 3)
     {
-        // if (debug)
-        //     printf("y: %2d\t\t", y);
-
-        for (int x = 0; x < twidth; ++x)
-        {
-            apPosf corners[4] = {
-                { x + 0, y + 0 },
-                { x + 1, y + 0 },
-                { x + 1, y + 1 },
-                { x + 0, y + 1 }
-            };
-
-            tile_image->bytes[y*twidth+x] = 0;
-
-            // We neeed to check all triangles
-            for (int t = 0, ti = 0; t < num_vertices/3; ++t, ti += 3)
-            {
-                apPosf triangle[3] = { triangles[ti+0], triangles[ti+1], triangles[ti+2] };
-                // Convert from [(-0.5, -0.5), (0.5, 0.5)] to [(0,0), (twidth, theight)]
-                triangle[0] = apMathMul(apMathAdd(triangle[0], half), tsize);
-                triangle[1] = apMathMul(apMathAdd(triangle[1], half), tsize);
-                triangle[2] = apMathMul(apMathAdd(triangle[2], half), tsize);
-
-                int overlap = apOverlapTest2D(triangle, 3, corners, 4);
-                if (overlap)
-                {
-                    tile_image->bytes[y*twidth+x] = 1;
-                    break;
-                }
-            }
-        }
+        // Convert from [(-0.5, -0.5), (0.5, 0.5)] to [(0,0), (twidth, theight)]
+        apPosf triangle[3];
+        triangle[0] = apMathMul(apMathAdd(triangles[ti+0], half), tsize);
+        triangle[1] = apMathMul(apMathAdd(triangles[ti+1], half), tsize);
+        triangle[2] = apMathMul(apMathAdd(triangles[ti+2], half), tsize);
+        apTilePackerRasterizeTriangle(tile_image->bytes, twidth, theight, triangle);
     }
 
     apTilePackerCalcImageRect(tile_image);
@@ -560,6 +629,7 @@ void apTilePackerCreateTileImageFromTriangles(apPacker* _packer, apImage* _image
     //     printf("\n");
     // }
 
+    apTilePackerDestroyTileImages(image);
     image->images[0] = tile_image;
     image->num_images = 1;
 }
@@ -573,11 +643,12 @@ void apTilePackerSetTileImage(apPacker* _packer, apImage* _image, int twidth, in
 
     tile_image->twidth = twidth;
     tile_image->theight = theight;
-    tile_image->bytecount = twidth*theight;
+    tile_image->bytecount = (size_t)twidth*theight;
     tile_image->bytes = timage;
 
     apTilePackerCalcImageRect(tile_image);
 
+    apTilePackerDestroyTileImages(image);
     image->images[0] = tile_image;
     image->num_images = 1;
 }
@@ -642,10 +713,16 @@ static int apTilePackerFitImageInRect(apTileImage* page_image, apTileImage* imag
     int pwidth = area->pos.x + area->size.width;
     int pheight = area->pos.y + area->size.height;
 
-    for (int dy = py; dy < pheight; ++dy)
+    // Only the non empty tiles are tested, but the whole image has to stay inside the page
+    int end_x = apMathMin(pwidth, page_image->twidth - image->twidth + image->rect.pos.x + 1);
+    int end_y = apMathMin(pheight, page_image->theight - image->theight + image->rect.pos.y + 1);
+    px = apMathMax(px, image->rect.pos.x);
+    py = apMathMax(py, image->rect.pos.y);
+
+    for (int dy = py; dy < end_y; ++dy)
     {
         int pheight_left = pheight - dy;
-        for (int dx = px; dx < pwidth; ++dx)
+        for (int dx = px; dx < end_x; ++dx)
         {
             int pwidth_left = pwidth - dx;
             int skip = apTilePackerFitImageAtPos(page_image, dx, dy, pwidth_left, pheight_left, image, 0);
@@ -721,17 +798,111 @@ static int apTilePackerPackImage(apTileImage* page_image, apTilePackerImage* ima
     // Try the rotated variations variation of the image
     for (int i = 0; i < image->num_images; ++i)
     {
+        // The mirrored variant is still allowed when not rotating
+        if (!allow_rotate && image->images[i]->rotation != 0)
+            continue;
+
         if (apTilePackerFitImage(page_image, image->images[i], prio_area, &image->pos))
         {
             image->fit_index = i;
             return i;
         }
-        if (!allow_rotate)
-            break;
     }
     return -1;
 }
 
+// Fits all the images in the page image, or none of them. Returns 1 if they all fit
+static int apTilePackerPackGroup(apTileImage* page_image, apImage** images, int num_images, apRect* prio_area, int allow_rotate,
+                                    uint8_t** scratch, size_t* scratch_size)
+{
+    if (*scratch_size < page_image->bytecount)
+    {
+        *scratch_size = page_image->bytecount;
+        *scratch = (uint8_t*)realloc(*scratch, *scratch_size);
+    }
+    memcpy(*scratch, page_image->bytes, page_image->bytecount);
+
+    for (int i = 0; i < num_images; ++i)
+    {
+        if (apTilePackerPackImage(page_image, (apTilePackerImage*)images[i], prio_area, allow_rotate) == -1)
+        {
+            memcpy(page_image->bytes, *scratch, page_image->bytecount);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Calculates the placement from the tile position, and adds the image to the page
+static void apTilePackerPlaceImage(apTilePackerPage* page, apTilePackerImage* image, int tile_size)
+{
+    apTileImage* fit_image = image->images[image->fit_index];
+    image->super.rotation = fit_image->rotation;
+    image->super.flip = fit_image->flip;
+
+    apPageAddImage(page->page, (apImage*)image);
+
+    int width = image->super.width;
+    int height = image->super.height;
+
+    // The tile image holds the padded image. If the image isn't a multiple of the tile size,
+    // the image may end up in another corner of the transformed tile image
+    int padded_width = width + image->padding*2;
+    int padded_height = height + image->padding*2;
+    int twidth = image->images[0]->twidth * tile_size;
+    int theight = image->images[0]->theight * tile_size;
+    apPos p1 = apTransform(0, 0, twidth, theight, fit_image->rotation, fit_image->flip);
+    apPos p2 = apTransform(padded_width - 1, padded_height - 1, twidth, theight, fit_image->rotation, fit_image->flip);
+
+    if (fit_image->rotation == 90 || fit_image->rotation == 270)
+    {
+        width = height;
+        height = image->super.width;
+    }
+
+    image->offset.x = apMathMin(p1.x, p2.x);
+    image->offset.y = apMathMin(p1.y, p2.y);
+    image->super.placement.pos.x = image->pos.x * tile_size + image->offset.x;
+    image->super.placement.pos.y = image->pos.y * tile_size + image->offset.y;
+    image->super.placement.size.width = width;
+    image->super.placement.size.height = height;
+
+    // also correct for any padding
+    image->super.placement.pos.x += image->padding;
+    image->super.placement.pos.y += image->padding;
+}
+
+// Frees the pages of a previous packing (the apPage's are owned by the context)
+static void apTilePackerDestroyPages(apTilePacker* packer)
+{
+    apTilePackerPage* page = packer->page.next;
+    while (page)
+    {
+        apTilePackerPage* next = page->next;
+        if (page->image)
+            apTilePackerDestroyTileImage(page->image);
+        free((void*)page);
+        page = next;
+    }
+    if (packer->page.image)
+        apTilePackerDestroyTileImage(packer->page.image);
+    memset(&packer->page, 0, sizeof(apTilePackerPage));
+}
+
+// Removes the last page (not the first one), which has no images
+static void apTilePackerDestroyLastPage(apTilePacker* packer, apContext* ctx)
+{
+    apTilePackerPage* prev = &packer->page;
+    while (prev->next->next)
+        prev = prev->next;
+    apTilePackerPage* page = prev->next;
+    if (page->image)
+        apTilePackerDestroyTileImage(page->image);
+    free((void*)page);
+    prev->next = 0;
+    apFreeLastPage(ctx);
+}
+
 static void apTilePackerPackImages(apPacker* _packer, apContext* ctx)
 {
     apTilePacker* packer = (apTilePacker*)_packer;
@@ -762,7 +933,8 @@ static void apTilePackerPackImages(apPacker* _packer, apContext* ctx)
     int page_size = ctx->options.page_size;
     if (page_size == 0)
     {
-        int totalArea = 0;
+        // 64 bit, as large texture sets easily exceed 2^31 texels
+        int64_t totalArea = 0;
         int max_rect_width = 0;
         int max_rect_height = 0;
 
@@ -774,14 +946,14 @@ static void apTilePackerPackImages(apPacker* _packer, apContext* ctx)
 
             int width = tile_image->rect.size.width * tile_size;
             int height = tile_image->rect.size.height * tile_size;
-            int area = width * height;
+            int64_t area = (int64_t)width * height;
             totalArea += area;
 
             max_rect_width = apMathMax(max_rect_width, width);
             max_rect_height = apMathMax(max_rect_height, height);
         }
 
-        int bin_size = (int)sqrtf(totalArea);
+        int bin_size = (int)sqrt((double)totalArea);
         if (bin_size == 0)
         {
             bin_size = 128;
@@ -795,13 +967,32 @@ static void apTilePackerPackImages(apPacker* _packer, apContext* ctx)
         page_size /= 2;
     }
 
+    // The size of new pages, and the largest size a page may become
+    apSize page_dims = { page_size, page_size };
+    apSize max_dims = { INT_MAX, INT_MAX };
+    if (ctx->options.page_size)
+        max_dims = page_dims;
+    if (ctx->options.max_page_width > 0 && ctx->options.max_page_width < max_dims.width)
+        max_dims.width = ctx->options.max_page_width;
+    if (ctx->options.max_page_height > 0 && ctx->options.max_page_height < max_dims.height)
+        max_dims.height = ctx->options.max_page_height;
+    // The page images are whole tiles, so round the limit down
+    if (max_dims.width != INT_MAX)
+        max_dims.width = apMathMax(tile_size, max_dims.width / tile_size * tile_size);
+    if (max_dims.height != INT_MAX)
+        max_dims.height = apMathMax(tile_size, max_dims.height / tile_size * tile_size);
+    if (page_dims.width > max_dims.width)
+        page_dims.width = max_dims.width;
+    if (page_dims.height > max_dims.height)
+        page_dims.height = max_dims.height;
+
+    // Clear any pages from a previous packing
+    apTilePackerDestroyPages(packer);
+
     {
         apTilePackerPage* page = &packer->page;
-        memset(page, 0, sizeof(apTilePackerPage));
         page->page = apAllocPage(ctx);
-        page->page->index = 0;
-        page->page->dimensions.width = page_size;
-        page->page->dimensions.height = page_size;
+        page->page->dimensions = page_dims;
 
         printf("Creating page: %d  %d x %d\n", page->page->index, page->page->dimensions.width, page->page->dimensions.height);
     }
@@ -811,22 +1002,52 @@ static void apTilePackerPackImages(apPacker* _packer, apContext* ctx)
     // In order to fill in all tiny gaps, we keep the previous area in the page image
     apRect prio_area = { {0, 0}, {0, 0} };
     apRect* p_prio_area = 0;
+    apTilePackerPage* prio_page = 0; // The page that the prio area belongs to
 
     uint64_t t_pack_image = 0;
 
+    uint8_t* group_scratch = 0;
+    size_t group_scratch_size = 0;
+    int group_start = -1;
+    int group_end = 0;      // The end of the last group that was handled
+    int group_active = 0;   // If the current group is still packed as one unit
+
     int allow_rotate = !packer->options.no_rotate;
     for (int i = 0; i < ctx->num_images; ++i)
     {
         apTilePackerImage* image = (apTilePackerImage*)ctx->images[i];
 
+        // The images of a group are next to each other (see apPackImages), and are packed onto one page if possible
+        if (image->super.group && i >= group_end)
+        {
+            group_start = i;
+            group_end = i + 1;
+            while (group_end < ctx->num_images && ctx->images[group_end]->group == image->super.group)
+                ++group_end;
+            group_active = group_end - i > 1;
+        }
+        int num_group_images = (group_active && i == group_start) ? group_end - i : 1;
+
+        apTileImage* tile_image = image->images[0];
+        int image_width = tile_image->twidth * tile_size;
+        int image_height = tile_image->theight * tile_size;
+        if (!(image_width <= max_dims.width && image_height <= max_dims.height) &&
+            !(allow_rotate && image_height <= max_dims.width && image_width <= max_dims.height))
+        {
+            printf("Image %s (%d x %d) is larger than the max page size %d x %d\n", image->super.path, image_width, image_height, max_dims.width, max_dims.height);
+            image->super.page = -1;
+            continue;
+        }
+
         int image_index = -1;
         apTilePackerPage* page = &packer->page;
         while (page) {
             if (!page->image)
             {
-                int width = apNextPowerOfTwo(page_size);
-                int height = apNextPowerOfTwo(page_size);
+                int width = page->page->dimensions.width;
+                int height = page->page->dimensions.height;
                 page->image = apTilePackerCreateTileImage(width, height, tile_size);
+                prio_page = page;
 
                 prio_area.pos.x = 0;
                 prio_area.pos.y = 0;
@@ -836,7 +1057,12 @@ static void apTilePackerPackImages(apPacker* _packer, apContext* ctx)
             }
             timestart = apGetTime();
 
-            image_index = apTilePackerPackImage(page->image, image, p_prio_area, allow_rotate);
+            apRect* page_prio_area = page == prio_page ? p_prio_area : 0;
+            if (num_group_images > 1)
+                image_index = apTilePackerPackGroup(page->image, ctx->images + i, num_group_images, page_prio_area, allow_rotate,
+                                                    &group_scratch, &group_scratch_size) ? 0 : -1;
+            else
+                image_index = apTilePackerPackImage(page->image, image, page_prio_area, allow_rotate);
 
             timeend = apGetTime();
             t_pack_image += timeend - timestart;
@@ -853,38 +1079,61 @@ static void apTilePackerPackImages(apPacker* _packer, apContext* ctx)
         // We tried all pages but it didn't fit
         if (image_index == -1)
         {
-            if (ctx->options.page_size != 0)
+            // Grow the last page, or create a new page if it has reached its max size
+            page = &packer->page;
+            while (page->next)
+                page = page->next;
+
+            apSize size;
+            size.width = page->image->twidth * tile_size;
+            size.height = page->image->theight * tile_size;
+            apSize grown = size;
+            if (ctx->options.page_size == 0)
+            {
+                grown = apGrowPageSize(&ctx->options, size, tile_size);
+                if (grown.width > max_dims.width || grown.height > max_dims.height)
+                    grown = size;
+            }
+
+            if (num_group_images > 1 && !page->page->first_image && grown.width == size.width && grown.height == size.height)
+            {
+                // The group doesn't fit in an empty page, so the images are packed one by one.
+                // Don't leave an empty page behind, if it was opened for this group
+                if (page != &packer->page)
+                {
+                    if (prio_page == page)
+                    {
+                        prio_page = 0;
+                        p_prio_area = 0;
+                    }
+                    apTilePackerDestroyLastPage(packer, ctx);
+                }
+                group_active = 0;
+                --i;
+                continue;
+            }
+
+            if (grown.width == size.width && grown.height == size.height)
             {
                 apTilePackerPage* new_page = (apTilePackerPage*)malloc(sizeof(apTilePackerPage));
                 memset(new_page, 0, sizeof(apTilePackerPage));
                 new_page->page = apAllocPage(ctx);
-                new_page->page->dimensions.width = page_size;
-                new_page->page->dimensions.height = page_size;
-
-                // insert the new page
-                apTilePackerPage* last_page = &packer->page;
-                while (last_page && last_page->next)
-                    last_page = last_page->next;
-                last_page->next = new_page;
+                new_page->page->dimensions = page_dims;
+                page->next = new_page;
+                p_prio_area = 0;
 
                 printf("Creating page: %d  %d x %d\n", new_page->page->index, new_page->page->dimensions.width, new_page->page->dimensions.height);
             }
             else
             {
-                page = &packer->page;
-
                 // Use the previous area as the first search area
                 prio_area.size.width = page->image->twidth;
                 prio_area.size.height = page->image->theight;
                 p_prio_area = &prio_area;
+                prio_page = page;
 
-                // grow the page, or find a next page that will fit this image
-                int width = page->image->twidth * tile_size;
-                int height = page->image->theight * tile_size;
-                if (width <= height)
-                    width *= 2;
-                else
-                    height *= 2;
+                int width = grown.width;
+                int height = grown.height;
                 apTilePackerGrowTileImage(page->image, width, height, tile_size);
                 printf("Growing page image to %d x %d\n", width, height);
 
@@ -897,30 +1146,10 @@ static void apTilePackerPackImages(apPacker* _packer, apContext* ctx)
             continue;
         }
 
-        apTileImage* fit_image = image->images[image->fit_index];
-        image->super.rotation = fit_image->rotation;
-
-        apPageAddImage(page->page, (apImage*)image);
-
-        int width = image->super.width;
-        int height = image->super.height;
-        int use_offsetx = fit_image->rotation == 180 || fit_image->rotation == 270;
-        int use_offsety = fit_image->rotation == 180 || fit_image->rotation == 90;
-
-        if (fit_image->rotation == 90 || fit_image->rotation == 270)
-        {
-            width = height;
-            height = image->super.width;
-        }
-
-        image->offset.x = use_offsetx * (fit_image->twidth * tile_size - width);
-        image->offset.y = use_offsety * (fit_image->theight * tile_size - height);
-        image->super.placement.pos.x = image->pos.x * tile_size + image->offset.x;
-        image->super.placement.pos.y = image->pos.y * tile_size + image->offset.y;
-
-        // also correct for any padding
-        image->super.placement.pos.x += image->padding;
-        image->super.placement.pos.y += image->padding;
+        for (int g = 0; g < num_group_images; ++g)
+            apTilePackerPlaceImage(page, (apTilePackerImage*)ctx->images[i + g], tile_size);
+        i += num_group_images - 1;
+        group_active = 0;
 
         // int debug = image->pos.x == 0 && image->pos.y == 20;
         // //int debug = image->pos.x == 0 && image->pos.y == 11;
@@ -935,6 +1164,8 @@ static void apTilePackerPackImages(apPacker* _packer, apContext* ctx)
         //DebugPrintTileImage(page->image);
     }
 
+    free((void*)group_scratch);
+
     uint64_t t_gen_vertices = 0;
     int t_num_vertices = 0;
 
@@ -965,15 +1196,34 @@ static void apTilePackerPackImages(apPacker* _packer, apContext* ctx)
         else
         {
             // Precalculated convex hull, in range [-0.5, 0.5]
+            // Transform it the same way as the image, and move it to the placement
             float width = image->super.width;
             float height = image->super.height;
-            float half_width = width * 0.5f;
-            float half_height = height * 0.5f;
             for (int v = 0; v < apimage->num_vertices; ++v)
             {
                 apPosf* p = &apimage->vertices[v];
-                p->x = apimage->placement.pos.x - image->padding - image->offset.x + width * (p->x + 0.5f);
-                p->y = apimage->placement.pos.y - image->padding - image->offset.y + height * (p->y + 0.5f);
+                apPosf t = { width * (p->x + 0.5f), height * (p->y + 0.5f) };
+                if (apimage->flip)
+                    t.x = width - t.x;
+
+                apPosf r = t;
+                if (apimage->rotation == 90)
+                {
+                    r.x = t.y;
+                    r.y = width - t.x;
+                }
+                else if (apimage->rotation == 180)
+                {
+                    r.x = width - t.x;
+                    r.y = height - t.y;
+                }
+                else if (apimage->rotation == 270)
+                {
+                    r.x = height - t.y;
+                    r.y = t.x;
+                }
+                p->x = apimage->placement.pos.x + r.x;
+                p->y = apimage->placement.pos.y + r.y;
             }
 
         }
@@ -1059,6 +1309,7 @@ apPacker* apTilePackerCreate(apTilePackerOptions* options)
 
 void apTilePackerDestroy(apPacker* packer)
 {
+    apTilePackerDestroyPages((apTilePacker*)packer);
     free((void*)packer);
 }
 
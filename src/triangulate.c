@@ -0,0 +1,781 @@
+// https://github.com/JCash/atlaspacker
+// License: MIT
+// @2021-@2023 Mathias Westerdahl
+
+// The ear clipping follows the approach of Mapbox's earcut (ISC license)
+// https://github.com/mapbox/earcut
+
+#include <atlaspacker/triangulate.h>
+
+#include <assert.h>
+#include <math.h> // fabsf
+#include <float.h> // FLT_MAX
+#include <stdlib.h> // malloc, qsort
+#include <string.h> // memset
+
+typedef struct apTriNode
+{
+    struct apTriNode* prev;
+    struct apTriNode* next;
+    struct apTriNode* prev_z;   // The nodes sorted on their z-order
+    struct apTriNode* next_z;
+    float   x, y;
+    int     i;                  // The vertex index
+    int32_t z;
+} apTriNode;
+
+typedef struct
+{
+    apTriNode*  nodes;
+    int         num_nodes;
+    int         capacity;
+
+    int*        indices;
+    int         num_indices;
+    int         max_indices;
+
+    float       min_x, min_y;
+    float       inv_size;       // 0 if the z-order hashing isn't used
+} apTriContext;
+
+static apTriNode* apTriNewNode(apTriContext* ctx, int i, float x, float y)
+{
+    assert(ctx->num_nodes < ctx->capacity);
+    apTriNode* p = &ctx->nodes[ctx->num_nodes++];
+    memset(p, 0, sizeof(apTriNode));
+    p->i = i;
+    p->x = x;
+    p->y = y;
+    return p;
+}
+
+static void apTriAddTriangle(apTriContext* ctx, const apTriNode* a, const apTriNode* b, const apTriNode* c)
+{
+    if (ctx->num_indices + 3 > ctx->max_indices)
+        return; // Can only happen with degenerate input
+    ctx->indices[ctx->num_indices++] = a->i;
+    ctx->indices[ctx->num_indices++] = b->i;
+    ctx->indices[ctx->num_indices++] = c->i;
+}
+
+// Positive if the triangle is reflex in the (positive) polygon winding
+static inline float apTriArea(const apTriNode* p, const apTriNode* q, const apTriNode* r)
+{
+    return (q->y - p->y) * (r->x - q->x) - (q->x - p->x) * (r->y - q->y);
+}
+
+static inline int apTriEquals(const apTriNode* a, const apTriNode* b)
+{
+    return a->x == b->x && a->y == b->y;
+}
+
+static apTriNode* apTriInsertNode(apTriContext* ctx, int i, float x, float y, apTriNode* last)
+{
+    apTriNode* p = apTriNewNode(ctx, i, x, y);
+    if (!last)
+    {
+        p->prev = p;
+        p->next = p;
+    }
+    else
+    {
+        p->next = last->next;
+        p->prev = last;
+        last->next->prev = p;
+        last->next = p;
+    }
+    return p;
+}
+
+static void apTriRemoveNode(apTriNode* p)
+{
+    p->next->prev = p->prev;
+    p->prev->next = p->next;
+    if (p->prev_z)
+        p->prev_z->next_z = p->next_z;
+    if (p->next_z)
+        p->next_z->prev_z = p->prev_z;
+}
+
+static float apTriSignedArea(const apPosf* vertices, int start, int end)
+{
+    float sum = 0;
+    for (int i = start, j = end - 1; i < end; j = i++)
+        sum += (vertices[j].x - vertices[i].x) * (vertices[i].y + vertices[j].y);
+    return sum;
+}
+
+// Creates a circular list. The outer polygon gets a positive winding, and the holes a negative winding
+static apTriNode* apTriLinkedList(apTriContext* ctx, const apPosf* vertices, int start, int end, int positive)
+{
+    apTriNode* last = 0;
+    if (positive == (apTriSignedArea(vertices, start, end) > 0))
+    {
+        for (int i = start; i < end; ++i)
+            last = apTriInsertNode(ctx, i, vertices[i].x, vertices[i].y, last);
+    }
+    else
+    {
+        for (int i = end - 1; i >= start; --i)
+            last = apTriInsertNode(ctx, i, vertices[i].x, vertices[i].y, last);
+    }
+
+    if (last && apTriEquals(last, last->next))
+    {
+        apTriRemoveNode(last);
+        last = last->next;
+    }
+    return last;
+}
+
+// Removes duplicate and collinear points
+static apTriNode* apTriFilterPoints(apTriNode* start, apTriNode* end)
+{
+    if (!start)
+        return start;
+    if (!end)
+        end = start;
+
+    apTriNode* p = start;
+    int again;
+    do
+    {
+        again = 0;
+        if (apTriEquals(p, p->next) || apTriArea(p->prev, p, p->next) == 0)
+        {
+            apTriRemoveNode(p);
+            p = end = p->prev;
+            if (p == p->next)
+                break;
+            again = 1;
+        }
+        else
+        {
+            p = p->next;
+        }
+    } while (again || p != end);
+    return end;
+}
+
+static int apTriPointInTriangle(float ax, float ay, float bx, float by, float cx, float cy, float px, float py)
+{
+    return (cx - px) * (ay - py) >= (ax - px) * (cy - py) &&
+           (ax - px) * (by - py) >= (bx - px) * (ay - py) &&
+           (bx - px) * (cy - py) >= (cx - px) * (by - py);
+}
+
+// ************************************************************************************************************************
+// Z-order hashing
+
+static int32_t apTriZOrder(float fx, float fy, float min_x, float min_y, float inv_size)
+{
+    uint32_t x = (uint32_t)((fx - min_x) * inv_size);
+    uint32_t y = (uint32_t)((fy - min_y) * inv_size);
+
+    x = (x | (x << 8)) & 0x00FF00FF;
+    x = (x | (x << 4)) & 0x0F0F0F0F;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+
+    y = (y | (y << 8)) & 0x00FF00FF;
+    y = (y | (y << 4)) & 0x0F0F0F0F;
+    y = (y | (y << 2)) & 0x33333333;
+    y = (y | (y << 1)) & 0x55555555;
+
+    return (int32_t)(x | (y << 1));
+}
+
+// Merge sort of the z-order list
+static void apTriSortLinked(apTriNode* list)
+{
+    int in_size = 1;
+    int num_merges;
+    do
+    {
+        apTriNode* p = list;
+        apTriNode* tail = 0;
+        list = 0;
+        num_merges = 0;
+
+        while (p)
+        {
+            num_merges++;
+            apTriNode* q = p;
+            int p_size = 0;
+            for (int i = 0; i < in_size; ++i)
+            {
+                p_size++;
+                q = q->next_z;
+                if (!q)
+                    break;
+            }
+            int q_size = in_size;
+
+            while (p_size > 0 || (q_size > 0 && q))
+            {
+                apTriNode* e;
+                if (p_size != 0 && (q_size == 0 || !q || p->z <= q->z))
+                {
+                    e = p;
+                    p = p->next_z;
+                    p_size--;
+                }
+                else
+                {
+                    e = q;
+                    q = q->next_z;
+                    q_size--;
+                }
+
+                if (tail)
+                    tail->next_z = e;
+                else
+                    list = e;
+                e->prev_z = tail;
+                tail = e;
+            }
+            p = q;
+        }
+        tail->next_z = 0;
+        in_size *= 2;
+    } while (num_merges > 1);
+}
+
+static void apTriIndexCurve(apTriContext* ctx, apTriNode* start)
+{
+    apTriNode* p = start;
+    do
+    {
+        if (p->z == 0)
+            p->z = apTriZOrder(p->x, p->y, ctx->min_x, ctx->min_y, ctx->inv_size);
+        p->prev_z = p->prev;
+        p->next_z = p->next;
+        p = p->next;
+    } while (p != start);
+
+    p->prev_z->next_z = 0;
+    p->prev_z = 0;
+    apTriSortLinked(p);
+}
+
+// ************************************************************************************************************************
+// Ears
+
+// Checks that no reflex vertex is inside the ear
+static int apTriIsEar(apTriNode* ear)
+{
+    const apTriNode* a = ear->prev;
+    const apTriNode* b = ear;
+    const apTriNode* c = ear->next;
+    if (apTriArea(a, b, c) >= 0)
+        return 0; // Reflex, can't be an ear
+
+    float x0 = fminf(a->x, fminf(b->x, c->x));
+    float y0 = fminf(a->y, fminf(b->y, c->y));
+    float x1 = fmaxf(a->x, fmaxf(b->x, c->x));
+    float y1 = fmaxf(a->y, fmaxf(b->y, c->y));
+
+    const apTriNode* p = c->next;
+    while (p != a)
+    {
+        if (p->x >= x0 && p->x <= x1 && p->y >= y0 && p->y <= y1 &&
+            apTriPointInTriangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y) &&
+            apTriArea(p->prev, p, p->next) >= 0)
+            return 0;
+        p = p->next;
+    }
+    return 1;
+}
+
+static int apTriIsInsideEar(const apTriNode* a, const apTriNode* b, const apTriNode* c, const apTriNode* p,
+                            float x0, float y0, float x1, float y1)
+{
+    return p->x >= x0 && p->x <= x1 && p->y >= y0 && p->y <= y1 && p != a && p != c &&
+           apTriPointInTriangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y) &&
+           apTriArea(p->prev, p, p->next) >= 0;
+}
+
+// Same as apTriIsEar, but only visits the vertices in the z-order range of the ear's bounding box
+static int apTriIsEarHashed(apTriContext* ctx, apTriNode* ear)
+{
+    const apTriNode* a = ear->prev;
+    const apTriNode* b = ear;
+    const apTriNode* c = ear->next;
+    if (apTriArea(a, b, c) >= 0)
+        return 0;
+
+    float x0 = fminf(a->x, fminf(b->x, c->x));
+    float y0 = fminf(a->y, fminf(b->y, c->y));
+    float x1 = fmaxf(a->x, fmaxf(b->x, c->x));
+    float y1 = fmaxf(a->y, fmaxf(b->y, c->y));
+
+    int32_t min_z = apTriZOrder(x0, y0, ctx->min_x, ctx->min_y, ctx->inv_size);
+    int32_t max_z = apTriZOrder(x1, y1, ctx->min_x, ctx->min_y, ctx->inv_size);
+
+    const apTriNode* p = ear->prev_z;
+    const apTriNode* n = ear->next_z;
+
+    // Look in both directions
+    while (p && p->z >= min_z && n && n->z <= max_z)
+    {
+        if (apTriIsInsideEar(a, b, c, p, x0, y0, x1, y1))
+            return 0;
+        p = p->prev_z;
+        if (apTriIsInsideEar(a, b, c, n, x0, y0, x1, y1))
+            return 0;
+        n = n->next_z;
+    }
+    while (p && p->z >= min_z)
+    {
+        if (apTriIsInsideEar(a, b, c, p, x0, y0, x1, y1))
+            return 0;
+        p = p->prev_z;
+    }
+    while (n && n->z <= max_z)
+    {
+        if (apTriIsInsideEar(a, b, c, n, x0, y0, x1, y1))
+            return 0;
+        n = n->next_z;
+    }
+    return 1;
+}
+
+static int apTriSign(float v)
+{
+    return v > 0 ? 1 : (v < 0 ? -1 : 0);
+}
+
+// For collinear points p, q, r: checks if q lies on the segment pr
+static int apTriOnSegment(const apTriNode* p, const apTriNode* q, const apTriNode* r)
+{
+    return q->x <= fmaxf(p->x, r->x) && q->x >= fminf(p->x, r->x) &&
+           q->y <= fmaxf(p->y, r->y) && q->y >= fminf(p->y, r->y);
+}
+
+static int apTriIntersects(const apTriNode* p1, const apTriNode* q1, const apTriNode* p2, const apTriNode* q2)
+{
+    int o1 = apTriSign(apTriArea(p1, q1, p2));
+    int o2 = apTriSign(apTriArea(p1, q1, q2));
+    int o3 = apTriSign(apTriArea(p2, q2, p1));
+    int o4 = apTriSign(apTriArea(p2, q2, q1));
+
+    if (o1 != o2 && o3 != o4)
+        return 1;
+    if (o1 == 0 && apTriOnSegment(p1, p2, q1))
+        return 1;
+    if (o2 == 0 && apTriOnSegment(p1, q2, q1))
+        return 1;
+    if (o3 == 0 && apTriOnSegment(p2, p1, q2))
+        return 1;
+    if (o4 == 0 && apTriOnSegment(p2, q1, q2))
+        return 1;
+    return 0;
+}
+
+static int apTriIntersectsPolygon(const apTriNode* a, const apTriNode* b)
+{
+    const apTriNode* p = a;
+    do
+    {
+        if (p->i != a->i && p->next->i != a->i && p->i != b->i && p->next->i != b->i &&
+            apTriIntersects(p, p->next, a, b))
+            return 1;
+        p = p->next;
+    } while (p != a);
+    return 0;
+}
+
+// Checks if the diagonal ab is inside the polygon, close to a
+static int apTriLocallyInside(const apTriNode* a, const apTriNode* b)
+{
+    if (apTriArea(a->prev, a, a->next) < 0)
+        return apTriArea(a, b, a->next) >= 0 && apTriArea(a, a->prev, b) >= 0;
+    return apTriArea(a, b, a->prev) < 0 || apTriArea(a, a->next, b) < 0;
+}
+
+// Checks if the middle of the diagonal ab is inside the polygon
+static int apTriMiddleInside(const apTriNode* a, const apTriNode* b)
+{
+    const apTriNode* p = a;
+    int inside = 0;
+    float px = (a->x + b->x) / 2;
+    float py = (a->y + b->y) / 2;
+    do
+    {
+        if (((p->y > py) != (p->next->y > py)) && p->next->y != p->y &&
+            (px < (p->next->x - p->x) * (py - p->y) / (p->next->y - p->y) + p->x))
+            inside = !inside;
+        p = p->next;
+    } while (p != a);
+    return inside;
+}
+
+static int apTriIsValidDiagonal(const apTriNode* a, const apTriNode* b)
+{
+    if (a->next->i == b->i || a->prev->i == b->i || apTriIntersectsPolygon(a, b))
+        return 0;
+    if (apTriLocallyInside(a, b) && apTriLocallyInside(b, a) && apTriMiddleInside(a, b) &&
+        (apTriArea(a->prev, a, b->prev) != 0 || apTriArea(a, b->prev, b) != 0))
+        return 1;
+    // Special zero length case
+    return apTriEquals(a, b) && apTriArea(a->prev, a, a->next) > 0 && apTriArea(b->prev, b, b->next) > 0;
+}
+
+// Splits the polygon in two by the diagonal ab. Returns the new node of b
+static apTriNode* apTriSplitPolygon(apTriContext* ctx, apTriNode* a, apTriNode* b)
+{
+    apTriNode* a2 = apTriNewNode(ctx, a->i, a->x, a->y);
+    apTriNode* b2 = apTriNewNode(ctx, b->i, b->x, b->y);
+    apTriNode* an = a->next;
+    apTriNode* bp = b->prev;
+
+    a->next = b;
+    b->prev = a;
+
+    a2->next = an;
+    an->prev = a2;
+
+    b2->next = a2;
+    a2->prev = b2;
+
+    bp->next = b2;
+    b2->prev = bp;
+
+    return b2;
+}
+
+static void apTriEarcutLinked(apTriContext* ctx, apTriNode* ear, int pass);
+
+// Removes small self intersections (e.g. from the filtering)
+static apTriNode* apTriCureLocalIntersections(apTriContext* ctx, apTriNode* start)
+{
+    apTriNode* p = start;
+    do
+    {
+        apTriNode* a = p->prev;
+        apTriNode* b = p->next->next;
+        if (!apTriEquals(a, b) && apTriIntersects(a, p, p->next, b) && apTriLocallyInside(a, b) && apTriLocallyInside(b, a))
+        {
+            apTriAddTriangle(ctx, a, p, b);
+            apTriRemoveNode(p);
+            apTriRemoveNode(p->next);
+            p = start = b;
+        }
+        p = p->next;
+    } while (p != start);
+    return apTriFilterPoints(p, 0);
+}
+
+// As a last resort, split the polygon in two, and triangulate each part
+static void apTriSplitEarcut(apTriContext* ctx, apTriNode* start)
+{
+    apTriNode* a = start;
+    do
+    {
+        apTriNode* b = a->next->next;
+        while (b != a->prev)
+        {
+            if (a->i != b->i && apTriIsValidDiagonal(a, b))
+            {
+                apTriNode* c = apTriSplitPolygon(ctx, a, b);
+                a = apTriFilterPoints(a, a->next);
+                c = apTriFilterPoints(c, c->next);
+                apTriEarcutLinked(ctx, a, 0);
+                apTriEarcutLinked(ctx, c, 0);
+                return;
+            }
+            b = b->next;
+        }
+        a = a->next;
+    } while (a != start);
+}
+
+static void apTriEarcutLinked(apTriContext* ctx, apTriNode* ear, int pass)
+{
+    if (!ear)
+        return;
+
+    if (!pass && ctx->inv_size != 0)
+        apTriIndexCurve(ctx, ear);
+
+    apTriNode* stop = ear;
+    while (ear->prev != ear->next)
+    {
+        apTriNode* prev = ear->prev;
+        apTriNode* next = ear->next;
+
+        if (ctx->inv_size != 0 ? apTriIsEarHashed(ctx, ear) : apTriIsEar(ear))
+        {
+            apTriAddTriangle(ctx, prev, ear, next);
+            apTriRemoveNode(ear);
+
+            // Skipping the next vertex leads to less sliver triangles
+            ear = next->next;
+            stop = next->next;
+            continue;
+        }
+
+        ear = next;
+
+        // We went through the whole polygon without finding an ear
+        if (ear == stop)
+        {
+            if (pass == 0)
+            {
+                apTriEarcutLinked(ctx, apTriFilterPoints(ear, 0), 1);
+            }
+            else if (pass == 1)
+            {
+                ear = apTriCureLocalIntersections(ctx, apTriFilterPoints(ear, 0));
+                apTriEarcutLinked(ctx, ear, 2);
+            }
+            else if (pass == 2)
+            {
+                apTriSplitEarcut(ctx, ear);
+            }
+            break;
+        }
+    }
+}
+
+// ************************************************************************************************************************
+// Holes
+
+static int apTriSectorContainsSector(const apTriNode* m, const apTriNode* p)
+{
+    return apTriArea(m->prev, m, p->prev) < 0 && apTriArea(p->next, m, m->next) < 0;
+}
+
+// Finds a vertex on the outer polygon that can be connected to the leftmost vertex of the hole
+static apTriNode* apTriFindHoleBridge(apTriNode* hole, apTriNode* outer)
+{
+    apTriNode* p = outer;
+    float hx = hole->x;
+    float hy = hole->y;
+    float qx = -FLT_MAX;
+    apTriNode* m = 0;
+
+    // Find the segment that a ray from the hole's leftmost point to the left hits first
+    do
+    {
+        if (hy <= p->y && hy >= p->next->y && p->next->y != p->y)
+        {
+            float x = p->x + (hy - p->y) * (p->next->x - p->x) / (p->next->y - p->y);
+            if (x <= hx && x > qx)
+            {
+                qx = x;
+                m = p->x < p->next->x ? p : p->next;
+                if (x == hx)
+                    return m; // The hole touches the outer segment
+            }
+        }
+        p = p->next;
+    } while (p != outer);
+
+    if (!m)
+        return 0;
+
+    // If there are vertices inside the triangle (hole point, ray intersection, segment end point),
+    // use the one with the smallest angle to the ray instead
+    const apTriNode* stop = m;
+    float mx = m->x;
+    float my = m->y;
+    float tan_min = FLT_MAX;
+    p = m;
+    do
+    {
+        if (hx >= p->x && p->x >= mx && hx != p->x &&
+            apTriPointInTriangle(hy < my ? hx : qx, hy, mx, my, hy < my ? qx : hx, hy, p->x, p->y))
+        {
+            float tan = fabsf(hy - p->y) / (hx - p->x);
+            if (apTriLocallyInside(p, hole) &&
+                (tan < tan_min || (tan == tan_min && (p->x > m->x || (p->x == m->x && apTriSectorContainsSector(m, p))))))
+            {
+                m = p;
+                tan_min = tan;
+            }
+        }
+        p = p->next;
+    } while (p != stop);
+
+    return m;
+}
+
+static apTriNode* apTriEliminateHole(apTriContext* ctx, apTriNode* hole, apTriNode* outer)
+{
+    apTriNode* bridge = apTriFindHoleBridge(hole, outer);
+    if (!bridge)
+        return outer;
+
+    apTriNode* bridge_reverse = apTriSplitPolygon(ctx, bridge, hole);
+
+    // Remove the collinear points around the cuts
+    apTriNode* filtered_bridge = apTriFilterPoints(bridge, bridge->next);
+    apTriFilterPoints(bridge_reverse, bridge_reverse->next);
+
+    // The outer node may have been removed by the filtering
+    return outer == bridge ? filtered_bridge : outer;
+}
+
+static apTriNode* apTriGetLeftmost(apTriNode* start)
+{
+    apTriNode* p = start;
+    apTriNode* leftmost = start;
+    do
+    {
+        if (p->x < leftmost->x || (p->x == leftmost->x && p->y < leftmost->y))
+            leftmost = p;
+        p = p->next;
+    } while (p != start);
+    return leftmost;
+}
+
+static int apTriCompareX(const void* _a, const void* _b)
+{
+    const apTriNode* a = *(const apTriNode**)_a;
+    const apTriNode* b = *(const apTriNode**)_b;
+    if (a->x != b->x)
+        return a->x < b->x ? -1 : 1;
+    return 0;
+}
+
+// Connects the holes to the outer polygon, so that we get one polygon
+static apTriNode* apTriEliminateHoles(apTriContext* ctx, const apPosf* vertices, const int* contour_sizes, int num_contours, apTriNode* outer)
+{
+    apTriNode** queue = (apTriNode**)malloc(sizeof(apTriNode*) * (size_t)num_contours);
+    int num_holes = 0;
+    int start = contour_sizes[0];
+    for (int i = 1; i < num_contours; ++i)
+    {
+        int end = start + contour_sizes[i];
+        apTriNode* list = end - start >= 3 ? apTriLinkedList(ctx, vertices, start, end, 0) : 0;
+        if (list && list != list->next)
+            queue[num_holes++] = apTriGetLeftmost(list);
+        start = end;
+    }
+
+    qsort(queue, (size_t)num_holes, sizeof(apTriNode*), apTriCompareX);
+    for (int i = 0; i < num_holes; ++i)
+        outer = apTriEliminateHole(ctx, queue[i], outer);
+
+    free((void*)queue);
+    return outer;
+}
+
+// ************************************************************************************************************************
+
+int apTriangulate(const apPosf* vertices, const int* contour_sizes, int num_contours, int** out_indices)
+{
+    *out_indices = 0;
+    if (num_contours <= 0 || contour_sizes[0] < 3)
+        return 0;
+
+    int num_vertices = 0;
+    for (int i = 0; i < num_contours; ++i)
+        num_vertices += contour_sizes[i];
+
+    apTriContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    // Each split (for holes, and the last resort splits) adds two nodes
+    ctx.capacity = 3 * num_vertices + 2 * num_contours + 8;
+    ctx.nodes = (apTriNode*)malloc(sizeof(apTriNode) * (size_t)ctx.capacity);
+    ctx.max_indices = 3 * (num_vertices + 2 * (num_contours - 1));
+    ctx.indices = (int*)malloc(sizeof(int) * (size_t)ctx.max_indices);
+
+    int outer_size = contour_sizes[0];
+    apTriNode* outer = apTriLinkedList(&ctx, vertices, 0, outer_size, 1);
+    if (outer && outer->next != outer->prev)
+    {
+        if (num_contours > 1)
+            outer = apTriEliminateHoles(&ctx, vertices, contour_sizes, num_contours, outer);
+
+        // For larger polygons, we use z-order hashing to find the vertices inside an ear
+        if (num_vertices > 80)
+        {
+            float max_x, max_y;
+            ctx.min_x = max_x = vertices[0].x;
+            ctx.min_y = max_y = vertices[0].y;
+            for (int i = 1; i < outer_size; ++i)
+            {
+                ctx.min_x = fminf(ctx.min_x, vertices[i].x);
+                ctx.min_y = fminf(ctx.min_y, vertices[i].y);
+                max_x = fmaxf(max_x, vertices[i].x);
+                max_y = fmaxf(max_y, vertices[i].y);
+            }
+            float size = fmaxf(max_x - ctx.min_x, max_y - ctx.min_y);
+            ctx.inv_size = size != 0 ? 32767.0f / size : 0;
+        }
+
+        apTriEarcutLinked(&ctx, outer, 0);
+    }
+
+    // The triangles are created with a positive winding
+    if (apTriSignedArea(vertices, 0, outer_size) < 0)
+    {
+        for (int i = 0; i < ctx.num_indices; i += 3)
+        {
+            int tmp = ctx.indices[i + 1];
+            ctx.indices[i + 1] = ctx.indices[i + 2];
+            ctx.indices[i + 2] = tmp;
+        }
+    }
+
+    free((void*)ctx.nodes);
+    *out_indices = ctx.indices;
+    return ctx.num_indices / 3;
+}
+
+int apTriangulateContours(const apContour* contours, int num_contours, apPosf** out_vertices, int* out_num_vertices, int** out_indices)
+{
+    int num_vertices = 0;
+    for (int i = 0; i < num_contours; ++i)
+        num_vertices += contours[i].num_vertices;
+
+    apPosf* vertices = (apPosf*)malloc(sizeof(apPosf) * (size_t)(num_vertices > 0 ? num_vertices : 1));
+    int* sizes = (int*)malloc(sizeof(int) * (size_t)(num_contours > 0 ? num_contours : 1));
+    int* indices = 0;
+    int num_indices = 0;
+    int num_added = 0;
+
+    for (int i = 0; i < num_contours; ++i)
+    {
+        if (contours[i].parent >= 0)
+            continue;
+        // A hole without an outer contour (the outer contours have a negative area, see apContourFromImage)
+        if (apTriSignedArea(contours[i].vertices, 0, contours[i].num_vertices) > 0)
+            continue;
+
+        // The outer contour, followed by its holes
+        int base = num_added;
+        int num_sizes = 0;
+        for (int j = i; j < num_contours; ++j)
+        {
+            if (j != i && contours[j].parent != i)
+                continue;
+            memcpy(vertices + num_added, contours[j].vertices, sizeof(apPosf) * (size_t)contours[j].num_vertices);
+            num_added += contours[j].num_vertices;
+            sizes[num_sizes++] = contours[j].num_vertices;
+        }
+
+        int* part = 0;
+        int num_triangles = apTriangulate(vertices + base, sizes, num_sizes, &part);
+        indices = (int*)realloc(indices, sizeof(int) * (size_t)(num_indices + num_triangles * 3));
+        for (int t = 0; t < num_triangles * 3; ++t)
+            indices[num_indices++] = base + part[t];
+        free((void*)part);
+    }
+    free((void*)sizes);
+
+    *out_vertices = vertices;
+    *out_num_vertices = num_added;
+    *out_indices = indices;
+    return num_indices / 3;
+}
+
+apPosf* apTriangulateExpand(const apPosf* vertices, const int* indices, int num_triangles)
+{
+    apPosf* triangles = (apPosf*)malloc(sizeof(apPosf) * 3 * (size_t)(num_triangles > 0 ? num_triangles : 1));
+    for (int i = 0; i < num_triangles * 3; ++i)
+        triangles[i] = vertices[indices[i]];
+    return triangles;
+}
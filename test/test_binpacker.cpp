@@ -19,6 +19,7 @@ TEST(PackerBinPack, PackSmall) {
     apPacker* packer = apBinPackerCreate(&packer_options);
 
     apOptions options;
+    apSetDefaultOptions(&options);
     apContext* ctx = apCreate(&options, packer);
 
     Image* image_a = CreateImage("a.png", 0x00FF00FF, 64, 64, 3);
@@ -61,6 +62,909 @@ TEST(PackerBinPack, PackSmall) {
     DestroyImage(image_c);
 }
 
+static uint32_t g_Seed = 0;
+static int RandomInt(int min, int max)
+{
+    g_Seed = g_Seed * 1664525u + 1013904223u;
+    return min + (int)((g_Seed >> 8) % (uint32_t)(max - min + 1));
+}
+
+// Checks that all images are within their page, and that no images overlap
+static int CheckPlacements(apContext* ctx)
+{
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        apImage* a = ctx->images[i];
+        apPage* page = apGetPage(ctx, a->page);
+        if (!page)
+            return 0;
+        if (a->placement.pos.x < 0 || a->placement.pos.y < 0 ||
+            a->placement.pos.x + a->placement.size.width > page->dimensions.width ||
+            a->placement.pos.y + a->placement.size.height > page->dimensions.height)
+        {
+            printf("Image %d is outside of page %d\n", i, a->page);
+            return 0;
+        }
+
+        for (int j = i + 1; j < ctx->num_images; ++j)
+        {
+            apImage* b = ctx->images[j];
+            if (a->page != b->page)
+                continue;
+            if (a->placement.pos.x < b->placement.pos.x + b->placement.size.width &&
+                b->placement.pos.x < a->placement.pos.x + a->placement.size.width &&
+                a->placement.pos.y < b->placement.pos.y + b->placement.size.height &&
+                b->placement.pos.y < a->placement.pos.y + a->placement.size.height)
+            {
+                printf("Image %d overlaps image %d\n", i, j);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static apContext* PackRandomRects(apBinPackerOptions* packer_options, apOptions* options, int num_rects)
+{
+    apPacker* packer = apBinPackerCreate(packer_options);
+    apContext* ctx = apCreate(options, packer);
+
+    g_Seed = 1234;
+    for (int i = 0; i < num_rects; ++i)
+    {
+        apAddImage(ctx, "rect", RandomInt(4, 64), RandomInt(4, 64), 4, 0);
+    }
+
+    apPackImages(ctx);
+    return ctx;
+}
+
+static apContext* PackRandomRects(apBinPackerOptions* packer_options, int num_rects, int page_size)
+{
+    apOptions options;
+    apSetDefaultOptions(&options);
+    options.page_size = page_size;
+    return PackRandomRects(packer_options, &options, num_rects);
+}
+
+static apContext* PackRandomRects(apBinPackMode mode, int num_rects, int page_size)
+{
+    apBinPackerOptions packer_options;
+    apBinPackerSetDefaultOptions(&packer_options);
+    packer_options.mode = mode;
+    return PackRandomRects(&packer_options, num_rects, page_size);
+}
+
+TEST(PackerBinPack, PackMaxRects) {
+    apBinPackMode modes[] = { AP_BP_MAXRECTS_BSSF, AP_BP_MAXRECTS_BAF, AP_BP_MAXRECTS_BL };
+    for (int m = 0; m < (int)(sizeof(modes)/sizeof(modes[0])); ++m)
+    {
+        apContext* ctx = PackRandomRects(modes[m], 10000, 0);
+        ASSERT_EQ(1, apGetNumPages(ctx));
+        ASSERT_TRUE(CheckPlacements(ctx));
+        apPacker* packer = ctx->packer;
+        apDestroy(ctx);
+        apBinPackerDestroy(packer);
+
+        ctx = PackRandomRects(modes[m], 10000, 256);
+        ASSERT_LT(1, apGetNumPages(ctx));
+        ASSERT_TRUE(CheckPlacements(ctx));
+        packer = ctx->packer;
+        apDestroy(ctx);
+        apBinPackerDestroy(packer);
+    }
+}
+
+TEST(PackerBinPack, PackGuillotine) {
+    apContext* ctx = PackRandomRects(AP_BP_GUILLOTINE, 2000, 0);
+    ASSERT_EQ(1, apGetNumPages(ctx));
+    ASSERT_TRUE(CheckPlacements(ctx));
+    apPacker* packer = ctx->packer;
+    apDestroy(ctx);
+    apBinPackerDestroy(packer);
+
+    ctx = PackRandomRects(AP_BP_GUILLOTINE, 2000, 256);
+    ASSERT_LT(1, apGetNumPages(ctx));
+    ASSERT_TRUE(CheckPlacements(ctx));
+    packer = ctx->packer;
+    apDestroy(ctx);
+    apBinPackerDestroy(packer);
+
+    // Without merging, the free list grows with the number of rects
+    apBinPackerOptions packer_options;
+    apBinPackerSetDefaultOptions(&packer_options);
+    packer_options.mode = AP_BP_GUILLOTINE;
+    packer_options.no_merge = 1;
+    ctx = PackRandomRects(&packer_options, 10000, 0);
+    ASSERT_EQ(1, apGetNumPages(ctx));
+    ASSERT_TRUE(CheckPlacements(ctx));
+    packer = ctx->packer;
+    apDestroy(ctx);
+    apBinPackerDestroy(packer);
+}
+
+TEST(PackerBinPack, PackSkylineWasteMap) {
+    apBinPackerOptions packer_options;
+    apBinPackerSetDefaultOptions(&packer_options);
+    packer_options.mode = AP_BP_SKYLINE_BL;
+
+    apContext* ctx = PackRandomRects(&packer_options, 2000, 256);
+    ASSERT_TRUE(CheckPlacements(ctx));
+    int num_pages = apGetNumPages(ctx);
+    apPacker* packer = ctx->packer;
+    apDestroy(ctx);
+    apBinPackerDestroy(packer);
+
+    packer_options.waste_map = 1;
+    ctx = PackRandomRects(&packer_options, 2000, 256);
+    ASSERT_TRUE(CheckPlacements(ctx));
+    ASSERT_GE(num_pages, apGetNumPages(ctx));
+    packer = ctx->packer;
+    apDestroy(ctx);
+    apBinPackerDestroy(packer);
+}
+
+TEST(PackerBinPack, PackBackfillPages) {
+    apBinPackerOptions packer_options;
+    apBinPackerSetDefaultOptions(&packer_options);
+    apPacker* packer = apBinPackerCreate(&packer_options);
+
+    apOptions options;
+    apSetDefaultOptions(&options);
+    options.page_size = 128;
+    apContext* ctx = apCreate(&options, packer);
+
+    apAddImage(ctx, "a", 128, 100, 4, 0);
+    apAddImage(ctx, "b", 128, 100, 4, 0);
+    apAddImage(ctx, "c", 128, 28, 4, 0); // fits on the first page
+
+    apPackImages(ctx);
+
+    ASSERT_EQ(2, apGetNumPages(ctx));
+    ASSERT_TRUE(CheckPlacements(ctx));
+    ASSERT_EQ(0, ctx->images[0]->page);
+    ASSERT_EQ(1, ctx->images[1]->page);
+    ASSERT_EQ(0, ctx->images[2]->page);
+
+    apDestroy(ctx);
+    apBinPackerDestroy(packer);
+}
+
+TEST(PackerBinPack, PageInsert) {
+    apBinPackMode modes[] = { AP_BP_SKYLINE_BL, AP_BP_MAXRECTS_BSSF, AP_BP_GUILLOTINE };
+    for (int m = 0; m < (int)(sizeof(modes)/sizeof(modes[0])); ++m)
+    {
+        apBinPackerOptions packer_options;
+        apBinPackerSetDefaultOptions(&packer_options);
+        packer_options.mode = modes[m];
+        apBinPackerPage* page = apBinPackerPageCreate(&packer_options, 256, 256);
+
+        ASSERT_EQ(0.0f, apBinPackerPageGetOccupancy(page));
+
+        // Glyph sized rects, until the page is full
+        g_Seed = 1234;
+        int num_inserted = 0;
+        int area = 0;
+        apRect rect;
+        while (1)
+        {
+            int width = RandomInt(8, 24);
+            int height = RandomInt(12, 24);
+            if (!apBinPackerPageInsert(page, width, height, &rect))
+                break;
+            ASSERT_EQ(width * height, rect.size.width * rect.size.height);
+            ASSERT_TRUE(rect.pos.x >= 0 && rect.pos.x + rect.size.width <= 256);
+            ASSERT_TRUE(rect.pos.y >= 0 && rect.pos.y + rect.size.height <= 256);
+            area += width * height;
+            ++num_inserted;
+        }
+
+        ASSERT_LT(100, num_inserted);
+        ASSERT_NEAR(area / (256.0f * 256.0f), apBinPackerPageGetOccupancy(page), 0.0001f);
+        ASSERT_LT(0.8f, apBinPackerPageGetOccupancy(page));
+
+        apBinPackerPageReset(page);
+        ASSERT_EQ(0.0f, apBinPackerPageGetOccupancy(page));
+        ASSERT_EQ(1, apBinPackerPageInsert(page, 256, 256, &rect));
+        ASSERT_EQ(0, rect.pos.x);
+        ASSERT_EQ(0, rect.pos.y);
+
+        apBinPackerPageDestroy(page);
+    }
+}
+
+TEST(PackerBinPack, PageInsertLargePage) {
+    // The area of the page doesn't fit in 32 bits
+    const int size = 65536;
+    apBinPackMode modes[] = { AP_BP_MAXRECTS_BAF, AP_BP_GUILLOTINE };
+    for (int m = 0; m < (int)(sizeof(modes)/sizeof(modes[0])); ++m)
+    {
+        apBinPackerOptions packer_options;
+        apBinPackerSetDefaultOptions(&packer_options);
+        packer_options.mode = modes[m];
+        packer_options.no_rotate = 1;
+        apBinPackerPage* page = apBinPackerPageCreate(&packer_options, size, size);
+
+        apRect rect;
+        ASSERT_EQ(1, apBinPackerPageInsert(page, size - 50, 10, &rect));
+        ASSERT_EQ(0, rect.pos.x);
+        ASSERT_EQ(0, rect.pos.y);
+
+        ASSERT_EQ(1, apBinPackerPageInsert(page, 40, 40, &rect));
+        ASSERT_TRUE(rect.pos.x >= 0 && rect.pos.x + rect.size.width <= size);
+        ASSERT_TRUE(rect.pos.y >= 10 || rect.pos.x >= size - 50);
+        if (modes[m] == AP_BP_MAXRECTS_BAF)
+        {
+            // The best area fit is the narrow column to the right of the first rect
+            ASSERT_EQ(size - 50, rect.pos.x);
+            ASSERT_EQ(0, rect.pos.y);
+        }
+
+        apBinPackerPageDestroy(page);
+    }
+}
+
+// The time of an insert grows much slower than the number of free rects
+TEST(PackerBinPack, PageInsertScaling) {
+    for (int merge = 0; merge < 2; ++merge)
+    {
+        apBinPackerOptions packer_options;
+        apBinPackerSetDefaultOptions(&packer_options);
+        packer_options.mode = AP_BP_GUILLOTINE;
+        packer_options.no_merge = !merge;
+        apBinPackerPage* page = apBinPackerPageCreate(&packer_options, 16384, 16384);
+
+        // The time of each batch of 10k inserts
+        const int batch_size = 10000;
+        const int num_batches = 16;
+        uint64_t times[num_batches];
+        g_Seed = 1234;
+        apRect rect;
+        for (int b = 0; b < num_batches; ++b)
+        {
+            uint64_t tstart = GetTime();
+            for (int i = 0; i < batch_size; ++i)
+                ASSERT_EQ(1, apBinPackerPageInsert(page, RandomInt(8, 31), RandomInt(8, 31), &rect));
+            times[b] = GetTime() - tstart;
+        }
+        // The faster of two batches, to be less sensitive to hiccups
+        uint64_t first = times[0] < times[1] ? times[0] : times[1];
+        uint64_t last = times[num_batches - 2] < times[num_batches - 1] ? times[num_batches - 2] : times[num_batches - 1];
+        printf("Guillotine (merge: %d): %.2f us per insert at %d rects, %.2f us at %d rects\n", merge,
+                first / (double)batch_size, 2 * batch_size, last / (double)batch_size, batch_size * num_batches);
+        // With a linear search, the last batches would be about ten times slower
+        ASSERT_LT(last, first * 4 + 10000);
+
+        apBinPackerPageDestroy(page);
+    }
+}
+
+TEST(PackerBinPack, PageInsertWasteMap) {
+    apBinPackerOptions packer_options;
+    apBinPackerSetDefaultOptions(&packer_options);
+    packer_options.mode = AP_BP_SKYLINE_BL;
+    packer_options.waste_map = 1;
+    packer_options.no_rotate = 1;
+    apBinPackerPage* page = apBinPackerPageCreate(&packer_options, 64, 64);
+
+    // The wide rect bridges over the gap to the right of the first one, which goes into the waste map (48 x 8)
+    apRect rect;
+    ASSERT_EQ(1, apBinPackerPageInsert(page, 16, 8, &rect));
+    ASSERT_EQ(1, apBinPackerPageInsert(page, 64, 8, &rect));
+    ASSERT_EQ(8, rect.pos.y);
+    // Fill the skyline to the top
+    ASSERT_EQ(1, apBinPackerPageInsert(page, 64, 48, &rect));
+    ASSERT_EQ(16, rect.pos.y);
+
+    // A failed insert updates the page summary
+    ASSERT_EQ(0, apBinPackerPageInsert(page, 50, 4, &rect));
+
+    // The rect only fits in the waste map
+    ASSERT_EQ(1, apBinPackerPageInsert(page, 40, 8, &rect));
+    ASSERT_EQ(16, rect.pos.x);
+    ASSERT_EQ(0, rect.pos.y);
+
+    apBinPackerPageDestroy(page);
+}
+
+TEST(PackerBinPack, PackTrim) {
+    apBinPackerOptions packer_options;
+    apBinPackerSetDefaultOptions(&packer_options);
+    packer_options.trim = 1;
+    apPacker* packer = apBinPackerCreate(&packer_options);
+
+    apOptions options;
+    apSetDefaultOptions(&options);
+    apContext* ctx = apCreate(&options, packer);
+
+    // A transparent image, with an opaque 20x10 rect in it
+    Image* image_a = CreateImage("a.png", 0x00000000, 64, 64, 4);
+    for (int y = 7; y < 17; ++y)
+    {
+        for (int x = 5; x < 25; ++x)
+        {
+            uint8_t* texel = &image_a->data[(y * 64 + x) * 4];
+            texel[0] = 255;
+            texel[3] = 255;
+        }
+    }
+    Image* image_b = CreateImage("b.png", 0x00FFFFFF, 32, 48, 3);
+
+    apImage* a = apAddImage(ctx, image_a->path, image_a->width, image_a->height, image_a->channels, image_a->data);
+    apImage* b = apAddImage(ctx, image_b->path, image_b->width, image_b->height, image_b->channels, image_b->data);
+
+    apPackImages(ctx);
+
+    ASSERT_TRUE(CheckPlacements(ctx));
+
+    ASSERT_EQ(5, a->trim.pos.x);
+    ASSERT_EQ(7, a->trim.pos.y);
+    ASSERT_EQ(20, a->trim.size.width);
+    ASSERT_EQ(10, a->trim.size.height);
+    ASSERT_EQ(200, a->placement.size.width * a->placement.size.height);
+
+    // No alpha channel, so it's not trimmed
+    ASSERT_EQ(0, b->trim.pos.x);
+    ASSERT_EQ(0, b->trim.pos.y);
+    ASSERT_EQ(32, b->trim.size.width);
+    ASSERT_EQ(48, b->trim.size.height);
+
+    // The trimmed image is rendered at its placement
+    apPage* page = apGetPage(ctx, a->page);
+    int width = page->dimensions.width;
+    int height = page->dimensions.height;
+    uint8_t* output = (uint8_t*)malloc((size_t)(width * height * 4));
+    memset(output, 0, (size_t)(width * height * 4));
+    apRenderImage(output, width, height, 4, a);
+
+    int num_opaque = 0;
+    for (int i = 0; i < width * height; ++i)
+        num_opaque += output[i*4+3] == 255 ? 1 : 0;
+    ASSERT_EQ(200, num_opaque);
+    ASSERT_EQ(255, output[(a->placement.pos.y * width + a->placement.pos.x) * 4 + 3]);
+    free((void*)output);
+
+    DebugWriteOutput(ctx, "pack_trim");
+
+    apDestroy(ctx);
+    apBinPackerDestroy(packer);
+
+    DestroyImage(image_a);
+    DestroyImage(image_b);
+}
+
+TEST(PackerBinPack, PackPaddingExtrude) {
+    apBinPackerOptions packer_options;
+    apBinPackerSetDefaultOptions(&packer_options);
+    packer_options.margin = 1;
+    packer_options.padding = 2;
+    packer_options.extrude = 3;
+    apPacker* packer = apBinPackerCreate(&packer_options);
+
+    apOptions options;
+    apSetDefaultOptions(&options);
+    apContext* ctx = apCreate(&options, packer);
+
+    Image* images[3];
+    images[0] = CreateImage("a.png", 0xFF0000FF, 16, 8, 4);
+    images[1] = CreateImage("b.png", 0xFF00FF00, 8, 24, 4);
+    images[2] = CreateImage("c.png", 0xFFFF0000, 12, 12, 4);
+    for (int i = 0; i < 3; ++i)
+        apAddImage(ctx, images[i]->path, images[i]->width, images[i]->height, images[i]->channels, images[i]->data);
+
+    apPackImages(ctx);
+
+    ASSERT_TRUE(CheckPlacements(ctx));
+
+    // The placements, including the reserved borders, shouldn't touch
+    int inset = packer_options.extrude + packer_options.padding;
+    int border = 2 * inset + packer_options.margin;
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        apImage* a = ctx->images[i];
+        ASSERT_LE(inset, a->placement.pos.x);
+        ASSERT_LE(inset, a->placement.pos.y);
+        ASSERT_EQ(3, a->extrude);
+        for (int j = i + 1; j < ctx->num_images; ++j)
+        {
+            apImage* b = ctx->images[j];
+            int overlap = a->placement.pos.x - inset < b->placement.pos.x - inset + b->placement.size.width + border &&
+                          b->placement.pos.x - inset < a->placement.pos.x - inset + a->placement.size.width + border &&
+                          a->placement.pos.y - inset < b->placement.pos.y - inset + b->placement.size.height + border &&
+                          b->placement.pos.y - inset < a->placement.pos.y - inset + a->placement.size.height + border;
+            ASSERT_FALSE(overlap);
+        }
+    }
+
+    apPage* page = apGetPage(ctx, 0);
+    int width = page->dimensions.width;
+    int height = page->dimensions.height;
+    uint8_t* output = (uint8_t*)malloc((size_t)(width * height * 4));
+    memset(output, 0, (size_t)(width * height * 4));
+    for (int i = 0; i < ctx->num_images; ++i)
+        apRenderImage(output, width, height, 4, ctx->images[i]);
+
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        apImage* image = ctx->images[i];
+        const uint8_t* color = images[i]->data;
+        int x0 = image->placement.pos.x;
+        int y0 = image->placement.pos.y;
+        int x1 = x0 + image->placement.size.width - 1;
+        int y1 = y0 + image->placement.size.height - 1;
+
+        // The extruded corners and borders have the same color as the image
+        const int corners[][2] = { {x0 - 3, y0 - 3}, {x1 + 3, y0 - 3}, {x0 - 3, y1 + 3}, {x1 + 3, y1 + 3}, {x0 - 1, y0}, {x0, y1 + 2} };
+        for (int c = 0; c < 6; ++c)
+        {
+            const uint8_t* texel = &output[(corners[c][1] * width + corners[c][0]) * 4];
+            ASSERT_EQ(0, memcmp(texel, color, 4));
+        }
+
+        // The padding is transparent
+        ASSERT_EQ(0, output[((y0 - 4) * width + x0) * 4 + 3]);
+        ASSERT_EQ(0, output[(y0 * width + x1 + 4) * 4 + 3]);
+    }
+    free((void*)output);
+
+    DebugWriteOutput(ctx, "pack_padding_extrude");
+
+    apDestroy(ctx);
+    apBinPackerDestroy(packer);
+
+    for (int i = 0; i < 3; ++i)
+        DestroyImage(images[i]);
+}
+
+TEST(PackerBinPack, GrowPolicies) {
+    apGrowPolicy policies[] = { AP_GROW_POWER_OF_TWO, AP_GROW_FIXED_STEP, AP_GROW_GOLDEN_RATIO };
+    for (int p = 0; p < (int)(sizeof(policies)/sizeof(policies[0])); ++p)
+    {
+        apBinPackerOptions packer_options;
+        apBinPackerSetDefaultOptions(&packer_options);
+
+        apOptions options;
+        apSetDefaultOptions(&options);
+        options.grow_policy = policies[p];
+        options.grow_step = 32;
+        options.shrink_to_fit = 1;
+
+        apContext* ctx = PackRandomRects(&packer_options, &options, 500);
+        ASSERT_EQ(1, apGetNumPages(ctx));
+        ASSERT_TRUE(CheckPlacements(ctx));
+
+        // The page is cropped to the images
+        apPage* page = apGetPage(ctx, 0);
+        int max_x = 0;
+        int max_y = 0;
+        for (int i = 0; i < ctx->num_images; ++i)
+        {
+            apImage* image = ctx->images[i];
+            if (image->placement.pos.x + image->placement.size.width > max_x)
+                max_x = image->placement.pos.x + image->placement.size.width;
+            if (image->placement.pos.y + image->placement.size.height > max_y)
+                max_y = image->placement.pos.y + image->placement.size.height;
+        }
+        if (policies[p] == AP_GROW_POWER_OF_TWO)
+        {
+            ASSERT_EQ((int)apNextPowerOfTwo((uint32_t)max_x), page->dimensions.width);
+            ASSERT_EQ((int)apNextPowerOfTwo((uint32_t)max_y), page->dimensions.height);
+        }
+        else
+        {
+            ASSERT_EQ(max_x, page->dimensions.width);
+            ASSERT_EQ(max_y, page->dimensions.height);
+        }
+
+        apPacker* packer = ctx->packer;
+        apDestroy(ctx);
+        apBinPackerDestroy(packer);
+    }
+
+    apOptions options;
+    apSetDefaultOptions(&options);
+    apSize size = { 64, 64 };
+    options.grow_policy = AP_GROW_FIXED_STEP;
+    options.grow_step = 24;
+    size = apGrowPageSize(&options, size, 1);
+    ASSERT_EQ(88, size.width);
+    ASSERT_EQ(64, size.height);
+    options.grow_policy = AP_GROW_GOLDEN_RATIO;
+    size = apGrowPageSize(&options, size, 16);
+    ASSERT_EQ(88, size.width);
+    ASSERT_EQ(112, size.height);
+}
+
+TEST(PackerBinPack, MaxPageSize) {
+    apBinPackMode modes[] = { AP_BP_SKYLINE_BL, AP_BP_MAXRECTS_BSSF, AP_BP_GUILLOTINE };
+    for (int m = 0; m < (int)(sizeof(modes)/sizeof(modes[0])); ++m)
+    {
+        apBinPackerOptions packer_options;
+        apBinPackerSetDefaultOptions(&packer_options);
+        packer_options.mode = modes[m];
+
+        apOptions options;
+        apSetDefaultOptions(&options);
+        options.max_page_width = 256;
+        options.max_page_height = 200;
+
+        apContext* ctx = PackRandomRects(&packer_options, &options, 500);
+        ASSERT_LT(1, apGetNumPages(ctx));
+        ASSERT_TRUE(CheckPlacements(ctx));
+        for (int i = 0; i < apGetNumPages(ctx); ++i)
+        {
+            apPage* page = apGetPage(ctx, i);
+            ASSERT_GE(256, page->dimensions.width);
+            ASSERT_GE(200, page->dimensions.height);
+        }
+
+        apPacker* packer = ctx->packer;
+        apDestroy(ctx);
+        apBinPackerDestroy(packer);
+    }
+
+    // An image that can never fit is skipped
+    apBinPackerOptions packer_options;
+    apBinPackerSetDefaultOptions(&packer_options);
+    apPacker* packer = apBinPackerCreate(&packer_options);
+
+    apOptions options;
+    apSetDefaultOptions(&options);
+    options.max_page_width = 64;
+    options.max_page_height = 64;
+    apContext* ctx = apCreate(&options, packer);
+    apImage* small = apAddImage(ctx, "small", 32, 32, 4, 0);
+    apImage* large = apAddImage(ctx, "large", 100, 20, 4, 0);
+    apPackImages(ctx);
+
+    ASSERT_EQ(0, small->page);
+    ASSERT_EQ(-1, large->page);
+    ASSERT_EQ(1, apGetNumPages(ctx));
+
+    apDestroy(ctx);
+    apBinPackerDestroy(packer);
+}
+
+TEST(PackerBinPack, SearchPageSize) {
+    apGrowPolicy policies[] = { AP_GROW_POWER_OF_TWO, AP_GROW_FIXED_STEP };
+    apBinPackMode modes[] = { AP_BP_SKYLINE_BL, AP_BP_MAXRECTS_BSSF };
+    for (int p = 0; p < (int)(sizeof(policies)/sizeof(policies[0])); ++p)
+    {
+        for (int m = 0; m < (int)(sizeof(modes)/sizeof(modes[0])); ++m)
+        {
+            apBinPackerOptions packer_options;
+            apBinPackerSetDefaultOptions(&packer_options);
+            packer_options.mode = modes[m];
+
+            apOptions options;
+            apSetDefaultOptions(&options);
+            options.grow_policy = policies[p];
+
+            // The default growing page
+            apContext* ctx = PackRandomRects(&packer_options, &options, 500);
+            apPage* page = apGetPage(ctx, 0);
+            int64_t grown_area = (int64_t)page->dimensions.width * page->dimensions.height;
+            apPacker* packer = ctx->packer;
+            apDestroy(ctx);
+            apBinPackerDestroy(packer);
+
+            packer_options.search_page_size = 1;
+            ctx = PackRandomRects(&packer_options, &options, 500);
+            ASSERT_EQ(1, apGetNumPages(ctx));
+            ASSERT_TRUE(CheckPlacements(ctx));
+
+            page = apGetPage(ctx, 0);
+            int64_t area = (int64_t)page->dimensions.width * page->dimensions.height;
+            ASSERT_LE(area, grown_area);
+            if (policies[p] == AP_GROW_POWER_OF_TWO)
+            {
+                ASSERT_EQ((int)apNextPowerOfTwo((uint32_t)page->dimensions.width), page->dimensions.width);
+                ASSERT_EQ((int)apNextPowerOfTwo((uint32_t)page->dimensions.height), page->dimensions.height);
+            }
+
+            // The result doesn't depend on the number of threads
+            apSize size = page->dimensions;
+            packer = ctx->packer;
+            apDestroy(ctx);
+            apBinPackerDestroy(packer);
+
+            packer_options.num_threads = 1;
+            ctx = PackRandomRects(&packer_options, &options, 500);
+            page = apGetPage(ctx, 0);
+            ASSERT_EQ(size.width, page->dimensions.width);
+            ASSERT_EQ(size.height, page->dimensions.height);
+            packer = ctx->packer;
+            apDestroy(ctx);
+            apBinPackerDestroy(packer);
+        }
+    }
+}
+
+TEST(PackerBinPack, SearchPageSizeLarge) {
+    // The stacked height of the rects times the page width doesn't fit in an int.
+    // All modes fit the rects into the same page size
+    apBinPackMode modes[] = { AP_BP_MAXRECTS_BSSF, AP_BP_MAXRECTS_BAF, AP_BP_MAXRECTS_BL };
+    apSize sizes[3];
+    for (int m = 0; m < (int)(sizeof(modes)/sizeof(modes[0])); ++m)
+    {
+        apBinPackerOptions packer_options;
+        apBinPackerSetDefaultOptions(&packer_options);
+        packer_options.mode = modes[m];
+        packer_options.search_page_size = 1;
+        apPacker* packer = apBinPackerCreate(&packer_options);
+
+        apOptions options;
+        apSetDefaultOptions(&options);
+        apContext* ctx = apCreate(&options, packer);
+        for (int i = 0; i < 2000; ++i)
+            apAddImage(ctx, "rect", 256, 256, 4, 0);
+        apPackImages(ctx);
+
+        ASSERT_EQ(1, apGetNumPages(ctx));
+        ASSERT_TRUE(CheckPlacements(ctx));
+        sizes[m] = apGetPage(ctx, 0)->dimensions;
+        ASSERT_EQ(sizes[0].width, sizes[m].width);
+        ASSERT_EQ(sizes[0].height, sizes[m].height);
+
+        apDestroy(ctx);
+        apBinPackerDestroy(packer);
+    }
+}
+
+TEST(PackerBinPack, Groups) {
+    apBinPackMode modes[] = { AP_BP_SKYLINE_BL, AP_BP_MAXRECTS_BSSF, AP_BP_GUILLOTINE };
+    for (int m = 0; m < (int)(sizeof(modes)/sizeof(modes[0])); ++m)
+    {
+        apBinPackerOptions packer_options;
+        apBinPackerSetDefaultOptions(&packer_options);
+        packer_options.mode = modes[m];
+        packer_options.waste_map = 1;
+        apPacker* packer = apBinPackerCreate(&packer_options);
+
+        apOptions options;
+        apSetDefaultOptions(&options);
+        options.max_page_width = 256;
+        options.max_page_height = 256;
+        apContext* ctx = apCreate(&options, packer);
+
+        // The groups are interleaved, and each one is a bit less than a quarter of a page
+        const int num_groups = 10;
+        g_Seed = 1234;
+        for (int i = 0; i < 300; ++i)
+        {
+            apAddImageToGroup(ctx, "rect", RandomInt(8, 24), RandomInt(8, 24), 4, 0, 1 + (i % num_groups));
+        }
+        // Some ungrouped images as well
+        for (int i = 0; i < 50; ++i)
+        {
+            apAddImage(ctx, "rect", RandomInt(4, 32), RandomInt(4, 32), 4, 0);
+        }
+
+        apImage** added = (apImage**)malloc(sizeof(apImage*) * (size_t)ctx->num_images);
+        memcpy(added, ctx->images, sizeof(apImage*) * (size_t)ctx->num_images);
+
+        apPackImages(ctx);
+        ASSERT_TRUE(CheckPlacements(ctx));
+
+        // The images keep the order they were added in
+        ASSERT_EQ(0, memcmp(added, ctx->images, sizeof(apImage*) * (size_t)ctx->num_images));
+        free((void*)added);
+        ASSERT_LT(1, apGetNumPages(ctx));
+
+        apStats stats;
+        apGetStats(ctx, &stats);
+        ASSERT_EQ(350, stats.num_images);
+        ASSERT_EQ(apGetNumPages(ctx), stats.num_pages);
+        ASSERT_EQ(num_groups, stats.num_groups);
+        ASSERT_EQ(0, stats.num_split_groups);
+        ASSERT_EQ(1, stats.max_group_pages);
+        for (int g = 1; g <= num_groups; ++g)
+        {
+            ASSERT_EQ(1, apGetGroupNumPages(ctx, g));
+        }
+
+        apDestroy(ctx);
+        apBinPackerDestroy(packer);
+    }
+
+    // A group that is too large for a page is spread over several pages
+    apBinPackerOptions packer_options;
+    apBinPackerSetDefaultOptions(&packer_options);
+    apPacker* packer = apBinPackerCreate(&packer_options);
+
+    apOptions options;
+    apSetDefaultOptions(&options);
+    options.page_size = 64;
+    apContext* ctx = apCreate(&options, packer);
+    for (int i = 0; i < 6; ++i)
+    {
+        apAddImageToGroup(ctx, "rect", 32, 32, 4, 0, 7);
+    }
+    apPackImages(ctx);
+    ASSERT_TRUE(CheckPlacements(ctx));
+
+    apStats stats;
+    apGetStats(ctx, &stats);
+    ASSERT_EQ(1, stats.num_groups);
+    ASSERT_EQ(1, stats.num_split_groups);
+    ASSERT_EQ(2, stats.max_group_pages);
+    ASSERT_EQ(2, apGetGroupNumPages(ctx, 7));
+
+    apDestroy(ctx);
+    apBinPackerDestroy(packer);
+
+    // A group that never fits a page doesn't leave an empty page behind,
+    // when its images fit in the gaps of the previous pages
+    packer = apBinPackerCreate(&packer_options);
+    ctx = apCreate(&options, packer);
+    for (int i = 0; i < 3; ++i)
+    {
+        apAddImage(ctx, "rect", 64, 40, 4, 0);
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        apAddImageToGroup(ctx, "rect", 64, 24, 4, 0, 3);
+    }
+    apPackImages(ctx);
+    ASSERT_TRUE(CheckPlacements(ctx));
+    ASSERT_EQ(3, apGetNumPages(ctx));
+    for (int i = 0; i < apGetNumPages(ctx); ++i)
+    {
+        ASSERT_TRUE(apGetPage(ctx, i)->first_image != 0);
+    }
+
+    apDestroy(ctx);
+    apBinPackerDestroy(packer);
+}
+
+static apContext* PackWeightedRects(int use_weights)
+{
+    apBinPackerOptions packer_options;
+    apBinPackerSetDefaultOptions(&packer_options);
+    apPacker* packer = apBinPackerCreate(&packer_options);
+
+    apOptions options;
+    apSetDefaultOptions(&options);
+    options.page_size = 128;
+    apContext* ctx = apCreate(&options, packer);
+
+    // Every 10th image is frequently used
+    g_Seed = 1234;
+    for (int i = 0; i < 200; ++i)
+    {
+        apImage* image = apAddImage(ctx, "rect", RandomInt(4, 32), RandomInt(4, 32), 4, 0);
+        if (use_weights)
+            image->weight = (i % 10) == 0 ? 100.0f : 1.0f;
+    }
+
+    apPackImages(ctx);
+    return ctx;
+}
+
+TEST(PackerBinPack, Weights) {
+    apContext* ctx = PackWeightedRects(0);
+    ASSERT_TRUE(CheckPlacements(ctx));
+    apStats stats_unweighted;
+    apGetStats(ctx, &stats_unweighted);
+    apPacker* packer = ctx->packer;
+    apDestroy(ctx);
+    apBinPackerDestroy(packer);
+
+    ctx = PackWeightedRects(1);
+    ASSERT_TRUE(CheckPlacements(ctx));
+    ASSERT_LT(1, apGetNumPages(ctx));
+
+    // All the hot images fit on the first page
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        apImage* image = ctx->images[i];
+        if (image->weight > 1.0f)
+            ASSERT_EQ(0, image->page);
+    }
+
+    apStats stats;
+    apGetStats(ctx, &stats);
+    ASSERT_EQ(stats_unweighted.num_pages, stats.num_pages);
+    ASSERT_LT(0.5f, stats.page0_residency);
+    ASSERT_LT(0.0f, stats.occupancy);
+    ASSERT_GE(1.0f, stats.occupancy);
+
+    // Without weights, each image weighs the same
+    ASSERT_GT(0.5f, stats_unweighted.page0_residency);
+
+    packer = ctx->packer;
+    apDestroy(ctx);
+    apBinPackerDestroy(packer);
+}
+
+// Checks that no page mixes images from different classes
+static int CheckPageChannels(apContext* ctx, apChannelPolicy policy)
+{
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        apImage* a = ctx->images[i];
+        apPage* page = apGetPage(ctx, a->page);
+        int num_channels = (a->channels == 4 && !a->has_alpha) ? 3 : a->channels;
+        if (page->num_channels < num_channels)
+            return 0;
+
+        for (int j = i + 1; j < ctx->num_images; ++j)
+        {
+            apImage* b = ctx->images[j];
+            if (a->page != b->page)
+                continue;
+            if (policy == AP_CHANNELS_SEPARATE && a->channels != b->channels)
+                return 0;
+            if (policy == AP_CHANNELS_SEPARATE_ALPHA && a->has_alpha != b->has_alpha)
+                return 0;
+        }
+    }
+    return 1;
+}
+
+TEST(PackerBinPack, ChannelPolicy) {
+    // Opaque RGB, opaque RGBA and translucent RGBA images
+    const int num_images = 60;
+    Image* images[num_images];
+    g_Seed = 4321;
+    for (int i = 0; i < num_images; ++i)
+    {
+        int w = RandomInt(8, 48);
+        int h = RandomInt(8, 48);
+        if (i % 3 == 0)
+            images[i] = CreateImage("rgb", 0x204080, w, h, 3);
+        else if (i % 3 == 1)
+            images[i] = CreateImage("opaque", 0xFF204080, w, h, 4);
+        else
+            images[i] = CreateImage("alpha", 0x80204080, w, h, 4);
+    }
+
+    apChannelPolicy policies[] = { AP_CHANNELS_MIXED, AP_CHANNELS_SEPARATE, AP_CHANNELS_SEPARATE_ALPHA };
+    int num_pages[3];
+    for (int p = 0; p < 3; ++p)
+    {
+        apBinPackerOptions packer_options;
+        apBinPackerSetDefaultOptions(&packer_options);
+        apPacker* packer = apBinPackerCreate(&packer_options);
+
+        apOptions options;
+        apSetDefaultOptions(&options);
+        options.channel_policy = policies[p];
+        apContext* ctx = apCreate(&options, packer);
+        for (int i = 0; i < num_images; ++i)
+            apAddImage(ctx, images[i]->path, images[i]->width, images[i]->height, images[i]->channels, images[i]->data);
+
+        apPackImages(ctx);
+        ASSERT_EQ(num_images, ctx->num_images);
+        ASSERT_TRUE(CheckPlacements(ctx));
+        ASSERT_TRUE(CheckPageChannels(ctx, policies[p]));
+        for (int i = 0; i < num_images; ++i)
+            ASSERT_EQ(strcmp(ctx->images[i]->path, "alpha") == 0 ? 1 : 0, ctx->images[i]->has_alpha);
+        num_pages[p] = apGetNumPages(ctx);
+
+        if (policies[p] == AP_CHANNELS_MIXED)
+        {
+            ASSERT_EQ(1, num_pages[p]);
+            ASSERT_EQ(4, apGetPage(ctx, 0)->num_channels);
+        }
+        else if (policies[p] == AP_CHANNELS_SEPARATE_ALPHA)
+        {
+            // The opaque images only need an RGB page
+            ASSERT_EQ(2, num_pages[p]);
+            ASSERT_EQ(3, apGetPage(ctx, 0)->num_channels);
+            ASSERT_EQ(4, apGetPage(ctx, 1)->num_channels);
+        }
+
+        apDestroy(ctx);
+        apBinPackerDestroy(packer);
+    }
+    // RGB, RGBA
+    ASSERT_EQ(2, num_pages[1]);
+
+    for (int i = 0; i < num_images; ++i)
+        DestroyImage(images[i]);
+}
+
 // Sorted on size
 static const char* spineboy_files[] = {
 "examples/spineboy/rear-thigh.png",
@@ -123,6 +1027,7 @@ TEST(PackerBinPack, PackSpineboy) {
     apPacker* packer = apBinPackerCreate(&packer_options);
 
     apOptions options;
+    apSetDefaultOptions(&options);
     apContext* ctx = apCreate(&options, packer);
 
     for (int i = 0; i < num_images; ++i)
@@ -288,7 +1193,9 @@ int main(int argc, char **argv)
 
         for (int i = 1; i < argc; ++i)
         {
-            // CHECK_NAME("-p", "--padding")   { packer_options.padding         = atoi(argv[++i]); continue; }
+            CHECK_NAME("-p", "--padding")   { packer_options.padding         = atoi(argv[++i]); continue; }
+            CHECK_NAME("-m", "--margin")    { packer_options.margin          = atoi(argv[++i]); continue; }
+            CHECK_NAME("-e", "--extrude")   { packer_options.extrude         = atoi(argv[++i]); continue; }
             CHECK_NAME("-s", "--size")      { options.page_size              = atoi(argv[++i]); continue; }
             CHECK_NAME("-d", "--dir")       { dir_path                       = argv[++i]; continue; }
             CHECK_NAME("-o", "--output")    { outname                        = argv[++i]; continue; }
@@ -305,7 +1212,9 @@ int main(int argc, char **argv)
         printf("Dir:                %s\n", dir_path?dir_path:"none");
         printf("Output:             %s\n", outname);
         printf("page_size:          %d\n", options.page_size);
-        //printf("padding:            %d\n", packer_options.padding);
+        printf("padding:            %d\n", packer_options.padding);
+        printf("margin:             %d\n", packer_options.margin);
+        printf("extrude:            %d\n", packer_options.extrude);
 
         if (!dir_path)
         {
@@ -0,0 +1,261 @@
+#include <memory.h>
+#include <math.h>
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test.h>
+
+extern "C" {
+#include <stb_wrappers.h>
+#include <atlaspacker/contour.h>
+#include "utils.h"
+}
+
+static float ContourArea(const apContour* contour)
+{
+    float area = 0.0f;
+    for (int i = 0; i < contour->num_vertices; ++i)
+    {
+        const apPosf& a = contour->vertices[i];
+        const apPosf& b = contour->vertices[(i+1) % contour->num_vertices];
+        area += a.x * b.y - b.x * a.y;
+    }
+    return area * 0.5f;
+}
+
+static int IsInside(const apContour* contour, float x, float y)
+{
+    int inside = 0;
+    for (int i = 0, j = contour->num_vertices - 1; i < contour->num_vertices; j = i++)
+    {
+        const apPosf& a = contour->vertices[i];
+        const apPosf& b = contour->vertices[j];
+        if (((a.y > y) != (b.y > y)) && (x < (b.x - a.x) * (y - a.y) / (b.y - a.y) + a.x))
+            inside = !inside;
+    }
+    return inside;
+}
+
+static float DistanceToContour(const apContour* contour, apPosf p)
+{
+    float min_distance = 1000000.0f;
+    for (int i = 0; i < contour->num_vertices; ++i)
+    {
+        apPosf a = contour->vertices[i];
+        apPosf b = contour->vertices[(i+1) % contour->num_vertices];
+        apPosf ab = { b.x - a.x, b.y - a.y };
+        float t = ((p.x - a.x) * ab.x + (p.y - a.y) * ab.y) / (ab.x * ab.x + ab.y * ab.y);
+        t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+        float dx = a.x + ab.x * t - p.x;
+        float dy = a.y + ab.y * t - p.y;
+        float distance = sqrtf(dx * dx + dy * dy);
+        if (distance < min_distance)
+            min_distance = distance;
+    }
+    return min_distance;
+}
+
+// The exact contours cover exactly the non empty texels
+static int CheckExact(const apContour* contours, int num_contours, const uint8_t* mask, int width, int height)
+{
+    int num_set = 0;
+    float area = 0.0f;
+    for (int i = 0; i < num_contours; ++i)
+    {
+        float contour_area = ContourArea(&contours[i]);
+        if ((contours[i].parent < 0) != (contour_area < 0.0f))
+        {
+            printf("Contour %d has the wrong winding\n", i);
+            return 0;
+        }
+        area += contour_area;
+    }
+
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            int inside = 0;
+            for (int i = 0; i < num_contours; ++i)
+                inside ^= IsInside(&contours[i], x + 0.5f, y + 0.5f);
+            if (inside != mask[y * width + x])
+            {
+                printf("Texel %d, %d: expected %d\n", x, y, mask[y * width + x]);
+                return 0;
+            }
+            num_set += mask[y * width + x];
+        }
+    }
+    if (-area != (float)num_set)
+    {
+        printf("Area %f != %d\n", -area, num_set);
+        return 0;
+    }
+    return 1;
+}
+
+// All non empty texels are inside an outer contour, and outside the holes
+static int CheckCovered(const apContour* contours, int num_contours, const uint8_t* mask, int width, int height)
+{
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            if (!mask[y * width + x])
+                continue;
+
+            int covered = 0;
+            for (int i = 0; i < num_contours; ++i)
+            {
+                int inside = IsInside(&contours[i], x + 0.5f, y + 0.5f);
+                if (inside && contours[i].parent >= 0)
+                {
+                    printf("Texel %d, %d is inside hole %d\n", x, y, i);
+                    return 0;
+                }
+                covered |= inside;
+            }
+            if (!covered)
+            {
+                printf("Texel %d, %d isn't covered\n", x, y);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+TEST(Contour, Simple)
+{
+    const int width = 8;
+    const int height = 8;
+    uint8_t mask[width * height];
+
+    // A single texel
+    memset(mask, 0, sizeof(mask));
+    mask[2 * width + 3] = 1;
+    apContour* contours = 0;
+    int num_contours = apContourFromImage(mask, width, height, &contours);
+    ASSERT_EQ(1, num_contours);
+    ASSERT_EQ(4, contours[0].num_vertices);
+    ASSERT_EQ(-1, contours[0].parent);
+    ASSERT_EQ(-1.0f, ContourArea(&contours[0]));
+    apContourDestroy(contours, num_contours);
+
+    // Empty
+    memset(mask, 0, sizeof(mask));
+    ASSERT_EQ(0, apContourFromImage(mask, width, height, &contours));
+
+    // Full
+    memset(mask, 1, sizeof(mask));
+    num_contours = apContourFromImage(mask, width, height, &contours);
+    ASSERT_EQ(1, num_contours);
+    ASSERT_EQ(4, contours[0].num_vertices);
+    ASSERT_EQ(-64.0f, ContourArea(&contours[0]));
+    apContourDestroy(contours, num_contours);
+
+    // Square with a hole
+    memset(mask, 0, sizeof(mask));
+    for (int y = 1; y < 7; ++y)
+        for (int x = 1; x < 7; ++x)
+            mask[y * width + x] = (x == 1 || x == 6 || y == 1 || y == 6) ? 1 : 0;
+    num_contours = apContourFromImage(mask, width, height, &contours);
+    ASSERT_EQ(2, num_contours);
+    ASSERT_EQ(-1, contours[0].parent);
+    ASSERT_EQ(0, contours[1].parent);
+    ASSERT_EQ(-36.0f, ContourArea(&contours[0]));
+    ASSERT_EQ(16.0f, ContourArea(&contours[1]));
+    ASSERT_TRUE(CheckExact(contours, num_contours, mask, width, height));
+    apContourDestroy(contours, num_contours);
+
+    // Texels that touch diagonally are separate
+    memset(mask, 0, sizeof(mask));
+    mask[1 * width + 1] = 1;
+    mask[2 * width + 2] = 1;
+    mask[1 * width + 3] = 1;
+    mask[3 * width + 1] = 1;
+    mask[3 * width + 3] = 1;
+    num_contours = apContourFromImage(mask, width, height, &contours);
+    ASSERT_EQ(5, num_contours);
+    ASSERT_TRUE(CheckExact(contours, num_contours, mask, width, height));
+    apContourDestroy(contours, num_contours);
+
+    // A diagonal ring of texels around a single empty texel
+    memset(mask, 0, sizeof(mask));
+    mask[2 * width + 3] = 1;
+    mask[3 * width + 2] = 1;
+    mask[3 * width + 4] = 1;
+    mask[4 * width + 3] = 1;
+    num_contours = apContourFromImage(mask, width, height, &contours);
+    ASSERT_EQ(4, num_contours);
+    ASSERT_TRUE(CheckExact(contours, num_contours, mask, width, height));
+    apContourDestroy(contours, num_contours);
+}
+
+static const char* contour_files[] = {
+    "examples/contour/solid.png",
+    "examples/contour/square_hollow.png",
+    "examples/contour/f.png",
+    "examples/contour/lines.png",
+    "examples/spineboy/head.png",
+    "examples/spineboy/gun.png",
+};
+
+TEST(Contour, Images)
+{
+    for (int f = 0; f < (int)(sizeof(contour_files)/sizeof(contour_files[0])); ++f)
+    {
+        Image* image = LoadImage(contour_files[f]);
+        ASSERT_NE((Image*)0, image);
+        uint8_t* mask = CreateMask(image);
+
+        uint64_t tstart = GetTime();
+        apContour* contours = 0;
+        int num_contours = apContourFromImage(mask, image->width, image->height, &contours);
+        uint64_t tend = GetTime();
+        ASSERT_LT(0, num_contours);
+        ASSERT_TRUE(CheckExact(contours, num_contours, mask, image->width, image->height));
+
+        int num_holes = 0;
+        int num_vertices = 0;
+        for (int i = 0; i < num_contours; ++i)
+        {
+            num_holes += contours[i].parent >= 0 ? 1 : 0;
+            num_vertices += contours[i].num_vertices;
+        }
+        if (strstr(contour_files[f], "square_hollow"))
+            ASSERT_LT(0, num_holes);
+
+        // Keep a copy of the exact contours to measure the error
+        apContour* exact = 0;
+        int num_exact = apContourFromImage(mask, image->width, image->height, &exact);
+
+        const float max_error = 1.5f;
+        apContourSimplify(contours, num_contours, mask, image->width, image->height, max_error);
+        ASSERT_TRUE(CheckCovered(contours, num_contours, mask, image->width, image->height));
+
+        int num_simplified = 0;
+        for (int i = 0; i < num_contours; ++i)
+        {
+            ASSERT_LE(3, contours[i].num_vertices);
+            ASSERT_LE(contours[i].num_vertices, exact[i].num_vertices);
+            for (int v = 0; v < exact[i].num_vertices; ++v)
+                ASSERT_GE(max_error + 0.001f, DistanceToContour(&contours[i], exact[i].vertices[v]));
+            num_simplified += contours[i].num_vertices;
+        }
+        ASSERT_LE(num_simplified, num_vertices);
+
+        printf("%s: %d contours (%d holes), %d vertices, %d simplified. Took %.3f ms\n", contour_files[f],
+                num_contours, num_holes, num_vertices, num_simplified, (tend-tstart)/1000.0f);
+
+        apContourDestroy(exact, num_exact);
+        apContourDestroy(contours, num_contours);
+        free((void*)mask);
+        DestroyImage(image);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
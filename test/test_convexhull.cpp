@@ -1,4 +1,6 @@
 #include <memory.h>
+#include <math.h>
+#include <stdlib.h>
 
 #define JC_TEST_IMPLEMENTATION
 #include <jc_test.h>
@@ -82,6 +84,419 @@ TEST(HullConvex, CreateHull)
     DestroyImage(image);
 }
 
+// Checks that the hull contains all the texels, and that each edge touches a texel
+static int CheckHull(const apPosf* vertices, int num_vertices, const uint8_t* image, int width, int height)
+{
+    float area = 0.0f;
+    for (int i = 0; i < num_vertices; ++i)
+    {
+        const apPosf& a = vertices[i];
+        const apPosf& b = vertices[(i+1) % num_vertices];
+        area += a.x * b.y - b.x * a.y;
+    }
+    float sign = area < 0.0f ? -1.0f : 1.0f;
+
+    const float epsilon = 0.01f;
+    for (int i = 0; i < num_vertices; ++i)
+    {
+        apPosf a = { (vertices[i].x + 0.5f) * width, (vertices[i].y + 0.5f) * height };
+        int j = (i+1) % num_vertices;
+        apPosf b = { (vertices[j].x + 0.5f) * width, (vertices[j].y + 0.5f) * height };
+        apPosf edge = { b.x - a.x, b.y - a.y };
+        float length = sqrtf(edge.x * edge.x + edge.y * edge.y);
+        if (length < 0.001f)
+            continue;
+        // Outward normal
+        apPosf n = { sign * edge.y / length, -sign * edge.x / length };
+
+        float max_distance = -1000000.0f;
+        for (int y = 0; y <= height; ++y)
+        {
+            for (int x = 0; x <= width; ++x)
+            {
+                // Corners of the non empty texels
+                int occupied = (x < width && y < height && image[y * width + x]) ||
+                               (x > 0 && y < height && image[y * width + x - 1]) ||
+                               (x < width && y > 0 && image[(y-1) * width + x]) ||
+                               (x > 0 && y > 0 && image[(y-1) * width + x - 1]);
+                if (!occupied)
+                    continue;
+                float distance = n.x * (x - a.x) + n.y * (y - a.y);
+                if (distance > epsilon)
+                {
+                    printf("Texel corner %d, %d is outside edge %d (%f)\n", x, y, i, distance);
+                    return 0;
+                }
+                if (distance > max_distance)
+                    max_distance = distance;
+            }
+        }
+        if (max_distance < -epsilon)
+        {
+            printf("Edge %d doesn't touch the image (%f)\n", i, max_distance);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+TEST(HullConvex, CreateHullTight)
+{
+    const char* paths[] = { "examples/spineboy/hoverboard-board.png", "examples/spineboy/gun.png", "examples/spineboy/head.png" };
+    for (int i = 0; i < (int)(sizeof(paths)/sizeof(paths[0])); ++i)
+    {
+        Image* image = LoadImage(paths[i]);
+        ASSERT_NE((Image*)0, image);
+        uint8_t* hull_image = apCreateHullImage(image->data, (uint32_t)image->width, (uint32_t)image->height, (uint32_t)image->channels, 0);
+
+        // Both table normals and calculated normals
+        int plane_counts[] = {4, 6, 8, 12, 16, 32};
+        for (int k = 0; k < (int)(sizeof(plane_counts)/sizeof(plane_counts[0])); ++k)
+        {
+            int num_vertices = 0;
+            apPosf* vertices = apConvexHullFromImage(plane_counts[k], hull_image, image->width, image->height, &num_vertices);
+            ASSERT_NE((apPosf*)0, vertices);
+            ASSERT_EQ(plane_counts[k], num_vertices);
+            ASSERT_TRUE(CheckHull(vertices, num_vertices, hull_image, image->width, image->height));
+            free((void*)vertices);
+        }
+
+        free((void*)hull_image);
+        DestroyImage(image);
+    }
+
+    // Empty images have no hull
+    uint8_t empty[16*16] = {0};
+    int num_vertices = 0;
+    ASSERT_EQ((apPosf*)0, apConvexHullFromImage(8, empty, 16, 16, &num_vertices));
+
+    // A large sprite (a disc)
+    int size = 2048;
+    uint8_t* disc = (uint8_t*)malloc((size_t)(size*size));
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            int dx = x - size/2;
+            int dy = y - size/2;
+            disc[y * size + x] = (dx*dx + dy*dy) < (size/2 - 8) * (size/2 - 8) ? 1 : 0;
+        }
+    }
+    uint64_t tstart = GetTime();
+    apPosf* vertices = apConvexHullFromImage(16, disc, size, size, &num_vertices);
+    uint64_t tend = GetTime();
+    printf("Hull of %d x %d image took %.3f ms\n", size, size, (tend-tstart)/1000.0f);
+    ASSERT_NE((apPosf*)0, vertices);
+    free((void*)vertices);
+    free((void*)disc);
+}
+
+static float HullArea(const apPosf* vertices, int num_vertices, int width, int height)
+{
+    float area = 0.0f;
+    for (int i = 0; i < num_vertices; ++i)
+    {
+        const apPosf& a = vertices[i];
+        const apPosf& b = vertices[(i+1) % num_vertices];
+        area += a.x * b.y - b.x * a.y;
+    }
+    return area * 0.5f * width * height;
+}
+
+TEST(HullConvex, CreateHullAdaptive)
+{
+    const char* paths[] = { "examples/spineboy/hoverboard-board.png", "examples/spineboy/gun.png", "examples/spineboy/head.png" };
+    for (int i = 0; i < (int)(sizeof(paths)/sizeof(paths[0])); ++i)
+    {
+        Image* image = LoadImage(paths[i]);
+        ASSERT_NE((Image*)0, image);
+        uint8_t* hull_image = apCreateHullImage(image->data, (uint32_t)image->width, (uint32_t)image->height, (uint32_t)image->channels, 0);
+
+        // The exact hull
+        int num_exact = 0;
+        apPosf* exact = apConvexHullFromImageAdaptive(hull_image, image->width, image->height, 1000, 0.0f, &num_exact);
+        ASSERT_NE((apPosf*)0, exact);
+        ASSERT_TRUE(CheckHull(exact, num_exact, hull_image, image->width, image->height));
+        float exact_area = HullArea(exact, num_exact, image->width, image->height);
+
+        // Same winding as the plane based hulls, and never larger
+        int num_planes = 0;
+        apPosf* planes = apConvexHullFromImage(16, hull_image, image->width, image->height, &num_planes);
+        float planes_area = HullArea(planes, num_planes, image->width, image->height);
+        ASSERT_GT(0.0f, exact_area);
+        ASSERT_GT(0.0f, planes_area);
+        ASSERT_LE(planes_area, exact_area + 0.01f);
+
+        int max_vertices[] = {4, 6, 8};
+        float prev_area = exact_area;
+        for (int k = 2; k >= 0; --k)
+        {
+            int num_vertices = 0;
+            apPosf* vertices = apConvexHullFromImageAdaptive(hull_image, image->width, image->height, max_vertices[k], 0.0f, &num_vertices);
+            ASSERT_LE(num_vertices, max_vertices[k]);
+            ASSERT_TRUE(CheckHull(vertices, num_vertices, hull_image, image->width, image->height));
+            float area = HullArea(vertices, num_vertices, image->width, image->height);
+            ASSERT_LE(area, prev_area + 0.01f); // more vertices never gives a larger area
+            prev_area = area;
+            free((void*)vertices);
+        }
+
+        // A high vertex cost gives few vertices
+        int num_vertices = 0;
+        apPosf* vertices = apConvexHullFromImageAdaptive(hull_image, image->width, image->height, 1000, 100000.0f, &num_vertices);
+        ASSERT_GE(4, num_vertices);
+        ASSERT_TRUE(CheckHull(vertices, num_vertices, hull_image, image->width, image->height));
+        free((void*)vertices);
+
+        printf("%s: exact hull: %d vertices, %.1f texels, 16 planes: %.1f texels\n", paths[i], num_exact, -exact_area, -planes_area);
+
+        free((void*)planes);
+        free((void*)exact);
+        free((void*)hull_image);
+        DestroyImage(image);
+    }
+
+    // A box only needs 4 vertices
+    const int size = 64;
+    uint8_t* data = (uint8_t*)malloc(size*size);
+    memset(data, 0, size*size);
+    for (int y = 8; y < 40; ++y)
+        memset(data + y * size + 4, 1, 50);
+    int num_vertices = 0;
+    apPosf* vertices = apConvexHullFromImageAdaptive(data, size, size, 16, 0.0f, &num_vertices);
+    ASSERT_EQ(4, num_vertices);
+    ASSERT_NEAR(-32.0f * 50.0f, HullArea(vertices, num_vertices, size, size), 0.1f);
+    free((void*)vertices);
+
+    // A diamond gets a tighter fit than its bounding box
+    memset(data, 0, size*size);
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+            data[y * size + x] = (abs(x - size/2) + abs(y - size/2)) < size/2 ? 1 : 0;
+    }
+    vertices = apConvexHullFromImageAdaptive(data, size, size, 16, 16.0f, &num_vertices);
+    ASSERT_GE(8, num_vertices);
+    ASSERT_TRUE(CheckHull(vertices, num_vertices, data, size, size));
+    ASSERT_GT(0.6f * size * size, -HullArea(vertices, num_vertices, size, size));
+    free((void*)vertices);
+    free((void*)data);
+}
+
+// The previous greedy decomposition, to compare the box count against
+static int GreedyCountBoxes(int width, int height, const uint8_t* image)
+{
+    uint8_t* data = (uint8_t*)malloc((size_t)width * (size_t)height);
+    for (int i = 0; i < width * height; ++i)
+        data[i] = image[i] ? 1 : 0;
+
+    int num_boxes = 0;
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            if (data[y*width+x] != 1)
+                continue;
+            int bwidth = 1;
+            int bheight = 1;
+            while (1)
+            {
+                int growx = x + bwidth < width;
+                for (int by = y; growx && by < y + bheight; ++by)
+                    growx = data[by*width + x + bwidth] == 1;
+                int growy = y + bheight < height;
+                for (int bx = x; growy && bx < x + bwidth; ++bx)
+                    growy = data[(y + bheight)*width + bx] == 1;
+                if (growx && growy && data[(y + bheight)*width + x + bwidth] != 1)
+                    growy = 0;
+                if (!growx && !growy)
+                    break;
+                bwidth += growx;
+                bheight += growy;
+            }
+            for (int by = y; by < y + bheight; ++by)
+                for (int bx = x; bx < x + bwidth; ++bx)
+                    data[by*width+bx] = 2;
+            ++num_boxes;
+        }
+    }
+    free((void*)data);
+    return num_boxes;
+}
+
+struct CoverageContext
+{
+    int width;
+    int height;
+    uint8_t* coverage;
+    int num_boxes;
+};
+
+static void CoverBox(void* _ctx, int x, int y, int width, int height)
+{
+    CoverageContext* ctx = (CoverageContext*)_ctx;
+    for (int by = y; by < y + height; ++by)
+        for (int bx = x; bx < x + width; ++bx)
+            ctx->coverage[by * ctx->width + bx]++;
+    ctx->num_boxes++;
+}
+
+// Checks that the boxes cover each set texel exactly once, and that there are no more boxes than the greedy version
+static int CheckBoxes(int width, int height, uint8_t* data)
+{
+    CoverageContext ctx;
+    ctx.width = width;
+    ctx.height = height;
+    ctx.coverage = (uint8_t*)malloc((size_t)width * (size_t)height);
+    ctx.num_boxes = 0;
+    memset(ctx.coverage, 0, (size_t)width * (size_t)height);
+    apHullFindLargestBoxes(width, height, data, CoverBox, &ctx);
+
+    int result = 1;
+    for (int i = 0; i < width * height && result; ++i)
+    {
+        if (ctx.coverage[i] != (data[i] ? 1 : 0))
+        {
+            printf("Texel %d, %d is covered %d times\n", i % width, i / width, ctx.coverage[i]);
+            result = 0;
+        }
+    }
+    int num_greedy = GreedyCountBoxes(width, height, data);
+    if (result && ctx.num_boxes > num_greedy)
+    {
+        printf("%d boxes, greedy: %d\n", ctx.num_boxes, num_greedy);
+        result = 0;
+    }
+    free((void*)ctx.coverage);
+    return result;
+}
+
+TEST(HullBoxes, Simple)
+{
+    const int width = 6;
+    const int height = 6;
+    uint8_t data[width * height];
+
+    // A plus sign: 3 boxes
+    const char* plus =  "..##.."
+                        "..##.."
+                        "######"
+                        "######"
+                        "..##.."
+                        "..##..";
+    for (int i = 0; i < width * height; ++i)
+        data[i] = plus[i] == '#';
+    ASSERT_TRUE(CheckBoxes(width, height, data));
+    int num_vertices = 0;
+    apPosf* vertices = apHullFromImage(data, width, height, &num_vertices);
+    ASSERT_EQ(3 * 6, num_vertices);
+    free((void*)vertices);
+
+    // A frame: 4 boxes
+    const char* frame = "######"
+                        "######"
+                        "##..##"
+                        "##..##"
+                        "######"
+                        "######";
+    for (int i = 0; i < width * height; ++i)
+        data[i] = frame[i] == '#';
+    ASSERT_TRUE(CheckBoxes(width, height, data));
+    vertices = apHullFromImage(data, width, height, &num_vertices);
+    ASSERT_EQ(4 * 6, num_vertices);
+    free((void*)vertices);
+
+    // Empty
+    memset(data, 0, sizeof(data));
+    vertices = apHullFromImage(data, width, height, &num_vertices);
+    ASSERT_EQ((apPosf*)0, vertices);
+    ASSERT_EQ(0, num_vertices);
+
+    // Random masks, with different densities
+    srand(17);
+    const int size = 24;
+    uint8_t random_data[size * size];
+    for (int i = 0; i < 200; ++i)
+    {
+        int density = 20 + (i % 8) * 10;
+        for (int t = 0; t < size * size; ++t)
+            random_data[t] = (rand() % 100) < density;
+        ASSERT_TRUE(CheckBoxes(size, size, random_data));
+    }
+
+    // A large mask has many chords, and long augmenting paths
+    const int large_size = 512;
+    uint8_t* large_data = (uint8_t*)malloc(large_size * large_size);
+    for (int t = 0; t < large_size * large_size; ++t)
+        large_data[t] = (rand() % 100) < 60;
+    uint64_t tstart = GetTime();
+    ASSERT_TRUE(CheckBoxes(large_size, large_size, large_data));
+    uint64_t tend = GetTime();
+    printf("Boxes of a %d x %d mask took %.3f ms\n", large_size, large_size, (tend-tstart)/1000.0f);
+    free((void*)large_data);
+}
+
+static const char* box_files[] = {
+    "examples/spineboy/head.png",
+    "examples/spineboy/gun.png",
+    "examples/spineboy/torso.png",
+    "examples/spineboy/goggles.png",
+    "examples/spineboy/front-foot.png",
+    "examples/spineboy/crosshair.png",
+};
+
+TEST(HullBoxes, FindLargestBoxes)
+{
+    for (int f = 0; f < (int)(sizeof(box_files)/sizeof(box_files[0])); ++f)
+    {
+        Image* image = LoadImage(box_files[f]);
+        ASSERT_NE((Image*)0, image);
+
+        for (uint32_t tile_size = 4; tile_size <= 16; tile_size *= 2)
+        {
+            int twidth = 0;
+            int theight = 0;
+            uint8_t* timage = CreateTileImage(image, tile_size, 8, &twidth, &theight);
+            uint8_t* original = (uint8_t*)malloc((size_t)(twidth * theight));
+            memcpy(original, timage, (size_t)(twidth * theight));
+
+            CoverageContext ctx;
+            ctx.width = twidth;
+            ctx.height = theight;
+            ctx.coverage = (uint8_t*)malloc((size_t)(twidth * theight));
+            ctx.num_boxes = 0;
+            memset(ctx.coverage, 0, (size_t)(twidth * theight));
+
+            uint64_t tstart = GetTime();
+            apHullFindLargestBoxes(twidth, theight, timage, CoverBox, &ctx);
+            uint64_t tend = GetTime();
+
+            // The boxes cover each set tile exactly once, and the image is left intact
+            for (int i = 0; i < twidth * theight; ++i)
+            {
+                ASSERT_EQ(original[i] ? 1 : 0, ctx.coverage[i]);
+                ASSERT_EQ(original[i], timage[i]);
+            }
+
+            int num_greedy = GreedyCountBoxes(twidth, theight, timage);
+            ASSERT_LE(ctx.num_boxes, num_greedy);
+
+            int num_vertices = 0;
+            apPosf* vertices = apHullFromImage(timage, twidth, theight, &num_vertices);
+            ASSERT_EQ(ctx.num_boxes * 6, num_vertices);
+            free((void*)vertices);
+
+            printf("%s: tile size %u: %d boxes (greedy: %d). Took %.3f ms\n", box_files[f], tile_size,
+                    ctx.num_boxes, num_greedy, (tend-tstart)/1000.0f);
+
+            free((void*)ctx.coverage);
+            free((void*)original);
+            free((void*)timage);
+        }
+        DestroyImage(image);
+    }
+}
+
 struct StandaloneContext
 {
     int width;
@@ -0,0 +1,73 @@
+#include <memory.h>
+
+#define JC_TEST_USE_DEFAULT_MAIN
+#include <jc_test.h>
+
+extern "C" {
+#include <atlaspacker/atlaspacker.h>
+#include <atlaspacker/glyphcache.h>
+}
+
+TEST(GlyphCache, InsertFind)
+{
+    // Two slices of 128x64, each holding 8x4 glyphs of size 16x16
+    apGlyphCache* cache = apGlyphCacheCreate(128, 128, 2, 1024);
+
+    apRect rect;
+    ASSERT_EQ(0, apGlyphCacheFind(cache, 0, &rect));
+
+    for (uint64_t key = 0; key < 64; ++key)
+    {
+        ASSERT_EQ(1, apGlyphCacheInsert(cache, key, 16, 16, &rect));
+        ASSERT_EQ(key < 32 ? 0 : 64, rect.pos.y - (rect.pos.y % 64));
+    }
+
+    for (uint64_t key = 0; key < 64; ++key)
+    {
+        ASSERT_EQ(1, apGlyphCacheFind(cache, key, &rect));
+    }
+
+    apGlyphCacheStats stats;
+    apGlyphCacheGetStats(cache, &stats);
+    ASSERT_EQ(64u, stats.hits);
+    ASSERT_EQ(1u, stats.misses);
+    ASSERT_EQ(0u, stats.evictions);
+    ASSERT_EQ(64u, stats.num_glyphs);
+
+    // Mark the first slice as the most recently used, so the second slice is evicted
+    ASSERT_EQ(1, apGlyphCacheFind(cache, 0, &rect));
+    ASSERT_EQ(1, apGlyphCacheInsert(cache, 64, 16, 16, &rect));
+    ASSERT_EQ(64, rect.pos.y);
+
+    ASSERT_EQ(0, apGlyphCacheFind(cache, 32, &rect));
+    ASSERT_EQ(1, apGlyphCacheFind(cache, 1, &rect));
+    ASSERT_EQ(1, apGlyphCacheFind(cache, 64, &rect));
+
+    apGlyphCacheGetStats(cache, &stats);
+    ASSERT_EQ(32u, stats.evictions);
+    ASSERT_EQ(1u, stats.page_evictions);
+    ASSERT_EQ(33u, stats.num_glyphs);
+
+    // Too large for a slice
+    ASSERT_EQ(0, apGlyphCacheInsert(cache, 100, 16, 65, &rect));
+
+    apGlyphCacheDestroy(cache);
+}
+
+TEST(GlyphCache, MaxGlyphs)
+{
+    apGlyphCache* cache = apGlyphCacheCreate(256, 256, 4, 8);
+
+    apRect rect;
+    for (uint64_t key = 0; key < 1000; ++key)
+    {
+        ASSERT_EQ(1, apGlyphCacheInsert(cache, key * 7919, 8 + (int)(key % 8), 12, &rect));
+
+        apGlyphCacheStats stats;
+        apGlyphCacheGetStats(cache, &stats);
+        ASSERT_GE(8u, stats.num_glyphs);
+        ASSERT_EQ(1, apGlyphCacheFind(cache, key * 7919, &rect));
+    }
+
+    apGlyphCacheDestroy(cache);
+}
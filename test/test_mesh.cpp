@@ -0,0 +1,436 @@
+#include <memory.h>
+#include <math.h>
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test.h>
+
+extern "C" {
+#include <stb_wrappers.h>
+#include <atlaspacker/mesh.h>
+#include <atlaspacker/binpacker.h>
+#include <atlaspacker/tilepacker.h>
+#include "utils.h"
+}
+
+static float TriangleArea(apPosf a, apPosf b, apPosf c)
+{
+    return ((b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x)) * 0.5f;
+}
+
+// Checks the winding and the area of the triangles, and that no vertex lies inside an edge (i.e. no T-junctions)
+static int CheckMesh(const apMesh* mesh, const apPosf* triangles, int num_triangle_vertices)
+{
+    float expected_area = 0.0f;
+    for (int t = 0; t < num_triangle_vertices; t += 3)
+        expected_area += TriangleArea(triangles[t], triangles[t+1], triangles[t+2]);
+
+    float area = 0.0f;
+    for (int t = 0; t < mesh->num_indices; t += 3)
+    {
+        const uint16_t* indices = mesh->indices + t;
+        for (int i = 0; i < 3; ++i)
+        {
+            if (indices[i] >= mesh->num_vertices)
+            {
+                printf("Index %d out of range\n", indices[i]);
+                return 0;
+            }
+        }
+
+        apPosf a = mesh->vertices[indices[0]];
+        apPosf b = mesh->vertices[indices[1]];
+        apPosf c = mesh->vertices[indices[2]];
+        float triangle_area = TriangleArea(a, b, c);
+        if (triangle_area * expected_area <= 0.0f)
+        {
+            printf("Triangle %d has the wrong winding (%f)\n", t / 3, triangle_area);
+            return 0;
+        }
+        area += triangle_area;
+
+        apPosf edges[3][2] = { { a, b }, { b, c }, { c, a } };
+        for (int e = 0; e < 3; ++e)
+        {
+            apPosf p0 = edges[e][0];
+            apPosf p1 = edges[e][1];
+            for (int v = 0; v < mesh->num_vertices; ++v)
+            {
+                apPosf p = mesh->vertices[v];
+                float cross = (p1.x - p0.x) * (p.y - p0.y) - (p1.y - p0.y) * (p.x - p0.x);
+                float dot = (p1.x - p0.x) * (p.x - p0.x) + (p1.y - p0.y) * (p.y - p0.y);
+                float length_sq = (p1.x - p0.x) * (p1.x - p0.x) + (p1.y - p0.y) * (p1.y - p0.y);
+                if (cross == 0.0f && dot > 0.0f && dot < length_sq)
+                {
+                    printf("Vertex %d (%f, %f) is on the edge of triangle %d\n", v, p.x, p.y, t / 3);
+                    return 0;
+                }
+            }
+        }
+    }
+
+    if (fabsf(area - expected_area) > 0.001f * fabsf(expected_area))
+    {
+        printf("Area %f != %f\n", area, expected_area);
+        return 0;
+    }
+    return 1;
+}
+
+static void AddBox(apPosf* triangles, float x0, float y0, float x1, float y1)
+{
+    apPosf box[6] = { { x0, y0 }, { x1, y0 }, { x1, y1 }, { x0, y0 }, { x1, y1 }, { x0, y1 } };
+    memcpy(triangles, box, sizeof(box));
+}
+
+TEST(Mesh, Simple)
+{
+    // Two boxes sharing an edge
+    apPosf triangles[6 * 3];
+    AddBox(triangles + 0, 0, 0, 2, 2);
+    AddBox(triangles + 6, 2, 0, 4, 2);
+
+    apMesh mesh;
+    ASSERT_EQ(1, apMeshFromTriangles(triangles, 12, &mesh));
+    ASSERT_EQ(6, mesh.num_vertices);
+    ASSERT_EQ(12, mesh.num_indices);
+    ASSERT_TRUE(CheckMesh(&mesh, triangles, 12));
+    apMeshDestroy(&mesh);
+
+    // A smaller box next to a larger one: the corner of the smaller box is a T-junction
+    AddBox(triangles + 6, 2, 0, 3, 1);
+    ASSERT_EQ(1, apMeshFromTriangles(triangles, 12, &mesh));
+    ASSERT_EQ(7, mesh.num_vertices);
+    ASSERT_EQ(3 * 5, mesh.num_indices);
+    ASSERT_TRUE(CheckMesh(&mesh, triangles, 12));
+    apMeshDestroy(&mesh);
+
+    // Two small boxes below a wide box: T-junctions on two edges of the same triangle
+    AddBox(triangles + 0, 0, 0, 4, 2);
+    AddBox(triangles + 6, 0, 2, 1, 3);
+    AddBox(triangles + 12, 3, 2, 4, 3);
+    ASSERT_EQ(1, apMeshFromTriangles(triangles, 18, &mesh));
+    ASSERT_EQ(10, mesh.num_vertices);
+    ASSERT_TRUE(CheckMesh(&mesh, triangles, 18));
+    apMeshDestroy(&mesh);
+
+    // Degenerate triangles are removed
+    apPosf degenerate[6] = { { 0, 0 }, { 1, 1 }, { 2, 2 }, { 0, 0 }, { 0, 0 }, { 1, 0 } };
+    ASSERT_EQ(1, apMeshFromTriangles(degenerate, 6, &mesh));
+    ASSERT_EQ(0, mesh.num_indices);
+    apMeshDestroy(&mesh);
+
+    ASSERT_EQ(1, apMeshFromTriangles(0, 0, &mesh));
+    ASSERT_EQ(0, mesh.num_vertices);
+    ASSERT_EQ(0, mesh.num_indices);
+}
+
+static const char* spineboy_files[] = {
+    "examples/spineboy/eye-indifferent.png",
+    "examples/spineboy/goggles.png",
+    "examples/spineboy/gun.png",
+    "examples/spineboy/head.png",
+    "examples/spineboy/torso.png",
+    "examples/spineboy/front-foot.png",
+    "examples/spineboy/front-shin.png",
+    "examples/spineboy/rear-foot.png",
+    "examples/spineboy/mouth-smile.png",
+    "examples/spineboy/crosshair.png",
+};
+
+static void TestPackedMeshes(apPacker* packer)
+{
+    const int num_images = sizeof(spineboy_files)/sizeof(spineboy_files[0]);
+    Image* images[num_images];
+
+    apOptions options;
+    apSetDefaultOptions(&options);
+    apContext* ctx = apCreate(&options, packer);
+    for (int i = 0; i < num_images; ++i)
+    {
+        images[i] = LoadImage(spineboy_files[i]);
+        ASSERT_NE((Image*)0, images[i]);
+        apAddImage(ctx, images[i]->path, images[i]->width, images[i]->height, images[i]->channels, images[i]->data);
+    }
+    apPackImages(ctx);
+
+    uint64_t tstart = GetTime();
+    ASSERT_EQ(1, apCreateMeshes(ctx));
+    uint64_t tend = GetTime();
+
+    int num_triangle_vertices = 0;
+    int num_vertices = 0;
+    for (int p = 0; p < apGetNumPages(ctx); ++p)
+    {
+        apPage* page = apGetPage(ctx, p);
+        int page_vertices = 0;
+        int page_indices = 0;
+        for (apImage* image = apPageGetFirstImage(page); image; image = image->next)
+        {
+            // The image meshes are stored one after the other
+            ASSERT_EQ(page_vertices, image->mesh_first_vertex);
+            ASSERT_EQ(page_indices, image->mesh_first_index);
+            page_vertices += image->mesh_num_vertices;
+            page_indices += image->mesh_num_indices;
+
+            // The page indices include the first vertex of the image
+            ASSERT_TRUE(page->mesh.indices != 0);
+            uint16_t* indices = (uint16_t*)malloc(sizeof(uint16_t) * (size_t)(image->mesh_num_indices + 1));
+            for (int i = 0; i < image->mesh_num_indices; ++i)
+            {
+                int index = page->mesh.indices[image->mesh_first_index + i];
+                ASSERT_LE(image->mesh_first_vertex, index);
+                indices[i] = (uint16_t)(index - image->mesh_first_vertex);
+            }
+
+            apMesh mesh;
+            mesh.vertices = page->mesh.vertices + image->mesh_first_vertex;
+            mesh.num_vertices = image->mesh_num_vertices;
+            mesh.indices = indices;
+            mesh.num_indices = image->mesh_num_indices;
+            ASSERT_TRUE(CheckMesh(&mesh, image->vertices, image->num_vertices));
+            free((void*)indices);
+            ASSERT_LE(image->mesh_num_vertices, image->num_vertices);
+
+            num_triangle_vertices += image->num_vertices;
+            num_vertices += image->mesh_num_vertices;
+            if (image == page->last_image)
+                break;
+        }
+        ASSERT_EQ(page_vertices, page->mesh.num_vertices);
+        ASSERT_EQ(page_indices, page->mesh.num_indices);
+    }
+
+    printf("%s: %d triangle list vertices -> %d mesh vertices. Took %.3f ms\n", packer->packer_type,
+            num_triangle_vertices, num_vertices, (tend-tstart)/1000.0f);
+
+    // Recreating the meshes replaces the old ones
+    ASSERT_EQ(1, apCreateMeshes(ctx));
+
+    apDestroy(ctx);
+    for (int i = 0; i < num_images; ++i)
+        DestroyImage(images[i]);
+}
+
+TEST(Mesh, TilePacker)
+{
+    apTilePackerOptions packer_options;
+    apTilePackerSetDefaultOptions(&packer_options);
+    packer_options.tile_size = 8;
+    apPacker* packer = apTilePackerCreate(&packer_options);
+    TestPackedMeshes(packer);
+    apTilePackerDestroy(packer);
+}
+
+TEST(Mesh, BinPacker)
+{
+    apBinPackerOptions packer_options;
+    apBinPackerSetDefaultOptions(&packer_options);
+    apPacker* packer = apBinPackerCreate(&packer_options);
+    TestPackedMeshes(packer);
+    apBinPackerDestroy(packer);
+}
+
+// A triangle list of a grid with (n+1)*(n+1) unique vertices, covering the rect
+static apPosf* CreateGridTriangles(apRect rect, int n, int* num_vertices)
+{
+    apPosf* triangles = (apPosf*)malloc(sizeof(apPosf) * (size_t)(n * n * 6));
+    apPosf* p = triangles;
+    float sx = rect.size.width / (float)n;
+    float sy = rect.size.height / (float)n;
+    for (int y = 0; y < n; ++y)
+    {
+        for (int x = 0; x < n; ++x)
+        {
+            apPosf a = { rect.pos.x + x * sx, rect.pos.y + y * sy };
+            apPosf b = { a.x + sx, a.y };
+            apPosf c = { a.x + sx, a.y + sy };
+            apPosf d = { a.x, a.y + sy };
+            *p++ = a; *p++ = b; *p++ = c;
+            *p++ = a; *p++ = c; *p++ = d;
+        }
+    }
+    *num_vertices = n * n * 6;
+    return triangles;
+}
+
+TEST(Mesh, LargePage)
+{
+    apBinPackerOptions packer_options;
+    apBinPackerSetDefaultOptions(&packer_options);
+    apPacker* packer = apBinPackerCreate(&packer_options);
+
+    apOptions options;
+    apSetDefaultOptions(&options);
+    options.page_size = 512;
+    apContext* ctx = apCreate(&options, packer);
+    const int num_images = 4;
+    for (int i = 0; i < num_images; ++i)
+        apAddImage(ctx, "rect", 256, 256, 4, 0);
+    apPackImages(ctx);
+    ASSERT_EQ(1, apGetNumPages(ctx));
+
+    // More page vertices than 16 bit indices can address
+    const int n = 128;
+    for (int i = 0; i < num_images; ++i)
+    {
+        apImage* image = ctx->images[i];
+        free((void*)image->vertices);
+        image->vertices = CreateGridTriangles(image->placement, n, &image->num_vertices);
+    }
+    ASSERT_EQ(1, apCreateMeshes(ctx));
+
+    apPage* page = apGetPage(ctx, 0);
+    ASSERT_EQ(num_images * (n+1) * (n+1), page->mesh.num_vertices);
+    ASSERT_TRUE(page->mesh.indices == 0);
+    ASSERT_TRUE(page->mesh.indices32 != 0);
+
+    for (apImage* image = apPageGetFirstImage(page); image; image = image->next)
+    {
+        float area = 0.0f;
+        const uint32_t* indices = page->mesh.indices32 + image->mesh_first_index;
+        for (int i = 0; i < image->mesh_num_indices; i += 3)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                ASSERT_LE((uint32_t)image->mesh_first_vertex, indices[i + c]);
+                ASSERT_GT((uint32_t)(image->mesh_first_vertex + image->mesh_num_vertices), indices[i + c]);
+            }
+            apPosf* v = page->mesh.vertices;
+            area += TriangleArea(v[indices[i]], v[indices[i+1]], v[indices[i+2]]);
+        }
+        ASSERT_NEAR((float)(image->placement.size.width * image->placement.size.height), area, 1.0f);
+        if (image == page->last_image)
+            break;
+    }
+
+    apDestroy(ctx);
+    apBinPackerDestroy(packer);
+}
+
+// Checks the compact vertices against the page mesh
+static void CheckVertexFormats(apContext* ctx, int tolerance)
+{
+    const int scale = 1 << AP_VERTEX_FIXED_SHIFT;
+    for (int p = 0; p < apGetNumPages(ctx); ++p)
+    {
+        apPage* page = apGetPage(ctx, p);
+        apPosf pivot = { 0.0f, 0.0f };
+        apVertexPageU16* page_vertices = (apVertexPageU16*)malloc(sizeof(apVertexPageU16) * (size_t)page->mesh.num_vertices);
+        apVertexLocalS16* local_vertices = (apVertexLocalS16*)malloc(sizeof(apVertexLocalS16) * (size_t)page->mesh.num_vertices);
+        ASSERT_EQ(1, apMeshWritePageVertices(page, AP_VERTEX_FORMAT_PAGE_U16, pivot, page_vertices));
+        ASSERT_EQ(1, apMeshWritePageVertices(page, AP_VERTEX_FORMAT_LOCAL_S16, pivot, local_vertices));
+
+        for (int v = 0; v < page->mesh.num_vertices; ++v)
+        {
+            apPosf pos = page->mesh.vertices[v];
+            ASSERT_EQ((int)floorf(pos.x + 0.5f), page_vertices[v].x);
+            ASSERT_EQ((int)floorf(pos.y + 0.5f), page_vertices[v].y);
+            ASSERT_NEAR(pos.x / page->dimensions.width, page_vertices[v].u / 65535.0f, 1.0f / 65535.0f);
+            ASSERT_NEAR(pos.y / page->dimensions.height, page_vertices[v].v / 65535.0f, 1.0f / 65535.0f);
+            ASSERT_EQ(page_vertices[v].u, local_vertices[v].u);
+            ASSERT_EQ(page_vertices[v].v, local_vertices[v].v);
+        }
+
+        for (apImage* image = apPageGetFirstImage(page); image; image = image->next)
+        {
+            // The local positions are within the image (plus the tolerance)
+            float local_area = 0.0f;
+            float page_area = 0.0f;
+            const apVertexLocalS16* local = local_vertices;
+            const apPosf* positions = page->mesh.vertices;
+            for (int v = image->mesh_first_vertex; v < image->mesh_first_vertex + image->mesh_num_vertices; ++v)
+            {
+                ASSERT_LE(-tolerance * scale, local[v].x);
+                ASSERT_LE(-tolerance * scale, local[v].y);
+                ASSERT_GE((image->dimensions.width + tolerance) * scale, local[v].x);
+                ASSERT_GE((image->dimensions.height + tolerance) * scale, local[v].y);
+            }
+
+            // The mapping from the page is only rotated and/or mirrored
+            const uint16_t* indices = page->mesh.indices + image->mesh_first_index;
+            for (int i = 0; i < image->mesh_num_indices; i += 3)
+            {
+                apPosf l[3];
+                for (int c = 0; c < 3; ++c)
+                {
+                    l[c].x = local[indices[i + c]].x / (float)scale;
+                    l[c].y = local[indices[i + c]].y / (float)scale;
+                }
+                local_area += fabsf(TriangleArea(l[0], l[1], l[2]));
+                page_area += fabsf(TriangleArea(positions[indices[i]], positions[indices[i+1]], positions[indices[i+2]]));
+            }
+            ASSERT_NEAR(page_area, local_area, 0.001f * page_area);
+
+            if (image == page->last_image)
+                break;
+        }
+
+        // Relative to the center of each image
+        pivot.x = 0.5f;
+        pivot.y = 0.5f;
+        ASSERT_EQ(1, apMeshWritePageVertices(page, AP_VERTEX_FORMAT_LOCAL_S16, pivot, page_vertices));
+        for (apImage* image = apPageGetFirstImage(page); image; image = image->next)
+        {
+            const apVertexLocalS16* centered = (apVertexLocalS16*)page_vertices + image->mesh_first_vertex;
+            const apVertexLocalS16* local = local_vertices + image->mesh_first_vertex;
+            for (int v = 0; v < image->mesh_num_vertices; ++v)
+            {
+                ASSERT_EQ(local[v].x - image->dimensions.width * scale / 2, centered[v].x);
+                ASSERT_EQ(local[v].y - image->dimensions.height * scale / 2, centered[v].y);
+            }
+            if (image == page->last_image)
+                break;
+        }
+
+        free((void*)local_vertices);
+        free((void*)page_vertices);
+    }
+}
+
+static apContext* PackImages(apPacker* packer, Image** images, int num_images)
+{
+    apOptions options;
+    apSetDefaultOptions(&options);
+    apContext* ctx = apCreate(&options, packer);
+    for (int i = 0; i < num_images; ++i)
+        apAddImage(ctx, images[i]->path, images[i]->width, images[i]->height, images[i]->channels, images[i]->data);
+    apPackImages(ctx);
+    apCreateMeshes(ctx);
+    return ctx;
+}
+
+TEST(Mesh, VertexFormats)
+{
+    const int num_images = sizeof(spineboy_files)/sizeof(spineboy_files[0]);
+    Image* images[num_images];
+    for (int i = 0; i < num_images; ++i)
+        images[i] = LoadImage(spineboy_files[i]);
+
+    // The boxes are exactly the image rectangles
+    apBinPackerOptions bin_options;
+    apBinPackerSetDefaultOptions(&bin_options);
+    apPacker* packer = apBinPackerCreate(&bin_options);
+    apContext* ctx = PackImages(packer, images, num_images);
+    CheckVertexFormats(ctx, 0);
+    apDestroy(ctx);
+    apBinPackerDestroy(packer);
+
+    // The tiles may extend outside of the image
+    apTilePackerOptions tile_options;
+    apTilePackerSetDefaultOptions(&tile_options);
+    tile_options.flip = 1;
+    packer = apTilePackerCreate(&tile_options);
+    ctx = PackImages(packer, images, num_images);
+    CheckVertexFormats(ctx, tile_options.tile_size + tile_options.padding);
+    apDestroy(ctx);
+    apTilePackerDestroy(packer);
+
+    for (int i = 0; i < num_images; ++i)
+        DestroyImage(images[i]);
+}
+
+int main(int argc, char **argv)
+{
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
@@ -0,0 +1,121 @@
+#include <memory.h>
+#include <math.h>
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test.h>
+
+extern "C" {
+#include <atlaspacker/atlaspacker.h>
+#include <atlaspacker/overlap.h>
+#include "utils.h"
+}
+
+// A convex polygon, with the vertices on a circle
+static int CreatePolygon(apPosf* vertices, float cx, float cy, float radius, int num_vertices, int clockwise)
+{
+    float angles[16];
+    for (int i = 0; i < num_vertices; ++i)
+        angles[i] = (i + (rand() % 100) / 200.0f) * 2.0f * (float)M_PI / num_vertices;
+    for (int i = 0; i < num_vertices; ++i)
+    {
+        float angle = clockwise ? -angles[i] : angles[i];
+        vertices[i].x = cx + cosf(angle) * radius;
+        vertices[i].y = cy + sinf(angle) * radius;
+    }
+    return num_vertices;
+}
+
+TEST(Overlap, Simple)
+{
+    apOverlapBatch* batch = apOverlapBatchCreate();
+
+    apPosf box1[4] = { {0, 0}, {1, 0}, {1, 1}, {0, 1} };
+    apPosf box2[4] = { {1, 0}, {2, 0}, {2, 1}, {1, 1} };         // Touching box1
+    apPosf box3[4] = { {3, 0}, {4, 0}, {4, 1}, {3, 1} };
+    apPosf triangle[3] = { {2.2f, 2.2f}, {2.9f, 1.4f}, {2.9f, 2.2f} };   // Inside the bounding box of the query, but not overlapping
+    ASSERT_EQ(0, apOverlapBatchAdd(batch, box1, 4));
+    ASSERT_EQ(1, apOverlapBatchAdd(batch, box2, 4));
+    ASSERT_EQ(2, apOverlapBatchAdd(batch, box3, 4));
+    ASSERT_EQ(3, apOverlapBatchAdd(batch, triangle, 3));
+
+    apPosf query[3] = { {0.5f, 0.5f}, {3.5f, 0.5f}, {0.5f, 3.5f} };
+    uint8_t results[5];
+    ASSERT_EQ(3, apOverlapBatchTest(batch, query, 3, results));
+    ASSERT_EQ(1, results[0]);
+    ASSERT_EQ(1, results[1]);
+    ASSERT_EQ(1, results[2]);
+    ASSERT_EQ(0, results[3]);
+
+    ASSERT_EQ(2, apOverlapBatchTest(batch, box1, 4, results));
+    ASSERT_EQ(1, results[0]);
+    ASSERT_EQ(1, results[1]);
+    ASSERT_EQ(0, results[2]);
+    ASSERT_EQ(0, results[3]);
+
+    // Empty polygons are ignored
+    ASSERT_EQ(-1, apOverlapBatchAdd(batch, box1, 0));
+    ASSERT_EQ(0, apOverlapBatchTest(batch, box1, 0, results));
+    ASSERT_EQ(0, results[0]);
+    ASSERT_EQ(4, apOverlapBatchAdd(batch, box1, 4));
+
+    apOverlapBatchClear(batch);
+    ASSERT_EQ(0, apOverlapBatchTest(batch, box1, 4, results));
+
+    apOverlapBatchDestroy(batch);
+}
+
+TEST(Overlap, Random)
+{
+    const int num_polygons = 4000;
+    const int num_queries = 200;
+    apOverlapBatch* batch = apOverlapBatchCreate();
+
+    srand(3);
+    apPosf* polygons = (apPosf*)malloc(sizeof(apPosf) * 16 * num_polygons);
+    int* sizes = (int*)malloc(sizeof(int) * num_polygons);
+    for (int i = 0; i < num_polygons; ++i)
+    {
+        sizes[i] = CreatePolygon(polygons + i * 16, (float)(rand() % 2048), (float)(rand() % 2048), 4.0f + rand() % 60, 3 + rand() % 14, rand() & 1);
+        ASSERT_EQ(i, apOverlapBatchAdd(batch, polygons + i * 16, sizes[i]));
+    }
+
+    uint8_t* results = (uint8_t*)malloc(num_polygons);
+    uint64_t t_batch = 0;
+    uint64_t t_single = 0;
+    int num_overlaps = 0;
+    for (int q = 0; q < num_queries; ++q)
+    {
+        apPosf query[16];
+        int num_vertices = CreatePolygon(query, (float)(rand() % 2048), (float)(rand() % 2048), 8.0f + rand() % 120, 3 + rand() % 14, rand() & 1);
+
+        uint64_t tstart = GetTime();
+        int count = apOverlapBatchTest(batch, query, num_vertices, results);
+        t_batch += GetTime() - tstart;
+
+        tstart = GetTime();
+        int expected_count = 0;
+        for (int i = 0; i < num_polygons; ++i)
+        {
+            int overlap = apOverlapTest2D(query, num_vertices, polygons + i * 16, sizes[i]);
+            expected_count += overlap;
+            ASSERT_EQ(overlap, results[i]);
+        }
+        t_single += GetTime() - tstart;
+        ASSERT_EQ(expected_count, count);
+        num_overlaps += count;
+    }
+
+    printf("%d queries vs %d polygons: %d overlaps. Batched: %.3f ms, apOverlapTest2D: %.3f ms\n", num_queries, num_polygons,
+            num_overlaps, t_batch/1000.0f, t_single/1000.0f);
+
+    free((void*)results);
+    free((void*)sizes);
+    free((void*)polygons);
+    apOverlapBatchDestroy(batch);
+}
+
+int main(int argc, char **argv)
+{
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
@@ -0,0 +1,369 @@
+#include <memory.h>
+#include <stdlib.h>
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test.h>
+
+extern "C" {
+#include <stb_wrappers.h>
+#include <atlaspacker/atlaspacker.h>
+#include <atlaspacker/polypacker.h>
+#include <atlaspacker/tilepacker.h>
+#include "utils.h"
+}
+
+static int PointInTriangles(const apPosf* triangles, int num_vertices, float x, float y)
+{
+    for (int t = 0; t < num_vertices; t += 3)
+    {
+        const apPosf* tri = triangles + t;
+        float d0 = (tri[1].x - tri[0].x) * (y - tri[0].y) - (tri[1].y - tri[0].y) * (x - tri[0].x);
+        float d1 = (tri[2].x - tri[1].x) * (y - tri[1].y) - (tri[2].y - tri[1].y) * (x - tri[1].x);
+        float d2 = (tri[0].x - tri[2].x) * (y - tri[2].y) - (tri[0].y - tri[2].y) * (x - tri[2].x);
+        if ((d0 >= 0 && d1 >= 0 && d2 >= 0) || (d0 <= 0 && d1 <= 0 && d2 <= 0))
+            return 1;
+    }
+    return 0;
+}
+
+// Renders each image on its own, and checks that the rendered texels are within the page, within the outline
+// of the image (see apImage::vertices), and that no texel is written by more than one image.
+// Returns the number of rendered texels
+static int CheckPages(apContext* ctx)
+{
+    int num_texels = 0;
+    for (int p = 0; p < apGetNumPages(ctx); ++p)
+    {
+        apPage* page = apGetPage(ctx, p);
+        int width = page->dimensions.width;
+        int height = page->dimensions.height;
+        uint8_t* owners = (uint8_t*)malloc((size_t)width * (size_t)height);
+        uint8_t* texels = (uint8_t*)malloc((size_t)width * (size_t)height * 4);
+        memset(owners, 0, (size_t)width * (size_t)height);
+        memset(texels, 0, (size_t)width * (size_t)height * 4);
+
+        for (apImage* image = apPageGetFirstImage(page); image; image = image->next)
+        {
+            EXPECT_LE(0, image->placement.pos.x);
+            EXPECT_LE(0, image->placement.pos.y);
+            EXPECT_LE(image->placement.pos.x + image->placement.size.width, width);
+            EXPECT_LE(image->placement.pos.y + image->placement.size.height, height);
+            EXPECT_LT(0, image->num_vertices);
+
+            apRenderImage(texels, width, height, 4, image);
+
+            const apRect* r = &image->placement;
+            for (int y = r->pos.y; y < r->pos.y + r->size.height && y < height; ++y)
+            {
+                for (int x = r->pos.x; x < r->pos.x + r->size.width && x < width; ++x)
+                {
+                    uint8_t* texel = texels + (y * width + x) * 4;
+                    if (!texel[3])
+                        continue;
+                    texel[3] = 0;
+                    ++num_texels;
+
+                    if (owners[y * width + x])
+                    {
+                        printf("Image %s overlaps another image at %d, %d\n", image->path, x, y);
+                        free((void*)owners);
+                        free((void*)texels);
+                        return -1;
+                    }
+                    owners[y * width + x] = 1;
+
+                    if (!PointInTriangles(image->vertices, image->num_vertices, x + 0.5f, y + 0.5f))
+                    {
+                        printf("Texel %d, %d of image %s is outside of its outline\n", x, y, image->path);
+                        free((void*)owners);
+                        free((void*)texels);
+                        return -1;
+                    }
+                }
+            }
+            if (image == page->last_image)
+                break;
+        }
+        free((void*)owners);
+        free((void*)texels);
+    }
+    return num_texels;
+}
+
+// An L shape, with arms 'thickness' texels wide
+static Image* CreateLImage(const char* path, int size, int thickness)
+{
+    Image* image = CreateImage(path, 0xFF0000FF, size, size, 4);
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            if (x >= thickness && y >= thickness)
+                image->data[(y * size + x) * 4 + 3] = 0;
+        }
+    }
+    return image;
+}
+
+static apContext* PackLImages(apPacker* packer, int page_size, Image** images, int num_images)
+{
+    apOptions options;
+    apSetDefaultOptions(&options);
+    options.page_size = page_size;
+    apContext* ctx = apCreate(&options, packer);
+    for (int i = 0; i < num_images; ++i)
+        apAddImage(ctx, images[i]->path, images[i]->width, images[i]->height, images[i]->channels, images[i]->data);
+    apPackImages(ctx);
+    return ctx;
+}
+
+TEST(PolyPacker, Simple)
+{
+    const int num_images = 2;
+    Image* images[num_images];
+    images[0] = CreateLImage("l0", 64, 16);
+    images[1] = CreateLImage("l1", 64, 16);
+    const int num_texels = 2 * (64 * 16 + 48 * 16);
+
+    for (int no_rotate = 0; no_rotate < 2; ++no_rotate)
+    {
+        apPolyPackerOptions packer_options;
+        apPolyPackerSetDefaultOptions(&packer_options);
+        packer_options.no_rotate = no_rotate;
+        apPacker* packer = apPolyPackerCreate(&packer_options);
+
+        // The images are too large to fit next to each other, but the L shapes fit into each other
+        apContext* ctx = PackLImages(packer, 128, images, num_images);
+        ASSERT_EQ(1, apGetNumPages(ctx));
+        ASSERT_EQ(num_texels, CheckPages(ctx));
+
+        const apRect* a = &ctx->images[0]->placement;
+        const apRect* b = &ctx->images[1]->placement;
+        ASSERT_TRUE(a->pos.x < b->pos.x + b->size.width && b->pos.x < a->pos.x + a->size.width);
+        ASSERT_TRUE(a->pos.y < b->pos.y + b->size.height && b->pos.y < a->pos.y + a->size.height);
+        if (no_rotate)
+        {
+            // The second L is placed diagonally, in the corner of the first one (with the padding of both images in between)
+            ASSERT_EQ(a->pos.x + 16 + 2, b->pos.x);
+            ASSERT_EQ(a->pos.y + 16 + 2, b->pos.y);
+        }
+        apDestroy(ctx);
+
+        // Without any padding, the images fit next to each other. When rotated, the second L wraps around the corner of the first one
+        packer_options.padding = 0;
+        apPacker* packer_no_padding = apPolyPackerCreate(&packer_options);
+        ctx = PackLImages(packer_no_padding, 128, images, num_images);
+        ASSERT_EQ(1, apGetNumPages(ctx));
+        ASSERT_EQ(num_texels, CheckPages(ctx));
+        a = &ctx->images[0]->placement;
+        b = &ctx->images[1]->placement;
+        ASSERT_EQ(a->pos.y, b->pos.y);
+        ASSERT_EQ(a->pos.x + (no_rotate ? 64 : 16), b->pos.x);
+        apDestroy(ctx);
+
+        // A page that is too small for both images
+        ctx = PackLImages(packer, 70, images, num_images);
+        ASSERT_EQ(2, apGetNumPages(ctx));
+        ASSERT_EQ(num_texels, CheckPages(ctx));
+        apDestroy(ctx);
+
+        apPolyPackerDestroy(packer);
+        apPolyPackerDestroy(packer_no_padding);
+    }
+
+    // The mirrored shapes
+    apPolyPackerOptions packer_options;
+    apPolyPackerSetDefaultOptions(&packer_options);
+    packer_options.flip = 1;
+    apPacker* packer = apPolyPackerCreate(&packer_options);
+    apContext* ctx = PackLImages(packer, 128, images, num_images);
+    ASSERT_EQ(1, apGetNumPages(ctx));
+    ASSERT_EQ(num_texels, CheckPages(ctx));
+    apDestroy(ctx);
+    apPolyPackerDestroy(packer);
+
+    // A tiny time budget still gives a valid packing
+    packer_options.search_page_size = 1;
+    packer_options.time_budget = 1;
+    packer = apPolyPackerCreate(&packer_options);
+    ctx = PackLImages(packer, 0, images, num_images);
+    ASSERT_EQ(1, apGetNumPages(ctx));
+    ASSERT_EQ(num_texels, CheckPages(ctx));
+    apDestroy(ctx);
+    apPolyPackerDestroy(packer);
+
+    for (int i = 0; i < num_images; ++i)
+        DestroyImage(images[i]);
+}
+
+static const char* spineboy_files[] = {
+    "examples/spineboy/eye-indifferent.png",
+    "examples/spineboy/eye-surprised.png",
+    "examples/spineboy/front-bracer.png",
+    "examples/spineboy/front-fist-closed.png",
+    "examples/spineboy/front-fist-open.png",
+    "examples/spineboy/front-foot.png",
+    "examples/spineboy/front-shin.png",
+    "examples/spineboy/front-thigh.png",
+    "examples/spineboy/front-upper-arm.png",
+    "examples/spineboy/goggles.png",
+    "examples/spineboy/gun.png",
+    "examples/spineboy/head.png",
+    "examples/spineboy/hoverboard-board.png",
+    "examples/spineboy/hoverboard-thruster.png",
+    "examples/spineboy/mouth-grind.png",
+    "examples/spineboy/mouth-oooo.png",
+    "examples/spineboy/mouth-smile.png",
+    "examples/spineboy/neck.png",
+    "examples/spineboy/rear-foot.png",
+    "examples/spineboy/rear-shin.png",
+    "examples/spineboy/rear-thigh.png",
+    "examples/spineboy/rear-upper-arm.png",
+    "examples/spineboy/torso.png",
+    "examples/spineboy/crosshair.png",
+};
+
+static apContext* PackImages(apPacker* packer, apOptions* options, Image** images, int num_images)
+{
+    apContext* ctx = apCreate(options, packer);
+    for (int i = 0; i < num_images; ++i)
+        apAddImageToGroup(ctx, images[i]->path, images[i]->width, images[i]->height, images[i]->channels, images[i]->data, 0);
+    apPackImages(ctx);
+    return ctx;
+}
+
+static int64_t GetPagesArea(apContext* ctx)
+{
+    int64_t area = 0;
+    for (int p = 0; p < apGetNumPages(ctx); ++p)
+    {
+        apPage* page = apGetPage(ctx, p);
+        area += (int64_t)page->dimensions.width * page->dimensions.height;
+    }
+    return area;
+}
+
+TEST(PolyPacker, Spineboy)
+{
+    const int num_images = sizeof(spineboy_files)/sizeof(spineboy_files[0]);
+    Image* images[num_images];
+    int expected_texels = 0;
+    for (int i = 0; i < num_images; ++i)
+    {
+        images[i] = LoadImage(spineboy_files[i]);
+        ASSERT_NE((Image*)0, images[i]);
+        for (int t = 0; t < images[i]->width * images[i]->height; ++t)
+            expected_texels += images[i]->channels != 4 || images[i]->data[t * 4 + 3] != 0;
+    }
+    SortImages(images, num_images);
+
+    apOptions options;
+    apSetDefaultOptions(&options);
+    options.grow_policy = AP_GROW_FIXED_STEP;
+    options.grow_step = 32;
+    options.shrink_to_fit = 1;
+
+    // Reference: the tile packer, with the same padding
+    apTilePackerOptions tile_options;
+    apTilePackerSetDefaultOptions(&tile_options);
+    tile_options.tile_size = 8;
+    apPacker* tile_packer = apTilePackerCreate(&tile_options);
+    apContext* ctx = PackImages(tile_packer, &options, images, num_images);
+    int64_t tile_area = GetPagesArea(ctx);
+    apDestroy(ctx);
+    apTilePackerDestroy(tile_packer);
+
+    apPolyPackerOptions packer_options;
+    apPolyPackerSetDefaultOptions(&packer_options);
+    apPacker* packer = apPolyPackerCreate(&packer_options);
+
+    uint64_t tstart = GetTime();
+    ctx = PackImages(packer, &options, images, num_images);
+    uint64_t tend = GetTime();
+    uint64_t pack_time = tend - tstart;
+
+    ASSERT_EQ(1, apGetNumPages(ctx));
+    ASSERT_EQ(expected_texels, CheckPages(ctx));
+    int64_t area = GetPagesArea(ctx);
+    printf("Polygon packer: %lld texels (tile packer: %lld texels). Took %.2f ms\n", (long long)area, (long long)tile_area, (tend-tstart)/1000.0f);
+    ASSERT_LE(area, tile_area);
+
+    apDestroy(ctx);
+    apPolyPackerDestroy(packer);
+
+    // Search for a smaller page. Without a time budget, so that the areas can be compared,
+    // and with the smaller images only, to keep the test fast
+    const int num_search_images = num_images / 2;
+    Image** search_images = images + num_images - num_search_images;
+    int expected_search_texels = 0;
+    for (int i = 0; i < num_search_images; ++i)
+    {
+        for (int t = 0; t < search_images[i]->width * search_images[i]->height; ++t)
+            expected_search_texels += search_images[i]->channels != 4 || search_images[i]->data[t * 4 + 3] != 0;
+    }
+
+    packer = apPolyPackerCreate(&packer_options);
+    ctx = PackImages(packer, &options, search_images, num_search_images);
+    area = GetPagesArea(ctx);
+    apDestroy(ctx);
+    apPolyPackerDestroy(packer);
+
+    packer_options.search_page_size = 1;
+    packer = apPolyPackerCreate(&packer_options);
+    tstart = GetTime();
+    ctx = PackImages(packer, &options, search_images, num_search_images);
+    tend = GetTime();
+    ASSERT_EQ(1, apGetNumPages(ctx));
+    ASSERT_EQ(expected_search_texels, CheckPages(ctx));
+    int64_t search_area = GetPagesArea(ctx);
+    printf("Polygon packer (search): %lld texels (no search: %lld texels). Took %.2f ms\n", (long long)search_area, (long long)area, (tend-tstart)/1000.0f);
+    ASSERT_LE(search_area, area);
+    apDestroy(ctx);
+    apPolyPackerDestroy(packer);
+
+    // When the time runs out, the remaining images are still placed, in less time than the full packing
+    apPolyPackerSetDefaultOptions(&packer_options);
+    packer_options.search_page_size = 1;
+    packer_options.time_budget = 1;
+    packer = apPolyPackerCreate(&packer_options);
+    tstart = GetTime();
+    ctx = PackImages(packer, &options, images, num_images);
+    tend = GetTime();
+    ASSERT_EQ(expected_texels, CheckPages(ctx));
+    for (int i = 0; i < ctx->num_images; ++i)
+        ASSERT_LE(0, ctx->images[i]->page);
+    printf("Polygon packer (time budget): %lld texels. Took %.2f ms\n", (long long)GetPagesArea(ctx), (tend-tstart)/1000.0f);
+    ASSERT_LT(tend - tstart, pack_time);
+    apDestroy(ctx);
+    apPolyPackerDestroy(packer);
+
+    // Fixed page size, with groups
+    apPolyPackerSetDefaultOptions(&packer_options);
+    packer = apPolyPackerCreate(&packer_options);
+    options.page_size = 512;
+    options.shrink_to_fit = 0;
+    ctx = apCreate(&options, packer);
+    for (int i = 0; i < num_images; ++i)
+        apAddImageToGroup(ctx, images[i]->path, images[i]->width, images[i]->height, images[i]->channels, images[i]->data, 1 + i % 3);
+    apPackImages(ctx);
+    ASSERT_LT(1, apGetNumPages(ctx));
+    ASSERT_EQ(expected_texels, CheckPages(ctx));
+    for (int p = 0; p < apGetNumPages(ctx); ++p)
+    {
+        ASSERT_EQ(512, apGetPage(ctx, p)->dimensions.width);
+        ASSERT_EQ(512, apGetPage(ctx, p)->dimensions.height);
+    }
+    for (int i = 0; i < ctx->num_images; ++i)
+        ASSERT_LE(0, ctx->images[i]->page);
+    apDestroy(ctx);
+    apPolyPackerDestroy(packer);
+
+    for (int i = 0; i < num_images; ++i)
+        DestroyImage(images[i]);
+}
+
+int main(int argc, char **argv)
+{
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
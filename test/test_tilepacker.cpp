@@ -120,6 +120,243 @@ TEST(PackerTilePack, PackSmall) {
     }
 }
 
+// An opaque "L" shape, with a unique color
+static Image* CreateLShapeImage(int width, int height, int thickness, uint32_t color)
+{
+    Image* image = CreateImage("lshape.png", 0x00000000, width, height, 4);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            if (x >= thickness && y >= thickness)
+                continue;
+            uint8_t* texel = &image->data[(y * width + x) * 4];
+            texel[0] = (uint8_t)(color >> 0);
+            texel[1] = (uint8_t)(color >> 8);
+            texel[2] = (uint8_t)(color >> 16);
+            texel[3] = 255;
+        }
+    }
+    return image;
+}
+
+TEST(PackerTilePack, PackFlip) {
+    apTilePackerOptions packer_options;
+    apTilePackerSetDefaultOptions(&packer_options);
+    packer_options.flip = 1;
+    apPacker* packer = apTilePackerCreate(&packer_options);
+
+    apOptions options;
+    apSetDefaultOptions(&options);
+    apContext* ctx = apCreate(&options, packer);
+
+    const int num_images = 24;
+    Image* images[num_images];
+    for (int i = 0; i < num_images; ++i)
+    {
+        images[i] = CreateLShapeImage(40 + (i % 5) * 9, 70 - (i % 4) * 7, 16 + (i % 3) * 4, 0x102030 + (uint32_t)i * 0x050709);
+        apAddImage(ctx, images[i]->path, images[i]->width, images[i]->height, images[i]->channels, images[i]->data);
+    }
+
+    apPackImages(ctx);
+
+    // Render the page, and check that every texel ends up where the rotation and flip says
+    apPage* page = apGetPage(ctx, 0);
+    ASSERT_EQ(1, apGetNumPages(ctx));
+    int width = page->dimensions.width;
+    int height = page->dimensions.height;
+    uint8_t* output = (uint8_t*)malloc((size_t)(width * height * 4));
+    memset(output, 0, (size_t)(width * height * 4));
+    for (int i = 0; i < ctx->num_images; ++i)
+        apRenderImage(output, width, height, 4, ctx->images[i]);
+
+    int num_flipped = 0;
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        apImage* image = ctx->images[i];
+        num_flipped += image->flip;
+        for (int y = 0; y < image->height; ++y)
+        {
+            for (int x = 0; x < image->width; ++x)
+            {
+                const uint8_t* source = &image->data[(y * image->width + x) * 4];
+                if (source[3] == 0)
+                    continue;
+                apPos pos = apTransform(x, y, image->width, image->height, image->rotation, image->flip);
+                pos.x += image->placement.pos.x;
+                pos.y += image->placement.pos.y;
+                ASSERT_LT(pos.x, width);
+                ASSERT_LT(pos.y, height);
+                ASSERT_EQ(0, memcmp(source, &output[(pos.y * width + pos.x) * 4], 4));
+            }
+        }
+    }
+    printf("Flipped %d of %d images\n", num_flipped, ctx->num_images);
+    free((void*)output);
+
+    ASSERT_TRUE(DebugWriteOutput(ctx, "pack_tile_flip"));
+
+    apDestroy(ctx);
+
+    for (int i = 0; i < num_images; ++i)
+    {
+        DestroyImage(images[i]);
+    }
+}
+
+TEST(PackerTilePack, PackPaddingRotated) {
+    apTilePackerOptions packer_options;
+    apTilePackerSetDefaultOptions(&packer_options);
+    packer_options.padding = 2;
+    apPacker* packer = apTilePackerCreate(&packer_options);
+
+    apOptions options;
+    apSetDefaultOptions(&options);
+    options.page_size = 64;
+    apContext* ctx = apCreate(&options, packer);
+
+    // Opaque images that aren't a multiple of the tile size fill all their tiles,
+    // so the images must always be at least the padding apart.
+    // Each wide image fills the top half of a page, and the tall image only fits below it when rotated
+    const int num_images = 8;
+    const int tall_widths[] = { 21, 27, 17, 9 };
+    const int tall_heights[] = { 50, 45, 58, 40 };
+    Image* images[num_images];
+    for (int i = 0; i < num_images; ++i)
+    {
+        uint32_t color = 0xFF000000 | ((uint32_t)i * 0x050709);
+        if (i & 1)
+            images[i] = CreateImage("tall.png", color, tall_widths[i/2], tall_heights[i/2], 4);
+        else
+            images[i] = CreateImage("wide.png", color, 60 - i, 28, 4);
+        apAddImage(ctx, images[i]->path, images[i]->width, images[i]->height, images[i]->channels, images[i]->data);
+    }
+
+    apPackImages(ctx);
+
+    int padding = packer_options.padding;
+    int num_rotated = 0;
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        apImage* a = ctx->images[i];
+        apPage* page = apGetPage(ctx, a->page);
+        ASSERT_TRUE(page != 0);
+        ASSERT_LE(padding, a->placement.pos.x);
+        ASSERT_LE(padding, a->placement.pos.y);
+        ASSERT_GE(page->dimensions.width, a->placement.pos.x + a->placement.size.width + padding);
+        ASSERT_GE(page->dimensions.height, a->placement.pos.y + a->placement.size.height + padding);
+        num_rotated += a->rotation != 0;
+
+        for (int j = i + 1; j < ctx->num_images; ++j)
+        {
+            apImage* b = ctx->images[j];
+            if (a->page != b->page)
+                continue;
+            int overlap_x = a->placement.pos.x - padding < b->placement.pos.x + b->placement.size.width &&
+                            b->placement.pos.x < a->placement.pos.x + a->placement.size.width + padding;
+            int overlap_y = a->placement.pos.y - padding < b->placement.pos.y + b->placement.size.height &&
+                            b->placement.pos.y < a->placement.pos.y + a->placement.size.height + padding;
+            ASSERT_FALSE(overlap_x && overlap_y);
+        }
+    }
+    ASSERT_EQ(num_images/2, num_rotated);
+
+    apDestroy(ctx);
+
+    for (int i = 0; i < num_images; ++i)
+    {
+        DestroyImage(images[i]);
+    }
+}
+
+TEST(PackerTilePack, PackFlipOnly) {
+    apTilePackerOptions packer_options;
+    apTilePackerSetDefaultOptions(&packer_options);
+    packer_options.flip = 1;
+    packer_options.no_rotate = 1;
+    packer_options.padding = 0;
+    apPacker* packer = apTilePackerCreate(&packer_options);
+
+    apOptions options;
+    apSetDefaultOptions(&options);
+    options.page_size = 64;
+    apContext* ctx = apCreate(&options, packer);
+
+    // A full page, except for a mirrored "L" (i.e. a "J") in the bottom right corner
+    Image* image_a = CreateImage("a.png", 0xFFFFFFFF, 64, 64, 4);
+    for (int y = 0; y < 48; ++y)
+    {
+        for (int x = 32; x < 64; ++x)
+        {
+            if (y < 16 || x >= 48)
+                image_a->data[(y * 64 + x) * 4 + 3] = 0;
+        }
+    }
+    // An "L" that only fits the hole when mirrored
+    Image* image_b = CreateLShapeImage(32, 48, 16, 0x0000FF);
+
+    apAddImage(ctx, image_a->path, image_a->width, image_a->height, image_a->channels, image_a->data);
+    apImage* b = apAddImage(ctx, image_b->path, image_b->width, image_b->height, image_b->channels, image_b->data);
+
+    apPackImages(ctx);
+
+    ASSERT_EQ(1, apGetNumPages(ctx));
+    ASSERT_EQ(0, b->page);
+    ASSERT_EQ(0, b->rotation);
+    ASSERT_EQ(1, b->flip);
+    ASSERT_EQ(32, b->placement.pos.x);
+    ASSERT_EQ(0, b->placement.pos.y);
+
+    apDestroy(ctx);
+
+    DestroyImage(image_a);
+    DestroyImage(image_b);
+}
+
+TEST(PackerTilePack, SetTileImage) {
+    apTilePackerOptions packer_options;
+    apTilePackerSetDefaultOptions(&packer_options);
+    packer_options.no_rotate = 1;
+    packer_options.padding = 0;
+    apPacker* packer = apTilePackerCreate(&packer_options);
+
+    apOptions options;
+    apSetDefaultOptions(&options);
+    options.page_size = 64;
+    apContext* ctx = apCreate(&options, packer);
+
+    Image* image_a = CreateImage("a.png", 0xFFFFFFFF, 64, 64, 4);
+    Image* image_b = CreateImage("b.png", 0xFF0000FF, 32, 64, 4);
+    apImage* a = apAddImage(ctx, image_a->path, image_a->width, image_a->height, image_a->channels, image_a->data);
+    apImage* b = apAddImage(ctx, image_b->path, image_b->width, image_b->height, image_b->channels, image_b->data);
+
+    // The packer owns (and frees) the tile images. The second one replaces the first one,
+    // and only uses the left half of the image
+    uint8_t* timage = (uint8_t*)malloc(4*4);
+    memset(timage, 1, 4*4);
+    apTilePackerSetTileImage(packer, a, 4, 4, timage);
+
+    timage = (uint8_t*)malloc(4*4);
+    memset(timage, 0, 4*4);
+    for (int y = 0; y < 4; ++y)
+        timage[y*4+0] = timage[y*4+1] = 1;
+    apTilePackerSetTileImage(packer, a, 4, 4, timage);
+
+    apPackImages(ctx);
+
+    ASSERT_EQ(1, apGetNumPages(ctx));
+    ASSERT_EQ(0, a->page);
+    ASSERT_EQ(0, b->page);
+    ASSERT_EQ(0, a->placement.pos.x);
+    ASSERT_EQ(32, b->placement.pos.x);
+    ASSERT_EQ(0, b->placement.pos.y);
+
+    apDestroy(ctx);
+
+    DestroyImage(image_a);
+    DestroyImage(image_b);
+}
+
 // Sorted on size
 static const char* spineboy_files[] = {
 "examples/spineboy/rear-thigh.png",
@@ -204,6 +441,159 @@ TEST(PackerTilePack, PackSpineboyNoVertices) {
 }
 
 
+TEST(PackerTilePack, PackSpineboyMaxPageSize) {
+    const int num_images = sizeof(spineboy_files)/sizeof(spineboy_files[0]);
+
+    Image** images = new Image*[num_images];
+    for (int i = 0; i < num_images; ++i)
+    {
+        Image* image = LoadImage(spineboy_files[i]);
+        images[i] = image;
+    }
+
+    SortImages(images, num_images);
+
+    apTilePackerOptions packer_options;
+    apTilePackerSetDefaultOptions(&packer_options);
+    apPacker* packer = apTilePackerCreate(&packer_options);
+
+    apOptions options;
+    apSetDefaultOptions(&options);
+    // Not a multiple of the tile size
+    options.max_page_width = 500;
+    options.max_page_height = 500;
+    apContext* ctx = apCreate(&options, packer);
+
+    for (int i = 0; i < num_images; ++i)
+    {
+        Image* image = images[i];
+        apAddImage(ctx, image->path, image->width, image->height, image->channels, image->data);
+    }
+
+    apPackImages(ctx);
+
+    // The images spill over to new pages, instead of growing the first page
+    ASSERT_LT(1, apGetNumPages(ctx));
+    for (int i = 0; i < apGetNumPages(ctx); ++i)
+    {
+        apPage* page = apGetPage(ctx, i);
+        ASSERT_GE(500, page->dimensions.width);
+        ASSERT_GE(500, page->dimensions.height);
+    }
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        apImage* image = ctx->images[i];
+        apPage* page = apGetPage(ctx, image->page);
+        ASSERT_TRUE(page != 0);
+        ASSERT_GE(page->dimensions.width, image->placement.pos.x + image->placement.size.width);
+        ASSERT_GE(page->dimensions.height, image->placement.pos.y + image->placement.size.height);
+    }
+
+    ASSERT_TRUE(DebugWriteOutput(ctx, "pack_tile_spineboy_maxpagesize"));
+
+    apDestroy(ctx);
+
+    for (int i = 0; i < num_images; ++i)
+    {
+        DestroyImage(images[i]);
+    }
+    delete[] images;
+}
+
+
+TEST(PackerTilePack, PackSpineboyGroups) {
+    const int num_images = sizeof(spineboy_files)/sizeof(spineboy_files[0]);
+
+    Image** images = new Image*[num_images];
+    for (int i = 0; i < num_images; ++i)
+    {
+        Image* image = LoadImage(spineboy_files[i]);
+        images[i] = image;
+    }
+
+    SortImages(images, num_images);
+
+    apTilePackerOptions packer_options;
+    apTilePackerSetDefaultOptions(&packer_options);
+    apPacker* packer = apTilePackerCreate(&packer_options);
+
+    apOptions options;
+    apSetDefaultOptions(&options);
+    options.max_page_width = 512;
+    options.max_page_height = 512;
+    apContext* ctx = apCreate(&options, packer);
+
+    // Interleaved groups
+    const int num_groups = 8;
+    for (int i = 0; i < num_images; ++i)
+    {
+        Image* image = images[i];
+        apAddImageToGroup(ctx, image->path, image->width, image->height, image->channels, image->data, 1 + (i % num_groups));
+    }
+
+    apPackImages(ctx);
+
+    apStats stats;
+    apGetStats(ctx, &stats);
+    ASSERT_LT(1, stats.num_pages);
+    ASSERT_EQ(num_groups, stats.num_groups);
+    ASSERT_EQ(0, stats.num_split_groups);
+    for (int g = 1; g <= num_groups; ++g)
+    {
+        ASSERT_EQ(1, apGetGroupNumPages(ctx, g));
+    }
+
+    ASSERT_TRUE(DebugWriteOutput(ctx, "pack_tile_spineboy_groups"));
+
+    apDestroy(ctx);
+
+    for (int i = 0; i < num_images; ++i)
+    {
+        DestroyImage(images[i]);
+    }
+    delete[] images;
+}
+
+
+TEST(PackerTilePack, PackGroupNoEmptyPage) {
+    apTilePackerOptions packer_options;
+    apTilePackerSetDefaultOptions(&packer_options);
+    packer_options.padding = 0;
+    apPacker* packer = apTilePackerCreate(&packer_options);
+
+    apOptions options;
+    apSetDefaultOptions(&options);
+    options.page_size = 64;
+    apContext* ctx = apCreate(&options, packer);
+
+    // A group that never fits a page doesn't leave an empty page behind,
+    // when its images fit in the gaps of the previous pages
+    Image* large = CreateImage("large.png", 0xFFFFFFFF, 64, 48, 4);
+    Image* small = CreateImage("small.png", 0xFF0000FF, 64, 16, 4);
+    const int num_pages = 5;
+    for (int i = 0; i < num_pages; ++i)
+        apAddImage(ctx, large->path, large->width, large->height, large->channels, large->data);
+    for (int i = 0; i < num_pages; ++i)
+        apAddImageToGroup(ctx, small->path, small->width, small->height, small->channels, small->data, 1);
+
+    apPackImages(ctx);
+
+    ASSERT_EQ(num_pages, apGetNumPages(ctx));
+    for (int i = 0; i < num_pages; ++i)
+    {
+        ASSERT_TRUE(apGetPage(ctx, i)->first_image != 0);
+    }
+    for (int i = 0; i < ctx->num_images; ++i)
+    {
+        ASSERT_LE(0, ctx->images[i]->page);
+    }
+
+    apDestroy(ctx);
+
+    DestroyImage(large);
+    DestroyImage(small);
+}
+
 TEST(PackerTilePack, PackSpineboyVertices) {
     const int num_images = sizeof(spineboy_files)/sizeof(spineboy_files[0]);
 
@@ -305,6 +695,147 @@ TEST(PackerTilePack, PackSpineboyVertices) {
     }
 }
 
+// The previous version of apTilePackerCreateTileImageFromTriangles: a separating axis test per tile and triangle
+static void CreateTileImageFromTrianglesSAT(const apPosf* triangles, int num_vertices, int twidth, int theight, uint8_t* bytes)
+{
+    apPosf half = {0.5f, 0.5f};
+    apPosf tsize = {(float)twidth, (float)theight};
+    for (int y = 0; y < theight; ++y)
+    {
+        for (int x = 0; x < twidth; ++x)
+        {
+            apPosf corners[4] = { { (float)x, (float)y }, { (float)x + 1, (float)y }, { (float)x + 1, (float)y + 1 }, { (float)x, (float)y + 1 } };
+            bytes[y*twidth+x] = 0;
+            for (int t = 0; t < num_vertices; t += 3)
+            {
+                apPosf triangle[3];
+                for (int i = 0; i < 3; ++i)
+                    triangle[i] = apMathMul(apMathAdd(triangles[t+i], half), tsize);
+                if (apOverlapTest2D(triangle, 3, corners, 4))
+                {
+                    bytes[y*twidth+x] = 1;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Returns the number of tiles that are set, that aren't set in the reference. Returns -1 if any tile in the reference isn't set
+static int CompareTileImages(apImage* apimage, int tile_size, int twidth, int theight, const uint8_t* reference)
+{
+    uint8_t* image = apTilePackerDebugCreateImageFromTileImage(apimage, 0, tile_size);
+    int num_extra = 0;
+    for (int y = 0; y < theight; ++y)
+    {
+        for (int x = 0; x < twidth; ++x)
+        {
+            int set = image[(y * tile_size) * apimage->width + x * tile_size] != 0;
+            if (!set && reference[y*twidth+x])
+            {
+                free((void*)image);
+                return -1;
+            }
+            num_extra += set && !reference[y*twidth+x];
+        }
+    }
+    free((void*)image);
+    return num_extra;
+}
+
+TEST(PackerTilePack, TileImageFromTriangles)
+{
+    const int num_images = sizeof(spineboy_files)/sizeof(spineboy_files[0]);
+    const int tile_size = 8;
+
+    apTilePackerOptions packer_options;
+    apTilePackerSetDefaultOptions(&packer_options);
+    packer_options.tile_size = tile_size;
+    apPacker* packer = apTilePackerCreate(&packer_options);
+    apOptions options;
+    apSetDefaultOptions(&options);
+    apContext* ctx = apCreate(&options, packer);
+
+    Image** images = new Image*[num_images];
+    uint64_t t_raster = 0;
+    uint64_t t_sat = 0;
+    int num_tiles = 0;
+    int num_extra_tiles = 0;
+    srand(7);
+    for (int i = 0; i < num_images; ++i)
+    {
+        Image* image = LoadImage(spineboy_files[i]);
+        images[i] = image;
+        int twidth = apMathRoundUp(image->width, tile_size) / tile_size;
+        int theight = apMathRoundUp(image->height, tile_size) / tile_size;
+        uint8_t* reference = (uint8_t*)malloc((size_t)(twidth * theight));
+
+        for (int variant = 0; variant < 2; ++variant)
+        {
+            apImage* apimage = apAddImage(ctx, image->path, image->width, image->height, image->channels, image->data);
+
+            int num_vertices = 0;
+            apPosf* triangles = 0;
+            if (variant == 0)
+            {
+                // Triangulate a convex hull
+                uint8_t* hull_image = apCreateHullImage(image->data, (uint32_t)image->width, (uint32_t)image->height, (uint32_t)image->channels, 0);
+                int num_hull_vertices;
+                apPosf* vertices = apConvexHullFromImage(16, hull_image, image->width, image->height, &num_hull_vertices);
+                num_vertices = (num_hull_vertices - 2) * 3;
+                triangles = (apPosf*)malloc(sizeof(apPosf) * (size_t)num_vertices);
+                for (int t = 0; t < num_hull_vertices - 2; ++t)
+                {
+                    triangles[t*3+0] = vertices[0];
+                    triangles[t*3+1] = vertices[1+t+0];
+                    triangles[t*3+2] = vertices[1+t+1];
+                }
+                free((void*)vertices);
+                free((void*)hull_image);
+            }
+            else
+            {
+                // Random triangles, in either winding, partially outside of the image, and some degenerate ones
+                num_vertices = 8 * 3;
+                triangles = (apPosf*)malloc(sizeof(apPosf) * (size_t)num_vertices);
+                for (int v = 0; v < num_vertices; ++v)
+                {
+                    triangles[v].x = (rand() % 1300) / 1000.0f - 0.65f;
+                    triangles[v].y = (rand() % 1300) / 1000.0f - 0.65f;
+                }
+                triangles[2] = triangles[1];
+                triangles[5].x = (triangles[3].x + triangles[4].x) * 0.5f;
+                triangles[5].y = (triangles[3].y + triangles[4].y) * 0.5f;
+            }
+
+            uint64_t tstart = GetTime();
+            apTilePackerCreateTileImageFromTriangles(packer, apimage, triangles, num_vertices);
+            t_raster += GetTime() - tstart;
+
+            tstart = GetTime();
+            CreateTileImageFromTrianglesSAT(triangles, num_vertices, twidth, theight, reference);
+            t_sat += GetTime() - tstart;
+
+            // The new tile images are the same, or more conservative
+            int num_extra = CompareTileImages(apimage, tile_size, twidth, theight, reference);
+            ASSERT_LE(0, num_extra);
+            num_extra_tiles += num_extra;
+            num_tiles += twidth * theight;
+
+            free((void*)triangles);
+        }
+        free((void*)reference);
+    }
+
+    printf("Rasterizing took %.3f ms, the SAT tests took %.3f ms. %d extra tiles out of %d\n", t_raster/1000.0f, t_sat/1000.0f, num_extra_tiles, num_tiles);
+
+    apDestroy(ctx);
+    apTilePackerDestroy(packer);
+    for (int i = 0; i < num_images; ++i)
+        DestroyImage(images[i]);
+    delete[] images;
+}
+
 static int IsImageSuffix(const char* suffix)
 {
     return strcmp(suffix, ".png") == 0 || strcmp(suffix, ".PNG") == 0;
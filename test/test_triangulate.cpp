@@ -0,0 +1,218 @@
+#include <memory.h>
+#include <math.h>
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test.h>
+
+extern "C" {
+#include <stb_wrappers.h>
+#include <atlaspacker/contour.h>
+#include <atlaspacker/triangulate.h>
+#include "utils.h"
+}
+
+static float PolygonArea(const apPosf* vertices, int num_vertices)
+{
+    float area = 0.0f;
+    for (int i = 0; i < num_vertices; ++i)
+    {
+        const apPosf& a = vertices[i];
+        const apPosf& b = vertices[(i+1) % num_vertices];
+        area += a.x * b.y - b.x * a.y;
+    }
+    return area * 0.5f;
+}
+
+static float TriangleArea(const apPosf* vertices, const int* indices)
+{
+    apPosf t[3] = { vertices[indices[0]], vertices[indices[1]], vertices[indices[2]] };
+    return PolygonArea(t, 3);
+}
+
+// Checks that all triangles have the expected winding, and that they add up to the expected area
+static int CheckTriangles(const apPosf* vertices, const int* indices, int num_triangles, float expected_area)
+{
+    float area = 0.0f;
+    for (int t = 0; t < num_triangles; ++t)
+    {
+        float triangle_area = TriangleArea(vertices, indices + t * 3);
+        if (triangle_area * expected_area < 0.0f)
+        {
+            printf("Triangle %d has the wrong winding (%f)\n", t, triangle_area);
+            return 0;
+        }
+        area += triangle_area;
+    }
+    if (fabsf(area - expected_area) > 0.001f * fabsf(expected_area))
+    {
+        printf("Area %f != %f\n", area, expected_area);
+        return 0;
+    }
+    return 1;
+}
+
+TEST(Triangulate, Simple)
+{
+    // Square, in both windings
+    apPosf square[] = { {0, 0}, {4, 0}, {4, 4}, {0, 4} };
+    int sizes[] = { 4 };
+    int* indices = 0;
+    int num_triangles = apTriangulate(square, sizes, 1, &indices);
+    ASSERT_EQ(2, num_triangles);
+    ASSERT_TRUE(CheckTriangles(square, indices, num_triangles, 16.0f));
+    free((void*)indices);
+
+    apPosf square_cw[] = { {0, 0}, {0, 4}, {4, 4}, {4, 0} };
+    num_triangles = apTriangulate(square_cw, sizes, 1, &indices);
+    ASSERT_EQ(2, num_triangles);
+    ASSERT_TRUE(CheckTriangles(square_cw, indices, num_triangles, -16.0f));
+    free((void*)indices);
+
+    // A comb (concave)
+    apPosf comb[] = { {0, 0}, {10, 0}, {10, 6}, {9, 6}, {9, 2}, {7, 2}, {7, 6}, {6, 6}, {6, 2}, {4, 2}, {4, 6}, {3, 6}, {3, 2}, {1, 2}, {1, 6}, {0, 6} };
+    int comb_size = (int)(sizeof(comb)/sizeof(comb[0]));
+    num_triangles = apTriangulate(comb, &comb_size, 1, &indices);
+    ASSERT_EQ(comb_size - 2, num_triangles);
+    ASSERT_TRUE(CheckTriangles(comb, indices, num_triangles, PolygonArea(comb, comb_size)));
+    free((void*)indices);
+
+    // A square with two holes (with the opposite winding)
+    apPosf holes[] = { {0, 0}, {10, 0}, {10, 10}, {0, 10},
+                       {1, 1}, {1, 4}, {4, 4}, {4, 1},
+                       {6, 6}, {6, 9}, {9, 9}, {9, 6} };
+    int hole_sizes[] = { 4, 4, 4 };
+    num_triangles = apTriangulate(holes, hole_sizes, 3, &indices);
+    ASSERT_EQ(12 + 2*2 - 2, num_triangles);
+    ASSERT_TRUE(CheckTriangles(holes, indices, num_triangles, 100.0f - 9.0f - 9.0f));
+    free((void*)indices);
+
+    // Degenerate
+    apPosf line[] = { {0, 0}, {1, 1}, {2, 2} };
+    int line_size = 3;
+    num_triangles = apTriangulate(line, &line_size, 1, &indices);
+    ASSERT_EQ(0, num_triangles);
+    free((void*)indices);
+}
+
+TEST(Triangulate, OrphanHole)
+{
+    // The outer contour has a negative area (see apContourFromImage), and the holes a positive one
+    apPosf outer[] = { {0, 0}, {0, 4}, {4, 4}, {4, 0} };
+    apPosf hole[] = { {1, 1}, {3, 1}, {3, 3}, {1, 3} };
+    apPosf outside[] = { {10, 10}, {12, 10}, {12, 12}, {10, 12} };
+    apContour contours[3];
+    contours[0].vertices = outer;
+    contours[0].num_vertices = 4;
+    contours[0].parent = -1;
+    // Holes without a parent are skipped, instead of being filled as outer contours
+    contours[1].vertices = hole;
+    contours[1].num_vertices = 4;
+    contours[1].parent = -1;
+    contours[2].vertices = outside;
+    contours[2].num_vertices = 4;
+    contours[2].parent = -1;
+
+    apPosf* vertices = 0;
+    int num_vertices = 0;
+    int* indices = 0;
+    int num_triangles = apTriangulateContours(contours, 3, &vertices, &num_vertices, &indices);
+    ASSERT_EQ(2, num_triangles);
+    ASSERT_EQ(4, num_vertices);
+    ASSERT_TRUE(CheckTriangles(vertices, indices, num_triangles, -16.0f));
+    free((void*)vertices);
+    free((void*)indices);
+}
+
+static const char* image_files[] = {
+    "examples/contour/square_hollow.png",
+    "examples/contour/f.png",
+    "examples/contour/lines.png",
+    "examples/spineboy/head.png",
+    "examples/spineboy/gun.png",
+    "examples/spineboy/torso.png",
+};
+
+TEST(Triangulate, Contours)
+{
+    for (int f = 0; f < (int)(sizeof(image_files)/sizeof(image_files[0])); ++f)
+    {
+        Image* image = LoadImage(image_files[f]);
+        ASSERT_NE((Image*)0, image);
+        uint8_t* mask = CreateMask(image);
+
+        apContour* contours = 0;
+        int num_contours = apContourFromImage(mask, image->width, image->height, &contours);
+        ASSERT_LT(0, num_contours);
+
+        for (int simplify = 0; simplify < 2; ++simplify)
+        {
+            if (simplify)
+                apContourSimplify(contours, num_contours, mask, image->width, image->height, 1.5f);
+
+            float expected_area = 0.0f;
+            int num_outlines = 0;
+            for (int i = 0; i < num_contours; ++i)
+            {
+                expected_area += PolygonArea(contours[i].vertices, contours[i].num_vertices);
+                num_outlines += contours[i].parent < 0 ? 1 : 0;
+            }
+
+            const int num_iterations = 100;
+            uint64_t tstart = GetTime();
+            apPosf* vertices = 0;
+            int num_vertices = 0;
+            int* indices = 0;
+            int num_triangles = 0;
+            for (int i = 0; i < num_iterations; ++i)
+            {
+                free((void*)vertices);
+                free((void*)indices);
+                num_triangles = apTriangulateContours(contours, num_contours, &vertices, &num_vertices, &indices);
+            }
+            uint64_t tend = GetTime();
+
+            ASSERT_LT(0, num_triangles);
+            if (!simplify)
+                ASSERT_TRUE(CheckTriangles(vertices, indices, num_triangles, expected_area));
+
+            // The triangles cover all non empty texels
+            apPosf* triangles = apTriangulateExpand(vertices, indices, num_triangles);
+            for (int y = 0; y < image->height; ++y)
+            {
+                for (int x = 0; x < image->width; ++x)
+                {
+                    if (!mask[y * image->width + x])
+                        continue;
+                    apPosf p = { x + 0.5f, y + 0.5f };
+                    int covered = 0;
+                    for (int t = 0; t < num_triangles && !covered; ++t)
+                    {
+                        const apPosf* tri = triangles + t * 3;
+                        float d0 = (tri[1].x - tri[0].x) * (p.y - tri[0].y) - (tri[1].y - tri[0].y) * (p.x - tri[0].x);
+                        float d1 = (tri[2].x - tri[1].x) * (p.y - tri[1].y) - (tri[2].y - tri[1].y) * (p.x - tri[1].x);
+                        float d2 = (tri[0].x - tri[2].x) * (p.y - tri[2].y) - (tri[0].y - tri[2].y) * (p.x - tri[2].x);
+                        covered = (d0 <= 0 && d1 <= 0 && d2 <= 0) || (d0 >= 0 && d1 >= 0 && d2 >= 0);
+                    }
+                    ASSERT_TRUE(covered);
+                }
+            }
+            free((void*)triangles);
+
+            printf("%s: %d outlines, %d vertices, %d triangles%s. %.1f outlines / ms\n", image_files[f], num_outlines, num_vertices,
+                    num_triangles, simplify ? " (simplified)" : "", (num_outlines * num_iterations) / ((tend-tstart)/1000.0f));
+
+            free((void*)vertices);
+            free((void*)indices);
+        }
+
+        apContourDestroy(contours, num_contours);
+        free((void*)mask);
+        DestroyImage(image);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
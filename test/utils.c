@@ -1,3 +1,5 @@
+#define _POSIX_C_SOURCE 200809L // strdup
+
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h> // qsort
@@ -38,7 +40,7 @@ Image* CreateImage(const char* path, uint32_t color, int w, int h, int c)
             *p++ = (color >> (j*8)) & 0xFF;
         }
     }
-    image->path = path;
+    image->path = strdup(path);
     return image;
 }
 
@@ -135,7 +137,7 @@ int DebugWriteOutput(apContext* ctx, const char* pattern)
 
         int width = page->dimensions.width;
         int height = page->dimensions.height;
-        int channels = ctx->num_channels;
+        int channels = page->num_channels;
 
         uint32_t size = width * height * channels;
         uint8_t* output = (uint8_t*)malloc(size);
@@ -174,9 +176,7 @@ int DebugWriteOutput(apContext* ctx, const char* pattern)
         apImage* image = apPageGetFirstImage(page);
         while(image)
         {
-            apCopyRGBA(output, width, height, channels,
-                    image->data, image->width, image->height, image->channels,
-                    image->placement.pos.x, image->placement.pos.y, image->rotation);
+            apRenderImage(output, width, height, channels, image);
 
             apSize size = { image->width, image->height };
             DrawTriangles(width, height, channels, output,
@@ -337,3 +337,23 @@ uint8_t* CreateTileImage(Image* image, uint32_t tile_size, int alphathreshold, i
     ConvertImageToTiles(tile_size, alphathreshold, image->width, image->height, image->channels, image->data, *twidth, *theight, timage);
     return timage;
 }
+
+// Non empty texels are 1
+uint8_t* CreateMask(const Image* image)
+{
+    uint8_t* mask = (uint8_t*)malloc((size_t)(image->width * image->height));
+    for (int i = 0; i < image->width * image->height; ++i)
+    {
+        const uint8_t* texel = image->data + i * image->channels;
+        int set = 0;
+        if (image->channels == 4)
+            set = texel[3] != 0;
+        else
+        {
+            for (int c = 0; c < image->channels; ++c)
+                set |= texel[c];
+        }
+        mask[i] = set ? 1 : 0;
+    }
+    return mask;
+}
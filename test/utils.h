@@ -21,6 +21,8 @@ Image*      CreateImage(const char* path, uint32_t color, int w, int h, int c);
 Image*      LoadImage(const char* path);
 void        DestroyImage(Image* image);
 uint8_t*    CreateTileImage(Image* image, uint32_t tile_size, int alphathreshold, int* twidth, int* theight);
+// Non empty texels are 1, the others 0
+uint8_t*    CreateMask(const Image* image);
 
 void    SortImages(Image** images, int num_images);
 int     DebugWriteOutput(apContext* ctx, const char* pattern);